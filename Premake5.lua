@@ -19,8 +19,36 @@ local rootDir = path.getabsolute(_WORKING_DIR)
 
 -- Get all the directories in our projects directory
 local projects = os.matchdirs(rootDir .. "/projects/*")
-local modules = os.matchdirs(rootDir .. "/modules/*")
+local moduleDirs = os.matchdirs(rootDir .. "/modules/*")
 local sampleGroups = os.matchdirs(rootDir .. "/samples/*")
+local tools = os.matchdirs(rootDir .. "/tools/*")
+
+-- Modules with only an include folder are header-only (ex: file formats shared between modules). They don't get a
+-- project and aren't linked, but their headers are visible to every module and project
+function IsHeaderOnlyModule(folderName)
+	if not os.isdir(path.join(folderName, "include")) then
+		return false
+	end
+	if os.isfile(path.join(folderName, "premake.lua")) or os.isfile(path.join(folderName, "premake5.lua")) then
+		return false
+	end
+	for k, v in pairs({ "src", "libs", "res", "dll" }) do
+		if os.isdir(path.join(folderName, v)) then
+			return false
+		end
+	end
+	return true
+end
+
+local modules = {}
+local headerOnlyModules = {}
+for k, v in pairs(moduleDirs) do
+	if IsHeaderOnlyModule(v) then
+		table.insert(headerOnlyModules, v)
+	else
+		table.insert(modules, v)
+	end
+end
 
 -- Select the last item in the project directory to be our startup project 
 -- (this is easily changed in VS, this is just to be handy)
@@ -237,6 +265,12 @@ if not os.isdir(path.join(rootDir, "shared_assets", "res")) then
 	os.mkdir(path.join(rootDir, "shared_assets", "res"))
 end
 
+-- Header-only modules are added before the other modules are generated, so that modules can include them
+for k, v in pairs(headerOnlyModules) do
+	premake.info("Adding header-only module: " .. path.getrelative(rootDir, v))
+	table.insert(ProjIncludes, path.join(path.getrelative(rootDir, v), "include"))
+end
+
 -- Generate the modules
 group("Modules")
 
@@ -392,8 +426,9 @@ function AddProjects(groupName, folders)
 
 end
 
--- Add the User Projects and Sample Projects
+-- Add the User Projects, Tools and Sample Projects
 AddProjects("Projects", projects)
+AddProjects("Tools", tools)
 
 for k, proj in pairs(sampleGroups) do
 	local name = path.getbasename(proj);
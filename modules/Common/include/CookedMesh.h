@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// The layout of cooked mesh files (.otmesh). These are written and read by the graphics module's MeshCooker and by
+// NOU's glTF loader, so the format lives in this header-only module where both of them can include it.
+//
+// A file starts with a CookedMeshHeader, followed by a CookedAttribute for every attribute in the layout and a
+// CookedDrawRange for every range, then the vertex and index sections, which start on COOKED_MESH_SECTION_ALIGNMENT
+// byte boundaries
+
+struct CookedMeshHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t Key;
+	// The size of the whole file, so that truncated files can be caught before we read past the end of them
+	uint64_t FileSize;
+	float    Dequantization[16];
+	// The model space bounding sphere of the mesh (see MeshLodSet::SetBounds)
+	float    BoundsCenter[3];
+	float    BoundsRadius;
+	uint32_t Stride;
+	uint32_t AttributeCount;
+	uint32_t RangeCount;
+	// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	uint32_t IndexType;
+	uint64_t VertexCount;
+	uint64_t IndexCount;
+	// The offsets of the vertex and index sections from the start of the file
+	uint64_t VertexOffset;
+	uint64_t IndexOffset;
+};
+static_assert(sizeof(CookedMeshHeader) == 152, "CookedMeshHeader should not have any padding");
+
+// A vertex attribute with fixed size fields, the stride is stored once in the header
+struct CookedAttribute
+{
+	uint32_t Slot;
+	uint32_t Size;
+	uint32_t Type;
+	uint32_t Normalized;
+	uint32_t Offset;
+	// The graphics module's AttribUsage
+	uint32_t Usage;
+};
+
+// A range of the index section to draw with it's own base vertex, used for meshes that were split to fit 16 bit indices
+struct CookedDrawRange
+{
+	uint32_t FirstIndex;
+	int32_t  IndexCount;
+	int32_t  BaseVertex;
+};
+
+constexpr uint32_t    COOKED_MESH_MAGIC   = 0x48534D4F; // "OMSH"
+// Bump this whenever the format or the way meshes are built changes, so that old cooked files are re-cooked
+constexpr uint32_t    COOKED_MESH_VERSION = 3;
+// The vertex and index sections are aligned to this, so the mapped pointers are suitably aligned for the driver to copy from
+constexpr size_t      COOKED_MESH_SECTION_ALIGNMENT = 64;
+constexpr const char* COOKED_MESH_DIRECTORY = "cache/meshes";
+constexpr const char* COOKED_MESH_EXTENSION = ".otmesh";
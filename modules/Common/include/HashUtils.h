@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// 64 bit FNV-1a, continuing from the given hash so that multiple values can be combined into one key
+inline uint64_t HashFnv1a64(const void* data, size_t length, uint64_t hash = 14695981039346656037ull) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t ix = 0; ix < length; ix++) {
+		hash = (hash ^ bytes[ix]) * 1099511628211ull;
+	}
+	return hash;
+}
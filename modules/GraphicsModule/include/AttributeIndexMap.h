@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GLM/glm.hpp>
+
+/// <summary>
+/// Maps OBJ style position/UV/normal index triples to vertex indices, so that corners that share all of their
+/// attributes can share a vertex. Full 32 bit indices are used for each attribute, so large models never alias.
+///
+/// This is an open addressing table with linear probing, and nothing is allocated per entry. Each part of the key and
+/// the values are stored in separate arrays, so probing mostly walks over positions, and only reads the UV and normal
+/// of slots where the position matches. Positions are 1-based in OBJ files, so a position of 0 marks an empty slot,
+/// and can't be used as a key
+/// </summary>
+class AttributeIndexMap final
+{
+public:
+	/// <summary>
+	/// Creates a new map with room for the given number of entries before it needs to grow
+	/// </summary>
+	/// <param name="expectedCount">The number of unique keys we expect to add</param>
+	explicit AttributeIndexMap(size_t expectedCount = 0);
+	~AttributeIndexMap() = default;
+
+	/// <summary>
+	/// Hashes an attribute triple, the low bits depend on all of the inputs so they can be used to pick a slot
+	/// </summary>
+	static inline uint32_t Hash(int32_t position, int32_t uv, int32_t normal) {
+		uint32_t hash = static_cast<uint32_t>(position) * 0x9E3779B1u;
+		hash ^= static_cast<uint32_t>(uv) * 0x85EBCA77u;
+		hash ^= static_cast<uint32_t>(normal) * 0xC2B2AE3Du;
+		// Finalizer from murmur3
+		hash ^= hash >> 16;
+		hash *= 0x85EBCA6Bu;
+		hash ^= hash >> 13;
+		hash *= 0xC2B2AE35u;
+		hash ^= hash >> 16;
+		return hash;
+	}
+
+	/// <summary>
+	/// Looks up the value for a key, adding the key with the given value if it isn't in the map yet
+	/// </summary>
+	/// <param name="key">The 1-based position, UV and normal indices, the position must not be 0</param>
+	/// <param name="value">The value to add if the key is missing</param>
+	/// <param name="result">Set to the value stored for the key</param>
+	/// <returns>True if the key was added, false if it was already in the map</returns>
+	inline bool FindOrAdd(const glm::ivec3& key, uint32_t value, uint32_t& result) {
+		if ((_count + 1) * 2 > _positions.size()) {
+			_Grow();
+		}
+		const size_t mask = _positions.size() - 1;
+		for (size_t slot = Hash(key.x, key.y, key.z) & mask; ; slot = (slot + 1) & mask) {
+			const int32_t position = _positions[slot];
+			if (position == 0) {
+				_positions[slot] = key.x;
+				_uvs[slot] = key.y;
+				_normals[slot] = key.z;
+				_values[slot] = value;
+				_count++;
+				result = value;
+				return true;
+			}
+			if (position == key.x && _uvs[slot] == key.y && _normals[slot] == key.z) {
+				result = _values[slot];
+				return false;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Gets the number of keys in the map
+	/// </summary>
+	size_t GetCount() const { return _count; }
+
+protected:
+	std::vector<int32_t>  _positions;
+	std::vector<int32_t>  _uvs;
+	std::vector<int32_t>  _normals;
+	std::vector<uint32_t> _values;
+	size_t                _count;
+
+	// Doubles the number of slots and re-inserts everything, keeping the table at most half full
+	void _Grow();
+};
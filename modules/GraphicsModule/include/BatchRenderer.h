@@ -0,0 +1,131 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "ShaderMaterial.h"
+#include "VertexArrayObject.h"
+#include "StreamingBuffer.h"
+
+/// <summary>
+/// The layout of a single command in a GL_DRAW_INDIRECT_BUFFER, as expected by glMultiDrawElementsIndirect
+/// </summary>
+struct DrawElementsIndirectCommand
+{
+	GLuint Count;
+	GLuint InstanceCount;
+	GLuint FirstIndex;
+	GLint  BaseVertex;
+	GLuint BaseInstance;
+};
+
+/// <summary>
+/// The batch renderer collects renderers for a frame, and groups runs that share a shader, material and mesh
+/// into buckets. Each bucket is submitted with a single glMultiDrawElementsIndirect call, with the per-object
+/// transforms stored in a shader storage buffer that is indexed using gl_BaseInstance in the vertex shader.
+/// Consecutive submissions of the same mesh and material are collapsed into a single instanced command
+/// </summary>
+class BatchRenderer final
+{
+public:
+	typedef std::shared_ptr<BatchRenderer> sptr;
+	static inline sptr Create(size_t maxObjects = DEFAULT_MAX_OBJECTS) {
+		return std::make_shared<BatchRenderer>(maxObjects);
+	}
+
+	/// <summary>
+	/// The default number of objects we can draw in a single frame
+	/// </summary>
+	static const size_t DEFAULT_MAX_OBJECTS = 4096;
+	/// <summary>
+	/// The shader storage binding that the per-object data is bound to (see vertex_shader_indirect.glsl)
+	/// </summary>
+	static const GLuint OBJECT_BUFFER_BINDING = 0;
+
+	/// <summary>
+	/// The per-object data that is uploaded for each draw, matches the ObjectData struct in the shaders
+	/// </summary>
+	struct ObjectData
+	{
+		glm::mat4 Model;
+		glm::mat4 NormalMatrix; // Upper 3x3 is the normal matrix, we use a mat4 to match std430 layout
+	};
+
+	// We'll disallow moving and copying, since we want to manually control when the destructor is called
+	// We'll use these classes via pointers
+	BatchRenderer(const BatchRenderer& other) = delete;
+	BatchRenderer(BatchRenderer&& other) = delete;
+	BatchRenderer& operator=(const BatchRenderer& other) = delete;
+	BatchRenderer& operator=(BatchRenderer&& other) = delete;
+
+public:
+	/// <summary>
+	/// Creates a new batch renderer
+	/// </summary>
+	/// <param name="maxObjects">The maximum number of objects that can be submitted in a single frame</param>
+	BatchRenderer(size_t maxObjects = DEFAULT_MAX_OBJECTS);
+	~BatchRenderer() = default;
+
+	/// <summary>
+	/// Starts a new frame, clearing all the buckets from the previous frame
+	/// </summary>
+	void Begin();
+	/// <summary>
+	/// Submits a mesh to be drawn this frame. Draws should be submitted in sorted order (ex: from a RenderQueue), since
+	/// consecutive draws that share a shader, material and mesh are bucketed together. Draws whose shader is still
+	/// compiling are skipped. The mesh and material are not retained, so they must stay alive until after Flush
+	/// </summary>
+	/// <param name="mesh">The mesh to draw</param>
+	/// <param name="material">The material to draw the mesh with</param>
+	/// <param name="world">The world transform of the object</param>
+	/// <param name="normalMatrix">The world normal matrix of the object</param>
+	void Submit(const VertexArrayObject* mesh, ShaderMaterial* material, const glm::mat4& world, const glm::mat3& normalMatrix);
+	/// <summary>
+	/// Uploads all the commands and object data for the frame, and draws all the buckets in submission order
+	/// </summary>
+	/// <param name="onShaderChanged">Invoked whenever a new shader is bound, so the caller can set up per-frame uniforms</param>
+	void Flush(const std::function<void(const Shader::sptr&)>& onShaderChanged = nullptr);
+
+	/// <summary>
+	/// Returns the number of objects submitted in the last frame
+	/// </summary>
+	size_t GetObjectCount() const { return _objects.size(); }
+	/// <summary>
+	/// Returns the number of draw calls issued in the last call to Flush
+	/// </summary>
+	size_t GetDrawCallCount() const { return _drawCalls; }
+	/// <summary>
+	/// Returns the number of objects in the last frame that were drawn as extra instances of the object before them,
+	/// instead of needing draw commands of their own
+	/// </summary>
+	size_t GetInstancedObjectCount() const { return _instancedObjects; }
+
+protected:
+	// A run of commands that share the same shader, material and mesh
+	struct Bucket
+	{
+		ShaderMaterial*           Material;
+		const VertexArrayObject*  Mesh;
+		size_t                    FirstCommand;
+		size_t                    CommandCount;
+	};
+
+	size_t _maxObjects;
+	size_t _drawCalls;
+	size_t _instancedObjects;
+	// The mesh of the last commands, used to detect runs that can be instanced
+	const VertexArrayObject* _lastMesh;
+	// The number of commands that were added for the last mesh (meshes with multiple draw ranges need several)
+	size_t _lastMeshCommands;
+
+	std::vector<Bucket>                      _buckets;
+	std::vector<DrawElementsIndirectCommand> _commands;
+	std::vector<ObjectData>                  _objects;
+
+	StreamingBuffer::sptr _objectBuffer;
+	StreamingBuffer::sptr _commandBuffer;
+
+	GLint _storageAlignment;
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+
+#include "Texture2DData.h"
+#include "TextureEnums.h"
+
+/// <summary>
+/// Encodes images into the BC block compressed formats on the CPU, for use by the texture cooker. The encoder fits
+/// each block's endpoints along the principal axis of it's colors, which is fast and gives reasonable quality, but
+/// it's nowhere near as thorough as a dedicated offline compressor
+/// </summary>
+class BlockCompressor
+{
+public:
+	/// <summary>
+	/// Gets the format an image will be compressed to, RG images become BC5, RGB images become BC1 and RGBA images become
+	/// BC3
+	/// </summary>
+	/// <param name="format">The pixel format of the image</param>
+	/// <returns>The compressed format, or InternalFormat::Unknown if the image can't be compressed</returns>
+	static InternalFormat GetTargetFormat(PixelFormat format);
+
+	/// <summary>
+	/// Compresses every level of an image, splitting the rows of blocks across all of the CPU's cores
+	/// </summary>
+	/// <param name="data">The image to compress, must be uncompressed 8 bit data</param>
+	/// <returns>The compressed image, or nullptr if the data is in a format we can't compress</returns>
+	static Texture2DData::sptr Compress(const Texture2DData::sptr& data);
+
+	/// <summary>
+	/// Encodes a 4x4 block of RGBA texels as a BC1 block
+	/// </summary>
+	/// <param name="texels">The 16 texels of the block, 4 bytes each, in row order</param>
+	/// <param name="dest">The 8 bytes to write the block to</param>
+	static void EncodeBC1(const uint8_t* texels, uint8_t* dest);
+	/// <summary>
+	/// Encodes a single channel of a 4x4 block of texels as a BC4 block, which is how BC3 stores alpha and BC5 stores each
+	/// of it's channels
+	/// </summary>
+	/// <param name="texels">The 16 texels of the block, in row order</param>
+	/// <param name="stride">The number of bytes between each texel</param>
+	/// <param name="dest">The 8 bytes to write the block to</param>
+	static void EncodeBC4(const uint8_t* texels, size_t stride, uint8_t* dest);
+};
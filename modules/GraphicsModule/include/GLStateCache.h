@@ -0,0 +1,160 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+
+/// <summary>
+/// Shadows the OpenGL state that we change the most (the bound program, VAO, texture units, samplers, framebuffers,
+/// buffers and the blend, depth and cull state), and filters out any calls that would set a state to the value it
+/// already has. All of our wrapper classes go through the cache, so code that changes these states directly (ex: a
+/// third party library that doesn't restore state) needs to call Invalidate afterwards.
+///
+/// Objects that may be bound should be deleted with the Delete functions, so that the cache doesn't think a deleted
+/// handle is still bound if OpenGL hands the same name out again
+/// </summary>
+class GLStateCache final
+{
+public:
+	// This is a static class, it can't be constructed
+	GLStateCache() = delete;
+
+	/// <summary>
+	/// Counters for the state changes made through the cache in a single frame
+	/// </summary>
+	struct FrameStats
+	{
+		/// <summary>
+		/// The number of state changes that were passed on to OpenGL
+		/// </summary>
+		uint32_t Issued;
+		/// <summary>
+		/// The number of state changes that were skipped since they would not have changed anything
+		/// </summary>
+		uint32_t Filtered;
+	};
+
+	/// <summary>
+	/// The number of texture and sampler units we track, binds to higher units are always issued
+	/// </summary>
+	static const GLuint MAX_TEXTURE_UNITS = 32;
+	/// <summary>
+	/// The number of indexed uniform and storage buffer bindings we track, binds to higher indices are always issued
+	/// </summary>
+	static const GLuint MAX_BUFFER_BINDINGS = 16;
+
+	static void UseProgram(GLuint program);
+	static void BindVertexArray(GLuint vao);
+	/// <summary>
+	/// Binds a texture to a texture unit using glBindTextureUnit, 0 will unbind all textures from the unit
+	/// </summary>
+	static void BindTextureUnit(GLuint unit, GLuint texture);
+	static void BindSampler(GLuint unit, GLuint sampler);
+	/// <summary>
+	/// Binds a framebuffer to GL_FRAMEBUFFER (both read and draw), GL_READ_FRAMEBUFFER or GL_DRAW_FRAMEBUFFER
+	/// </summary>
+	static void BindFramebuffer(GLenum target, GLuint framebuffer);
+	/// <summary>
+	/// Binds a buffer to a target, note that the GL_ELEMENT_ARRAY_BUFFER binding is part of the bound VAO's state
+	/// </summary>
+	static void BindBuffer(GLenum target, GLuint buffer);
+	static void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	static void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+	/// <summary>
+	/// Enables or disables a capability (ex: GL_DEPTH_TEST). GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST and
+	/// GL_STENCIL_TEST are tracked, anything else is always issued
+	/// </summary>
+	static void SetEnabled(GLenum capability, bool enabled);
+	static void Enable(GLenum capability) { SetEnabled(capability, true); }
+	static void Disable(GLenum capability) { SetEnabled(capability, false); }
+	static void BlendFunc(GLenum source, GLenum destination);
+	static void DepthFunc(GLenum func);
+	static void DepthMask(bool write);
+	static void CullFace(GLenum face);
+
+	static void DeleteProgram(GLuint program);
+	static void DeleteVertexArrays(GLsizei count, const GLuint* handles);
+	static void DeleteTextures(GLsizei count, const GLuint* handles);
+	static void DeleteFramebuffers(GLsizei count, const GLuint* handles);
+	static void DeleteBuffers(GLsizei count, const GLuint* handles);
+
+	/// <summary>
+	/// Forgets all of the shadowed state, so the next call for every state will be issued
+	/// </summary>
+	static void Invalidate();
+
+	/// <summary>
+	/// Starts counting a new frame, the counters for the previous frame can be read with GetLastFrameStats
+	/// </summary>
+	static void BeginFrame();
+	/// <summary>
+	/// Gets the counters for the frame in progress
+	/// </summary>
+	static const FrameStats& GetFrameStats() { return _frameStats; }
+	/// <summary>
+	/// Gets the counters for the last full frame
+	/// </summary>
+	static const FrameStats& GetLastFrameStats() { return _lastFrameStats; }
+
+protected:
+	// Used for any state that we don't know the value of yet
+	static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+	struct IndexedBinding
+	{
+		GLuint     Buffer;
+		GLintptr   Offset;
+		// -1 for bindings made with glBindBufferBase, since those follow the size of the buffer
+		GLsizeiptr Size;
+
+		bool operator ==(const IndexedBinding& other) const {
+			return Buffer == other.Buffer && Offset == other.Offset && Size == other.Size;
+		}
+	};
+
+	// The buffer targets we track with glBindBuffer
+	static const int BUFFER_TARGET_COUNT = 9;
+	// The capabilities we track with glEnable/glDisable
+	static const int CAPABILITY_COUNT = 5;
+
+	struct State
+	{
+		GLuint         Program;
+		GLuint         VertexArray;
+		GLuint         Textures[MAX_TEXTURE_UNITS];
+		GLuint         Samplers[MAX_TEXTURE_UNITS];
+		GLuint         ReadFramebuffer;
+		GLuint         DrawFramebuffer;
+		GLuint         Buffers[BUFFER_TARGET_COUNT];
+		IndexedBinding UniformBuffers[MAX_BUFFER_BINDINGS];
+		IndexedBinding StorageBuffers[MAX_BUFFER_BINDINGS];
+		GLuint         Capabilities[CAPABILITY_COUNT];
+		GLenum         BlendSource;
+		GLenum         BlendDestination;
+		GLenum         DepthFunc;
+		GLuint         DepthMask;
+		GLenum         CullFace;
+	};
+
+	static State      _state;
+	static FrameStats _frameStats;
+	static FrameStats _lastFrameStats;
+
+	// Updates the shadow if it differs from value, returning true if the call needs to be issued
+	template <typename T>
+	static bool _Changed(T& shadow, const T& value) {
+		if (shadow == value) {
+			_frameStats.Filtered++;
+			return false;
+		}
+		shadow = value;
+		_frameStats.Issued++;
+		return true;
+	}
+
+	// Gets the slot in State::Buffers for a buffer target, or -1 if it's not tracked
+	static int _GetBufferSlot(GLenum target);
+	// Gets the slot in State::Capabilities for a capability, or -1 if it's not tracked
+	static int _GetCapabilitySlot(GLenum capability);
+	// Gets the indexed bindings for a target, or nullptr if it's not tracked
+	static IndexedBinding* _GetIndexedBindings(GLenum target);
+};
@@ -0,0 +1,186 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "VertexArrayObject.h"
+
+/// <summary>
+/// A simple free-list allocator that hands out ranges of elements from a fixed size block, merging neighbouring
+/// ranges back together when they are freed
+/// </summary>
+class RangeAllocator
+{
+public:
+	RangeAllocator(size_t capacity = 0);
+
+	/// <summary>
+	/// Allocates a range of the given size using a first-fit search of the free list
+	/// </summary>
+	/// <param name="count">The number of elements to allocate</param>
+	/// <param name="outOffset">Will store the offset of the allocated range on success</param>
+	/// <returns>True if the range could be allocated, false if there is no free range large enough</returns>
+	bool Allocate(size_t count, size_t& outOffset);
+	/// <summary>
+	/// Returns a range to the free list, merging it with any free neighbours
+	/// </summary>
+	/// <param name="offset">The offset of the range, as returned by Allocate</param>
+	/// <param name="count">The size of the range, as passed to Allocate</param>
+	void Free(size_t offset, size_t count);
+
+	/// <summary>
+	/// Returns the total number of elements managed by this allocator
+	/// </summary>
+	size_t GetCapacity() const { return _capacity; }
+	/// <summary>
+	/// Returns the number of elements currently allocated
+	/// </summary>
+	size_t GetUsed() const { return _used; }
+
+protected:
+	size_t _capacity;
+	size_t _used;
+	// Maps the start of each free range to it's size, ordered so we can find neighbours when merging
+	std::map<size_t, size_t> _freeRanges;
+};
+
+/// <summary>
+/// The geometry arena owns a few large immutable vertex and index buffers for each vertex layout, and sub-allocates
+/// all the meshes that are baked into it from those buffers. Every mesh with the same layout in a page shares a
+/// single VAO, so meshes can be drawn back to back (or in a single indirect draw) without switching VAOs
+/// </summary>
+class GeometryArena final : public std::enable_shared_from_this<GeometryArena>
+{
+public:
+	typedef std::shared_ptr<GeometryArena> sptr;
+	static inline sptr Create(size_t verticesPerPage = DEFAULT_VERTICES_PER_PAGE, size_t indicesPerPage = DEFAULT_INDICES_PER_PAGE) {
+		return std::make_shared<GeometryArena>(verticesPerPage, indicesPerPage);
+	}
+
+	static const size_t DEFAULT_VERTICES_PER_PAGE = 1 << 18;
+	static const size_t DEFAULT_INDICES_PER_PAGE  = 1 << 20;
+
+	/// <summary>
+	/// Describes where a mesh lives inside of the arena
+	/// </summary>
+	struct MeshHandle
+	{
+		uint32_t LayoutId;
+		uint32_t PageIndex;
+		uint32_t BaseVertex;
+		uint32_t VertexCount;
+		uint32_t FirstIndex;
+		uint32_t IndexCount;
+	};
+
+	// We'll disallow moving and copying, since we want to manually control when the destructor is called
+	// We'll use these classes via pointers
+	GeometryArena(const GeometryArena& other) = delete;
+	GeometryArena(GeometryArena&& other) = delete;
+	GeometryArena& operator=(const GeometryArena& other) = delete;
+	GeometryArena& operator=(GeometryArena&& other) = delete;
+
+public:
+	/// <summary>
+	/// Creates a new geometry arena, note that pages are only allocated once a mesh is added
+	/// </summary>
+	/// <param name="verticesPerPage">The default number of vertices to allocate for each page</param>
+	/// <param name="indicesPerPage">The default number of indices to allocate for each page</param>
+	GeometryArena(size_t verticesPerPage = DEFAULT_VERTICES_PER_PAGE, size_t indicesPerPage = DEFAULT_INDICES_PER_PAGE);
+	~GeometryArena() = default;
+
+	/// <summary>
+	/// Gets the ID of the given vertex layout and index type within this arena, registering it if it has not been seen
+	/// yet. Layouts are identified by the address of their declaration, so use a static declaration such as
+	/// VertexPosNormTexCol::V_DECL
+	/// </summary>
+	/// <param name="layout">The vertex layout to look up</param>
+	/// <param name="stride">The size of a single vertex using the layout, in bytes</param>
+	/// <param name="indexType">The type of indices stored with the layout (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT)</param>
+	/// <returns>The ID of the layout within the arena</returns>
+	uint32_t GetLayoutId(const std::vector<BufferAttribute>& layout, size_t stride, GLenum indexType);
+
+	/// <summary>
+	/// Uploads a mesh into the arena, returning a VAO view that draws the mesh from the shared buffers. The range
+	/// will be returned to the arena when the view is destroyed. Meshes whose indices all fit in 16 bits are stored
+	/// in pages with 16 bit index buffers
+	/// </summary>
+	/// <param name="vertices">A pointer to the vertex data</param>
+	/// <param name="vertexSize">The size of a single vertex, in bytes</param>
+	/// <param name="vertexCount">The number of vertices to upload</param>
+	/// <param name="layout">The layout of the vertices (ex: VertexPosNormTexCol::V_DECL)</param>
+	/// <param name="indices">A pointer to the indices, may be nullptr if the mesh is not indexed</param>
+	/// <param name="indexCount">The number of indices to upload</param>
+	/// <param name="outHandle">Optional, will store where the mesh was placed in the arena</param>
+	/// <returns>A VAO that can be used to render the mesh</returns>
+	VertexArrayObject::sptr Upload(const void* vertices, size_t vertexSize, size_t vertexCount, const std::vector<BufferAttribute>& layout,
+		const uint32_t* indices, size_t indexCount, MeshHandle* outHandle = nullptr);
+	/// <summary>
+	/// Uploads a mesh into the arena using indices that are already in the type they'll be stored as, so the data can be
+	/// copied straight into the arena's buffers (ex: from a memory mapped file)
+	/// </summary>
+	/// <param name="vertices">A pointer to the vertex data</param>
+	/// <param name="vertexSize">The size of a single vertex, in bytes</param>
+	/// <param name="vertexCount">The number of vertices to upload</param>
+	/// <param name="layout">The layout of the vertices (ex: VertexPosNormTexCol::V_DECL)</param>
+	/// <param name="indices">A pointer to the indices</param>
+	/// <param name="indexType">The type of the indices, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT</param>
+	/// <param name="indexCount">The number of indices to upload</param>
+	/// <param name="outHandle">Optional, will store where the mesh was placed in the arena</param>
+	/// <returns>A VAO that can be used to render the mesh</returns>
+	VertexArrayObject::sptr Upload(const void* vertices, size_t vertexSize, size_t vertexCount, const std::vector<BufferAttribute>& layout,
+		const void* indices, GLenum indexType, size_t indexCount, MeshHandle* outHandle = nullptr);
+
+	/// <summary>
+	/// Returns the number of pages that have been allocated across all layouts
+	/// </summary>
+	size_t GetPageCount() const;
+	/// <summary>
+	/// Returns the total amount of GPU memory allocated by this arena, in bytes
+	/// </summary>
+	size_t GetReservedBytes() const;
+	/// <summary>
+	/// Returns the amount of GPU memory that is in use by meshes, in bytes
+	/// </summary>
+	size_t GetUsedBytes() const;
+
+	/// <summary>
+	/// Gets the arena that MeshBuilder::Bake will use by default, or nullptr if meshes should get their own buffers
+	/// </summary>
+	static const sptr& GetDefault() { return _default; }
+	/// <summary>
+	/// Sets the arena that MeshBuilder::Bake will use by default. Make sure to set this back to nullptr before the
+	/// OpenGL context is destroyed
+	/// </summary>
+	static void SetDefault(const sptr& arena) { _default = arena; }
+
+protected:
+	// A single set of large buffers that meshes are allocated from
+	struct Page
+	{
+		VertexBuffer::sptr      Vertices;
+		IndexBuffer::sptr       Indices;
+		VertexArrayObject::sptr Vao;
+		RangeAllocator          VertexRanges;
+		RangeAllocator          IndexRanges;
+	};
+
+	// All the pages for a given vertex layout and index type
+	struct Layout
+	{
+		const std::vector<BufferAttribute>* Declaration;
+		size_t                              Stride;
+		GLenum                              IndexType;
+		size_t                              IndexSize;
+		std::vector<Page>                   Pages;
+	};
+
+	size_t _verticesPerPage;
+	size_t _indicesPerPage;
+	std::vector<Layout> _layouts;
+
+	static sptr _default;
+
+	void _Free(const MeshHandle& handle);
+};
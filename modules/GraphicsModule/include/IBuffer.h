@@ -1,5 +1,6 @@
 #pragma once
 #include <glad/glad.h>
+#include <cstddef>
 
 /// <summary>
 /// This is our abstract base class for all our OpenGL buffer types
@@ -35,9 +36,27 @@ public:
 	/// <param name="count">The number of elements in the array to upload</param>
 	template <typename T>
 	void LoadData(const T* data, size_t count) {
-		IBuffer::LoadData((const void*)(data), sizeof(T), count);
+		// Not qualified, so that buffers which can't be re-allocated still get to reject this
+		LoadData((const void*)(data), sizeof(T), count);
 	}
 
+	/// <summary>
+	/// Allocates immutable storage for this buffer using glNamedBufferStorage. The buffer can no longer be
+	/// re-sized with LoadData, but sub-ranges can still be updated with UpdateData. Can only be called once per buffer
+	/// </summary>
+	/// <param name="elementSize">The size of a single element, in bytes</param>
+	/// <param name="elementCount">The number of elements to allocate space for</param>
+	/// <param name="flags">The storage flags for the buffer (ex: GL_DYNAMIC_STORAGE_BIT)</param>
+	/// <param name="data">Optional data to initialize the buffer with</param>
+	void AllocateStorage(size_t elementSize, size_t elementCount, GLbitfield flags = GL_DYNAMIC_STORAGE_BIT, const void* data = nullptr);
+	/// <summary>
+	/// Updates a range of the data in this buffer, using glNamedBufferSubData
+	/// </summary>
+	/// <param name="data">The data to upload</param>
+	/// <param name="offset">The offset into the buffer to write to, in bytes</param>
+	/// <param name="size">The number of bytes to write</param>
+	void UpdateData(const void* data, size_t offset, size_t size);
+
 	/// <summary>
 	/// Returns the number of elements that are loaded into this buffer
 	/// </summary>
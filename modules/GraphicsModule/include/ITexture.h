@@ -3,6 +3,7 @@
 #include <memory>
 #include <glad/glad.h>
 #include <GLM/glm.hpp>
+#include "ResourcePool.h"
 
 class ITexture
 {
@@ -59,3 +60,8 @@ protected:
 	static Limits _limits;
 	static bool _isStaticInit;
 };
+
+/// <summary>
+/// A handle to a texture in ResourcePools::Textures
+/// </summary>
+typedef ResourceHandle<ITexture> TextureHandle;
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// Hands out small integer IDs, reusing released IDs before allocating new ones so that the values stay as small as
+/// possible. Used to give objects IDs that can be packed into a few bits of a sort key
+/// </summary>
+class IdPool final
+{
+public:
+	IdPool() : _next(0), _free() { }
+	~IdPool() = default;
+
+	IdPool(const IdPool& other) = delete;
+	IdPool(IdPool&& other) = delete;
+	IdPool& operator=(const IdPool& other) = delete;
+	IdPool& operator=(IdPool&& other) = delete;
+
+	/// <summary>
+	/// Gets an unused ID, preferring the most recently released one
+	/// </summary>
+	uint32_t Allocate() {
+		if (!_free.empty()) {
+			uint32_t id = _free.back();
+			_free.pop_back();
+			return id;
+		}
+		return _next++;
+	}
+	/// <summary>
+	/// Returns an ID to the pool so that it can be handed out again
+	/// </summary>
+	void Release(uint32_t id) { _free.push_back(id); }
+
+	/// <summary>
+	/// Gets the number of IDs that are currently in use
+	/// </summary>
+	size_t GetUsedCount() const { return _next - _free.size(); }
+
+protected:
+	uint32_t              _next;
+	std::vector<uint32_t> _free;
+};
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <stdexcept>
 #include <memory>
+#include <vector>
 
 /// <summary>
 /// The index buffer will store indices for rendering (uint8_t, uint16_t and uint32_t)
@@ -24,7 +25,7 @@ public:
 		IBuffer(GL_ELEMENT_ARRAY_BUFFER, usage), _elementType(GL_NONE) { }
 
 	// We'll override the LoadData to force users to use our overload that takes in the element type as well
-	inline void LoadData(const void* data, size_t elementSize, size_t elementCount) override {
+	inline void LoadData(const void* /*data*/, size_t /*elementSize*/, size_t /*elementCount*/) override {
 		throw std::runtime_error("Must use the templated overload, or the LoadData that specifies the element type");
 	}
 	/// <summary>
@@ -39,13 +40,50 @@ public:
 		_elementType = elementType;
 	}
 	/// <summary>
+	/// Allocates immutable storage for this index buffer, specifying the type of indices that will be stored
+	/// </summary>
+	/// <param name="elementSize">The size of a single element, in bytes</param>
+	/// <param name="elementCount">The number of elements to allocate space for</param>
+	/// <param name="elementType">The type of elements you are storing (GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_UNSIGNED_INT)</param>
+	/// <param name="flags">The storage flags for the buffer (ex: GL_DYNAMIC_STORAGE_BIT)</param>
+	/// <param name="data">Optional data to initialize the buffer with</param>
+	inline void AllocateStorage(size_t elementSize, size_t elementCount, GLenum elementType, GLbitfield flags = GL_DYNAMIC_STORAGE_BIT, const void* data = nullptr) {
+		IBuffer::AllocateStorage(elementSize, elementCount, flags, data);
+		_elementType = elementType;
+	}
+	/// <summary>
 	/// Loads data of a known type into this index buffer
 	/// </summary>
 	/// <typeparam name="T">The type of data to load, must be uint8_t, uint16_t or uint32_t</typeparam>
 	/// <param name="data">A pointer to the start of the array</param>
 	/// <param name="count">The number of elements in the array to upload</param>
 	template <typename T>
-	void LoadData(const T* data, size_t count) { throw std::runtime_error("Must be one of uint8_t, uint16_t or uint32_t"); } // Note, see template specializations below
+	void LoadData(const T* /*data*/, size_t /*count*/) { throw std::runtime_error("Must be one of uint8_t, uint16_t or uint32_t"); } // Note, see template specializations below
+
+	/// <summary>
+	/// Loads 32 bit indices into this buffer, converting them to 16 bit indices if they are all small enough
+	/// </summary>
+	/// <param name="data">A pointer to the start of the array</param>
+	/// <param name="count">The number of indices in the array</param>
+	inline void LoadCompactData(const uint32_t* data, size_t count);
+
+	/// <summary>
+	/// The number of unique vertices that can be addressed with 16 bit indices
+	/// </summary>
+	static constexpr size_t SHORT_INDEX_LIMIT = 65536;
+	/// <summary>
+	/// Returns true if all of the given indices can be stored as 16 bit indices
+	/// </summary>
+	/// <param name="data">A pointer to the start of the array</param>
+	/// <param name="count">The number of indices in the array</param>
+	static bool FitsShortIndices(const uint32_t* data, size_t count) {
+		for (size_t ix = 0; ix < count; ix++) {
+			if (data[ix] >= SHORT_INDEX_LIMIT) {
+				return false;
+			}
+		}
+		return true;
+	}
 
 	/// <summary>
 	/// Gets the underlying index type for this buffer (GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_UNSIGNED_INT)
@@ -67,16 +105,25 @@ protected:
 
 template<>
 inline void IndexBuffer::LoadData<uint8_t>(const uint8_t* data, size_t count) {
-	IBuffer::LoadData<uint8_t>(data, count);
+	IBuffer::LoadData(data, sizeof(uint8_t), count);
 	_elementType = GL_UNSIGNED_BYTE;
 }
 template<>
 inline void IndexBuffer::LoadData<uint16_t>(const uint16_t* data, size_t count) {
-	IBuffer::LoadData<uint16_t>(data, count);
+	IBuffer::LoadData(data, sizeof(uint16_t), count);
 	_elementType = GL_UNSIGNED_SHORT;
 }
 template<>
 inline void IndexBuffer::LoadData<uint32_t>(const uint32_t* data, size_t count) {
-	IBuffer::LoadData<uint32_t>(data, count);
+	IBuffer::LoadData(data, sizeof(uint32_t), count);
 	_elementType = GL_UNSIGNED_INT;
 }
+
+void IndexBuffer::LoadCompactData(const uint32_t* data, size_t count) {
+	if (FitsShortIndices(data, count)) {
+		std::vector<uint16_t> compact(data, data + count);
+		LoadData(compact.data(), compact.size());
+	} else {
+		LoadData(data, count);
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/// <summary>
+/// Maps a whole file into memory as read only, so that it can be read without copying it into a buffer first. Pages
+/// are loaded by the OS as they're touched, and the mapping is closed when the object is destroyed
+/// </summary>
+class MappedFile final
+{
+public:
+	typedef std::shared_ptr<MappedFile> sptr;
+	/// <summary>
+	/// Maps the file at the given path, returning nullptr if it could not be opened
+	/// </summary>
+	static sptr Create(const std::string& path);
+	// We'll disallow moving and copying, since we own the mapping
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile(MappedFile&& other) = delete;
+	MappedFile& operator=(const MappedFile& other) = delete;
+	MappedFile& operator=(MappedFile&& other) = delete;
+
+	MappedFile();
+	~MappedFile();
+
+	/// <summary>
+	/// Gets a pointer to the start of the file's contents, or nullptr if the file is empty
+	/// </summary>
+	const uint8_t* GetData() const { return _data; }
+	/// <summary>
+	/// Gets the size of the file, in bytes
+	/// </summary>
+	size_t GetSize() const { return _size; }
+
+protected:
+	const uint8_t* _data;
+	size_t         _size;
+	// The OS handles for the file and it's mapping, only used on Windows
+	void*          _file;
+	void*          _mapping;
+
+	// Opens and maps the file, returning false if it could not be mapped
+	bool _Open(const std::string& path);
+};
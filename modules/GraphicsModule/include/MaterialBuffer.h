@@ -0,0 +1,115 @@
+#pragma once
+#include <glad/glad.h>
+#include <memory>
+
+#include "IBuffer.h"
+#include "GeometryArena.h"
+
+/// <summary>
+/// A single large uniform buffer that holds the parameter blocks of every material. Shaders declare their material
+/// parameters in a std140 block named b_Material at binding MaterialBuffer::BINDING, and each material gets a range of
+/// this buffer sized for the block of the shader variant it uses. Making a material current is then just a matter of
+/// binding it's range, and only the parts of a block that actually changed are ever uploaded
+/// </summary>
+class MaterialBuffer final : public IBuffer
+{
+public:
+	typedef std::shared_ptr<MaterialBuffer> sptr;
+	static inline sptr Create(size_t capacity = DEFAULT_CAPACITY) {
+		return std::make_shared<MaterialBuffer>(capacity);
+	}
+	// We'll disallow moving and copying, since materials hold on to the buffer they allocated from
+	MaterialBuffer(const MaterialBuffer& other) = delete;
+	MaterialBuffer(MaterialBuffer&& other) = delete;
+	MaterialBuffer& operator=(const MaterialBuffer& other) = delete;
+	MaterialBuffer& operator=(MaterialBuffer&& other) = delete;
+
+	/// <summary>
+	/// The default size of the buffer, in bytes
+	/// </summary>
+	static const size_t DEFAULT_CAPACITY = 256 * 1024;
+	/// <summary>
+	/// The uniform block binding point that material blocks are bound to
+	/// </summary>
+	static const GLuint BINDING = 2;
+	/// <summary>
+	/// The name of the uniform block that shaders declare their material parameters in
+	/// </summary>
+	static constexpr const char* BLOCK_NAME = "b_Material";
+
+	/// <summary>
+	/// A range of the buffer that belongs to a single material
+	/// </summary>
+	struct Allocation
+	{
+		size_t Offset;
+		size_t Size;
+
+		bool IsValid() const { return Size > 0; }
+	};
+
+public:
+	/// <summary>
+	/// Creates a new material buffer, must be created after the OpenGL context
+	/// </summary>
+	/// <param name="capacity">The size of the buffer in bytes</param>
+	MaterialBuffer(size_t capacity = DEFAULT_CAPACITY);
+	~MaterialBuffer() = default;
+
+	// Material buffers have a fixed size, use Allocate and Update instead
+	void LoadData(const void* data, size_t elementSize, size_t elementCount) override;
+
+	/// <summary>
+	/// Allocates a range for a material block, aligned so that it can be bound with glBindBufferRange
+	/// </summary>
+	/// <param name="size">The size of the block in bytes</param>
+	/// <returns>The allocated range, or an invalid allocation if the buffer is full</returns>
+	Allocation Allocate(size_t size);
+	/// <summary>
+	/// Returns a range to the buffer, does nothing for invalid allocations
+	/// </summary>
+	void Free(const Allocation& allocation);
+
+	/// <summary>
+	/// Uploads part of a material block
+	/// </summary>
+	/// <param name="allocation">The range of the material</param>
+	/// <param name="data">The data to upload</param>
+	/// <param name="offset">The offset of the data from the start of the material's range</param>
+	/// <param name="size">The number of bytes to upload</param>
+	void Update(const Allocation& allocation, const void* data, size_t offset, size_t size);
+	/// <summary>
+	/// Binds a material's range to the material block binding point
+	/// </summary>
+	void Bind(const Allocation& allocation);
+	/// <summary>
+	/// Binds the whole buffer to the material block binding point
+	/// </summary>
+	void Bind() override;
+
+	/// <summary>
+	/// Returns the number of bytes that are allocated to materials
+	/// </summary>
+	size_t GetUsed() const { return _ranges.GetUsed() * _alignment; }
+	/// <summary>
+	/// Returns the total number of bytes uploaded with Update, so callers can measure how much changes between frames
+	/// </summary>
+	size_t GetBytesUploaded() const { return _bytesUploaded; }
+
+	/// <summary>
+	/// Gets the buffer that new material blocks are allocated from, or nullptr if materials should use regular uniforms
+	/// </summary>
+	static const sptr& GetDefault() { return _default; }
+	/// <summary>
+	/// Sets the buffer that new material blocks are allocated from. Materials keep the buffer they allocated from alive
+	/// </summary>
+	static void SetDefault(const sptr& buffer) { _default = buffer; }
+
+protected:
+	// Ranges are allocated in units of the uniform buffer offset alignment
+	size_t         _alignment;
+	RangeAllocator _ranges;
+	size_t         _bytesUploaded;
+
+	static sptr _default;
+};
@@ -1,6 +1,11 @@
 #pragma once
 #include <vector>
 #include <VertexArrayObject.h>
+#include <GeometryArena.h>
+#include <VertexTypes.h>
+#include <MeshOptimizer.h>
+#include <MeshLodSet.h>
+#include <MeshCooker.h>
 
 template <typename VertType>
 class MeshBuilder
@@ -43,7 +48,7 @@ public:
 	/// <param name="c">The index of the third vertex</param>
 	void AddIndexTri(uint32_t a, uint32_t b, uint32_t c)
 	{
-		ReserveIndexSpace(3);
+		// We let push_back grow the buffer, reserving exactly 3 more every time would reallocate on every triangle
 		_indices.push_back(a);
 		_indices.push_back(b);
 		_indices.push_back(c);
@@ -81,19 +86,142 @@ public:
 	/// </summary>
 	size_t GetTriangleCount() const { return _indices.size() > 0 ? _indices.size() / 3 : _vertices.size() / 3; }
 
-	VertexArrayObject::sptr Bake() {
-		VertexBuffer::sptr vbo = VertexBuffer::Create();
-		vbo->LoadData(GetVertexDataPtr(), _vertices.size());
+	/// <summary>
+	/// Optimizes the mesh for rendering. This welds identical vertices, re-orders the triangles for the post-transform
+	/// vertex cache (and optionally to reduce overdraw), then re-orders the vertices into the order they are fetched.
+	/// Non-indexed meshes will be converted to indexed meshes. Requires VertType to have a glm::vec3 Position field
+	/// </summary>
+	/// <param name="reduceOverdraw">True to re-order clusters of triangles to reduce overdraw</param>
+	/// <returns>The vertex cache statistics from before and after the optimization</returns>
+	MeshOptimizer::Report Optimize(bool reduceOverdraw = true) {
+		MeshOptimizer::Report report;
+		report.VerticesBefore = _vertices.size();
+		if (_indices.empty()) {
+			_indices.resize(_vertices.size());
+			for (size_t ix = 0; ix < _vertices.size(); ix++) {
+				_indices[ix] = static_cast<uint32_t>(ix);
+			}
+		}
+		report.Before = MeshOptimizer::AnalyzeVertexCache(_indices.data(), _indices.size(), _vertices.size());
 
-		IndexBuffer::sptr ebo = IndexBuffer::Create();
-		ebo->LoadData(GetIndexDataPtr(), _indices.size());
+		std::vector<uint32_t> remap;
+		size_t vertexCount = MeshOptimizer::WeldVertices(_vertices.data(), sizeof(VertType), _vertices.size(), remap);
+		_Remap(remap, vertexCount);
 
-		VertexArrayObject::sptr result = VertexArrayObject::Create();
-		result->AddVertexBuffer(vbo, VertType::V_DECL);
-		result->SetIndexBuffer(ebo);
+		MeshOptimizer::OptimizeVertexCache(_indices.data(), _indices.size(), _vertices.size());
+		if (reduceOverdraw) {
+			std::vector<glm::vec3> positions(_vertices.size());
+			for (size_t ix = 0; ix < _vertices.size(); ix++) {
+				positions[ix] = _vertices[ix].Position;
+			}
+			MeshOptimizer::OptimizeOverdraw(_indices.data(), _indices.size(), positions.data(), positions.size());
+		}
+
+		vertexCount = MeshOptimizer::OptimizeVertexFetch(_indices.data(), _indices.size(), _vertices.size(), remap);
+		_Remap(remap, vertexCount);
+
+		report.VerticesAfter = _vertices.size();
+		report.After = MeshOptimizer::AnalyzeVertexCache(_indices.data(), _indices.size(), _vertices.size());
+		return report;
+	}
+
+	/// <summary>
+	/// Bakes this mesh into a VAO. If a default geometry arena has been set, the mesh will be sub-allocated
+	/// from the arena, otherwise it will get it's own buffers
+	/// </summary>
+	VertexArrayObject::sptr Bake() {
+		return Bake(GeometryArena::GetDefault());
+	}
+	/// <summary>
+	/// Bakes this mesh into the given geometry arena, returning a view into the arena's shared buffers
+	/// </summary>
+	/// <param name="arena">The arena to allocate the mesh from</param>
+	VertexArrayObject::sptr Bake(const GeometryArena::sptr& arena) {
+		VertexArrayObject::sptr result = _Bake(_vertices, _indices, arena);
+		_ApplyBounds(result);
+		return result;
+	}
+	/// <summary>
+	/// Bakes this mesh into a VAO using a packed vertex format (ex: VertexPackedPosNormTexCol). Positions are
+	/// quantized to the bounds of the mesh, and the resulting VAO's dequantization matrix is set accordingly
+	/// </summary>
+	/// <typeparam name="TPacked">The packed vertex type, must be constructible from a VertType and a VertexQuantization</typeparam>
+	/// <param name="arena">The arena to allocate the mesh from, or nullptr for the mesh to get it's own buffers</param>
+	template <typename TPacked>
+	VertexArrayObject::sptr BakePacked(const GeometryArena::sptr& arena = GeometryArena::GetDefault()) {
+		VertexQuantization quantization = VertexQuantization::Compute(_vertices.data(), _vertices.size());
 
+		std::vector<TPacked> packed;
+		packed.reserve(_vertices.size());
+		for (const VertType& vertex : _vertices) {
+			packed.emplace_back(vertex, quantization);
+		}
+
+		VertexArrayObject::sptr result = _Bake(packed, _indices, arena);
+		result->SetDequantization(quantization.ToMatrix());
+		_ApplyBounds(result);
 		return result;
 	}
+
+	/// <summary>
+	/// Generates a chain of simplified versions of this mesh (see MeshOptimizer::Simplify) and bakes them into a LOD set.
+	/// All the levels share the same vertices, only the index lists differ. Meshes too big for 16 bit indices are split
+	/// once for all the levels (see MeshOptimizer::SplitSharedIndices). Levels that could not be simplified any
+	/// further than the level before them are skipped. Requires VertType to have a glm::vec3 Position field
+	/// </summary>
+	/// <param name="ratios">The fraction of the original triangles to keep for each level, from most to least detailed</param>
+	/// <param name="arena">The arena to allocate the mesh from, or nullptr for the mesh to get it's own buffers</param>
+	MeshLodSet::sptr BakeLods(const std::vector<float>& ratios = { 1.0f, 0.5f, 0.25f, 0.1f }, const GeometryArena::sptr& arena = GeometryArena::GetDefault()) {
+		return _BakeLods(_vertices, ratios, arena, glm::mat4(1.0f));
+	}
+	/// <summary>
+	/// Same as BakeLods, but the levels are baked using a packed vertex format (see BakePacked)
+	/// </summary>
+	/// <typeparam name="TPacked">The packed vertex type, must be constructible from a VertType and a VertexQuantization</typeparam>
+	/// <param name="ratios">The fraction of the original triangles to keep for each level, from most to least detailed</param>
+	/// <param name="arena">The arena to allocate the mesh from, or nullptr for the mesh to get it's own buffers</param>
+	template <typename TPacked>
+	MeshLodSet::sptr BakeLodsPacked(const std::vector<float>& ratios = { 1.0f, 0.5f, 0.25f, 0.1f }, const GeometryArena::sptr& arena = GeometryArena::GetDefault()) {
+		VertexQuantization quantization = VertexQuantization::Compute(_vertices.data(), _vertices.size());
+
+		std::vector<TPacked> packed;
+		packed.reserve(_vertices.size());
+		for (const VertType& vertex : _vertices) {
+			packed.emplace_back(vertex, quantization);
+		}
+
+		return _BakeLods(packed, ratios, arena, quantization.ToMatrix());
+	}
+
+	/// <summary>
+	/// Writes this mesh to a mesh cooker, exactly as Bake would upload it, so that it can be loaded with
+	/// MeshCooker::TryLoad instead of being rebuilt from it's source. Requires VertType to have a glm::vec3 Position field
+	/// </summary>
+	/// <param name="cooker">The cooker to write the mesh to</param>
+	/// <param name="key">The key of the mesh, from MeshCooker::ComputeKey</param>
+	/// <returns>True if the mesh was written</returns>
+	bool Cook(const MeshCooker& cooker, uint64_t key) const {
+		return _Cook(cooker, key, _vertices, glm::mat4(1.0f));
+	}
+	/// <summary>
+	/// Same as Cook, but the mesh is written using a packed vertex format, as BakePacked would upload it
+	/// </summary>
+	/// <typeparam name="TPacked">The packed vertex type, must be constructible from a VertType and a VertexQuantization</typeparam>
+	/// <param name="cooker">The cooker to write the mesh to</param>
+	/// <param name="key">The key of the mesh, from MeshCooker::ComputeKey</param>
+	/// <returns>True if the mesh was written</returns>
+	template <typename TPacked>
+	bool CookPacked(const MeshCooker& cooker, uint64_t key) const {
+		VertexQuantization quantization = VertexQuantization::Compute(_vertices.data(), _vertices.size());
+
+		std::vector<TPacked> packed;
+		packed.reserve(_vertices.size());
+		for (const VertType& vertex : _vertices) {
+			packed.emplace_back(vertex, quantization);
+		}
+
+		return _Cook(cooker, key, packed, quantization.ToMatrix());
+	}
 	
 	/// <summary>
 	/// Gets a pointer to the underlying vertex data in the mesh, valid only
@@ -112,6 +240,211 @@ public:
 	
 protected:
 	friend class MeshFactory;
+
+	// Moves each vertex to the position given by the remap table and updates the indices to match
+	void _Remap(const std::vector<uint32_t>& remap, size_t newCount) {
+		std::vector<VertType> vertices(newCount);
+		for (size_t ix = 0; ix < remap.size(); ix++) {
+			if (remap[ix] != MeshOptimizer::INVALID_INDEX) {
+				vertices[remap[ix]] = _vertices[ix];
+			}
+		}
+		_vertices.swap(vertices);
+		for (uint32_t& index : _indices) {
+			index = remap[index];
+		}
+	}
+
+	// Finds the bounding sphere of our model space positions, centered on the middle of their bounding box
+	void _ComputeBounds(glm::vec3& center, float& radius) const {
+		glm::vec3 min = _vertices.empty() ? glm::vec3(0.0f) : _vertices[0].Position;
+		glm::vec3 max = min;
+		for (const VertType& vertex : _vertices) {
+			min = glm::min(min, vertex.Position);
+			max = glm::max(max, vertex.Position);
+		}
+		center = (min + max) * 0.5f;
+		radius = 0.0f;
+		for (const VertType& vertex : _vertices) {
+			radius = glm::max(radius, glm::length(vertex.Position - center));
+		}
+	}
+
+	// Gives a baked mesh the bounds of our positions, so it matches the same mesh loaded from a cooked file
+	void _ApplyBounds(const VertexArrayObject::sptr& mesh) const {
+		glm::vec3 center;
+		float radius;
+		_ComputeBounds(center, radius);
+		mesh->SetBounds(center, radius);
+	}
+
+	// Uploads the given vertices and indices, either to the arena or to new buffers. Meshes with too many vertices
+	// for 16 bit indices are split into ranges that each fit, so they can still use 16 bit indices
+	template <typename TVertex>
+	static VertexArrayObject::sptr _Bake(const std::vector<TVertex>& vertices, const std::vector<uint32_t>& sourceIndices, const GeometryArena::sptr& arena) {
+		std::vector<uint32_t> sequential;
+		const std::vector<uint32_t>& indices = _GetIndices(sourceIndices, vertices.size(), sequential);
+
+		if (vertices.size() <= IndexBuffer::SHORT_INDEX_LIMIT) {
+			return _Upload(vertices.data(), vertices.size(), indices.data(), indices.size(), arena);
+		}
+
+		std::vector<TVertex> splitVertices;
+		std::vector<uint32_t> splitIndices;
+		std::vector<DrawRange> ranges;
+		_Split(vertices, indices, splitVertices, splitIndices, ranges);
+
+		VertexArrayObject::sptr result = _Upload(splitVertices.data(), splitVertices.size(), splitIndices.data(), splitIndices.size(), arena);
+		result->SetDrawRanges(ranges);
+		return result;
+	}
+
+	// Writes the given vertices to the cooker the same way _Bake would upload them, with the bounds of our model space positions
+	template <typename TVertex>
+	bool _Cook(const MeshCooker& cooker, uint64_t key, const std::vector<TVertex>& vertices, const glm::mat4& dequantization) const {
+		std::vector<uint32_t> sequential;
+		const std::vector<uint32_t>& indices = _GetIndices(_indices, vertices.size(), sequential);
+
+		MeshCooker::MeshData data;
+		data.Layout = &TVertex::V_DECL;
+		data.Stride = sizeof(TVertex);
+		data.Dequantization = dequantization;
+		_ComputeBounds(data.BoundsCenter, data.BoundsRadius);
+
+		std::vector<TVertex> splitVertices;
+		std::vector<uint32_t> splitIndices;
+		if (vertices.size() <= IndexBuffer::SHORT_INDEX_LIMIT) {
+			data.Vertices = vertices.data();
+			data.VertexCount = vertices.size();
+			data.Indices = indices.data();
+			data.IndexCount = indices.size();
+		} else {
+			_Split(vertices, indices, splitVertices, splitIndices, data.Ranges);
+			data.Vertices = splitVertices.data();
+			data.VertexCount = splitVertices.size();
+			data.Indices = splitIndices.data();
+			data.IndexCount = splitIndices.size();
+		}
+		return cooker.Write(key, data);
+	}
+
+	// Gets the indices to upload, meshes without indices get a sequential index list so that they can follow the same path
+	static const std::vector<uint32_t>& _GetIndices(const std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>& sequential) {
+		if (!indices.empty()) {
+			return indices;
+		}
+		sequential.resize(vertexCount);
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			sequential[ix] = static_cast<uint32_t>(ix);
+		}
+		return sequential;
+	}
+
+	// Splits a mesh with too many vertices for 16 bit indices into ranges that each fit (see MeshOptimizer::SplitIndices)
+	template <typename TVertex>
+	static void _Split(const std::vector<TVertex>& vertices, const std::vector<uint32_t>& indices,
+		std::vector<TVertex>& outVertices, std::vector<uint32_t>& outIndices, std::vector<DrawRange>& outRanges)
+	{
+		std::vector<uint32_t> sources;
+		MeshOptimizer::SplitIndices(indices.data(), indices.size(), vertices.size(), sources, outIndices, outRanges);
+
+		outVertices.resize(sources.size());
+		for (size_t ix = 0; ix < sources.size(); ix++) {
+			outVertices[ix] = vertices[sources[ix]];
+		}
+	}
+
+	// Simplifies our indices for each of the ratios, and bakes the levels into a LOD set. Quantized vertex types
+	// pass in the matrix that maps them back to model space
+	template <typename TVertex>
+	MeshLodSet::sptr _BakeLods(const std::vector<TVertex>& vertices, const std::vector<float>& ratios, const GeometryArena::sptr& arena, const glm::mat4& dequantization) {
+		MeshLodSet::sptr result = MeshLodSet::Create();
+
+		glm::vec3 center;
+		float radius;
+		_ComputeBounds(center, radius);
+		result->SetBounds(center, radius);
+
+		// The simplifier works on model space positions
+		std::vector<glm::vec3> positions(_vertices.size());
+		for (size_t ix = 0; ix < _vertices.size(); ix++) {
+			positions[ix] = _vertices[ix].Position;
+		}
+
+		std::vector<uint32_t> sequential;
+		const std::vector<uint32_t>* source = &_GetIndices(_indices, _vertices.size(), sequential);
+
+		// Every level is simplified from the original mesh, so that the errors are measured against the real surface
+		std::vector<std::vector<uint32_t>> levels;
+		std::vector<float> errors;
+		for (float ratio : ratios) {
+			size_t target = static_cast<size_t>(source->size() / 3 * ratio) * 3;
+			std::vector<uint32_t> indices;
+			float error = MeshOptimizer::Simplify(source->data(), source->size(), positions.data(), positions.size(), target, indices);
+			if (!levels.empty() && indices.size() >= levels.back().size()) {
+				continue;
+			}
+			MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), positions.size());
+			levels.push_back(std::move(indices));
+			errors.push_back(error);
+		}
+
+		// All the levels go in one allocation, and each level is a view into it. If the mesh is too big for 16 bit
+		// indices, the levels are split together so that they still share the split vertices
+		std::vector<uint32_t> combined;
+		std::vector<std::vector<DrawRange>> levelRanges(levels.size());
+		VertexArrayObject::sptr base;
+		if (vertices.size() <= IndexBuffer::SHORT_INDEX_LIMIT) {
+			for (const std::vector<uint32_t>& level : levels) {
+				combined.insert(combined.end(), level.begin(), level.end());
+			}
+			base = _Upload(vertices.data(), vertices.size(), combined.data(), combined.size(), arena);
+		} else {
+			std::vector<uint32_t> sources;
+			MeshOptimizer::SplitSharedIndices(levels, vertices.size(), sources, combined, levelRanges);
+
+			std::vector<TVertex> splitVertices(sources.size());
+			for (size_t ix = 0; ix < sources.size(); ix++) {
+				splitVertices[ix] = vertices[sources[ix]];
+			}
+			base = _Upload(splitVertices.data(), splitVertices.size(), combined.data(), combined.size(), arena);
+		}
+		const VertexArrayObject::sptr& root = base->IsView() ? base->GetSource() : base;
+
+		GLuint offset = 0;
+		for (size_t ix = 0; ix < levels.size(); ix++) {
+			// The views hold on to the base mesh, so the allocation is freed once all the levels are gone
+			VertexArrayObject::sptr view = VertexArrayObject::Create(root, base->GetFirstIndex() + offset, static_cast<GLsizei>(levels[ix].size()),
+				base->GetBaseVertex(), base->GetVertexCount(), [base]() {});
+			view->SetDrawRanges(levelRanges[ix]);
+			view->SetDequantization(dequantization);
+			view->SetBounds(center, radius);
+			result->AddLevel(view, errors[ix], levels[ix].size() / 3);
+			offset += static_cast<GLuint>(levels[ix].size());
+		}
+
+		return result;
+	}
+
+	// Uploads vertices and indices to the arena, or to new buffers if there is no arena
+	template <typename TVertex>
+	static VertexArrayObject::sptr _Upload(const TVertex* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount, const GeometryArena::sptr& arena) {
+		if (arena != nullptr) {
+			return arena->Upload(vertices, sizeof(TVertex), vertexCount, TVertex::V_DECL, indices, indexCount);
+		}
+
+		VertexBuffer::sptr vbo = VertexBuffer::Create();
+		vbo->LoadData(vertices, vertexCount);
+
+		IndexBuffer::sptr ebo = IndexBuffer::Create();
+		ebo->LoadCompactData(indices, indexCount);
+
+		VertexArrayObject::sptr result = VertexArrayObject::Create();
+		result->AddVertexBuffer(vbo, TVertex::V_DECL);
+		result->SetIndexBuffer(ebo);
+
+		return result;
+	}
 	
 	std::vector<VertType> _vertices;
 	std::vector<uint32_t> _indices;
@@ -0,0 +1,137 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "CookedMesh.h"
+#include "GeometryArena.h"
+#include "VertexArrayObject.h"
+
+/// <summary>
+/// Stores baked meshes on disk in a binary format (.otmesh), so that meshes loaded from text formats only have to be
+/// parsed and built once. Each file holds the vertex layout, the vertices exactly as they're uploaded, a 16 or 32 bit
+/// index stream, the draw ranges for meshes that were split, the bounds of the mesh and the key of the source it was
+/// built from (see CookedMesh.h). The vertex and index sections are aligned, so loading memory maps the file and hands
+/// the sections straight to OpenGL without copying them into vectors first.
+///
+/// Files are keyed by a hash of the source file and the options it was loaded with, so editing a model or loading it
+/// with different options will miss the cache rather than loading a stale mesh. ObjLoader and NotObjLoader write to
+/// and read from the default cooker when one is set
+/// </summary>
+class MeshCooker final
+{
+public:
+	typedef std::shared_ptr<MeshCooker> sptr;
+	static inline sptr Create(const std::string& directory = DEFAULT_DIRECTORY) {
+		return std::make_shared<MeshCooker>(directory);
+	}
+	// We'll disallow moving and copying, since the cooker is shared via pointers
+	MeshCooker(const MeshCooker& other) = delete;
+	MeshCooker(MeshCooker&& other) = delete;
+	MeshCooker& operator=(const MeshCooker& other) = delete;
+	MeshCooker& operator=(MeshCooker&& other) = delete;
+
+	/// <summary>
+	/// The default directory that cooked meshes are stored in, relative to the working directory
+	/// </summary>
+	static constexpr const char* DEFAULT_DIRECTORY = COOKED_MESH_DIRECTORY;
+	/// <summary>
+	/// The extension given to cooked mesh files
+	/// </summary>
+	static constexpr const char* FILE_EXTENSION = COOKED_MESH_EXTENSION;
+
+	/// <summary>
+	/// Describes a baked mesh to write to the cache, the data is only read during the call to Write
+	/// </summary>
+	struct MeshData
+	{
+		/// <summary>
+		/// The layout of the vertices (ex: VertexPosNormTexCol::V_DECL)
+		/// </summary>
+		const std::vector<BufferAttribute>* Layout;
+		/// <summary>
+		/// The size of a single vertex, in bytes
+		/// </summary>
+		size_t                 Stride;
+		const void*            Vertices;
+		size_t                 VertexCount;
+		/// <summary>
+		/// The indices of the mesh, these will be stored as 16 bit indices if they all fit
+		/// </summary>
+		const uint32_t*        Indices;
+		size_t                 IndexCount;
+		/// <summary>
+		/// The ranges to draw the mesh with, or empty to draw it with a single draw call (see VertexArrayObject::SetDrawRanges)
+		/// </summary>
+		std::vector<DrawRange> Ranges;
+		/// <summary>
+		/// The matrix that converts stored positions into model space (see VertexArrayObject::SetDequantization)
+		/// </summary>
+		glm::mat4              Dequantization;
+		/// <summary>
+		/// The model space bounding sphere of the mesh (see VertexArrayObject::SetBounds)
+		/// </summary>
+		glm::vec3              BoundsCenter;
+		float                  BoundsRadius;
+
+		MeshData() :
+			Layout(nullptr), Stride(0), Vertices(nullptr), VertexCount(0), Indices(nullptr), IndexCount(0),
+			Ranges(), Dequantization(1.0f), BoundsCenter(0.0f), BoundsRadius(0.0f)
+		{ }
+	};
+
+public:
+	/// <summary>
+	/// Creates a new mesh cooker storing cooked files in the given directory, which will be created if needed
+	/// </summary>
+	/// <param name="directory">The directory to store cooked meshes in</param>
+	MeshCooker(const std::string& directory);
+	~MeshCooker() = default;
+
+	/// <summary>
+	/// Gets the directory that cooked meshes are stored in
+	/// </summary>
+	const std::string& GetDirectory() const { return _directory; }
+
+	/// <summary>
+	/// Computes the key for a mesh from the contents of it's source file and the options it's being loaded with
+	/// </summary>
+	/// <param name="path">The path of the source file</param>
+	/// <param name="options">Every option that changes the result of the load</param>
+	/// <returns>The key for the mesh, or 0 if the source file could not be read</returns>
+	uint64_t ComputeKey(const std::string& path, const std::string& options) const;
+
+	/// <summary>
+	/// Writes a baked mesh to the cache, replacing any existing file with the same key
+	/// </summary>
+	/// <param name="key">The key of the mesh, from ComputeKey</param>
+	/// <param name="mesh">The mesh to write</param>
+	/// <returns>True if the mesh was written</returns>
+	bool Write(uint64_t key, const MeshData& mesh) const;
+	/// <summary>
+	/// Loads a cooked mesh, uploading it straight from the memory mapped file
+	/// </summary>
+	/// <param name="key">The key of the mesh, from ComputeKey</param>
+	/// <param name="arena">The arena to upload the mesh to, or nullptr for the mesh to get it's own buffers</param>
+	/// <returns>The mesh with it's bounds set, or nullptr if the cache does not have an up to date copy</returns>
+	VertexArrayObject::sptr TryLoad(uint64_t key, const GeometryArena::sptr& arena = GeometryArena::GetDefault()) const;
+
+	/// <summary>
+	/// Gets the cooker that meshes will be loaded through, or nullptr if meshes are always built from their source
+	/// </summary>
+	static const sptr& GetDefault() { return _default; }
+	/// <summary>
+	/// Sets the cooker that meshes will be loaded through, or nullptr to always build meshes from their source
+	/// </summary>
+	static void SetDefault(const sptr& cooker) { _default = cooker; }
+
+protected:
+	std::string _directory;
+
+	// Gets the path of the file storing the cooked mesh with the given key
+	std::string _GetPath(uint64_t key) const;
+
+	static sptr _default;
+};
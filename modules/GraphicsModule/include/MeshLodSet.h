@@ -0,0 +1,116 @@
+#pragma once
+#include <GLM/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "VertexArrayObject.h"
+
+/// <summary>
+/// A chain of progressively simpler versions of a mesh (see MeshBuilder::BakeLods), along with the geometric error of
+/// each level. Renderers pick a level each frame by projecting the error onto the screen
+/// </summary>
+class MeshLodSet final
+{
+public:
+	typedef std::shared_ptr<MeshLodSet> sptr;
+	static inline sptr Create() {
+		return std::make_shared<MeshLodSet>();
+	}
+	// We'll disallow moving and copying, LOD sets are shared between renderers via pointers
+	MeshLodSet(const MeshLodSet& other) = delete;
+	MeshLodSet(MeshLodSet&& other) = delete;
+	MeshLodSet& operator=(const MeshLodSet& other) = delete;
+	MeshLodSet& operator=(MeshLodSet&& other) = delete;
+
+	/// <summary>
+	/// The default number of pixels of error we allow before switching to a more detailed level
+	/// </summary>
+	static constexpr float DEFAULT_PIXEL_THRESHOLD = 1.0f;
+	/// <summary>
+	/// The default fraction below the threshold a coarser level must be before we switch to it, stops levels from
+	/// flickering back and forth when the error is right at the threshold
+	/// </summary>
+	static constexpr float DEFAULT_HYSTERESIS = 0.25f;
+
+	/// <summary>
+	/// A single level in the chain
+	/// </summary>
+	struct Level
+	{
+		VertexArrayObject::sptr Mesh;
+		/// <summary>
+		/// The handle of Mesh in ResourcePools::Meshes, so renderers can switch to the level without any lookups
+		/// </summary>
+		MeshHandle Handle;
+		/// <summary>
+		/// The approximate distance the surface has moved from the original mesh, in model space
+		/// </summary>
+		float Error;
+		size_t TriangleCount;
+	};
+
+public:
+	MeshLodSet();
+	// Removes the level meshes from the mesh pool
+	~MeshLodSet();
+
+	/// <summary>
+	/// Adds a level to the end of the chain, levels should be added from most to least detailed. The mesh is added to
+	/// ResourcePools::Meshes for as long as the LOD set is alive
+	/// </summary>
+	/// <param name="mesh">The mesh to draw for this level</param>
+	/// <param name="error">The geometric error of the level, in model space</param>
+	/// <param name="triangleCount">The number of triangles in the level</param>
+	void AddLevel(const VertexArrayObject::sptr& mesh, float error, size_t triangleCount);
+
+	/// <summary>
+	/// Returns the number of levels in the chain
+	/// </summary>
+	size_t GetLevelCount() const { return _levels.size(); }
+	/// <summary>
+	/// Returns the level at the given index, where level 0 is the most detailed
+	/// </summary>
+	const Level& GetLevel(size_t index) const { return _levels[index]; }
+	/// <summary>
+	/// Returns the number of bytes of vertex and index data used by all the levels, counting vertices shared by
+	/// several levels once
+	/// </summary>
+	size_t GetDataSize() const;
+
+	/// <summary>
+	/// Sets the bounding sphere of the mesh in model space, used to find the distance to the camera
+	/// </summary>
+	void SetBounds(const glm::vec3& center, float radius) { _boundsCenter = center; _boundsRadius = radius; }
+	const glm::vec3& GetBoundsCenter() const { return _boundsCenter; }
+	float GetBoundsRadius() const { return _boundsRadius; }
+
+	/// <summary>
+	/// Finds how many pixels a unit of model space error covers on screen for an object with the given transform
+	/// </summary>
+	/// <param name="world">The world transform of the object</param>
+	/// <param name="cameraPos">The position of the camera in world space</param>
+	/// <param name="projection">The camera's projection matrix</param>
+	/// <param name="viewportHeight">The height of the viewport, in pixels</param>
+	float GetPixelsPerUnit(const glm::mat4& world, const glm::vec3& cameraPos, const glm::mat4& projection, float viewportHeight) const;
+
+	/// <summary>
+	/// Selects the coarsest level whose error on screen is below the threshold. Switching to a coarser level than the
+	/// current one requires the error to be a fraction below the threshold, so that levels don't flicker
+	/// </summary>
+	/// <param name="current">The level the object was drawn with last frame</param>
+	/// <param name="pixelsPerUnit">The result of GetPixelsPerUnit for the object</param>
+	/// <param name="threshold">The maximum allowed error, in pixels</param>
+	/// <param name="hysteresis">The fraction of the threshold a coarser level must be below before we switch to it</param>
+	/// <returns>The index of the level to draw</returns>
+	size_t SelectLevel(size_t current, float pixelsPerUnit, float threshold = DEFAULT_PIXEL_THRESHOLD, float hysteresis = DEFAULT_HYSTERESIS) const;
+
+protected:
+	std::vector<Level> _levels;
+	glm::vec3 _boundsCenter;
+	float     _boundsRadius;
+};
+
+/// <summary>
+/// A handle to a LOD set in ResourcePools::LodSets
+/// </summary>
+typedef ResourceHandle<MeshLodSet> LodSetHandle;
@@ -0,0 +1,146 @@
+#pragma once
+#include <GLM/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "VertexArrayObject.h"
+
+/// <summary>
+/// Contains the algorithms used by MeshBuilder::Optimize to re-order a mesh so the GPU can render it faster. All of
+/// these operate on raw index lists, so they can be used with any vertex type
+/// </summary>
+class MeshOptimizer
+{
+public:
+	/// <summary>
+	/// Used in remap tables to mark vertices that are no longer referenced
+	/// </summary>
+	static constexpr uint32_t INVALID_INDEX = ~0u;
+	/// <summary>
+	/// The size of the FIFO cache we simulate when analyzing meshes. Most GPUs have a cache at least this large
+	/// </summary>
+	static constexpr size_t DEFAULT_CACHE_SIZE = 16;
+
+	/// <summary>
+	/// Statistics about how well a mesh uses the post-transform vertex cache
+	/// </summary>
+	struct CacheStats
+	{
+		/// <summary>
+		/// Average cache miss ratio, the number of vertices transformed per triangle. Ranges from 0.5 (ideal) to 3.0 (no reuse)
+		/// </summary>
+		float ACMR;
+		/// <summary>
+		/// Average transformed vertex ratio, the number of times each vertex is transformed. 1.0 is ideal
+		/// </summary>
+		float ATVR;
+	};
+
+	/// <summary>
+	/// The before and after statistics from an optimization pass
+	/// </summary>
+	struct Report
+	{
+		CacheStats Before;
+		CacheStats After;
+		size_t     VerticesBefore;
+		size_t     VerticesAfter;
+	};
+
+	/// <summary>
+	/// Simulates a FIFO post-transform cache to measure how well the index order re-uses vertices
+	/// </summary>
+	/// <param name="indices">The triangle list to analyze</param>
+	/// <param name="indexCount">The number of indices in the list</param>
+	/// <param name="vertexCount">The number of vertices that the indices reference</param>
+	/// <param name="cacheSize">The number of entries in the simulated cache</param>
+	static CacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t cacheSize = DEFAULT_CACHE_SIZE);
+
+	/// <summary>
+	/// Finds vertices that are byte-for-byte identical, and generates a table mapping each vertex to the first copy
+	/// </summary>
+	/// <param name="vertices">A pointer to the vertex data</param>
+	/// <param name="vertexSize">The size of a single vertex, in bytes</param>
+	/// <param name="vertexCount">The number of vertices</param>
+	/// <param name="outRemap">Will be filled with the new index of each vertex</param>
+	/// <returns>The number of unique vertices</returns>
+	static size_t WeldVertices(const void* vertices, size_t vertexSize, size_t vertexCount, std::vector<uint32_t>& outRemap);
+
+	/// <summary>
+	/// Re-orders triangles in place to improve post-transform cache hits, using Tom Forsyth's linear-speed vertex
+	/// cache optimization
+	/// </summary>
+	/// <param name="indices">The triangle list to re-order</param>
+	/// <param name="indexCount">The number of indices in the list</param>
+	/// <param name="vertexCount">The number of vertices that the indices reference</param>
+	static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+	/// <summary>
+	/// Re-orders clusters of triangles to reduce overdraw, while keeping most of the vertex cache efficiency. The
+	/// triangle list should already be optimized for the vertex cache. Clusters that face away from the center of
+	/// the mesh are drawn first, since they are the most likely to occlude the rest of the mesh
+	/// </summary>
+	/// <param name="indices">The triangle list to re-order</param>
+	/// <param name="indexCount">The number of indices in the list</param>
+	/// <param name="positions">The positions of the vertices</param>
+	/// <param name="vertexCount">The number of vertices</param>
+	/// <param name="threshold">How much worse than the mesh's ACMR a cluster can be, higher values give more clusters</param>
+	static void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const glm::vec3* positions, size_t vertexCount, float threshold = 1.05f);
+
+	/// <summary>
+	/// Generates a table that will re-order vertices to match the order they are first used in the index list, so
+	/// that vertex fetches are mostly sequential. Unused vertices will be mapped to INVALID_INDEX
+	/// </summary>
+	/// <param name="indices">The triangle list</param>
+	/// <param name="indexCount">The number of indices in the list</param>
+	/// <param name="vertexCount">The number of vertices</param>
+	/// <param name="outRemap">Will be filled with the new index of each vertex</param>
+	/// <returns>The number of vertices that are referenced by the index list</returns>
+	static size_t OptimizeVertexFetch(const uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& outRemap);
+
+	/// <summary>
+	/// Splits a triangle list into ranges that each reference at most maxVertices vertices, so they can be drawn with
+	/// 16 bit indices and a base vertex. Vertices shared between ranges are duplicated
+	/// </summary>
+	/// <param name="indices">The triangle list to split</param>
+	/// <param name="indexCount">The number of indices in the list</param>
+	/// <param name="vertexCount">The number of vertices that the indices reference</param>
+	/// <param name="outVertexSources">Will be filled with the source vertex for each vertex in the split mesh</param>
+	/// <param name="outIndices">Will be filled with the new indices, relative to the base vertex of their range</param>
+	/// <param name="outRanges">Will be filled with the ranges of the split mesh</param>
+	/// <param name="maxVertices">The maximum number of vertices in a single range</param>
+	static void SplitIndices(const uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& outVertexSources,
+		std::vector<uint32_t>& outIndices, std::vector<DrawRange>& outRanges, size_t maxVertices = IndexBuffer::SHORT_INDEX_LIMIT);
+	/// <summary>
+	/// Splits several triangle lists over the same vertices (ex: the levels of a LOD chain) so that they can all be
+	/// drawn from one split vertex buffer. The first list is split with SplitIndices, and triangles from the other
+	/// lists are drawn from whichever of it's ranges already holds all three of their vertices. Only triangles that
+	/// don't fit in any range add vertices, in extra ranges shared by all the lists
+	/// </summary>
+	/// <param name="lists">The triangle lists to split, all referencing the same vertices</param>
+	/// <param name="vertexCount">The number of vertices that the indices reference</param>
+	/// <param name="outVertexSources">Will be filled with the source vertex for each vertex in the split mesh</param>
+	/// <param name="outIndices">Will be filled with the new indices of every list back to back, in the same order and
+	/// with the same size as the input lists, relative to the base vertex of their range</param>
+	/// <param name="outRanges">Will be filled with the ranges of each list, relative to the start of that list's indices</param>
+	/// <param name="maxVertices">The maximum number of vertices in a single range</param>
+	static void SplitSharedIndices(const std::vector<std::vector<uint32_t>>& lists, size_t vertexCount, std::vector<uint32_t>& outVertexSources,
+		std::vector<uint32_t>& outIndices, std::vector<std::vector<DrawRange>>& outRanges, size_t maxVertices = IndexBuffer::SHORT_INDEX_LIMIT);
+
+	/// <summary>
+	/// Simplifies a triangle list using quadric error metrics, collapsing edges until the target index count is reached
+	/// or there are no more edges that can be collapsed. The vertices are not modified, only the index list, so the
+	/// result can be used with the same vertex buffer. Vertices on open borders are never moved
+	/// </summary>
+	/// <param name="indices">The triangle list to simplify</param>
+	/// <param name="indexCount">The number of indices in the list</param>
+	/// <param name="positions">The positions of the vertices</param>
+	/// <param name="vertexCount">The number of vertices</param>
+	/// <param name="targetIndexCount">The number of indices to aim for</param>
+	/// <param name="outIndices">Will be filled with the simplified triangle list</param>
+	/// <returns>The approximate geometric error of the result, as a distance in model space</returns>
+	static float Simplify(const uint32_t* indices, size_t indexCount, const glm::vec3* positions, size_t vertexCount, size_t targetIndexCount, std::vector<uint32_t>& outIndices);
+
+protected:
+	MeshOptimizer() = default;
+	~MeshOptimizer() = default;
+};
@@ -9,4 +9,7 @@ public:
 protected:
 	NotObjLoader() = default;
 	~NotObjLoader() = default;
+
+	// Parses and bakes a mesh without going through the resource cache
+	static VertexArrayObject::sptr _Load(const std::string& filename);
 };
\ No newline at end of file
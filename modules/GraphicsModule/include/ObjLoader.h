@@ -4,9 +4,46 @@
 class ObjLoader
 {
 public:
-	static VertexArrayObject::sptr LoadFromFile(const std::string& filename, const glm::vec4& inColor = glm::vec4(1.0f));
+	/// <summary>
+	/// Loads a mesh from an OBJ file
+	/// </summary>
+	/// <param name="filename">The path to the file to load</param>
+	/// <param name="inColor">The color to give all the vertices in the mesh</param>
+	/// <param name="packed">If true, the mesh will be baked using VertexPackedPosNormTexCol. Shaders drawing it will need to be compiled with PACKED_NORMALS</param>
+	/// <param name="optimize">If true, the mesh will be optimized for the vertex cache and overdraw before baking (see MeshBuilder::Optimize)</param>
+	static VertexArrayObject::sptr LoadFromFile(const std::string& filename, const glm::vec4& inColor = glm::vec4(1.0f), bool packed = false, bool optimize = false);
+
+	/// <summary>
+	/// Loads a mesh from an OBJ file, and generates a chain of simplified versions of it (see MeshBuilder::BakeLods)
+	/// </summary>
+	/// <param name="filename">The path to the file to load</param>
+	/// <param name="inColor">The color to give all the vertices in the mesh</param>
+	/// <param name="packed">If true, the levels will be baked using VertexPackedPosNormTexCol</param>
+	/// <param name="ratios">The fraction of the original triangles to keep for each level, from most to least detailed</param>
+	static MeshLodSet::sptr LoadLodsFromFile(const std::string& filename, const glm::vec4& inColor = glm::vec4(1.0f), bool packed = false,
+		const std::vector<float>& ratios = { 1.0f, 0.5f, 0.25f, 0.1f });
+
+	/// <summary>
+	/// Reads the contents of an OBJ file into a mesh builder. The file is memory mapped and split into chunks of lines
+	/// that are parsed in parallel, then the chunks are merged in file order, so the result is the same as ParseStream
+	/// </summary>
+	/// <param name="filename">The path to the file to load</param>
+	/// <param name="inColor">The color to give all the vertices in the mesh</param>
+	/// <param name="mesh">The mesh builder to add the vertices and triangles to</param>
+	static void Parse(const std::string& filename, const glm::vec4& inColor, MeshBuilder<VertexPosNormTexCol>& mesh);
+	/// <summary>
+	/// Reads the contents of an OBJ file into a mesh builder one line at a time with an std::ifstream. This is the
+	/// original parser, kept around as a reference for Parse
+	/// </summary>
+	/// <param name="filename">The path to the file to load</param>
+	/// <param name="inColor">The color to give all the vertices in the mesh</param>
+	/// <param name="mesh">The mesh builder to add the vertices and triangles to</param>
+	static void ParseStream(const std::string& filename, const glm::vec4& inColor, MeshBuilder<VertexPosNormTexCol>& mesh);
 
 protected:
+	// Loads and simplifies a mesh without going through the resource cache
+	static MeshLodSet::sptr _LoadLods(const std::string& filename, const glm::vec4& inColor, bool packed, const std::vector<float>& ratios);
+
 	ObjLoader() = default;
 	~ObjLoader() = default;
 };
\ No newline at end of file
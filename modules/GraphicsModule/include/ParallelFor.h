@@ -0,0 +1,44 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Runs a function for every index in [0, count) across all of the CPU's cores, and waits for all of them to finish.
+/// Indices are handed out a chunk at a time from a shared counter, so work that is uneven still balances out across
+/// the threads. The calling thread does it's share of the work as well
+/// </summary>
+/// <param name="count">The number of indices to run the function for</param>
+/// <param name="func">The function to run, taking the index as it's only parameter. Must be safe to call from multiple threads</param>
+/// <param name="chunkSize">The number of indices that a thread claims at a time</param>
+template <typename Func>
+void ParallelFor(size_t count, const Func& func, size_t chunkSize = 1) {
+	if (count == 0) {
+		return;
+	}
+	chunkSize = std::max<size_t>(chunkSize, 1);
+	size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+	size_t threadCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), chunkCount);
+
+	std::atomic<size_t> next(0);
+	auto worker = [&]() {
+		for (size_t begin = next.fetch_add(chunkSize); begin < count; begin = next.fetch_add(chunkSize)) {
+			size_t end = std::min(begin + chunkSize, count);
+			for (size_t ix = begin; ix < end; ix++) {
+				func(ix);
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount - 1);
+	for (size_t ix = 1; ix < threadCount; ix++) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
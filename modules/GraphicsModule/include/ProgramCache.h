@@ -0,0 +1,123 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// <summary>
+/// Stores linked shader programs on disk using glGetProgramBinary, so that on the next run they can be restored with
+/// glProgramBinary instead of being compiled from source. Binaries are keyed by a hash of the program's sources and
+/// the driver (GL_VENDOR, GL_RENDERER and GL_VERSION), so a driver update or an edited shader will miss the cache
+/// </summary>
+class ProgramCache final
+{
+public:
+	typedef std::shared_ptr<ProgramCache> sptr;
+	static inline sptr Create(const std::string& directory = DEFAULT_DIRECTORY) {
+		return std::make_shared<ProgramCache>(directory);
+	}
+	// We'll disallow moving and copying, since the cache is shared via pointers
+	ProgramCache(const ProgramCache& other) = delete;
+	ProgramCache(ProgramCache&& other) = delete;
+	ProgramCache& operator=(const ProgramCache& other) = delete;
+	ProgramCache& operator=(ProgramCache&& other) = delete;
+
+	/// <summary>
+	/// The default directory that binaries are stored in, relative to the working directory
+	/// </summary>
+	static constexpr const char* DEFAULT_DIRECTORY = "cache/shaders";
+
+	/// <summary>
+	/// Statistics about how the cache has been used since it was created
+	/// </summary>
+	struct Stats
+	{
+		/// <summary>
+		/// The number of programs restored from a binary
+		/// </summary>
+		size_t Hits;
+		/// <summary>
+		/// The number of programs that had to be compiled from source
+		/// </summary>
+		size_t Misses;
+		/// <summary>
+		/// The number of binaries that were found but rejected by the driver
+		/// </summary>
+		size_t Rejected;
+		/// <summary>
+		/// The total time the main thread spent building programs that use this cache, in milliseconds. Time that programs
+		/// spent compiling in the background is not included
+		/// </summary>
+		double LinkTimeMs;
+	};
+
+public:
+	/// <summary>
+	/// Creates a new program cache storing binaries in the given directory, which will be created if needed. Must be
+	/// created after the OpenGL context
+	/// </summary>
+	/// <param name="directory">The directory to store binaries in</param>
+	ProgramCache(const std::string& directory);
+	~ProgramCache() = default;
+
+	/// <summary>
+	/// Returns true if the driver supports program binaries, if not the cache will never load or store anything
+	/// </summary>
+	bool IsSupported() const { return _supported; }
+
+	/// <summary>
+	/// Computes the key for a program from the sources of it's stages, after preprocessing
+	/// </summary>
+	/// <param name="stages">The type and source of each stage in the program</param>
+	uint64_t ComputeKey(const std::vector<std::pair<GLenum, std::string>>& stages) const;
+
+	/// <summary>
+	/// Attempts to load the binary with the given key into a program. If the driver rejects the binary, it is deleted
+	/// from the cache and the program will need to be compiled from source
+	/// </summary>
+	/// <param name="program">The handle of the program to load into</param>
+	/// <param name="key">The key for the program, from ComputeKey</param>
+	/// <returns>True if the program was loaded and linked successfully</returns>
+	bool TryLoad(GLuint program, uint64_t key);
+	/// <summary>
+	/// Writes the binary of a linked program to the cache. The program should have been linked with
+	/// GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	/// </summary>
+	/// <param name="program">The handle of the linked program</param>
+	/// <param name="key">The key for the program, from ComputeKey</param>
+	void Store(GLuint program, uint64_t key);
+
+	/// <summary>
+	/// Records how long a program took to link, for the cache statistics
+	/// </summary>
+	/// <param name="fromCache">True if the program was restored from the cache</param>
+	/// <param name="milliseconds">The time it took to link, in milliseconds</param>
+	void RecordLink(bool fromCache, double milliseconds);
+	/// <summary>
+	/// Returns the statistics for this cache
+	/// </summary>
+	const Stats& GetStats() const { return _stats; }
+
+	/// <summary>
+	/// Gets the cache that shaders will use when they are linked, or nullptr if programs should always be compiled
+	/// </summary>
+	static const sptr& GetDefault() { return _default; }
+	/// <summary>
+	/// Sets the cache that shaders will use when they are linked, or nullptr to always compile from source
+	/// </summary>
+	static void SetDefault(const sptr& cache) { _default = cache; }
+
+protected:
+	std::string _directory;
+	// Hash of the vendor, renderer and version strings, so binaries from another driver are never loaded
+	uint64_t    _driverHash;
+	bool        _supported;
+	Stats       _stats;
+
+	// Gets the path of the file storing the binary with the given key
+	std::string _GetPath(uint64_t key) const;
+
+	static sptr _default;
+};
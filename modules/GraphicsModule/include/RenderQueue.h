@@ -0,0 +1,127 @@
+#pragma once
+#include <GLM/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "RendererComponent.h"
+#include "Transform.h"
+
+/// <summary>
+/// Collects the renderers for a frame and sorts them into draw order using a packed 64 bit key per draw, instead of
+/// comparing components directly. From the most to least significant bits, a key holds:
+///
+///   Opaque:      layer (8) | 0 (1) | shader ID (10) | material ID (12) | VAO (9) | mesh ID (10) | depth (14)
+///   Transparent: layer (8) | 1 (1) | inverted depth (14) | shader ID (10) | material ID (12) | VAO (9) | mesh ID (10)
+///
+/// So opaque objects are grouped by state to minimize switches, and drawn front to back within a group, while
+/// transparent objects are drawn back to front after all the opaque objects in their layer. The keys are radix sorted,
+/// and if the keys are identical to the last frame's the previous order is reused without sorting at all.
+///
+/// The renderer's handles are resolved when they are pushed, and the queue stores raw pointers to the resources and the
+/// transform, so the registry and resource pools must not be modified between Push and drawing
+/// </summary>
+class RenderQueue final
+{
+public:
+	typedef std::shared_ptr<RenderQueue> sptr;
+	static inline sptr Create(size_t capacity = DEFAULT_CAPACITY) {
+		return std::make_shared<RenderQueue>(capacity);
+	}
+	// We'll disallow moving and copying, since we want to manually control when the destructor is called
+	// We'll use these classes via pointers
+	RenderQueue(const RenderQueue& other) = delete;
+	RenderQueue(RenderQueue&& other) = delete;
+	RenderQueue& operator=(const RenderQueue& other) = delete;
+	RenderQueue& operator=(RenderQueue&& other) = delete;
+
+	/// <summary>
+	/// The number of draws we reserve room for up front, the queue will grow past this if needed
+	/// </summary>
+	static const size_t DEFAULT_CAPACITY = 4096;
+
+	/// <summary>
+	/// A single draw in the queue
+	/// </summary>
+	struct Item
+	{
+		const VertexArrayObject* Mesh;
+		ShaderMaterial*          Material;
+		const ::Transform*       Transform;
+	};
+
+public:
+	/// <summary>
+	/// Creates a new render queue
+	/// </summary>
+	/// <param name="capacity">The number of draws to reserve room for</param>
+	RenderQueue(size_t capacity = DEFAULT_CAPACITY);
+	~RenderQueue() = default;
+
+	/// <summary>
+	/// Starts a new frame, clearing the draws from the previous frame
+	/// </summary>
+	/// <param name="view">The view matrix of the camera, used to find the depth of each object</param>
+	/// <param name="farPlane">The distance to the camera's far plane, depths are quantized between 0 and this</param>
+	void Begin(const glm::mat4& view, float farPlane);
+	/// <summary>
+	/// Adds a renderer to the queue, renderers without a valid mesh, material or shader are ignored
+	/// </summary>
+	/// <param name="renderer">The renderer to draw</param>
+	/// <param name="transform">The transform of the object, it's origin is used for the depth</param>
+	void Push(const RendererComponent& renderer, const ::Transform& transform);
+	/// <summary>
+	/// Sorts the draws that have been pushed this frame, after this they can be read in order with GetItem
+	/// </summary>
+	void Sort();
+
+	/// <summary>
+	/// Returns the number of draws in the queue
+	/// </summary>
+	size_t GetCount() const { return _items.size(); }
+	/// <summary>
+	/// Gets the draw at the given position in the sorted order, only valid after Sort
+	/// </summary>
+	const Item& GetItem(size_t ix) const { return _items[_order[ix]]; }
+	/// <summary>
+	/// Returns true if the last call to Sort reused the previous frame's order, since none of the keys changed
+	/// </summary>
+	bool WasSortSkipped() const { return _sortSkipped; }
+
+	/// <summary>
+	/// Packs the sort key for a single draw, see the class summary for the layout. IDs that don't fit in their field
+	/// are wrapped, which only affects how well draws are grouped
+	/// </summary>
+	/// <param name="layer">The render layer, clamped between -128 and 127</param>
+	/// <param name="transparent">True if the draw is transparent</param>
+	/// <param name="shaderId">The ID of the shader variant (see Shader::GetId)</param>
+	/// <param name="materialId">The ID of the material (see ShaderMaterial::GetId)</param>
+	/// <param name="vaoHandle">The OpenGL VAO the mesh draws from, shared by every mesh in an arena page (see VertexArrayObject::GetHandle)</param>
+	/// <param name="meshId">The ID of the mesh (see VertexArrayObject::GetId)</param>
+	/// <param name="depth">The view depth of the draw, between 0 (at the camera) and 1 (at the far plane)</param>
+	static uint64_t MakeKey(int layer, bool transparent, uint32_t shaderId, uint32_t materialId, uint32_t vaoHandle, uint32_t meshId, float depth);
+
+protected:
+	// A key and the index of the item it belongs to, this is what actually gets sorted
+	struct SortEntry
+	{
+		uint64_t Key;
+		uint32_t Index;
+	};
+
+	glm::mat4 _view;
+	float     _farPlane;
+	bool      _sortSkipped;
+
+	std::vector<Item>      _items;
+	std::vector<uint64_t>  _keys;
+	// The keys from the last sort, in push order, so that we can tell if anything has changed
+	std::vector<uint64_t>  _lastKeys;
+	// Indices into _items in draw order
+	std::vector<uint32_t>  _order;
+	std::vector<SortEntry> _entries;
+	std::vector<SortEntry> _scratch;
+
+	// Sorts the keys with an LSD radix sort 8 bits at a time, filling in _order
+	void _RadixSort();
+};
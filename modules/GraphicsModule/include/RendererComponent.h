@@ -1,12 +1,47 @@
 #pragma once
-#include <VertexArrayObject.h>
-#include <ShaderMaterial.h>
+#include <type_traits>
+#include <ResourcePools.h>
 
+/// <summary>
+/// Draws a mesh with a material. The component only stores handles into ResourcePools, so it is trivially copyable and
+/// the render group can be iterated without touching any reference counts. The resources need to be added to the pools
+/// before they can be used here, and stay alive until they are removed from the pools
+/// </summary>
 class RendererComponent {
 public:
-	VertexArrayObject::sptr Mesh;
-	ShaderMaterial::sptr    Material;
+	MeshHandle     Mesh;
+	MaterialHandle Material;
+	// Optional chain of simplified meshes, if set Mesh will be swapped to the level picked by UpdateLod
+	LodSetHandle   Lods;
+	uint32_t       LodLevel = 0;
 
-	RendererComponent& SetMesh(const VertexArrayObject::sptr& mesh) { Mesh = mesh; return *this; }
-	RendererComponent& SetMaterial(const ShaderMaterial::sptr& material) { Material = material; return *this; }
-};
\ No newline at end of file
+	RendererComponent& SetMesh(MeshHandle mesh) { Mesh = mesh; Lods = LodSetHandle(); LodLevel = 0; return *this; }
+	RendererComponent& SetMaterial(MaterialHandle material) { Material = material; return *this; }
+	RendererComponent& SetLods(LodSetHandle lods) {
+		Lods = lods;
+		LodLevel = 0;
+		const MeshLodSet* lodSet = ResourcePools::LodSets().Get(lods);
+		Mesh = (lodSet != nullptr && lodSet->GetLevelCount() > 0) ? lodSet->GetLevel(0).Handle : MeshHandle();
+		return *this;
+	}
+
+	/// <summary>
+	/// Picks the level of detail to draw this frame based on how large the simplification error would be on screen,
+	/// and updates Mesh to match. Does nothing if there is no LOD set
+	/// </summary>
+	/// <param name="world">The world transform of the object</param>
+	/// <param name="cameraPos">The position of the camera in world space</param>
+	/// <param name="projection">The camera's projection matrix</param>
+	/// <param name="viewportHeight">The height of the viewport, in pixels</param>
+	/// <param name="threshold">The maximum allowed error, in pixels</param>
+	void UpdateLod(const glm::mat4& world, const glm::vec3& cameraPos, const glm::mat4& projection, float viewportHeight, float threshold = MeshLodSet::DEFAULT_PIXEL_THRESHOLD) {
+		const MeshLodSet* lodSet = ResourcePools::LodSets().Get(Lods);
+		if (lodSet == nullptr || lodSet->GetLevelCount() == 0) {
+			return;
+		}
+		LodLevel = static_cast<uint32_t>(lodSet->SelectLevel(LodLevel, lodSet->GetPixelsPerUnit(world, cameraPos, projection, viewportHeight), threshold));
+		Mesh = lodSet->GetLevel(LodLevel).Handle;
+	}
+};
+
+static_assert(std::is_trivially_copyable<RendererComponent>::value, "RendererComponent should only hold handles");
@@ -0,0 +1,167 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+
+#include "Logging.h"
+
+/// <summary>
+/// Shares resources that are loaded from files, so that loading the same file with the same options again gives back
+/// the object that is already loaded instead of parsing and uploading it a second time. Entries are keyed by the
+/// canonical path of the file plus the load options, and only hold weak references, so a resource is still destroyed as
+/// soon as the last thing using it lets go (the next load will then load it fresh).
+///
+/// Texture2D, TextureCubeMap, ObjLoader and NotObjLoader all go through the default cache when one is set. Keep in mind
+/// that cached resources are shared, so changing one (ex: a texture's filtering) changes it for everything using it.
+/// The cache is not thread safe, and should only be used from the main thread
+/// </summary>
+class ResourceCache final
+{
+public:
+	typedef std::shared_ptr<ResourceCache> sptr;
+	static inline sptr Create() {
+		return std::make_shared<ResourceCache>();
+	}
+	// We'll disallow moving and copying, since the cache is shared via pointers
+	ResourceCache(const ResourceCache& other) = delete;
+	ResourceCache(ResourceCache&& other) = delete;
+	ResourceCache& operator=(const ResourceCache& other) = delete;
+	ResourceCache& operator=(ResourceCache&& other) = delete;
+
+	/// <summary>
+	/// Statistics about how the cache has been used since it was created
+	/// </summary>
+	struct Stats
+	{
+		/// <summary>
+		/// The number of loads that were given a resource that was already loaded
+		/// </summary>
+		size_t Hits;
+		/// <summary>
+		/// The number of loads that had to load the resource from it's file
+		/// </summary>
+		size_t Misses;
+		/// <summary>
+		/// The number of resources in the cache that are still alive
+		/// </summary>
+		size_t Entries;
+		/// <summary>
+		/// The estimated amount of GPU memory used by the resources that are still alive, in bytes
+		/// </summary>
+		size_t BytesResident;
+		/// <summary>
+		/// The estimated amount of GPU memory that would have been allocated again if it weren't for the cache, in bytes
+		/// </summary>
+		size_t BytesSaved;
+	};
+
+public:
+	ResourceCache();
+	~ResourceCache() = default;
+
+	/// <summary>
+	/// Makes a key for a resource loaded from a file, different spellings of the same path will give the same key
+	/// </summary>
+	/// <param name="path">The path of the file</param>
+	/// <param name="options">Identifies the type of resource and every option that changes the result of the load</param>
+	static std::string MakeKey(const std::string& path, const std::string& options);
+
+	/// <summary>
+	/// Looks for a resource that is still alive in the cache, and records a hit or miss in the statistics
+	/// </summary>
+	/// <typeparam name="T">The type of the resource, must match the type it was stored with</typeparam>
+	/// <param name="key">The key of the resource, from MakeKey</param>
+	/// <returns>The resource, or nullptr if it isn't in the cache or has been destroyed</returns>
+	template <typename T>
+	std::shared_ptr<T> Find(const std::string& key) {
+		auto it = _entries.find(key);
+		if (it != _entries.end()) {
+			std::shared_ptr<void> resource = it->second.Resource.lock();
+			if (resource != nullptr) {
+				LOG_ASSERT(it->second.Type == typeid(T).hash_code(), "Resource \"{}\" was stored with a different type!", key);
+				_stats.Hits++;
+				_stats.BytesSaved += it->second.Measure(resource.get());
+				return std::static_pointer_cast<T>(resource);
+			}
+			_entries.erase(it);
+		}
+		_stats.Misses++;
+		return nullptr;
+	}
+
+	/// <summary>
+	/// Adds a resource to the cache, replacing anything stored under the same key. T must have a GetDataSize method
+	/// that returns an estimate of the resource's size in bytes
+	/// </summary>
+	/// <param name="key">The key of the resource, from MakeKey</param>
+	/// <param name="resource">The resource to store, the cache will only hold a weak reference to it</param>
+	template <typename T>
+	void Store(const std::string& key, const std::shared_ptr<T>& resource) {
+		Entry& entry = _entries[key];
+		entry.Resource = resource;
+		entry.Type = typeid(T).hash_code();
+		entry.Measure = [](const void* value) { return static_cast<const T*>(value)->GetDataSize(); };
+	}
+
+	/// <summary>
+	/// Removes the entries for resources that have been destroyed
+	/// </summary>
+	void Prune();
+	/// <summary>
+	/// Removes every entry from the cache, resources that are still in use are not affected
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// Returns the statistics for this cache, pruning any destroyed resources first so the counts are up to date
+	/// </summary>
+	const Stats& GetStats();
+
+	/// <summary>
+	/// Loads a resource through the default cache, only calling the load function if the cache doesn't already have it.
+	/// If there is no default cache, this always calls the load function
+	/// </summary>
+	/// <typeparam name="T">The type of resource to load</typeparam>
+	/// <param name="key">The key of the resource, from MakeKey</param>
+	/// <param name="load">A function that loads the resource, returning a std::shared_ptr to T</param>
+	template <typename T, typename LoadFunc>
+	static std::shared_ptr<T> Load(const std::string& key, const LoadFunc& load) {
+		if (_default == nullptr) {
+			return load();
+		}
+		std::shared_ptr<T> result = _default->Find<T>(key);
+		if (result == nullptr) {
+			result = load();
+			if (result != nullptr) {
+				_default->Store(key, result);
+			}
+		}
+		return result;
+	}
+
+	/// <summary>
+	/// Gets the cache that resources are loaded through, or nullptr if every load should load from the file
+	/// </summary>
+	static const sptr& GetDefault() { return _default; }
+	/// <summary>
+	/// Sets the cache that resources are loaded through, or nullptr to always load from the file
+	/// </summary>
+	static void SetDefault(const sptr& cache) { _default = cache; }
+
+protected:
+	struct Entry
+	{
+		std::weak_ptr<void> Resource;
+		// The hash of the resource's type, so that we can catch keys that are used for more than one type
+		size_t              Type;
+		// Estimates the size of the resource, in bytes
+		size_t (*Measure)(const void* resource);
+	};
+
+	std::unordered_map<std::string, Entry> _entries;
+	Stats _stats;
+
+	static sptr _default;
+};
@@ -0,0 +1,165 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "Logging.h"
+
+/// <summary>
+/// A 32 bit handle to a resource in a ResourcePool, made of a slot index and the generation of the slot when the
+/// resource was added. Once the resource is removed the slot's generation changes, so any handles that are still
+/// around become stale instead of pointing at whatever is put in the slot next. A value of 0 is the null handle.
+///
+/// Handles are plain integers, so they can be copied around (ex: in components) without any reference counting
+/// </summary>
+template <typename T>
+struct ResourceHandle
+{
+	static const uint32_t INDEX_BITS = 20;
+	static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+	static const uint32_t MAX_GENERATION = (1u << (32 - INDEX_BITS)) - 1;
+
+	uint32_t Value = 0;
+
+	ResourceHandle() = default;
+	ResourceHandle(uint32_t index, uint32_t generation) : Value((generation << INDEX_BITS) | (index & INDEX_MASK)) { }
+
+	uint32_t GetIndex() const { return Value & INDEX_MASK; }
+	uint32_t GetGeneration() const { return Value >> INDEX_BITS; }
+	bool IsNull() const { return Value == 0; }
+
+	bool operator ==(const ResourceHandle& other) const { return Value == other.Value; }
+	bool operator !=(const ResourceHandle& other) const { return Value != other.Value; }
+};
+
+/// <summary>
+/// Stores resources of a single type in slots that are referred to by generational handles. The pool holds a strong
+/// reference to every resource in it, so resources stay alive until they are explicitly removed (or the pool is cleared),
+/// no matter how many handles to them are still around. Looking up a stale handle gives nullptr, and will assert in
+/// debug builds since it usually means something is holding on to a resource it shouldn't
+/// </summary>
+template <typename T>
+class ResourcePool final
+{
+public:
+	typedef ResourceHandle<T> Handle;
+
+	ResourcePool() = default;
+	~ResourcePool() = default;
+
+	// We'll disallow moving and copying, handles would point into the wrong pool
+	ResourcePool(const ResourcePool& other) = delete;
+	ResourcePool(ResourcePool&& other) = delete;
+	ResourcePool& operator=(const ResourcePool& other) = delete;
+	ResourcePool& operator=(ResourcePool&& other) = delete;
+
+	/// <summary>
+	/// Adds a resource to the pool, the pool will keep it alive until the handle is removed
+	/// </summary>
+	/// <param name="resource">The resource to add, must not be nullptr</param>
+	/// <returns>A handle to the resource</returns>
+	Handle Add(const std::shared_ptr<T>& resource) {
+		LOG_ASSERT(resource != nullptr, "Cannot add a null resource to a pool!");
+		uint32_t index;
+		if (!_free.empty()) {
+			index = _free.back();
+			_free.pop_back();
+		} else {
+			LOG_ASSERT(_slots.size() <= Handle::INDEX_MASK, "Resource pool is full!");
+			index = static_cast<uint32_t>(_slots.size());
+			_slots.push_back({ nullptr, 1 });
+		}
+		_slots[index].Resource = resource;
+		_count++;
+		return Handle(index, _slots[index].Generation);
+	}
+
+	/// <summary>
+	/// Removes a resource from the pool, making all handles to it stale. The resource is destroyed if nothing else
+	/// holds a reference to it
+	/// </summary>
+	/// <param name="handle">The handle to remove</param>
+	/// <returns>True if the handle was valid, false if it was null or already stale</returns>
+	bool Remove(Handle handle) {
+		if (!IsValid(handle)) {
+			return false;
+		}
+		// Move the resource out first, so that if it's destructor touches the pool it sees a consistent state
+		std::shared_ptr<T> resource = std::move(_slots[handle.GetIndex()].Resource);
+		_Release(handle.GetIndex());
+		return true;
+	}
+
+	/// <summary>
+	/// Removes every resource from the pool, making all existing handles stale
+	/// </summary>
+	void Clear() {
+		std::vector<std::shared_ptr<T>> resources;
+		resources.reserve(_count);
+		for (uint32_t ix = 0; ix < _slots.size(); ix++) {
+			if (_slots[ix].Resource != nullptr) {
+				resources.push_back(std::move(_slots[ix].Resource));
+				_Release(ix);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Returns true if the handle refers to a resource that is still in the pool
+	/// </summary>
+	bool IsValid(Handle handle) const {
+		uint32_t index = handle.GetIndex();
+		return !handle.IsNull() && index < _slots.size() && _slots[index].Generation == handle.GetGeneration() &&
+			_slots[index].Resource != nullptr;
+	}
+
+	/// <summary>
+	/// Gets the resource for a handle, or nullptr if the handle is null or stale. Does not touch any reference counts,
+	/// so the pointer is only valid until the resource is removed
+	/// </summary>
+	T* Get(Handle handle) const {
+		if (handle.IsNull()) {
+			return nullptr;
+		}
+		if (!IsValid(handle)) {
+			#ifdef _DEBUG
+			LOG_ASSERT(false, "Stale resource handle! (index {}, generation {})", handle.GetIndex(), handle.GetGeneration());
+			#endif
+			return nullptr;
+		}
+		return _slots[handle.GetIndex()].Resource.get();
+	}
+
+	/// <summary>
+	/// Gets a shared reference to the resource for a handle, for when it needs to outlive it's slot in the pool. Gives
+	/// nullptr if the handle is null or stale
+	/// </summary>
+	std::shared_ptr<T> GetShared(Handle handle) const {
+		return IsValid(handle) ? _slots[handle.GetIndex()].Resource : nullptr;
+	}
+
+	/// <summary>
+	/// Returns the number of resources in the pool
+	/// </summary>
+	size_t GetCount() const { return _count; }
+
+protected:
+	struct Slot
+	{
+		std::shared_ptr<T> Resource;
+		uint32_t           Generation;
+	};
+
+	std::vector<Slot>     _slots;
+	std::vector<uint32_t> _free;
+	size_t                _count = 0;
+
+	// Bumps the generation of an emptied slot so old handles go stale, and returns it to the free list
+	void _Release(uint32_t index) {
+		Slot& slot = _slots[index];
+		// Generation 0 is never used, so that the null handle can't match a slot
+		slot.Generation = slot.Generation >= Handle::MAX_GENERATION ? 1 : slot.Generation + 1;
+		_free.push_back(index);
+		_count--;
+	}
+};
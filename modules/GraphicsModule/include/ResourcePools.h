@@ -0,0 +1,37 @@
+#pragma once
+#include "ResourcePool.h"
+#include "ITexture.h"
+#include "MeshLodSet.h"
+#include "Shader.h"
+#include "ShaderMaterial.h"
+#include "VertexArrayObject.h"
+
+/// <summary>
+/// The global pools that renderers refer to resources through. Resources are added explicitly and live until they are
+/// removed, or until Clear is called, which must happen before the OpenGL context is destroyed
+/// </summary>
+class ResourcePools final
+{
+public:
+	// This is a static class, it can't be constructed
+	ResourcePools() = delete;
+
+	static ResourcePool<VertexArrayObject>& Meshes() { return _meshes; }
+	static ResourcePool<ShaderMaterial>& Materials() { return _materials; }
+	static ResourcePool<Shader>& Shaders() { return _shaders; }
+	static ResourcePool<ITexture>& Textures() { return _textures; }
+	static ResourcePool<MeshLodSet>& LodSets() { return _lodSets; }
+
+	/// <summary>
+	/// Removes everything from all the pools. Pools are cleared from the users of resources down (ex: LOD sets before
+	/// meshes), so nothing is destroyed while something else still expects to find it
+	/// </summary>
+	static void Clear();
+
+protected:
+	static ResourcePool<VertexArrayObject> _meshes;
+	static ResourcePool<ShaderMaterial>    _materials;
+	static ResourcePool<Shader>            _shaders;
+	static ResourcePool<ITexture>          _textures;
+	static ResourcePool<MeshLodSet>        _lodSets;
+};
@@ -1,23 +1,151 @@
 #pragma once
 #include <glad/glad.h>
+#include <cstdint>
 #include <memory>
 
 #include <string>               // for std::string
 #include <unordered_map>        // for std::unordered_map
+#include <unordered_set>        // for std::unordered_set
+#include <vector>               // for std::vector
 #include <GLM/glm.hpp>          // for our GLM types
 #include <GLM/gtc/type_ptr.hpp> // for glm::value_ptr
 #include "Logging.h"            // for the logging functions
+#include "IdPool.h"             // for our sort key IDs
+#include "ResourcePool.h"       // for ResourceHandle
+
+class ProgramCache;
+
+// GL_KHR_parallel_shader_compile isn't in our glad loader, so we declare the parts of it that we use ourselves
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+/// <summary>
+/// Hashes a string using 32 bit FNV-1a. This is constexpr, so hashes of string literals can be computed at compile time
+/// </summary>
+/// <param name="str">The string to hash</param>
+/// <param name="length">The number of characters to hash</param>
+constexpr uint32_t HashFnv1a(const char* str, size_t length) {
+	uint32_t hash = 2166136261u;
+	for (size_t ix = 0; ix < length; ix++) {
+		hash = (hash ^ static_cast<uint8_t>(str[ix])) * 16777619u;
+	}
+	return hash;
+}
+/// <summary>
+/// Hashes a null terminated string using 32 bit FNV-1a
+/// </summary>
+constexpr uint32_t HashFnv1a(const char* str) {
+	size_t length = 0;
+	while (str[length] != '\0') {
+		length++;
+	}
+	return HashFnv1a(str, length);
+}
+
+/// <summary>
+/// Identifies a uniform by the hash of it's name, so that uniforms can be looked up without building or hashing strings.
+/// Declare these as constexpr so the hash is done at compile time, ex:
+/// static constexpr UniformId U_MODEL("u_Model");
+/// </summary>
+struct UniformId
+{
+	uint32_t Hash;
+
+	constexpr explicit UniformId(const char* name) : Hash(HashFnv1a(name)) {}
+	explicit UniformId(const std::string& name) : Hash(HashFnv1a(name.c_str(), name.length())) {}
+
+	constexpr bool operator ==(const UniformId& other) const { return Hash == other.Hash; }
+	constexpr bool operator !=(const UniformId& other) const { return Hash != other.Hash; }
+};
 
 /// <summary>
-/// This class will wrap around an OpenGL shader program
+/// Describes an active uniform in a linked shader program, as reported by the program interface queries
 /// </summary>
-class Shader final
+struct UniformInfo
+{
+	std::string Name;
+	uint32_t    Hash;
+	/// <summary>
+	/// The GLSL type of the uniform (ex: GL_FLOAT_VEC3, GL_SAMPLER_2D)
+	/// </summary>
+	GLenum      Type;
+	/// <summary>
+	/// The location of the uniform, or -1 if the uniform is in a uniform block
+	/// </summary>
+	GLint       Location;
+	GLint       ArraySize;
+	/// <summary>
+	/// The index of the uniform block the uniform belongs to (into Shader::GetUniformBlocks), or -1 for regular uniforms
+	/// </summary>
+	GLint       BlockIndex;
+	/// <summary>
+	/// The byte offset of the uniform from the start of it's block, or -1 for regular uniforms
+	/// </summary>
+	GLint       Offset;
+};
+
+/// <summary>
+/// Describes an active uniform block in a linked shader program
+/// </summary>
+struct UniformBlockInfo
+{
+	std::string Name;
+	uint32_t    Hash;
+	GLint       Binding;
+	/// <summary>
+	/// The minimum size of a buffer that can back this block, in bytes
+	/// </summary>
+	GLint       DataSize;
+};
+
+/// <summary>
+/// The stages that a shader program goes through while it is being built
+/// </summary>
+enum class ShaderState
+{
+	/// <summary>
+	/// Stages are being loaded, and the program has not been linked yet
+	/// </summary>
+	Unlinked,
+	/// <summary>
+	/// The program has been submitted to the driver and may still be compiling in the background
+	/// </summary>
+	Compiling,
+	/// <summary>
+	/// The program is linked and can be used for drawing
+	/// </summary>
+	Ready,
+	/// <summary>
+	/// A stage failed to compile or the program failed to link, see the log for details
+	/// </summary>
+	Failed
+};
+
+/// <summary>
+/// This class will wrap around an OpenGL shader program.
+/// 
+/// Shaders can declare keywords with #pragma multi_compile KEYWORD_A KEYWORD_B, and each combination of keywords is
+/// built as a separate program (a variant) with those keywords #defined. Variants are only compiled when they are first
+/// requested with GetVariant, so a single source can cover many features while we only pay for the ones in use
+/// </summary>
+class Shader final : public std::enable_shared_from_this<Shader>
 {
 public:
 	typedef std::shared_ptr<Shader> sptr;
 	static inline sptr Create() {
 		return std::make_shared<Shader>(); 
 	}
+	/// <summary>
+	/// Creates a shader from a vertex and fragment shader file and starts building it with LinkAsync. The shader can be
+	/// given to materials right away, the renderer will skip anything using it until IsReady returns true
+	/// </summary>
+	/// <param name="vsPath">The relative path to the vertex shader source</param>
+	/// <param name="fsPath">The relative path to the fragment shader source</param>
+	static sptr LoadAsync(const char* vsPath, const char* fsPath);
 	
 public:
 	// We'll disallow moving and copying, since we want to manually control when the destructor is called
@@ -37,25 +165,108 @@ public:
 	~Shader();
 
 	/// <summary>
-	/// Loads a single shader stage into this shader object (ex: Vertex Shader or Fragment Shader)
+	/// Loads a single shader stage into this shader object (ex: Vertex Shader or Fragment Shader). The stage is not compiled
+	/// until Link is called, so that it can be skipped if the program is in the ProgramCache
 	/// </summary>
 	/// <param name="source">The source code of the shader to load</param>
 	/// <param name="type">The stage to load (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER)</param>
 	/// <returns>True if the shader is loaded, false if there was an issue</returns>
 	bool LoadShaderPart(const char* source, GLenum type);
 	/// <summary>
-	/// Loads a single shader stage into this shader object (ex: Vertex Shader or Fragment Shader) from an external file (in res)
+	/// Loads a single shader stage into this shader object, with the given macros defined (ex: PACKED_NORMALS)
+	/// </summary>
+	/// <param name="source">The source code of the shader to load</param>
+	/// <param name="type">The stage to load (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER)</param>
+	/// <param name="defines">The macros to define before the rest of the source, inserted after the #version directive</param>
+	/// <returns>True if the shader is loaded, false if there was an issue</returns>
+	bool LoadShaderPart(const char* source, GLenum type, const std::vector<std::string>& defines);
+	/// <summary>
+	/// Loads a single shader stage into this shader object (ex: Vertex Shader or Fragment Shader) from an external file (in res).
+	/// Lines of the form #include "file" are replaced with the contents of that file, relative to the including file
 	/// </summary>
 	/// <param name="path">The relative path to the file containing the source</param>
 	/// <param name="type">The stage to load (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER)</param>
 	/// <returns>True if the shader is loaded, false if there was an issue</returns>
 	bool LoadShaderPartFromFile(const char* path, GLenum type);
+	/// <summary>
+	/// Loads a single shader stage into this shader object from an external file (in res), with the given macros defined
+	/// </summary>
+	/// <param name="path">The relative path to the file containing the source</param>
+	/// <param name="type">The stage to load (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER)</param>
+	/// <param name="defines">The macros to define before the rest of the source (ex: PACKED_NORMALS)</param>
+	/// <returns>True if the shader is loaded, false if there was an issue</returns>
+	bool LoadShaderPartFromFile(const char* path, GLenum type, const std::vector<std::string>& defines);
 
 	/// <summary>
-	/// Links the vertex and fragment shader, and allows this shader program to be used
+	/// Compiles and links the vertex and fragment shader, and allows this shader program to be used. If a default
+	/// ProgramCache has been set, the program will be restored from the cache when possible, and stored in it otherwise
 	/// </summary>
 	/// <returns>True if the linking was sucessful, false if otherwise</returns>
 	bool Link();
+	/// <summary>
+	/// Submits all the stages and the link to the driver without waiting for them to finish. When the driver supports
+	/// parallel shader compilation, the program will be built on the driver's threads while we carry on loading, use
+	/// IsReady to poll for completion or Wait to block until it is done
+	/// </summary>
+	/// <returns>True if the program was submitted, or was restored from the ProgramCache</returns>
+	bool LinkAsync();
+	/// <summary>
+	/// Returns true if the program has finished linking successfully and can be used. If the program is still
+	/// compiling, this will check whether the driver has finished without blocking (unless parallel compilation is not
+	/// supported, in which case it waits for the driver to finish)
+	/// </summary>
+	bool IsReady();
+	/// <summary>
+	/// Blocks until the program has finished building
+	/// </summary>
+	/// <returns>True if the program linked successfully, false if otherwise</returns>
+	bool Wait();
+	/// <summary>
+	/// Gets the current build state of the program, without polling the driver
+	/// </summary>
+	ShaderState GetState() const { return _state; }
+
+	/// <summary>
+	/// Enables GL_KHR_parallel_shader_compile (or the ARB version) if the driver supports it, and sets how many
+	/// threads the driver can use to compile shaders. Must be called after the OpenGL context is created
+	/// </summary>
+	/// <param name="loader">The function to use to load the extension's entry points (ex: glfwGetProcAddress)</param>
+	/// <param name="maxThreads">The maximum number of compiler threads, 0xFFFFFFFF lets the driver decide</param>
+	/// <returns>True if parallel compilation is supported</returns>
+	static bool InitParallelCompile(GLADloadproc loader, GLuint maxThreads = 0xFFFFFFFF);
+	/// <summary>
+	/// Returns true if the driver can compile shaders in the background, see InitParallelCompile
+	/// </summary>
+	static bool IsParallelCompileSupported() { return _parallelCompile; }
+
+	/// <summary>
+	/// Gets the keywords declared by #pragma multi_compile in this shader's stages, bit N of a keyword mask refers to
+	/// the Nth keyword in this list
+	/// </summary>
+	const std::vector<std::string>& GetKeywords() const { return _keywords; }
+	/// <summary>
+	/// Gets the keyword mask for a set of keyword names, unknown keywords are ignored
+	/// </summary>
+	/// <param name="keywords">The names of the keywords to enable</param>
+	uint32_t GetKeywordMask(const std::vector<std::string>& keywords) const;
+	/// <summary>
+	/// Gets the keywords that a uniform depends on, based on the #ifdef blocks that it is declared in. Materials use
+	/// this to pick the variant that uses all of their parameters
+	/// </summary>
+	/// <param name="name">The name of the uniform</param>
+	/// <returns>The keyword mask for the uniform, or 0 if it is declared in every variant</returns>
+	uint32_t GetParamKeywords(const std::string& name) const;
+	/// <summary>
+	/// Gets the keywords that this program was built with, this is 0 for the shader that the stages were loaded into
+	/// </summary>
+	uint32_t GetVariantMask() const { return _variantMask; }
+	/// <summary>
+	/// Gets the variant of this shader with the given keywords enabled. Variants are cached by keyword mask, and are
+	/// built with LinkAsync the first time they are requested. A mask of 0 returns this shader, linking it if that
+	/// has not been done yet
+	/// </summary>
+	/// <param name="mask">The mask of keywords to enable, see GetKeywordMask</param>
+	sptr GetVariant(uint32_t mask);
 
 	/// <summary>
 	/// Binds this shader for use
@@ -70,25 +281,78 @@ public:
 	/// Gets the underlying OpenGL handle that this class is wrapping
 	/// </summary>
 	GLuint GetHandle() const { return _handle; }
+	/// <summary>
+	/// Gets a small integer ID that is unique among all live shaders, for use in sort keys. Every variant gets it's own ID
+	/// </summary>
+	uint32_t GetId() const { return _id; }
 	
+	/// <summary>
+	/// Returns all the active uniforms in the program, sorted by the hash of their names. Only valid after Link
+	/// </summary>
+	const std::vector<UniformInfo>& GetUniforms() const { return _uniforms; }
+	/// <summary>
+	/// Returns all the active uniform blocks in the program. Only valid after Link
+	/// </summary>
+	const std::vector<UniformBlockInfo>& GetUniformBlocks() const { return _uniformBlocks; }
+	/// <summary>
+	/// Returns the indices (into GetUniforms) of all the sampler uniforms in the program. Only valid after Link
+	/// </summary>
+	const std::vector<size_t>& GetSamplers() const { return _samplers; }
+
+	/// <summary>
+	/// Finds the index of a uniform in GetUniforms, or -1 if the program has no active uniform with that name
+	/// </summary>
+	/// <param name="id">The ID of the uniform to find</param>
+	int FindUniform(UniformId id) const;
+	/// <summary>
+	/// Returns the reflected info for the given uniform, or nullptr if the program has no active uniform with that name
+	/// </summary>
+	/// <param name="id">The ID of the uniform to find</param>
+	const UniformInfo* GetUniformInfo(UniformId id) const;
+	/// <summary>
+	/// Returns the reflected info for the given uniform block, or nullptr if the program has no active block with that name
+	/// </summary>
+	/// <param name="id">The ID of the block to find, ex: UniformId("b_FrameUniforms")</param>
+	const UniformBlockInfo* GetUniformBlockInfo(UniformId id) const;
+	/// <summary>
+	/// Returns true if the program has an active uniform with the given name and GLSL type (ex: GL_FLOAT_VEC3). Logs a
+	/// warning if the uniform exists with a different type
+	/// </summary>
+	/// <param name="id">The ID of the uniform to check</param>
+	/// <param name="type">The type that the uniform is expected to have</param>
+	bool ValidateUniform(UniformId id, GLenum type) const;
+	/// <summary>
+	/// Returns true if the given GLSL type is a sampler (ex: GL_SAMPLER_2D)
+	/// </summary>
+	static bool IsSamplerType(GLenum type);
+
 public:
+	int GetUniformLocation(UniformId id);
 	int GetUniformLocation(const std::string& name);
 	
 	template <typename T>
-	void SetUniform(const std::string& name, const T& value) {
-		int location = GetUniformLocation(name);
+	void SetUniform(UniformId id, const T& value) {
+		int location = GetUniformLocation(id);
 		if (location != -1) {
 			SetUniform(location, &value, 1);
 		}
 	}
 	template <typename T>
-	void SetUniformMatrix(const std::string& name, const T& value, bool transposed = false) {
-		int location = GetUniformLocation(name);
+	void SetUniformMatrix(UniformId id, const T& value, bool transposed = false) {
+		int location = GetUniformLocation(id);
 		if (location != -1) {
 			SetUniformMatrix(location, &value, 1, transposed);
 		}
 	}
 	template <typename T>
+	void SetUniform(const std::string& name, const T& value) {
+		SetUniform(UniformId(name), value);
+	}
+	template <typename T>
+	void SetUniformMatrix(const std::string& name, const T& value, bool transposed = false) {
+		SetUniformMatrix(UniformId(name), value, transposed);
+	}
+	template <typename T>
 	void SetUniform(int location, const T& value) {
 		if (location != -1) {
 			SetUniform(location, &value, 1);
@@ -117,11 +381,50 @@ public:
 	void SetUniform(int location, const glm::bvec4* value, int count = 1);
 	
 protected:
-	GLuint _vs;
-	GLuint _fs;
+	// The type and source of each stage that will be compiled when we link, these are kept around after linking if we
+	// have keywords, since the variants are built from them
+	std::vector<std::pair<GLenum, std::string>> _stages;
+	// The shader parts that are attached while the program is compiling
+	std::vector<GLuint> _parts;
 	
-	GLuint _handle;
+	GLuint      _handle;
+	ShaderState _state;
+
+	// The cache to store the program in once it's linked, and the time we've spent building it on the main thread
+	std::shared_ptr<ProgramCache> _cache;
+	uint64_t                      _cacheKey;
+	double                        _buildTimeMs;
 
-	std::unordered_map<std::string, int> _uniformLocs;
+	// Reflected program interface, filled in by _Reflect after linking. Uniforms are sorted by hash so we can binary search
+	std::vector<UniformInfo>      _uniforms;
+	std::vector<UniformBlockInfo> _uniformBlocks;
+	std::vector<size_t>           _samplers;
+	// Hashes of uniforms we've already warned about, so we don't spam the log every frame
+	std::unordered_set<uint32_t>  _missingUniforms;
+
+	// Queries all the active uniforms and uniform blocks from the linked program
+	void _Reflect();
+	// Checks the result of the link once the driver is done, and cleans up the shader parts
+	void _FinishLink();
+
+	// The keywords from #pragma multi_compile, and which keywords each uniform is declared under
+	std::vector<std::string>                  _keywords;
+	std::unordered_map<std::string, uint32_t> _paramKeywords;
+	// The variants that have been requested so far, and the keywords that this program was built with
+	std::unordered_map<uint32_t, sptr>        _variants;
+	uint32_t                                  _variantMask;
+	uint32_t                                  _id;
+
+	// Removes #pragma multi_compile lines from a stage's source, adding their keywords to this shader, and records the
+	// uniforms that are declared inside of #ifdef blocks for those keywords
+	void _Preprocess(std::string& source);
+
+	static bool   _parallelCompile;
+	static IdPool _ids;
 	
-};
\ No newline at end of file
+};
+
+/// <summary>
+/// A handle to a shader in ResourcePools::Shaders
+/// </summary>
+typedef ResourceHandle<Shader> ShaderHandle;
@@ -1,16 +1,23 @@
 #pragma once
 #include <string>
+#include <utility>
+#include <vector>
 #include "Shader.h"
 #include "ITexture.h"
 #include "Macros.h"
+#include "MaterialBuffer.h"
 #include <EnumToString.h>
 
 struct ShaderParamName {
 	std::string Name;
-	int         Location;
+	// Mutable so that these can be resolved once the shader finishes compiling, they aren't part of the key
+	// The location of the uniform for parameters outside of the material block, or -1
+	mutable int Location;
+	// The byte offset of the parameter in the material block, or -1 if it's not in the block
+	mutable int Offset;
 
 	ShaderParamName(const std::string& name) :
-		Name(name), Location(-1) {}
+		Name(name), Location(-1), Offset(-1) {}
 
 	bool operator ==(const ShaderParamName& r) const {
 		return Name == r.Name;
@@ -30,6 +37,15 @@ namespace  std
 	};
 }
 
+/// <summary>
+/// A shader and the values for it's parameters. Parameters declared in the shader's b_Material uniform block (see
+/// MaterialBuffer) are packed into a std140 block in the shared material buffer, and changes are tracked as a dirty
+/// byte range so that only modified fields are uploaded. Textures are kept in a table of texture units, so applying a
+/// material is a single buffer range bind plus the texture binds. Parameters outside of the block still work, but are
+/// re-uploaded as regular uniforms every time the material is applied.
+///
+/// Parameters should always be changed with Set, modifying the maps directly bypasses the dirty tracking
+/// </summary>
 class ShaderMaterial {
 	SMART_MEMORY_MANAGED(ShaderMaterial)
 public:
@@ -47,10 +63,27 @@ public:
 	std::unordered_map<ShaderParamName, glm::mat3> Mat3Params;
 
 	int RenderLayer;
+	// Transparent materials are drawn after the opaque ones in their layer, back to front with alpha blending
+	bool Transparent;
 	std::string DebugName;
 
+	/// <summary>
+	/// Gets a small integer ID that is unique among all live materials, for use in sort keys
+	/// </summary>
+	uint32_t GetId() const { return _id; }
+
+	/// <summary>
+	/// Uploads any parameters that changed since the last call, then binds the material's block and textures. Does
+	/// nothing if the shader is not ready yet
+	/// </summary>
 	void Apply();
 
+	/// <summary>
+	/// Gets the variant of Shader that this material draws with. The variant enables every keyword that one of the
+	/// material's parameters is declared under (see Shader::GetParamKeywords), and is built the first time it's needed
+	/// </summary>
+	const Shader::sptr& GetActiveShader();
+
 	void Set(const std::string& name, const ITexture::sptr& texture);
 	void Set(const std::string& name, float value);
 	void Set(const std::string& name, const glm::vec2& value);
@@ -60,4 +93,46 @@ public:
 	void Set(const std::string& name, const glm::mat3& value);
 
 protected:
+	// The variant we picked from Shader, and the shader it was picked from so we can tell if Shader was changed
+	Shader::sptr    _activeShader;
+	const ::Shader* _activeSource;
+	// True if a parameter has been added since we last picked a variant
+	bool            _variantDirty;
+	// True if some parameters still need their locations looked up in the active shader
+	bool            _unresolved;
+	uint32_t        _id;
+
+	// Our range of the material buffer, the CPU copy of the block, and the range of the copy that needs uploading
+	MaterialBuffer::sptr       _blockBuffer;
+	MaterialBuffer::Allocation _block;
+	std::vector<uint8_t>       _blockData;
+	size_t                     _dirtyBegin;
+	size_t                     _dirtyEnd;
+	// The texture unit for each texture the active shader samples, pointing at the values in Textures
+	std::vector<std::pair<GLuint, const ITexture::sptr*>> _textureTable;
+	// True if some parameters are regular uniforms, and need to be uploaded on every Apply
+	bool            _hasLooseParams;
+
+	static IdPool _ids;
+
+	// Finds a parameter in the active shader, or nullptr if it's missing or has the wrong type
+	const UniformInfo* _ResolveParam(const std::string& name, GLenum type);
+	// Lays out all the parameters for the active shader once it's ready, filling in the block and texture table
+	void _Compile();
+	// Resolves one map of parameters, writing the ones in the material block into the block
+	template <typename T>
+	void _CompileParams(const std::unordered_map<ShaderParamName, T>& values, GLenum type, int blockIndex);
+	// Copies a value into the block if the parameter is in it, and marks the bytes as needing an upload
+	template <typename T>
+	void _WriteParam(const ShaderParamName& name, const T& value);
+	// Marks that a new parameter was added, which may need a different variant and always needs to be laid out
+	void _OnParamAdded();
+	// Handles a Set call for any of the value maps
+	template <typename T>
+	void _SetParam(std::unordered_map<ShaderParamName, T>& values, const std::string& name, const T& value);
 };
+
+/// <summary>
+/// A handle to a material in ResourcePools::Materials
+/// </summary>
+typedef ResourceHandle<ShaderMaterial> MaterialHandle;
@@ -0,0 +1,138 @@
+#pragma once
+#include "IBuffer.h"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+/// <summary>
+/// A streaming buffer is a persistently mapped ring of buffer memory, used for data that we re-write every frame
+/// (dynamic vertices, uniform blocks, indirect draw commands, etc...). The storage is split into a number of frame
+/// regions, and each region is protected by a fence so that we never write over data the GPU is still reading from
+/// </summary>
+class StreamingBuffer : public IBuffer
+{
+public:
+	typedef std::shared_ptr<StreamingBuffer> sptr;
+	static inline sptr Create(GLenum type, size_t frameSize, uint32_t frameCount = DEFAULT_FRAME_COUNT) {
+		return std::make_shared<StreamingBuffer>(type, frameSize, frameCount);
+	}
+
+	/// <summary>
+	/// The default number of frame regions, allows the CPU to work up to 2 frames ahead of the GPU
+	/// </summary>
+	static const uint32_t DEFAULT_FRAME_COUNT = 3;
+
+	/// <summary>
+	/// Represents a block of memory that was allocated from a streaming buffer for the current frame
+	/// </summary>
+	struct Allocation
+	{
+		/// <summary>
+		/// The CPU pointer to write data into, only valid until the end of the frame
+		/// </summary>
+		void*    Data;
+		/// <summary>
+		/// The offset in bytes from the start of the buffer, as used by glBindBufferRange or glDraw*Indirect
+		/// </summary>
+		GLintptr Offset;
+		/// <summary>
+		/// The size of the allocation, in bytes
+		/// </summary>
+		size_t   Size;
+
+		Allocation() : Data(nullptr), Offset(0), Size(0) {}
+		Allocation(void* data, GLintptr offset, size_t size) : Data(data), Offset(offset), Size(size) {}
+
+		bool IsValid() const { return Data != nullptr; }
+	};
+
+public:
+	/// <summary>
+	/// Creates a new streaming buffer with immutable, persistently mapped storage
+	/// </summary>
+	/// <param name="type">The type of buffer (EX: GL_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_DRAW_INDIRECT_BUFFER)</param>
+	/// <param name="frameSize">The number of bytes available to allocate from each frame</param>
+	/// <param name="frameCount">The number of frame regions to cycle through</param>
+	StreamingBuffer(GLenum type, size_t frameSize, uint32_t frameCount = DEFAULT_FRAME_COUNT);
+	~StreamingBuffer();
+
+	// Streaming buffers have immutable storage, so we can't re-specify them with glNamedBufferData
+	inline void LoadData(const void* /*data*/, size_t /*elementSize*/, size_t /*elementCount*/) override {
+		throw std::runtime_error("Streaming buffers cannot be re-allocated, use Allocate or Upload instead");
+	}
+
+	/// <summary>
+	/// Allocates a block of memory from the current frame region. The memory is coherent, so anything written
+	/// to the returned pointer will be visible to draw calls issued after this call
+	/// </summary>
+	/// <param name="bytes">The number of bytes to allocate</param>
+	/// <param name="align">The alignment of the returned offset, in bytes (ex: GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)</param>
+	/// <returns>The allocation, or an invalid allocation if the frame region is out of space</returns>
+	Allocation Allocate(size_t bytes, size_t align = 4);
+	/// <summary>
+	/// Allocates space for and copies an array of data into the current frame region
+	/// </summary>
+	/// <typeparam name="T">The type of data you are uploading</typeparam>
+	/// <param name="data">A pointer to the first element in the array</param>
+	/// <param name="count">The number of elements in the array to upload</param>
+	/// <param name="align">The alignment of the returned offset, in bytes</param>
+	template <typename T>
+	Allocation Upload(const T* data, size_t count, size_t align = alignof(T)) {
+		Allocation result = Allocate(sizeof(T) * count, align);
+		if (result.IsValid()) {
+			memcpy(result.Data, data, result.Size);
+		}
+		return result;
+	}
+
+	/// <summary>
+	/// Waits for the GPU to finish with the current frame region if it is still in use, and resets it for writing.
+	/// Should be called once at the start of each frame, before any calls to Allocate
+	/// </summary>
+	void BeginFrame();
+	/// <summary>
+	/// Inserts a fence after all the commands that used the current frame region, and moves to the next region.
+	/// Should be called once at the end of each frame, after the last draw call that sources from this buffer
+	/// </summary>
+	void EndFrame();
+
+	/// <summary>
+	/// Binds an allocation to an indexed binding point (only for GL_UNIFORM_BUFFER and GL_SHADER_STORAGE_BUFFER)
+	/// </summary>
+	/// <param name="index">The binding index to bind to</param>
+	/// <param name="allocation">The allocation to bind</param>
+	void BindRange(GLuint index, const Allocation& allocation) const;
+
+	/// <summary>
+	/// Returns the number of bytes available to each frame
+	/// </summary>
+	size_t GetFrameSize() const { return _frameSize; }
+	/// <summary>
+	/// Returns the number of frame regions in the ring
+	/// </summary>
+	uint32_t GetFrameCount() const { return _frameCount; }
+	/// <summary>
+	/// Returns the index of the frame region currently being written to
+	/// </summary>
+	uint32_t GetFrameIndex() const { return _frameIndex; }
+	/// <summary>
+	/// Returns the number of bytes allocated from the current frame region so far
+	/// </summary>
+	size_t GetFrameUsage() const { return _frameHead; }
+	/// <summary>
+	/// Returns the number of times that BeginFrame had to block on the GPU
+	/// </summary>
+	uint32_t GetStallCount() const { return _stallCount; }
+
+protected:
+	uint8_t* _mapped;     // The persistently mapped pointer to the start of the buffer
+	size_t   _frameSize;  // The size of a single frame region, in bytes
+	size_t   _frameHead;  // The offset of the next free byte within the current frame region
+	uint32_t _frameCount; // The number of frame regions
+	uint32_t _frameIndex; // The frame region we are currently writing into
+	uint32_t _stallCount; // Number of times we had to wait on the GPU
+
+	std::vector<GLsync> _fences; // One fence per frame region, null if the region has never been used
+};
@@ -19,6 +19,9 @@ struct Texture2DDescription
 	MagFilter      MagnificationFilter;
 	float          MaxAnisotropic;
 	bool           GenerateMipMaps;
+	// The number of mip levels to allocate, or 0 to allocate the full chain when GenerateMipMaps is set (and a single level
+	// otherwise). Data with a pre-built mip chain will resize the texture to fit it's levels
+	uint32_t       MipLevels;
 
 	Texture2DDescription() :
 		Width(0), Height(0),
@@ -28,7 +31,8 @@ struct Texture2DDescription
 		MinificationFilter(MinFilter::NearestMipLinear),
 		MagnificationFilter(MagFilter::Linear),
 		MaxAnisotropic(-1.0f),
-		GenerateMipMaps(true)
+		GenerateMipMaps(true),
+		MipLevels(0)
 	{ }
 };
 
@@ -63,7 +67,9 @@ public:
 	~Texture2D() = default;
 
 	/// <summary>
-	/// Uploads data to this texture
+	/// Uploads data to this texture. If the data is compressed, the texture will switch to the data's format, and any
+	/// pre-built mip levels in the data are uploaded instead of being generated. Use Texture2DData::GenerateMipChain to
+	/// build the levels on the CPU, when they need to look the same on every driver
 	/// </summary>
 	/// <param name="data">The texture data to upload into this texture</param>
 	void LoadData(const Texture2DData::sptr& data);
@@ -74,6 +80,13 @@ public:
 	/// <param name="path">The path to load the image from</param>
 	/// <returns>A pointer to the loaded image</returns>
 	static Texture2D::sptr LoadFromFile(const std::string& path);
+	/// <summary>
+	/// Starts loading an image from a file in the background using the default TextureLoader. The texture holds a
+	/// single white texel until the image is ready. If there is no default loader, this is the same as LoadFromFile
+	/// </summary>
+	/// <param name="path">The path to load the image from</param>
+	/// <returns>A pointer to the texture the image will be loaded into</returns>
+	static Texture2D::sptr LoadFromFileAsync(const std::string& path);
 	
 	uint32_t GetWidth() const { return _description.Width; }
 	uint32_t GetHeight() const { return _description.Height; }
@@ -90,9 +103,31 @@ public:
 	void SetAnisotropicFiltering(float level = -1.0f);
 
 	const Texture2DDescription& GetDescription() const { return _description; }
+	/// <summary>
+	/// Gets the number of mip levels allocated for this texture
+	/// </summary>
+	uint32_t GetLevelCount() const { return GetStorageLevels(_description); }
+	/// <summary>
+	/// Estimates the amount of GPU memory used by this texture and it's mip chain, in bytes
+	/// </summary>
+	size_t GetDataSize() const;
+
+	/// <summary>
+	/// Gets the number of mip levels that will be allocated for a texture with the given description
+	/// </summary>
+	static uint32_t GetStorageLevels(const Texture2DDescription& description);
 	
 private:
+	// The texture loader builds the real texture off to the side, and swaps it in when it's done
+	friend class TextureLoader;
+
 	Texture2DDescription _description;
 
 	void _RecreateTexture();
+	// Replaces our texture with one that was created elsewhere, keeping our current sampling settings
+	void _AdoptStorage(GLuint handle, const Texture2DDescription& description);
+	// Creates a texture and allocates it's storage based on a description, returns 0 if the description is empty
+	static GLuint _CreateStorage(Texture2DDescription& description);
+	// Gets the MipLevels to allocate for uploading the given data, so that every allocated level gets filled
+	static uint32_t _GetUploadLevels(const Texture2DDescription& description, const Texture2DData::sptr& data);
 };
@@ -1,9 +1,29 @@
 #pragma once
 #include <memory>
 #include <cstdint>
+#include <vector>
 
 #include "TextureEnums.h"
 
+/// <summary>
+/// The filters that can be used to build a mip chain on the CPU
+/// </summary>
+enum class MipFilterType
+{
+	/// <summary>
+	/// Averages the texels that each texel of the next level covers, this is cheap but tends to blur
+	/// </summary>
+	Box,
+	/// <summary>
+	/// A Kaiser windowed sinc filter, this keeps smaller levels sharper at the cost of a wider footprint
+	/// </summary>
+	Kaiser,
+	/// <summary>
+	/// A 3 lobe Lanczos filter, the sharpest of the three but it can ring around hard edges
+	/// </summary>
+	Lanczos
+};
+
 /// <summary>
 /// Stores data required to upload texture data into OpenGL
 /// </summary>
@@ -28,6 +48,26 @@ public:
 	/// <param name="sourceData">A pointer to the data to upload to this texture</param>
 	/// <param name="recommendedFormat">The recommended internal format to use when creating textures from this data</param>
 	Texture2DData(uint32_t width, uint32_t height, PixelFormat format, PixelType type, void* sourceData, InternalFormat recommendedFormat = InternalFormat::Unknown);
+	/// <summary>
+	/// Creates a new 2D texture data object holding a block compressed image and it's pre-built mip chain
+	/// </summary>
+	/// <param name="width">The width of the texture, in pixels</param>
+	/// <param name="height">The height of the texture, in pixels</param>
+	/// <param name="compressedFormat">The compressed format that the data is stored in, textures made from the data must use this format</param>
+	/// <param name="levels">The layout of each level in the data, starting with the full sized image</param>
+	/// <param name="sourceData">A pointer to the data for all the levels</param>
+	Texture2DData(uint32_t width, uint32_t height, InternalFormat compressedFormat, const std::vector<MipLevel>& levels, const void* sourceData);
+	/// <summary>
+	/// Creates a new 2D texture data object holding an image and it's pre-built mip chain
+	/// </summary>
+	/// <param name="width">The width of the texture, in pixels</param>
+	/// <param name="height">The height of the texture, in pixels</param>
+	/// <param name="format">The pixel format or layout of a pixel (ex: RGBA)</param>
+	/// <param name="type">The component type of the pixel (ex: uint8_t)</param>
+	/// <param name="recommendedFormat">The recommended internal format to use when creating textures from this data</param>
+	/// <param name="levels">The layout of each level in the data, starting with the full sized image</param>
+	/// <param name="sourceData">A pointer to the data for all the levels</param>
+	Texture2DData(uint32_t width, uint32_t height, PixelFormat format, PixelType type, InternalFormat recommendedFormat, const std::vector<MipLevel>& levels, const void* sourceData);
 	~Texture2DData();
 
 	/// <summary>
@@ -36,6 +76,7 @@ public:
 	/// <param name="file">The path of the file to load</param>
 	/// <param name="forceRgba">True to force STBI to load 4 component texture data</param>
 	/// <returns>A pointer to the data loaded from the file, or nullptr if the file failed to load</returns>
+	/// <remarks>DDS and KTX2 files are loaded as compressed data with their mip chains, see TextureContainer</remarks>
 	static Texture2DData::sptr LoadFromFile(const std::string& file, bool forceRgba = false);
 
 	/// <summary>
@@ -68,11 +109,48 @@ public:
 	/// </summary>
 	const void* GetDataPtr() const { return _data; }
 
+	/// <summary>
+	/// Returns true if the data is block compressed, in which case the recommended format is the compressed format, and
+	/// the pixel format and type describe the texels once they're decompressed
+	/// </summary>
+	bool IsCompressed() const { return IsCompressedFormat(_recommendedFormat); }
+	/// <summary>
+	/// Gets the number of mip levels stored in the data, this is 1 unless the data has a pre-built mip chain
+	/// </summary>
+	uint32_t GetLevelCount() const { return static_cast<uint32_t>(_levels.size()); }
+	/// <summary>
+	/// Gets the size and location of a single mip level in the data
+	/// </summary>
+	const MipLevel& GetLevel(uint32_t level) const { return _levels[level]; }
+	/// <summary>
+	/// Gets a readonly copy of the data for a single mip level
+	/// </summary>
+	const void* GetLevelDataPtr(uint32_t level) const { return static_cast<const char*>(_data) + _levels[level].Offset; }
+
+	/// <summary>
+	/// Builds the full mip chain for this image on the CPU, replacing any levels past the first. The work for each level
+	/// is split across all of the CPU's cores. Only uncompressed 8 bit images are supported
+	/// </summary>
+	/// <param name="filter">The filter to downsample each level with</param>
+	/// <param name="srgb">True if the color channels are sRGB encoded, in which case they are filtered in linear space so that
+	/// smaller levels don't get darker. Alpha, and images with less than 3 channels, are always filtered as-is</param>
+	/// <returns>True if the mip chain was built, false if the data is in a format we can't filter</returns>
+	bool GenerateMipChain(MipFilterType filter = MipFilterType::Box, bool srgb = true);
+	/// <summary>
+	/// Flips every level of the image upside down, compressed data can't be flipped
+	/// </summary>
+	void FlipVertically();
+
 private:
+	// Used to select the constructor that takes ownership of a buffer allocated with malloc, instead of copying it
+	struct AdoptTag {};
+	Texture2DData(AdoptTag, uint32_t width, uint32_t height, PixelFormat format, PixelType type, void* ownedData, InternalFormat recommendedFormat);
+
 	uint32_t    _width, _height;
 	size_t      _dataSize;
 	PixelFormat _format;
 	PixelType   _type;
 	InternalFormat _recommendedFormat;
 	void* _data;
+	std::vector<MipLevel> _levels;
 };
\ No newline at end of file
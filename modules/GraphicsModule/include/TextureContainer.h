@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TextureEnums.h"
+
+/// <summary>
+/// Reads block compressed images and their pre-built mip chains from DDS and KTX2 files. Both 2D textures and cubemaps
+/// are supported, and the data is re-arranged so that each level is stored contiguously, with the faces of a cubemap
+/// back to back within each level (the order glCompressedTextureSubImage3D expects them in).
+///
+/// Note that both formats store the top row of the image first, where OpenGL expects the bottom row first. Compressed
+/// blocks can't be flipped in general, so files should be written upside down (the texture cooker does this)
+/// </summary>
+class TextureContainer final
+{
+public:
+	TextureContainer(const TextureContainer& other) = delete;
+	TextureContainer(TextureContainer&& other) = delete;
+	TextureContainer& operator=(const TextureContainer& other) = delete;
+	TextureContainer& operator=(TextureContainer&& other) = delete;
+	typedef std::shared_ptr<TextureContainer> sptr;
+
+	TextureContainer() : Format(InternalFormat::Unknown), FaceCount(1) { }
+	~TextureContainer() = default;
+
+	/// <summary>
+	/// The compressed format the image is stored in
+	/// </summary>
+	InternalFormat        Format;
+	/// <summary>
+	/// The number of faces in each level, 1 for 2D textures and 6 for cubemaps
+	/// </summary>
+	uint32_t              FaceCount;
+	/// <summary>
+	/// The levels of the mip chain, starting with the full sized image
+	/// </summary>
+	std::vector<MipLevel> Levels;
+	/// <summary>
+	/// The image data for every level
+	/// </summary>
+	std::vector<uint8_t>  Data;
+
+	/// <summary>
+	/// Checks if a file has the extension of a container we can load (.dds or .ktx2)
+	/// </summary>
+	static bool IsContainerFile(const std::string& path);
+
+	/// <summary>
+	/// Loads a DDS or KTX2 file, based on it's extension
+	/// </summary>
+	/// <param name="path">The path of the file to load</param>
+	/// <returns>The contents of the file, or nullptr if the file could not be loaded or uses a format we don't support</returns>
+	static TextureContainer::sptr LoadFromFile(const std::string& path);
+
+protected:
+	static bool _ParseDds(const std::vector<uint8_t>& file, TextureContainer& result);
+	static bool _ParseKtx2(const std::vector<uint8_t>& file, TextureContainer& result);
+	// Fills in the level sizes and offsets for the current format, returning the total size of the data
+	size_t _LayoutLevels(uint32_t width, uint32_t height, uint32_t levelCount);
+};
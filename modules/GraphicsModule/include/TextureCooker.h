@@ -0,0 +1,143 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Texture2DData.h"
+
+/// <summary>
+/// Converts images into a form that's ready to upload, and stores the result on disk so that the work only has to be
+/// done once. Cooking flips the image, builds it's mip chain and can block compress it, and the result is stored
+/// gzipped in a cache directory. Cooked files are keyed by a hash of the source file and the cook settings, so editing
+/// an image or changing the settings will miss the cache rather than loading a stale texture.
+///
+/// Images are normally cooked ahead of time with the TextureCooker tool, and Texture2D::LoadFromFile picks up the
+/// cooked file when the default cooker has one for the image
+/// </summary>
+class TextureCooker final
+{
+public:
+	/// <summary>
+	/// Controls how images are processed when they are cooked. These are part of the key for the cooked file, so the
+	/// settings used at runtime need to match the ones the tool was run with
+	/// </summary>
+	struct Settings
+	{
+		/// <summary>
+		/// True to store the image bottom row first, the way OpenGL expects it. This matches Texture2DData::LoadFromFile
+		/// </summary>
+		bool          FlipVertically;
+		/// <summary>
+		/// True to build the mip chain ahead of time
+		/// </summary>
+		bool          GenerateMips;
+		/// <summary>
+		/// The filter to build the mip chain with
+		/// </summary>
+		MipFilterType MipFilter;
+		/// <summary>
+		/// True if the color channels are sRGB encoded, so that mips are filtered in linear space. This does not change
+		/// the format of the texture
+		/// </summary>
+		bool          SRGB;
+		/// <summary>
+		/// True to block compress the image, see BlockCompressor for the formats used
+		/// </summary>
+		bool          Compress;
+
+		Settings() :
+			FlipVertically(true),
+			GenerateMips(true),
+			MipFilter(MipFilterType::Box),
+			SRGB(true),
+			Compress(false)
+		{ }
+	};
+
+	typedef std::shared_ptr<TextureCooker> sptr;
+	static inline sptr Create(const std::string& directory = DEFAULT_DIRECTORY, const Settings& settings = Settings()) {
+		return std::make_shared<TextureCooker>(directory, settings);
+	}
+	// We'll disallow moving and copying, since the cooker is shared via pointers
+	TextureCooker(const TextureCooker& other) = delete;
+	TextureCooker(TextureCooker&& other) = delete;
+	TextureCooker& operator=(const TextureCooker& other) = delete;
+	TextureCooker& operator=(TextureCooker&& other) = delete;
+
+	/// <summary>
+	/// The default directory that cooked textures are stored in, relative to the working directory
+	/// </summary>
+	static constexpr const char* DEFAULT_DIRECTORY = "cache/textures";
+	/// <summary>
+	/// The extension given to cooked texture files
+	/// </summary>
+	static constexpr const char* FILE_EXTENSION = ".otex";
+
+public:
+	/// <summary>
+	/// Creates a new texture cooker storing cooked files in the given directory, which will be created if needed
+	/// </summary>
+	/// <param name="directory">The directory to store cooked textures in</param>
+	/// <param name="settings">The settings to cook images with</param>
+	TextureCooker(const std::string& directory, const Settings& settings);
+	~TextureCooker() = default;
+
+	/// <summary>
+	/// Gets the directory that cooked textures are stored in
+	/// </summary>
+	const std::string& GetDirectory() const { return _directory; }
+	/// <summary>
+	/// Gets the settings that images are cooked with
+	/// </summary>
+	const Settings& GetSettings() const { return _settings; }
+
+	/// <summary>
+	/// Computes the key for an image from the contents of it's source file and our settings
+	/// </summary>
+	/// <param name="source">The contents of the source file</param>
+	/// <param name="size">The size of the source file, in bytes</param>
+	uint64_t ComputeKey(const void* source, size_t size) const;
+
+	/// <summary>
+	/// Cooks an image and writes it to the cache, if it hasn't been already
+	/// </summary>
+	/// <param name="path">The path of the image, this can be any file that Texture2DData::LoadFromFile accepts</param>
+	/// <param name="force">True to cook the image even if the cache already has an up to date copy</param>
+	/// <returns>True if the cache has an up to date copy of the image</returns>
+	bool Cook(const std::string& path, bool force = false);
+	/// <summary>
+	/// Loads the cooked copy of an image, if it's up to date. This is safe to call from multiple threads
+	/// </summary>
+	/// <param name="path">The path of the source image</param>
+	/// <returns>The cooked image data, or nullptr if the image hasn't been cooked with our settings</returns>
+	Texture2DData::sptr TryLoad(const std::string& path) const;
+
+	/// <summary>
+	/// Loads image data using the default cooker's copy of the image if it has one, otherwise the image is loaded
+	/// straight from the file
+	/// </summary>
+	/// <param name="path">The path of the image to load</param>
+	/// <returns>The image data, or nullptr if the file could not be loaded</returns>
+	static Texture2DData::sptr LoadData(const std::string& path);
+
+	/// <summary>
+	/// Gets the cooker that textures will be loaded through, or nullptr if textures are always loaded from their source
+	/// </summary>
+	static const sptr& GetDefault() { return _default; }
+	/// <summary>
+	/// Sets the cooker that textures will be loaded through, or nullptr to always load from the source files
+	/// </summary>
+	static void SetDefault(const sptr& cooker) { _default = cooker; }
+
+protected:
+	std::string _directory;
+	Settings    _settings;
+
+	// Gets the path of the file storing the cooked image with the given key
+	std::string _GetPath(uint64_t key) const;
+	// Writes cooked image data to the cache
+	bool _Write(const Texture2DData::sptr& data, uint64_t key) const;
+
+	static sptr _default;
+};
@@ -11,13 +11,17 @@ struct TextureCubeDesc {
 	MinFilter      MinificationFilter;
 	MagFilter      MagnificationFilter;
 	bool           GenerateMipMaps;
+	// The number of mip levels to allocate, or 0 to allocate the full chain when GenerateMipMaps is set (and a single level
+	// otherwise). Data with a pre-built mip chain will resize the texture to fit it's levels
+	uint32_t       MipLevels;
 
 	TextureCubeDesc() :
 		Size(0),
 		Format(InternalFormat::Unknown),
 		MinificationFilter(MinFilter::Linear),
 		MagnificationFilter(MagFilter::Linear),
-		GenerateMipMaps(false)
+		GenerateMipMaps(false),
+		MipLevels(0)
 	{ }
 };
 
@@ -45,12 +49,19 @@ public:
 	~TextureCubeMap() = default;
 
 	/// <summary>
-	/// Uploads data to this texture
+	/// Uploads data to this texture. If the data is compressed, the texture will switch to the data's format, and any
+	/// pre-built mip levels in the data are uploaded instead of being generated
 	/// </summary>
 	/// <param name="data">The texture data to upload into this texture</param>
 	void LoadData(const TextureCubeMapData::sptr& data);
 
 	static TextureCubeMap::sptr LoadFromImages(const std::string& path);
+	/// <summary>
+	/// Loads a compressed cubemap from a single DDS or KTX2 file
+	/// </summary>
+	/// <param name="path">The path to load the cubemap from</param>
+	/// <returns>A pointer to the loaded cubemap</returns>
+	static TextureCubeMap::sptr LoadFromFile(const std::string& path);
 
 	uint32_t GetSize() const { return _description.Size; }
 	InternalFormat GetFormat() const { return _description.Format; }
@@ -61,9 +72,24 @@ public:
 	void SetMagFilter(MagFilter filter);
 
 	const TextureCubeDesc& GetDescription() const { return _description; }
+	/// <summary>
+	/// Gets the number of mip levels allocated for this texture
+	/// </summary>
+	uint32_t GetLevelCount() const { return GetStorageLevels(_description); }
+	/// <summary>
+	/// Estimates the amount of GPU memory used by this texture and it's mip chain, in bytes
+	/// </summary>
+	size_t GetDataSize() const;
+
+	/// <summary>
+	/// Gets the number of mip levels that will be allocated for a cubemap with the given description
+	/// </summary>
+	static uint32_t GetStorageLevels(const TextureCubeDesc& description);
 
 private:
 	TextureCubeDesc _description;
 
 	void _RecreateTexture();
+	// Gets the MipLevels to allocate for uploading the given data, so that every allocated level gets filled
+	static uint32_t _GetUploadLevels(const TextureCubeDesc& description, const TextureCubeMapData::sptr& data);
 };
@@ -1,6 +1,7 @@
 #pragma once
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "TextureEnums.h"
 
@@ -47,6 +48,14 @@ public:
 	/// <param name="sourceData">A pointer to the data to upload to this texture</param>
 	/// <param name="recommendedFormat">The recommended internal format to use when creating textures from this data</param>
 	TextureCubeMapData(uint32_t size, PixelFormat format, PixelType type, void* sourceData, InternalFormat recommendedFormat = InternalFormat::Unknown);
+	/// <summary>
+	/// Creates a new cubemap data object holding block compressed faces and their pre-built mip chain
+	/// </summary>
+	/// <param name="size">The width and height of each face, in pixels</param>
+	/// <param name="compressedFormat">The compressed format that the data is stored in, textures made from the data must use this format</param>
+	/// <param name="levels">The layout of each level in the data, with the 6 faces of a level stored back to back</param>
+	/// <param name="sourceData">A pointer to the data for all the levels</param>
+	TextureCubeMapData(uint32_t size, InternalFormat compressedFormat, const std::vector<MipLevel>& levels, const void* sourceData);
 	~TextureCubeMapData();
 
 	/// <summary>
@@ -70,6 +79,13 @@ public:
 	/// <returns>A pointer to the data created from the images</returns>
 	static TextureCubeMapData::sptr LoadFromImages(const std::string& rootImagePath);
 
+	/// <summary>
+	/// Loads a compressed cubemap and it's mip chain from a single DDS or KTX2 file, see TextureContainer
+	/// </summary>
+	/// <param name="file">The path of the file to load</param>
+	/// <returns>A pointer to the data loaded from the file, or nullptr if the file failed to load or isn't a cubemap</returns>
+	static TextureCubeMapData::sptr LoadFromFile(const std::string& file);
+
 	/// <summary>
 	/// Loads 2D image data into this cubemap data for the given face. Dimensions and format must match the existing size and formats
 	/// </summary>
@@ -115,6 +131,23 @@ public:
 	/// <returns>A const pointer to the start of data for the given face</returns>
 	const void* GetFaceDataPtr(CubeMapFace face) const { return static_cast<char*>(_data) + (_faceDataSize * (size_t)face); }
 
+	/// <summary>
+	/// Returns true if the data is block compressed, in which case the recommended format is the compressed format
+	/// </summary>
+	bool IsCompressed() const { return IsCompressedFormat(_recommendedFormat); }
+	/// <summary>
+	/// Gets the number of mip levels stored in the data, this is 1 unless the data has a pre-built mip chain
+	/// </summary>
+	uint32_t GetLevelCount() const { return static_cast<uint32_t>(_levels.size()); }
+	/// <summary>
+	/// Gets the size and location of a single mip level in the data, the size is for a single face
+	/// </summary>
+	const MipLevel& GetLevel(uint32_t level) const { return _levels[level]; }
+	/// <summary>
+	/// Gets a readonly copy of the data for all 6 faces of a single mip level
+	/// </summary>
+	const void* GetLevelDataPtr(uint32_t level) const { return static_cast<const char*>(_data) + _levels[level].Offset; }
+
 private:
 	uint32_t    _size;
 	size_t      _dataSize;
@@ -123,4 +156,5 @@ private:
 	PixelType   _type;
 	InternalFormat _recommendedFormat;
 	void* _data;
+	std::vector<MipLevel> _levels;
 };
\ No newline at end of file
@@ -5,6 +5,16 @@
 #include "Logging.h"
 #include "glad/glad.h"
 
+// S3TC (BC1-BC3) is still technically an extension so our loader doesn't define it, but every desktop GPU supports it
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
 // https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glTexImage2D.xhtml
 // These are some of our more common available internal formats
 ENUM(InternalFormat, GLint,
@@ -18,7 +28,17 @@ ENUM(InternalFormat, GLint,
 	RGB10        = GL_RGB10,
 	RGB16        = GL_RGB16,
 	RGBA8        = GL_RGBA8,
-	RGBA16       = GL_RGBA16
+	RGBA16       = GL_RGBA16,
+
+	// Block compressed formats, these store 4x4 blocks of texels in 8 or 16 bytes and can only be loaded from
+	// pre-compressed data (see Texture2DData::LoadFromFile)
+	BC1          = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,       // RGB + 1 bit alpha, 8 bytes per block
+	BC1_SRGB     = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT,
+	BC3          = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,       // RGBA, 16 bytes per block
+	BC3_SRGB     = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT,
+	BC5          = GL_COMPRESSED_RG_RGTC2,                 // Two channels (ex: normal maps), 16 bytes per block
+	BC7          = GL_COMPRESSED_RGBA_BPTC_UNORM,          // High quality RGBA, 16 bytes per block
+	BC7_SRGB     = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
 
 	// Note: There are sized internal formats but there is a LOT of them
 );
@@ -86,6 +106,7 @@ constexpr size_t GetTexelComponentSize(PixelType type)
 		return 2;
 	case PixelType::Int:
 	case PixelType::UInt:
+	case PixelType::Float:
 		return 4;
 	default:
 		LOG_ASSERT(false, "Unknown type: {}", type);
@@ -107,6 +128,7 @@ constexpr GLint GetTexelComponentCount(PixelFormat format)
 		case PixelFormat::RG:
 			return 2;
 		case PixelFormat::RGB:
+		case PixelFormat::SRGB:
 		case PixelFormat::BGR:
 			return 3;
 		case PixelFormat::RGBA:
@@ -126,4 +148,128 @@ constexpr GLint GetTexelComponentCount(PixelFormat format)
  */
 constexpr size_t GetTexelSize(PixelFormat format, PixelType type) {
 	return GetTexelComponentSize(type) * GetTexelComponentCount(format);
-}
\ No newline at end of file
+}
+
+/*
+ * Describes where a single level of a mip chain is stored in a block of image data
+ */
+struct MipLevel
+{
+	uint32_t Width;
+	uint32_t Height;
+	// The offset of the level from the start of the data, in bytes. For cubemaps this is the offset of the first face,
+	// and the rest of the faces follow it
+	size_t   Offset;
+	// The size of a single image (or face) in the level, in bytes
+	size_t   Size;
+};
+
+/*
+ * Checks whether an internal format is block compressed
+ */
+constexpr bool IsCompressedFormat(InternalFormat format)
+{
+	switch (format) {
+	case InternalFormat::BC1:
+	case InternalFormat::BC1_SRGB:
+	case InternalFormat::BC3:
+	case InternalFormat::BC3_SRGB:
+	case InternalFormat::BC5:
+	case InternalFormat::BC7:
+	case InternalFormat::BC7_SRGB:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Gets the number of bytes used to store a single 4x4 block of a compressed format
+ */
+constexpr size_t GetCompressedBlockSize(InternalFormat format)
+{
+	switch (format) {
+	case InternalFormat::BC1:
+	case InternalFormat::BC1_SRGB:
+		return 8;
+	case InternalFormat::BC3:
+	case InternalFormat::BC3_SRGB:
+	case InternalFormat::BC5:
+	case InternalFormat::BC7:
+	case InternalFormat::BC7_SRGB:
+		return 16;
+	default:
+		LOG_ASSERT(false, "Not a compressed format: {}", format);
+		return 0;
+	}
+}
+
+/*
+ * Gets the number of bytes needed to store an image in a compressed format. Images that aren't a multiple of 4 texels
+ * are padded out to whole blocks
+ * @param format The compressed format of the image
+ * @param width The width of the image, in texels
+ * @param height The height of the image, in texels
+ * @returns The size of the compressed image, in bytes
+ */
+constexpr size_t GetCompressedImageSize(InternalFormat format, uint32_t width, uint32_t height) {
+	return ((width + 3) / 4) * (size_t)((height + 3) / 4) * GetCompressedBlockSize(format);
+}
+
+/*
+ * Gets the number of levels in a full mip chain, halving the largest dimension until it reaches a single texel
+ * @param width The width of the full sized image, in texels
+ * @param height The height of the full sized image, in texels
+ * @returns floor(log2(max(width, height))) + 1
+ */
+constexpr uint32_t GetFullMipCount(uint32_t width, uint32_t height) {
+	uint32_t size = width > height ? width : height;
+	uint32_t count = 1;
+	while (size > 1) {
+		size >>= 1;
+		count++;
+	}
+	return count;
+}
+
+/*
+ * Estimates the number of bytes the GPU uses to store an image in the given format. Drivers are free to pad formats
+ * out (ex: RGB8 is often stored as RGBA8), so this is only a lower bound
+ * @param format The internal format of the image
+ * @param width The width of the image, in texels
+ * @param height The height of the image, in texels
+ * @returns The size of the image, in bytes, or 0 if the format is unknown
+ */
+constexpr size_t GetImageSize(InternalFormat format, uint32_t width, uint32_t height) {
+	if (IsCompressedFormat(format)) {
+		return GetCompressedImageSize(format, width, height);
+	}
+	size_t texelSize = 0;
+	switch (format) {
+	case InternalFormat::R8:
+		texelSize = 1;
+		break;
+	case InternalFormat::R16:
+	case InternalFormat::RG8:
+		texelSize = 2;
+		break;
+	case InternalFormat::RGB8:
+		texelSize = 3;
+		break;
+	case InternalFormat::RGB10:
+	case InternalFormat::RGBA8:
+	case InternalFormat::Depth:
+	case InternalFormat::DepthStencil:
+		texelSize = 4;
+		break;
+	case InternalFormat::RGB16:
+		texelSize = 6;
+		break;
+	case InternalFormat::RGBA16:
+		texelSize = 8;
+		break;
+	default:
+		break;
+	}
+	return width * (size_t)height * texelSize;
+}
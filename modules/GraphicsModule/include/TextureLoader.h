@@ -0,0 +1,132 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "StreamingBuffer.h"
+#include "Texture2D.h"
+#include "Texture2DData.h"
+
+/// <summary>
+/// Loads textures in the background, so that loading a scene doesn't stall on decoding and uploading images. Files are
+/// decoded on a pool of worker threads, and the pixels are copied into a ring of pixel unpack buffers on the GL thread,
+/// a few rows at a time so that no more than a fixed number of bytes are uploaded in a single frame. The texture is
+/// returned right away holding a 1x1 placeholder texel, and once the GPU has finished with the upload the real image
+/// is swapped in. Since materials bind the texture's handle every time they are applied, nothing else needs to know
+/// </summary>
+class TextureLoader final
+{
+public:
+	typedef std::shared_ptr<TextureLoader> sptr;
+	static inline sptr Create(size_t frameBudget = DEFAULT_FRAME_BUDGET, uint32_t workerCount = 0) {
+		return std::make_shared<TextureLoader>(frameBudget, workerCount);
+	}
+	// We'll disallow moving and copying, since the worker threads hold on to the loader
+	TextureLoader(const TextureLoader& other) = delete;
+	TextureLoader(TextureLoader&& other) = delete;
+	TextureLoader& operator=(const TextureLoader& other) = delete;
+	TextureLoader& operator=(TextureLoader&& other) = delete;
+
+	/// <summary>
+	/// The default number of bytes we upload per frame
+	/// </summary>
+	static const size_t DEFAULT_FRAME_BUDGET = 4 * 1024 * 1024;
+
+public:
+	/// <summary>
+	/// Creates a new texture loader, must be created on the thread that owns the OpenGL context
+	/// </summary>
+	/// <param name="frameBudget">The maximum number of bytes to upload in a single frame</param>
+	/// <param name="workerCount">The number of threads to decode images with, or 0 to pick based on the CPU</param>
+	TextureLoader(size_t frameBudget = DEFAULT_FRAME_BUDGET, uint32_t workerCount = 0);
+	~TextureLoader();
+
+	/// <summary>
+	/// Starts loading a texture from a file. The result can be used right away, and will show the placeholder
+	/// color until the image has been uploaded
+	/// </summary>
+	/// <param name="path">The path to load the image from</param>
+	/// <param name="placeholder">The color of the texel to show while the image is loading</param>
+	/// <returns>The texture that the image will be loaded into</returns>
+	Texture2D::sptr Load(const std::string& path, const glm::vec4& placeholder = glm::vec4(1.0f));
+
+	/// <summary>
+	/// Moves decoded images to the GPU and swaps in the textures that are done, should be called once per frame
+	/// on the GL thread
+	/// </summary>
+	void Update();
+
+	/// <summary>
+	/// Returns the number of textures that have been requested but haven't been swapped in yet
+	/// </summary>
+	size_t GetPendingCount() const { return _pendingCount; }
+	/// <summary>
+	/// Returns the number of bytes that were uploaded during the last call to Update
+	/// </summary>
+	size_t GetFrameBytes() const { return _frameBytes; }
+	/// <summary>
+	/// Returns the maximum number of bytes that are uploaded in a single frame
+	/// </summary>
+	size_t GetFrameBudget() const { return _ring->GetFrameSize(); }
+
+	/// <summary>
+	/// Gets the loader used by Texture2D::LoadFromFileAsync, or nullptr if textures should be loaded right away
+	/// </summary>
+	static const sptr& GetDefault() { return _default; }
+	/// <summary>
+	/// Sets the loader used by Texture2D::LoadFromFileAsync
+	/// </summary>
+	static void SetDefault(const sptr& loader) { _default = loader; }
+
+protected:
+	// A file that's waiting for a worker to decode it
+	struct DecodeRequest
+	{
+		std::string             Path;
+		std::weak_ptr<Texture2D> Target;
+	};
+
+	// An image that's being copied to the GPU, or is waiting for the GPU to finish with it
+	struct Upload
+	{
+		std::weak_ptr<Texture2D> Target;
+		Texture2DData::sptr      Data;
+		Texture2DDescription     Description;
+		GLuint                   Handle;
+		uint32_t                 Level;
+		uint32_t                 RowsUploaded;
+		GLsync                   Fence;
+	};
+
+	StreamingBuffer::sptr _ring;
+	size_t _frameBytes;
+	size_t _pendingCount;
+
+	// Only touched on the GL thread
+	std::deque<Upload>  _uploads;
+	std::vector<Upload> _inFlight;
+
+	// Shared with the workers, guarded by _mutex
+	std::mutex              _mutex;
+	std::condition_variable _wake;
+	std::deque<DecodeRequest> _requests;
+	std::vector<Upload>       _decoded;
+	bool                      _stopping;
+
+	std::vector<std::thread> _workers;
+
+	static sptr _default;
+
+	void _WorkerMain();
+	// Copies as many rows of an upload as will fit in this frame's budget, returns true once every level has been sent
+	bool _UploadRows(Upload& upload);
+	// Gives the finished storage to it's texture, or deletes it if nobody is using the texture anymore
+	void _Finish(Upload& upload);
+};
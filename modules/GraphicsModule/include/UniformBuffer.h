@@ -0,0 +1,64 @@
+#pragma once
+#include "IBuffer.h"
+#include "GLStateCache.h"
+#include <memory>
+#include <stdexcept>
+#include "Logging.h"
+
+/// <summary>
+/// A uniform buffer stores a block of uniforms (declared with layout(std140) in GLSL) that can be shared between
+/// any number of shaders. The buffer is bound to a fixed binding point, so every shader that declares the block
+/// with the same binding will see the data without any per-shader uniform uploads
+/// </summary>
+class UniformBuffer : public IBuffer
+{
+public:
+	typedef std::shared_ptr<UniformBuffer> sptr;
+	static inline sptr Create(size_t size, GLuint binding) {
+		return std::make_shared<UniformBuffer>(size, binding);
+	}
+
+public:
+	/// <summary>
+	/// Creates a new uniform buffer with storage for a block of the given size
+	/// </summary>
+	/// <param name="size">The size of the uniform block, in bytes</param>
+	/// <param name="binding">The uniform block binding point that this buffer will be bound to</param>
+	UniformBuffer(size_t size, GLuint binding) :
+		IBuffer(GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW),
+		_binding(binding)
+	{
+		AllocateStorage(size, 1, GL_DYNAMIC_STORAGE_BIT);
+	}
+
+	// Uniform buffers have a fixed size, use Update instead
+	inline void LoadData(const void* /*data*/, size_t /*elementSize*/, size_t /*elementCount*/) override {
+		throw std::runtime_error("Uniform buffers have fixed storage, use Update instead");
+	}
+
+	/// <summary>
+	/// Uploads the contents of the uniform block. T must match the std140 layout of the block in GLSL
+	/// </summary>
+	/// <typeparam name="T">The C++ mirror of the uniform block</typeparam>
+	/// <param name="data">The data to upload</param>
+	template <typename T>
+	void Update(const T& data) {
+		LOG_ASSERT(sizeof(T) <= GetTotalSize(), "Data is larger than the uniform buffer!");
+		UpdateData(&data, 0, sizeof(T));
+	}
+
+	/// <summary>
+	/// Binds this buffer to it's uniform block binding point
+	/// </summary>
+	void Bind() override {
+		GLStateCache::BindBufferBase(GL_UNIFORM_BUFFER, _binding, _handle);
+	}
+
+	/// <summary>
+	/// Returns the uniform block binding point that this buffer binds to
+	/// </summary>
+	GLuint GetBinding() const { return _binding; }
+
+protected:
+	GLuint _binding;
+};
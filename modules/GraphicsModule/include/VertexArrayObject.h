@@ -1,11 +1,15 @@
 #pragma once
 #include <glad/glad.h>
+#include <GLM/glm.hpp>
 #include <cstdint>
 #include <vector>
 #include <memory>
+#include <functional>
 
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
+#include "IdPool.h"
+#include "ResourcePool.h"
 
 /// <summary>
 /// We'll use this just to make it more clear what the intended usage of an attribute is in our code!
@@ -49,7 +53,8 @@ struct BufferAttribute
 	/// </summary>
 	GLenum  Type;
 	/// <summary>
-	/// Whether or not the data should be normalized into the 0-1 range (usually this is false)
+	/// Whether or not the data should be normalized into the 0-1 range (usually this is false). Integer types that
+	/// aren't normalized are passed to the shader as integers (see IsInteger)
 	/// </summary>
 	bool    Normalized;
 	/// <summary>
@@ -68,6 +73,44 @@ struct BufferAttribute
 
 	BufferAttribute(uint32_t slot, uint32_t size, GLenum type, bool normalized, GLsizei stride, size_t offset, AttribUsage usage = AttribUsage::Unknown) :
 		Slot(slot), Size(size), Type(type), Normalized(normalized), Stride(stride), Offset(offset), Usage(usage) { }
+
+	/// <summary>
+	/// Returns true if this attribute feeds an integer shader input (int, ivec, uint or uvec), which is the case for
+	/// integer types that aren't normalized
+	/// </summary>
+	bool IsInteger() const {
+		switch (Type) {
+			case GL_BYTE:
+			case GL_UNSIGNED_BYTE:
+			case GL_SHORT:
+			case GL_UNSIGNED_SHORT:
+			case GL_INT:
+			case GL_UNSIGNED_INT:
+				return !Normalized;
+			default:
+				return false;
+		}
+	}
+};
+
+/// <summary>
+/// Describes a range of indices to draw from a VAO, used for meshes that need to be split into multiple draws
+/// (ex: to keep each range within the limits of 16 bit indices)
+/// </summary>
+struct DrawRange
+{
+	/// <summary>
+	/// The first index to draw, relative to the first index of the VAO
+	/// </summary>
+	GLuint  FirstIndex;
+	/// <summary>
+	/// The number of indices to draw
+	/// </summary>
+	GLsizei IndexCount;
+	/// <summary>
+	/// The value added to each index in the range, relative to the base vertex of the VAO
+	/// </summary>
+	GLint   BaseVertex;
 };
 
 /// <summary>
@@ -93,6 +136,17 @@ public:
 	/// Creates a new empty Vertex Array Object
 	/// </summary>
 	VertexArrayObject();
+	/// <summary>
+	/// Creates a view into a range of another VAO's buffers. The view shares the source's OpenGL handle, so many
+	/// views can be drawn without switching VAOs, using the base vertex and first index to select the mesh
+	/// </summary>
+	/// <param name="source">The VAO that owns the buffers, will be kept alive by this view</param>
+	/// <param name="firstIndex">The first index in the source's index buffer to draw</param>
+	/// <param name="indexCount">The number of indices to draw</param>
+	/// <param name="baseVertex">The offset added to each index before fetching vertices</param>
+	/// <param name="vertexCount">The number of vertices referenced by the range</param>
+	/// <param name="onRelease">Optional callback to invoke when the view is destroyed, used to free the range</param>
+	VertexArrayObject(const sptr& source, GLuint firstIndex, GLsizei indexCount, GLint baseVertex, GLsizei vertexCount, const std::function<void()>& onRelease = nullptr);
 	// Destructor does not need to be virtual due to the use of the final keyword
 	~VertexArrayObject();
 
@@ -127,8 +181,99 @@ public:
 	/// Returns the underlying OpenGL handle that this class is wrapping around
 	/// </summary>
 	GLuint GetHandle() const { return _handle; }
+	/// <summary>
+	/// Gets a small integer ID that is unique among all live VAOs and views, for use in sort keys
+	/// </summary>
+	uint32_t GetId() const { return _id; }
+	/// <summary>
+	/// Returns the index buffer bound to this VAO, or nullptr if the VAO is not indexed
+	/// </summary>
+	const IndexBuffer::sptr& GetIndexBuffer() const { return _source != nullptr ? _source->_indexBuffer : _indexBuffer; }
+	/// <summary>
+	/// Returns the number of vertices that this VAO draws from
+	/// </summary>
+	GLsizei GetVertexCount() const { return _vertexCount; }
+	/// <summary>
+	/// Returns the number of indices this VAO will draw, or 0 if the VAO is not indexed
+	/// </summary>
+	GLsizei GetIndexCount() const;
+	/// <summary>
+	/// Returns the number of bytes of vertex and index data this VAO draws from. For views this only counts their range
+	/// of the source's buffers
+	/// </summary>
+	size_t GetDataSize() const { return GetVertexDataSize() + GetIndexDataSize(); }
+	/// <summary>
+	/// Returns the number of bytes of vertex data this VAO draws from (see GetDataSize)
+	/// </summary>
+	size_t GetVertexDataSize() const;
+	/// <summary>
+	/// Returns the number of bytes of index data this VAO draws, or 0 if the VAO is not indexed (see GetDataSize)
+	/// </summary>
+	size_t GetIndexDataSize() const;
+	/// <summary>
+	/// Returns the first index in the index buffer that this VAO will draw (non-zero only for views)
+	/// </summary>
+	GLuint GetFirstIndex() const { return _firstIndex; }
+	/// <summary>
+	/// Returns the value added to indices before fetching vertices (non-zero only for views)
+	/// </summary>
+	GLint GetBaseVertex() const { return _baseVertex; }
+	/// <summary>
+	/// Returns true if this VAO is a view into the buffers of another VAO
+	/// </summary>
+	bool IsView() const { return _source != nullptr; }
+	/// <summary>
+	/// Returns the VAO that this view draws from, or nullptr if this VAO owns it's buffers
+	/// </summary>
+	const sptr& GetSource() const { return _source; }
+
+	/// <summary>
+	/// Sets the matrix that converts the positions stored in this VAO into model space, used by meshes with
+	/// quantized positions (see VertexQuantization). Renderers should apply this before the model matrix
+	/// </summary>
+	/// <param name="value">The new dequantization matrix</param>
+	void SetDequantization(const glm::mat4& value) { _dequantization = value; }
+	/// <summary>
+	/// Returns the matrix that converts the positions stored in this VAO into model space, identity unless
+	/// the VAO stores quantized positions
+	/// </summary>
+	const glm::mat4& GetDequantization() const { return _dequantization; }
+
+	/// <summary>
+	/// Sets the bounding sphere of the mesh in model space (see MeshLodSet::SetBounds)
+	/// </summary>
+	void SetBounds(const glm::vec3& center, float radius) { _boundsCenter = center; _boundsRadius = radius; }
+	/// <summary>
+	/// Returns the center of the mesh's bounding sphere in model space, the origin unless SetBounds was called
+	/// </summary>
+	const glm::vec3& GetBoundsCenter() const { return _boundsCenter; }
+	/// <summary>
+	/// Returns the radius of the mesh's bounding sphere in model space, 0 unless SetBounds was called
+	/// </summary>
+	float GetBoundsRadius() const { return _boundsRadius; }
+
+	/// <summary>
+	/// Sets the ranges that this VAO will be drawn with. If empty (the default), the whole VAO is drawn with a single
+	/// draw call, otherwise each range gets it's own draw call
+	/// </summary>
+	/// <param name="ranges">The ranges to draw, relative to the first index and base vertex of this VAO</param>
+	void SetDrawRanges(const std::vector<DrawRange>& ranges) { _drawRanges = ranges; }
+	/// <summary>
+	/// Returns the ranges that this VAO is drawn with, or an empty list if the VAO is drawn with a single draw call
+	/// </summary>
+	const std::vector<DrawRange>& GetDrawRanges() const { return _drawRanges; }
 
+	/// <summary>
+	/// Renders this VAO. The VAO is left bound afterwards, so drawing the same VAO again won't need another bind
+	/// </summary>
 	void Render() const;
+	/// <summary>
+	/// Renders multiple instances of this VAO in a single draw call. Per-instance data is fed by indexing into a
+	/// buffer with gl_BaseInstance + gl_InstanceID (see BatchRenderer)
+	/// </summary>
+	/// <param name="instanceCount">The number of instances to draw</param>
+	/// <param name="baseInstance">The first instance to draw, offsets gl_BaseInstance</param>
+	void RenderInstanced(GLsizei instanceCount, GLuint baseInstance = 0) const;
 	
 protected:
 	// Helper structure to store a buffer and the attributes
@@ -144,7 +289,31 @@ protected:
 	std::vector<VertexBufferBinding> _vertexBuffers;
 
 	GLsizei _vertexCount;
+	// Converts stored positions into model space, for quantized meshes
+	glm::mat4 _dequantization;
+	// The model space bounding sphere
+	glm::vec3 _boundsCenter;
+	float     _boundsRadius;
+
+	// The VAO that we are a view into, or nullptr if we own our buffers
+	sptr    _source;
+	// The range of the index buffer that we will draw, only used for views
+	GLuint  _firstIndex;
+	GLsizei _indexCount;
+	GLint   _baseVertex;
+	// Sub-ranges to draw, for meshes that were split
+	std::vector<DrawRange> _drawRanges;
+	// Callback for when a view is destroyed
+	std::function<void()> _onRelease;
 	
 	// The underlying OpenGL handle that this class is wrapping around
 	GLuint _handle;
+	uint32_t _id;
+
+	static IdPool _ids;
 };
+
+/// <summary>
+/// A handle to a mesh in ResourcePools::Meshes
+/// </summary>
+typedef ResourceHandle<VertexArrayObject> MeshHandle;
@@ -0,0 +1,60 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "VertexArrayObject.h"
+
+/// <summary>
+/// Describes how a field type is passed to OpenGL as a vertex attribute. Custom field types can either specialize
+/// this, or provide static constexpr ATTRIB_SIZE, ATTRIB_TYPE and ATTRIB_NORMALIZED members
+/// </summary>
+/// <typeparam name="T">The type of the field in the vertex structure</typeparam>
+template <typename T>
+struct AttribFormat
+{
+	static constexpr GLint  Size       = T::ATTRIB_SIZE;
+	static constexpr GLenum Type       = T::ATTRIB_TYPE;
+	static constexpr bool   Normalized = T::ATTRIB_NORMALIZED;
+};
+
+// Helper for declaring the format of the basic types
+#define ATTRIB_FORMAT(type, size, glType, normalized) \
+	template <> struct AttribFormat<type> { \
+		static constexpr GLint  Size       = size; \
+		static constexpr GLenum Type       = glType; \
+		static constexpr bool   Normalized = normalized; \
+	}
+
+ATTRIB_FORMAT(float,      1, GL_FLOAT, false);
+ATTRIB_FORMAT(glm::vec2,  2, GL_FLOAT, false);
+ATTRIB_FORMAT(glm::vec3,  3, GL_FLOAT, false);
+ATTRIB_FORMAT(glm::vec4,  4, GL_FLOAT, false);
+// Integer fields aren't normalized, so they feed int and ivec shader inputs (see BufferAttribute::IsInteger)
+ATTRIB_FORMAT(int32_t,    1, GL_INT,   false);
+ATTRIB_FORMAT(glm::ivec2, 2, GL_INT,   false);
+ATTRIB_FORMAT(glm::ivec3, 3, GL_INT,   false);
+ATTRIB_FORMAT(glm::ivec4, 4, GL_INT,   false);
+
+#undef ATTRIB_FORMAT
+
+/// <summary>
+/// Builds a buffer attribute from a pointer to a field in a vertex structure, so that the type, size and offset
+/// of the attribute can never get out of sync with the structure
+/// </summary>
+/// <typeparam name="TVertex">The type of the vertex structure</typeparam>
+/// <typeparam name="TField">The type of the field, must have an AttribFormat</typeparam>
+/// <param name="slot">The vertex shader input slot for the attribute</param>
+/// <param name="field">A pointer to the field (ex: &VertexPosCol::Position)</param>
+/// <param name="usage">The usage of the attribute</param>
+template <typename TVertex, typename TField>
+BufferAttribute MakeAttribute(GLuint slot, TField TVertex::* field, AttribUsage usage = AttribUsage::Unknown) {
+	static_assert(std::is_standard_layout<TVertex>::value, "Vertex types must be standard layout!");
+	static_assert(AttribFormat<TField>::Size >= 1 && AttribFormat<TField>::Size <= 4, "Vertex attributes must have between 1 and 4 components!");
+	// Measured against a real vertex, since going through a null pointer to find the offset is undefined behavior
+	static const TVertex probe{};
+	size_t offset = reinterpret_cast<const char*>(&(probe.*field)) - reinterpret_cast<const char*>(&probe);
+	return BufferAttribute(slot, AttribFormat<TField>::Size, AttribFormat<TField>::Type, AttribFormat<TField>::Normalized, sizeof(TVertex), offset, usage);
+}
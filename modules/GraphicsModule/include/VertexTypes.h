@@ -1,7 +1,9 @@
 #pragma once
 
 #include <GLM/glm.hpp>
+#include <cstdint>
 #include <VertexArrayObject.h>
+#include <VertexDecl.h>
 
 struct VertexPosCol {
 	glm::vec3 Position;
@@ -57,4 +59,143 @@ struct VertexPosNormTexCol {
 		Position({ x, y, z }), Normal({ nX, nY, nZ }), UV({ u, v }), Color({r, g, b, a}) {}
 
 	static const std::vector<BufferAttribute> V_DECL;
-};
\ No newline at end of file
+};
+
+/*
+ * Packed attribute types, these store a single attribute in a compressed form that the GPU can expand for us
+ * when fetching vertices. See VertexPackedPosNormTexCol for an example of how they are used
+ */
+
+/// <summary>
+/// A position stored as 3 signed normalized 16 bit integers (plus padding), in the range [-1, 1] relative to the
+/// mesh bounds. The vertex shader gets the dequantized position from the mesh's dequantization matrix
+/// </summary>
+struct Snorm16x4 {
+	int16_t X, Y, Z, W;
+	static constexpr GLint  ATTRIB_SIZE = 3;
+	static constexpr GLenum ATTRIB_TYPE = GL_SHORT;
+	static constexpr bool   ATTRIB_NORMALIZED = true;
+};
+/// <summary>
+/// A position stored as 3 half precision floats (plus padding)
+/// </summary>
+struct Half4 {
+	uint16_t X, Y, Z, W;
+	static constexpr GLint  ATTRIB_SIZE = 3;
+	static constexpr GLenum ATTRIB_TYPE = GL_HALF_FLOAT;
+	static constexpr bool   ATTRIB_NORMALIZED = false;
+};
+/// <summary>
+/// A unit vector stored using an octahedral mapping in 2 signed normalized 16 bit integers. Shaders need to be
+/// compiled with PACKED_NORMALS to decode these
+/// </summary>
+struct OctNormal16 {
+	int16_t X, Y;
+	static constexpr GLint  ATTRIB_SIZE = 2;
+	static constexpr GLenum ATTRIB_TYPE = GL_SHORT;
+	static constexpr bool   ATTRIB_NORMALIZED = true;
+};
+/// <summary>
+/// A texture coordinate stored as 2 unsigned normalized 16 bit integers, only covers the [0, 1] range
+/// </summary>
+struct Unorm16x2 {
+	uint16_t X, Y;
+	static constexpr GLint  ATTRIB_SIZE = 2;
+	static constexpr GLenum ATTRIB_TYPE = GL_UNSIGNED_SHORT;
+	static constexpr bool   ATTRIB_NORMALIZED = true;
+};
+/// <summary>
+/// A color stored as 4 unsigned normalized bytes
+/// </summary>
+struct Rgba8 {
+	uint8_t R, G, B, A;
+	static constexpr GLint  ATTRIB_SIZE = 4;
+	static constexpr GLenum ATTRIB_TYPE = GL_UNSIGNED_BYTE;
+	static constexpr bool   ATTRIB_NORMALIZED = true;
+};
+
+/// <summary>
+/// Stores the mapping from a mesh's bounds to the [-1, 1] range used by quantized positions
+/// </summary>
+struct VertexQuantization {
+	glm::vec3 Center;
+	glm::vec3 Extents;
+
+	VertexQuantization() : Center(glm::vec3(0.0f)), Extents(glm::vec3(1.0f)) {}
+
+	/// <summary>
+	/// Gets the matrix that will transform quantized positions back into model space
+	/// </summary>
+	glm::mat4 ToMatrix() const;
+	/// <summary>
+	/// Maps a model space position into the [-1, 1] range
+	/// </summary>
+	glm::vec3 Quantize(const glm::vec3& position) const { return (position - Center) / Extents; }
+
+	/// <summary>
+	/// Calculates the quantization parameters from the bounds of a list of vertices
+	/// </summary>
+	/// <typeparam name="TVertex">The type of vertex, must have a glm::vec3 Position field</typeparam>
+	/// <param name="vertices">A pointer to the first vertex</param>
+	/// <param name="count">The number of vertices</param>
+	template <typename TVertex>
+	static VertexQuantization Compute(const TVertex* vertices, size_t count) {
+		VertexQuantization result;
+		if (count == 0) {
+			return result;
+		}
+		glm::vec3 min = vertices[0].Position;
+		glm::vec3 max = vertices[0].Position;
+		for (size_t ix = 1; ix < count; ix++) {
+			min = glm::min(min, vertices[ix].Position);
+			max = glm::max(max, vertices[ix].Position);
+		}
+		result.Center = (min + max) * 0.5f;
+		// Avoid dividing by zero for flat meshes (ex: planes)
+		result.Extents = glm::max((max - min) * 0.5f, glm::vec3(1e-6f));
+		return result;
+	}
+};
+
+// Helper functions for filling in packed attributes
+Snorm16x4   PackSnorm16(const glm::vec3& value);
+Half4       PackHalf(const glm::vec3& value);
+OctNormal16 PackOctahedral(const glm::vec3& normal);
+Unorm16x2   PackUnorm16(const glm::vec2& value);
+Rgba8       PackRgba8(const glm::vec4& color);
+
+/// <summary>
+/// A packed version of VertexPosNormTexCol, using 20 bytes instead of 48. Positions are quantized to the bounds
+/// of the mesh, and need the VAO's dequantization matrix to be applied
+/// </summary>
+struct VertexPackedPosNormTexCol {
+	Snorm16x4   Position;
+	OctNormal16 Normal;
+	Unorm16x2   UV;
+	Rgba8       Color;
+
+	VertexPackedPosNormTexCol() : Position({ 0, 0, 0, 0 }), Normal({ 0, 0 }), UV({ 0, 0 }), Color({ 0, 0, 0, 255 }) {}
+	VertexPackedPosNormTexCol(const VertexPosNormTexCol& source, const VertexQuantization& quantization) :
+		Position(PackSnorm16(quantization.Quantize(source.Position))), Normal(PackOctahedral(source.Normal)),
+		UV(PackUnorm16(source.UV)), Color(PackRgba8(source.Color)) {}
+
+	static const std::vector<BufferAttribute> V_DECL;
+};
+
+/// <summary>
+/// A packed version of VertexPosNormTexCol using half precision positions, using 20 bytes instead of 48. Positions
+/// are stored relative to the bounds of the mesh to make the most of the available precision
+/// </summary>
+struct VertexHalfPosNormTexCol {
+	Half4       Position;
+	OctNormal16 Normal;
+	Unorm16x2   UV;
+	Rgba8       Color;
+
+	VertexHalfPosNormTexCol() : Position({ 0, 0, 0, 0 }), Normal({ 0, 0 }), UV({ 0, 0 }), Color({ 0, 0, 0, 255 }) {}
+	VertexHalfPosNormTexCol(const VertexPosNormTexCol& source, const VertexQuantization& quantization) :
+		Position(PackHalf(quantization.Quantize(source.Position))), Normal(PackOctahedral(source.Normal)),
+		UV(PackUnorm16(source.UV)), Color(PackRgba8(source.Color)) {}
+
+	static const std::vector<BufferAttribute> V_DECL;
+};
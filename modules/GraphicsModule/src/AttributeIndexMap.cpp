@@ -0,0 +1,44 @@
+#include "AttributeIndexMap.h"
+
+AttributeIndexMap::AttributeIndexMap(size_t expectedCount) :
+	_positions(),
+	_uvs(),
+	_normals(),
+	_values(),
+	_count(0)
+{
+	// Keep the table at most half full, with a power of two size so slots can be picked with a mask
+	size_t capacity = 16;
+	while (capacity < expectedCount * 2) {
+		capacity *= 2;
+	}
+	_positions.resize(capacity, 0);
+	_uvs.resize(capacity);
+	_normals.resize(capacity);
+	_values.resize(capacity);
+}
+
+void AttributeIndexMap::_Grow() {
+	const size_t capacity = _positions.size() * 2;
+	std::vector<int32_t> positions(capacity, 0);
+	std::vector<int32_t> uvs(capacity);
+	std::vector<int32_t> normals(capacity);
+	std::vector<uint32_t> values(capacity);
+	const size_t mask = capacity - 1;
+	for (size_t ix = 0; ix < _positions.size(); ix++) {
+		if (_positions[ix] != 0) {
+			size_t slot = Hash(_positions[ix], _uvs[ix], _normals[ix]) & mask;
+			while (positions[slot] != 0) {
+				slot = (slot + 1) & mask;
+			}
+			positions[slot] = _positions[ix];
+			uvs[slot] = _uvs[ix];
+			normals[slot] = _normals[ix];
+			values[slot] = _values[ix];
+		}
+	}
+	_positions = std::move(positions);
+	_uvs = std::move(uvs);
+	_normals = std::move(normals);
+	_values = std::move(values);
+}
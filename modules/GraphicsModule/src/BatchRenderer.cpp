@@ -0,0 +1,173 @@
+#include "BatchRenderer.h"
+#include <algorithm>
+#include "GLStateCache.h"
+#include "Logging.h"
+
+BatchRenderer::BatchRenderer(size_t maxObjects) :
+	_maxObjects(maxObjects),
+	_drawCalls(0),
+	_instancedObjects(0),
+	_lastMesh(nullptr),
+	_lastMeshCommands(0),
+	_storageAlignment(256)
+{
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &_storageAlignment);
+
+	// Leave some extra room in each frame for alignment padding
+	_objectBuffer = StreamingBuffer::Create(GL_SHADER_STORAGE_BUFFER, sizeof(ObjectData) * _maxObjects + _storageAlignment);
+	_commandBuffer = StreamingBuffer::Create(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand) * _maxObjects + sizeof(DrawElementsIndirectCommand));
+
+	_buckets.reserve(_maxObjects);
+	_commands.reserve(_maxObjects);
+	_objects.reserve(_maxObjects);
+}
+
+void BatchRenderer::Begin() {
+	_buckets.clear();
+	_commands.clear();
+	_objects.clear();
+	_drawCalls = 0;
+	_instancedObjects = 0;
+	_lastMesh = nullptr;
+	_lastMeshCommands = 0;
+}
+
+void BatchRenderer::Submit(const VertexArrayObject* mesh, ShaderMaterial* material, const glm::mat4& world, const glm::mat3& normalMatrix) {
+	if (mesh == nullptr || material == nullptr || material->GetActiveShader() == nullptr) {
+		return;
+	}
+	// Shaders built with LinkAsync may still be compiling, we'll just skip the object until they're ready
+	if (!material->GetActiveShader()->IsReady()) {
+		return;
+	}
+	// Meshes that were split need a command per range, so we need to check that we have room for all of them
+	size_t commandCount = std::max<size_t>(mesh->GetDrawRanges().size(), 1);
+	if (_objects.size() >= _maxObjects || _commands.size() + commandCount > _maxObjects) {
+		LOG_WARN("Batch renderer is full, ignoring submission! (max {} objects)", _maxObjects);
+		return;
+	}
+
+	GLuint objectIx = static_cast<GLuint>(_objects.size());
+	// Quantized meshes need to be mapped back into model space before the world transform is applied
+	_objects.push_back({ world * mesh->GetDequantization(), glm::mat4(normalMatrix) });
+
+	// If this is the same mesh and material as the last submission, we can just draw another instance of the last
+	// commands. Objects are stored in submission order, so gl_BaseInstance + gl_InstanceID still finds the right object
+	if (!_buckets.empty() && _buckets.back().Material == material && _lastMesh == mesh) {
+		for (size_t ix = _commands.size() - _lastMeshCommands; ix < _commands.size(); ix++) {
+			_commands[ix].InstanceCount++;
+		}
+		_instancedObjects++;
+		return;
+	}
+	_lastMesh = mesh;
+
+	// If this continues the last run, we can just extend the bucket, otherwise we start a new one. Since meshes from the
+	// same arena page share a VAO handle, they can all go in the same bucket
+	if (_buckets.empty() || _buckets.back().Material != material || _buckets.back().Mesh->GetHandle() != mesh->GetHandle()) {
+		_buckets.push_back({ material, mesh, _commands.size(), 0 });
+	}
+
+	DrawElementsIndirectCommand command;
+	command.InstanceCount = 1;
+	command.BaseInstance = objectIx;
+	const IndexBuffer::sptr& ibo = mesh->GetIndexBuffer();
+	const std::vector<DrawRange>& ranges = mesh->GetDrawRanges();
+	if (ibo != nullptr && !ranges.empty()) {
+		// Meshes that were split to fit 16 bit indices need a command per range
+		for (const DrawRange& range : ranges) {
+			command.Count = range.IndexCount;
+			command.FirstIndex = mesh->GetFirstIndex() + range.FirstIndex;
+			command.BaseVertex = mesh->GetBaseVertex() + range.BaseVertex;
+			_commands.push_back(command);
+		}
+		_lastMeshCommands = ranges.size();
+	} else {
+		if (ibo != nullptr) {
+			// Meshes baked into a geometry arena are views into a shared buffer, so we need to respect their ranges
+			command.Count = mesh->GetIndexCount();
+			command.FirstIndex = mesh->GetFirstIndex();
+			command.BaseVertex = mesh->GetBaseVertex();
+		} else {
+			// For non-indexed meshes, we use glMultiDrawArraysIndirect, which expects {count, instanceCount, first, baseInstance},
+			// so the first vertex goes in the first index slot, and the object index needs to go where the base vertex would be
+			command.Count = mesh->GetVertexCount();
+			command.FirstIndex = static_cast<GLuint>(mesh->GetBaseVertex());
+			command.BaseVertex = static_cast<GLint>(objectIx);
+		}
+		_commands.push_back(command);
+		_lastMeshCommands = 1;
+	}
+	_buckets.back().CommandCount += _lastMeshCommands;
+}
+
+void BatchRenderer::Flush(const std::function<void(const Shader::sptr&)>& onShaderChanged) {
+	if (_buckets.empty()) {
+		return;
+	}
+
+	// Wait for the GPU to be done with this frame's region, then stream all our data in one go
+	_objectBuffer->BeginFrame();
+	_commandBuffer->BeginFrame();
+
+	StreamingBuffer::Allocation objects = _objectBuffer->Upload(_objects.data(), _objects.size(), _storageAlignment);
+	StreamingBuffer::Allocation commands = _commandBuffer->Upload(_commands.data(), _commands.size(), sizeof(GLuint));
+	LOG_ASSERT(objects.IsValid() && commands.IsValid(), "Failed to allocate streaming memory for batch!");
+
+	_objectBuffer->BindRange(OBJECT_BUFFER_BINDING, objects);
+	_commandBuffer->Bind();
+
+	// We only track raw pointers here, the materials keep their shaders alive so there's no need to copy references
+	const Shader* currentShader = nullptr;
+	ShaderMaterial* currentMat = nullptr;
+	for (const Bucket& bucket : _buckets) {
+		// If the shader has changed, bind it and let the caller set up it's uniforms
+		const Shader::sptr& shader = bucket.Material->GetActiveShader();
+		if (currentShader != shader.get()) {
+			currentShader = shader.get();
+			shader->Bind();
+			if (onShaderChanged) {
+				onShaderChanged(shader);
+			}
+		}
+		// If the material has changed, apply it
+		if (currentMat != bucket.Material) {
+			currentMat = bucket.Material;
+			currentMat->Apply();
+			// Transparent materials blend over what's behind them, and shouldn't hide anything drawn after them
+			GLStateCache::SetEnabled(GL_BLEND, currentMat->Transparent);
+			GLStateCache::DepthMask(!currentMat->Transparent);
+			if (currentMat->Transparent) {
+				GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			}
+		}
+
+		// A bucket with a single command is just one mesh drawn some number of times, so a regular instanced draw will do
+		if (bucket.CommandCount == 1) {
+			const DrawElementsIndirectCommand& command = _commands[bucket.FirstCommand];
+			bucket.Mesh->RenderInstanced(static_cast<GLsizei>(command.InstanceCount), command.BaseInstance);
+			_drawCalls++;
+			continue;
+		}
+
+		// The indirect pointer is a byte offset into the bound GL_DRAW_INDIRECT_BUFFER
+		const void* indirect = (const void*)(commands.Offset + bucket.FirstCommand * sizeof(DrawElementsIndirectCommand));
+
+		bucket.Mesh->Bind();
+		const IndexBuffer::sptr& ibo = bucket.Mesh->GetIndexBuffer();
+		if (ibo != nullptr) {
+			glMultiDrawElementsIndirect(GL_TRIANGLES, ibo->GetElementType(), indirect, static_cast<GLsizei>(bucket.CommandCount), sizeof(DrawElementsIndirectCommand));
+		} else {
+			glMultiDrawArraysIndirect(GL_TRIANGLES, indirect, static_cast<GLsizei>(bucket.CommandCount), sizeof(DrawElementsIndirectCommand));
+		}
+		_drawCalls++;
+	}
+	// We leave the last VAO and the command buffer bound, the state cache will skip re-binding them next frame. Depth
+	// writes need to be restored though, otherwise clearing the depth buffer won't work
+	GLStateCache::Disable(GL_BLEND);
+	GLStateCache::DepthMask(true);
+
+	// Fence off this frame's region so we don't overwrite it while the GPU is still reading
+	_objectBuffer->EndFrame();
+	_commandBuffer->EndFrame();
+}
@@ -0,0 +1,216 @@
+#include "BlockCompressor.h"
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Logging.h"
+#include "ParallelFor.h"
+
+// Rounds a color to 5:6:5, the way BC1 stores it's endpoints
+static uint16_t PackRgb565(const glm::vec3& color) {
+	glm::vec3 clamped = glm::clamp(color, glm::vec3(0.0f), glm::vec3(255.0f));
+	uint16_t r = static_cast<uint16_t>(clamped.r * 31.0f / 255.0f + 0.5f);
+	uint16_t g = static_cast<uint16_t>(clamped.g * 63.0f / 255.0f + 0.5f);
+	uint16_t b = static_cast<uint16_t>(clamped.b * 31.0f / 255.0f + 0.5f);
+	return (r << 11) | (g << 5) | b;
+}
+
+// Expands a 5:6:5 color back out to 8 bits per channel, the same way the GPU will
+static glm::vec3 UnpackRgb565(uint16_t packed) {
+	uint32_t r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	return glm::vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+void BlockCompressor::EncodeBC1(const uint8_t* texels, uint8_t* dest) {
+	glm::vec3 colors[16];
+	glm::vec3 mean(0.0f);
+	for (int ix = 0; ix < 16; ix++) {
+		colors[ix] = glm::vec3(texels[ix * 4], texels[ix * 4 + 1], texels[ix * 4 + 2]);
+		mean += colors[ix];
+	}
+	mean /= 16.0f;
+
+	// Find the direction the colors vary the most along with a few rounds of power iteration on their covariance
+	glm::mat3 covariance(0.0f);
+	glm::vec3 low = colors[0], high = colors[0];
+	for (int ix = 0; ix < 16; ix++) {
+		glm::vec3 delta = colors[ix] - mean;
+		covariance += glm::outerProduct(delta, delta);
+		low = glm::min(low, colors[ix]);
+		high = glm::max(high, colors[ix]);
+	}
+	glm::vec3 axis = high - low;
+	for (int iteration = 0; iteration < 8; iteration++) {
+		axis = covariance * axis;
+		float length = glm::length(axis);
+		if (length < 1e-6f) {
+			break;
+		}
+		axis /= length;
+	}
+
+	// The endpoints are the furthest colors along that axis
+	float minProj = 0.0f, maxProj = 0.0f;
+	if (glm::dot(axis, axis) > 1e-12f) {
+		axis = glm::normalize(axis);
+		minProj = maxProj = glm::dot(colors[0] - mean, axis);
+		for (int ix = 1; ix < 16; ix++) {
+			float proj = glm::dot(colors[ix] - mean, axis);
+			minProj = std::min(minProj, proj);
+			maxProj = std::max(maxProj, proj);
+		}
+	}
+	uint16_t color0 = PackRgb565(mean + axis * maxProj);
+	uint16_t color1 = PackRgb565(mean + axis * minProj);
+	// color0 > color1 selects the 4 color mode, if they're equal every texel just uses the first endpoint
+	if (color0 < color1) {
+		std::swap(color0, color1);
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		glm::vec3 palette[4];
+		palette[0] = UnpackRgb565(color0);
+		palette[1] = UnpackRgb565(color1);
+		palette[2] = (palette[0] * 2.0f + palette[1]) / 3.0f;
+		palette[3] = (palette[0] + palette[1] * 2.0f) / 3.0f;
+		for (int ix = 0; ix < 16; ix++) {
+			uint32_t best = 0;
+			float bestDistance = FLT_MAX;
+			for (uint32_t entry = 0; entry < 4; entry++) {
+				glm::vec3 delta = colors[ix] - palette[entry];
+				float distance = glm::dot(delta, delta);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = entry;
+				}
+			}
+			indices |= best << (ix * 2);
+		}
+	}
+
+	dest[0] = color0 & 0xFF;
+	dest[1] = color0 >> 8;
+	dest[2] = color1 & 0xFF;
+	dest[3] = color1 >> 8;
+	for (int ix = 0; ix < 4; ix++) {
+		dest[4 + ix] = (indices >> (ix * 8)) & 0xFF;
+	}
+}
+
+void BlockCompressor::EncodeBC4(const uint8_t* texels, size_t stride, uint8_t* dest) {
+	uint8_t low = 255, high = 0;
+	for (int ix = 0; ix < 16; ix++) {
+		low = std::min(low, texels[ix * stride]);
+		high = std::max(high, texels[ix * stride]);
+	}
+
+	// With the first endpoint larger, the block uses 6 values interpolated between the endpoints
+	uint64_t indices = 0;
+	if (high != low) {
+		int palette[8];
+		palette[0] = high;
+		palette[1] = low;
+		for (int ix = 1; ix < 7; ix++) {
+			palette[ix + 1] = ((7 - ix) * high + ix * low) / 7;
+		}
+		for (int ix = 0; ix < 16; ix++) {
+			int value = texels[ix * stride];
+			uint64_t best = 0;
+			int bestDistance = 256;
+			for (int entry = 0; entry < 8; entry++) {
+				int distance = std::abs(value - palette[entry]);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = entry;
+				}
+			}
+			indices |= best << (ix * 3);
+		}
+	}
+
+	dest[0] = high;
+	dest[1] = low;
+	for (int ix = 0; ix < 6; ix++) {
+		dest[2 + ix] = (indices >> (ix * 8)) & 0xFF;
+	}
+}
+
+InternalFormat BlockCompressor::GetTargetFormat(PixelFormat format) {
+	switch (format) {
+	case PixelFormat::RG:
+		return InternalFormat::BC5;
+	case PixelFormat::RGB:
+		return InternalFormat::BC1;
+	case PixelFormat::RGBA:
+		return InternalFormat::BC3;
+	default:
+		return InternalFormat::Unknown;
+	}
+}
+
+Texture2DData::sptr BlockCompressor::Compress(const Texture2DData::sptr& data) {
+	InternalFormat format = GetTargetFormat(data->GetFormat());
+	if (data->IsCompressed() || data->GetPixelType() != PixelType::UByte || format == InternalFormat::Unknown) {
+		return nullptr;
+	}
+	const uint32_t channels = static_cast<uint32_t>(GetTexelComponentCount(data->GetFormat()));
+	const size_t blockSize = GetCompressedBlockSize(format);
+
+	// Lay out the compressed levels, and make a list of every row of blocks so that the work can be split up evenly
+	// even when most of the rows are in the first level
+	struct BlockRow { uint32_t Level; uint32_t Y; };
+	std::vector<MipLevel> levels(data->GetLevelCount());
+	std::vector<BlockRow> rows;
+	size_t offset = 0;
+	for (uint32_t ix = 0; ix < data->GetLevelCount(); ix++) {
+		const MipLevel& source = data->GetLevel(ix);
+		levels[ix] = { source.Width, source.Height, offset, GetCompressedImageSize(format, source.Width, source.Height) };
+		offset += levels[ix].Size;
+		for (uint32_t y = 0; y < source.Height; y += 4) {
+			rows.push_back({ ix, y });
+		}
+	}
+	std::vector<uint8_t> result(offset);
+
+	ParallelFor(rows.size(), [&](size_t rowIx) {
+		const BlockRow& row = rows[rowIx];
+		const MipLevel& source = data->GetLevel(row.Level);
+		const uint8_t* pixels = static_cast<const uint8_t*>(data->GetLevelDataPtr(row.Level));
+		uint8_t* dest = result.data() + levels[row.Level].Offset + (row.Y / 4) * ((source.Width + 3) / 4) * blockSize;
+
+		for (uint32_t x = 0; x < source.Width; x += 4, dest += blockSize) {
+			// Gather the block as RGBA, texels past the edge of the image repeat the last row or column
+			uint8_t block[16 * 4];
+			for (uint32_t ix = 0; ix < 16; ix++) {
+				uint32_t px = std::min(x + (ix & 3), source.Width - 1);
+				uint32_t py = std::min(row.Y + (ix >> 2), source.Height - 1);
+				const uint8_t* texel = pixels + (py * (size_t)source.Width + px) * channels;
+				for (uint32_t c = 0; c < 4; c++) {
+					block[ix * 4 + c] = c < channels ? texel[c] : 255;
+				}
+			}
+
+			switch (format) {
+			case InternalFormat::BC1:
+				EncodeBC1(block, dest);
+				break;
+			case InternalFormat::BC3:
+				EncodeBC4(block + 3, 4, dest);
+				EncodeBC1(block, dest + 8);
+				break;
+			case InternalFormat::BC5:
+				EncodeBC4(block, 4, dest);
+				EncodeBC4(block + 1, 4, dest + 8);
+				break;
+			default:
+				break;
+			}
+		}
+	}, 4);
+
+	Texture2DData::sptr compressed = std::make_shared<Texture2DData>(data->GetWidth(), data->GetHeight(), format, levels, result.data());
+	compressed->DebugName = data->DebugName;
+	return compressed;
+}
@@ -0,0 +1,267 @@
+#include "GLStateCache.h"
+
+GLStateCache::State      GLStateCache::_state;
+GLStateCache::FrameStats GLStateCache::_frameStats = { 0, 0 };
+GLStateCache::FrameStats GLStateCache::_lastFrameStats = { 0, 0 };
+
+// Everything starts out unknown, so the first call for each state is always issued
+static const bool _isStaticInit = (GLStateCache::Invalidate(), true);
+
+void GLStateCache::UseProgram(GLuint program) {
+	if (_Changed(_state.Program, program)) {
+		glUseProgram(program);
+	}
+}
+
+void GLStateCache::BindVertexArray(GLuint vao) {
+	if (_Changed(_state.VertexArray, vao)) {
+		glBindVertexArray(vao);
+		// The element buffer binding belongs to the VAO, so we don't know what it is anymore
+		_state.Buffers[_GetBufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+	}
+}
+
+void GLStateCache::BindTextureUnit(GLuint unit, GLuint texture) {
+	if (unit >= MAX_TEXTURE_UNITS) {
+		_frameStats.Issued++;
+		glBindTextureUnit(unit, texture);
+	} else if (_Changed(_state.Textures[unit], texture)) {
+		glBindTextureUnit(unit, texture);
+	}
+}
+
+void GLStateCache::BindSampler(GLuint unit, GLuint sampler) {
+	if (unit >= MAX_TEXTURE_UNITS) {
+		_frameStats.Issued++;
+		glBindSampler(unit, sampler);
+	} else if (_Changed(_state.Samplers[unit], sampler)) {
+		glBindSampler(unit, sampler);
+	}
+}
+
+void GLStateCache::BindFramebuffer(GLenum target, GLuint framebuffer) {
+	switch (target) {
+		case GL_FRAMEBUFFER:
+			if (_state.ReadFramebuffer == framebuffer && _state.DrawFramebuffer == framebuffer) {
+				_frameStats.Filtered++;
+			} else {
+				_state.ReadFramebuffer = _state.DrawFramebuffer = framebuffer;
+				_frameStats.Issued++;
+				glBindFramebuffer(target, framebuffer);
+			}
+			break;
+		case GL_READ_FRAMEBUFFER:
+			if (_Changed(_state.ReadFramebuffer, framebuffer)) {
+				glBindFramebuffer(target, framebuffer);
+			}
+			break;
+		case GL_DRAW_FRAMEBUFFER:
+			if (_Changed(_state.DrawFramebuffer, framebuffer)) {
+				glBindFramebuffer(target, framebuffer);
+			}
+			break;
+		default:
+			_frameStats.Issued++;
+			glBindFramebuffer(target, framebuffer);
+			break;
+	}
+}
+
+void GLStateCache::BindBuffer(GLenum target, GLuint buffer) {
+	int slot = _GetBufferSlot(target);
+	if (slot == -1) {
+		_frameStats.Issued++;
+		glBindBuffer(target, buffer);
+	} else if (_Changed(_state.Buffers[slot], buffer)) {
+		glBindBuffer(target, buffer);
+	}
+}
+
+void GLStateCache::BindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	IndexedBinding* bindings = _GetIndexedBindings(target);
+	if (bindings == nullptr || index >= MAX_BUFFER_BINDINGS) {
+		_frameStats.Issued++;
+		glBindBufferBase(target, index, buffer);
+	} else if (_Changed(bindings[index], IndexedBinding{ buffer, 0, -1 })) {
+		glBindBufferBase(target, index, buffer);
+		// Indexed binds also bind the buffer to the generic binding point
+		_state.Buffers[_GetBufferSlot(target)] = buffer;
+	}
+}
+
+void GLStateCache::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	IndexedBinding* bindings = _GetIndexedBindings(target);
+	if (bindings == nullptr || index >= MAX_BUFFER_BINDINGS) {
+		_frameStats.Issued++;
+		glBindBufferRange(target, index, buffer, offset, size);
+	} else if (_Changed(bindings[index], IndexedBinding{ buffer, offset, size })) {
+		glBindBufferRange(target, index, buffer, offset, size);
+		_state.Buffers[_GetBufferSlot(target)] = buffer;
+	}
+}
+
+void GLStateCache::SetEnabled(GLenum capability, bool enabled) {
+	int slot = _GetCapabilitySlot(capability);
+	if (slot == -1) {
+		_frameStats.Issued++;
+	} else if (!_Changed(_state.Capabilities[slot], static_cast<GLuint>(enabled))) {
+		return;
+	}
+	if (enabled) {
+		glEnable(capability);
+	} else {
+		glDisable(capability);
+	}
+}
+
+void GLStateCache::BlendFunc(GLenum source, GLenum destination) {
+	if (_state.BlendSource == source && _state.BlendDestination == destination) {
+		_frameStats.Filtered++;
+	} else {
+		_state.BlendSource = source;
+		_state.BlendDestination = destination;
+		_frameStats.Issued++;
+		glBlendFunc(source, destination);
+	}
+}
+
+void GLStateCache::DepthFunc(GLenum func) {
+	if (_Changed(_state.DepthFunc, func)) {
+		glDepthFunc(func);
+	}
+}
+
+void GLStateCache::DepthMask(bool write) {
+	if (_Changed(_state.DepthMask, static_cast<GLuint>(write))) {
+		glDepthMask(write ? GL_TRUE : GL_FALSE);
+	}
+}
+
+void GLStateCache::CullFace(GLenum face) {
+	if (_Changed(_state.CullFace, face)) {
+		glCullFace(face);
+	}
+}
+
+void GLStateCache::DeleteProgram(GLuint program) {
+	// Programs that are in use are only flagged for deletion, so the name stays valid until another program is used
+	glDeleteProgram(program);
+}
+
+void GLStateCache::DeleteVertexArrays(GLsizei count, const GLuint* handles) {
+	for (GLsizei ix = 0; ix < count; ix++) {
+		if (_state.VertexArray == handles[ix]) {
+			_state.VertexArray = 0;
+			_state.Buffers[_GetBufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = 0;
+		}
+	}
+	glDeleteVertexArrays(count, handles);
+}
+
+void GLStateCache::DeleteTextures(GLsizei count, const GLuint* handles) {
+	for (GLsizei ix = 0; ix < count; ix++) {
+		for (GLuint& texture : _state.Textures) {
+			if (texture == handles[ix]) {
+				texture = 0;
+			}
+		}
+	}
+	glDeleteTextures(count, handles);
+}
+
+void GLStateCache::DeleteFramebuffers(GLsizei count, const GLuint* handles) {
+	for (GLsizei ix = 0; ix < count; ix++) {
+		if (_state.ReadFramebuffer == handles[ix]) {
+			_state.ReadFramebuffer = 0;
+		}
+		if (_state.DrawFramebuffer == handles[ix]) {
+			_state.DrawFramebuffer = 0;
+		}
+	}
+	glDeleteFramebuffers(count, handles);
+}
+
+void GLStateCache::DeleteBuffers(GLsizei count, const GLuint* handles) {
+	for (GLsizei ix = 0; ix < count; ix++) {
+		// Deleting a buffer resets every binding of it in the current context to 0
+		for (GLuint& buffer : _state.Buffers) {
+			if (buffer == handles[ix]) {
+				buffer = 0;
+			}
+		}
+		for (GLuint binding = 0; binding < MAX_BUFFER_BINDINGS; binding++) {
+			if (_state.UniformBuffers[binding].Buffer == handles[ix]) {
+				_state.UniformBuffers[binding] = { 0, 0, -1 };
+			}
+			if (_state.StorageBuffers[binding].Buffer == handles[ix]) {
+				_state.StorageBuffers[binding] = { 0, 0, -1 };
+			}
+		}
+	}
+	glDeleteBuffers(count, handles);
+}
+
+void GLStateCache::Invalidate() {
+	_state.Program = UNKNOWN;
+	_state.VertexArray = UNKNOWN;
+	for (GLuint unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+		_state.Textures[unit] = UNKNOWN;
+		_state.Samplers[unit] = UNKNOWN;
+	}
+	_state.ReadFramebuffer = UNKNOWN;
+	_state.DrawFramebuffer = UNKNOWN;
+	for (GLuint& buffer : _state.Buffers) {
+		buffer = UNKNOWN;
+	}
+	for (GLuint binding = 0; binding < MAX_BUFFER_BINDINGS; binding++) {
+		_state.UniformBuffers[binding] = { UNKNOWN, 0, 0 };
+		_state.StorageBuffers[binding] = { UNKNOWN, 0, 0 };
+	}
+	for (GLuint& capability : _state.Capabilities) {
+		capability = UNKNOWN;
+	}
+	_state.BlendSource = UNKNOWN;
+	_state.BlendDestination = UNKNOWN;
+	_state.DepthFunc = UNKNOWN;
+	_state.DepthMask = UNKNOWN;
+	_state.CullFace = UNKNOWN;
+}
+
+void GLStateCache::BeginFrame() {
+	_lastFrameStats = _frameStats;
+	_frameStats = { 0, 0 };
+}
+
+int GLStateCache::_GetBufferSlot(GLenum target) {
+	switch (target) {
+		case GL_ARRAY_BUFFER:          return 0;
+		case GL_ELEMENT_ARRAY_BUFFER:  return 1;
+		case GL_UNIFORM_BUFFER:        return 2;
+		case GL_SHADER_STORAGE_BUFFER: return 3;
+		case GL_DRAW_INDIRECT_BUFFER:  return 4;
+		case GL_PIXEL_PACK_BUFFER:     return 5;
+		case GL_PIXEL_UNPACK_BUFFER:   return 6;
+		case GL_COPY_READ_BUFFER:      return 7;
+		case GL_COPY_WRITE_BUFFER:     return 8;
+		default:                       return -1;
+	}
+}
+
+int GLStateCache::_GetCapabilitySlot(GLenum capability) {
+	switch (capability) {
+		case GL_BLEND:        return 0;
+		case GL_DEPTH_TEST:   return 1;
+		case GL_CULL_FACE:    return 2;
+		case GL_SCISSOR_TEST: return 3;
+		case GL_STENCIL_TEST: return 4;
+		default:              return -1;
+	}
+}
+
+GLStateCache::IndexedBinding* GLStateCache::_GetIndexedBindings(GLenum target) {
+	switch (target) {
+		case GL_UNIFORM_BUFFER:        return _state.UniformBuffers;
+		case GL_SHADER_STORAGE_BUFFER: return _state.StorageBuffers;
+		default:                       return nullptr;
+	}
+}
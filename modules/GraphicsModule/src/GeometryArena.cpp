@@ -0,0 +1,199 @@
+#include "GeometryArena.h"
+#include <algorithm>
+#include "Logging.h"
+
+GeometryArena::sptr GeometryArena::_default = nullptr;
+
+RangeAllocator::RangeAllocator(size_t capacity) :
+	_capacity(capacity),
+	_used(0)
+{
+	if (capacity > 0) {
+		_freeRanges[0] = capacity;
+	}
+}
+
+bool RangeAllocator::Allocate(size_t count, size_t& outOffset) {
+	for (auto it = _freeRanges.begin(); it != _freeRanges.end(); it++) {
+		if (it->second >= count) {
+			outOffset = it->first;
+			size_t remaining = it->second - count;
+			_freeRanges.erase(it);
+			// Put the remainder of the range back into the free list
+			if (remaining > 0) {
+				_freeRanges[outOffset + count] = remaining;
+			}
+			_used += count;
+			return true;
+		}
+	}
+	return false;
+}
+
+void RangeAllocator::Free(size_t offset, size_t count) {
+	if (count == 0) return;
+	auto inserted = _freeRanges.emplace(offset, count).first;
+	_used -= count;
+
+	// Merge with the next range if they touch
+	auto next = std::next(inserted);
+	if (next != _freeRanges.end() && inserted->first + inserted->second == next->first) {
+		inserted->second += next->second;
+		_freeRanges.erase(next);
+	}
+	// Merge with the previous range if they touch
+	if (inserted != _freeRanges.begin()) {
+		auto prev = std::prev(inserted);
+		if (prev->first + prev->second == inserted->first) {
+			prev->second += inserted->second;
+			_freeRanges.erase(inserted);
+		}
+	}
+}
+
+GeometryArena::GeometryArena(size_t verticesPerPage, size_t indicesPerPage) :
+	_verticesPerPage(verticesPerPage),
+	_indicesPerPage(indicesPerPage)
+{ }
+
+uint32_t GeometryArena::GetLayoutId(const std::vector<BufferAttribute>& layout, size_t stride, GLenum indexType) {
+	for (size_t ix = 0; ix < _layouts.size(); ix++) {
+		if (_layouts[ix].Declaration == &layout && _layouts[ix].IndexType == indexType) {
+			LOG_ASSERT(_layouts[ix].Stride == stride, "Layout was registered with a different stride! {} vs {}", _layouts[ix].Stride, stride);
+			return static_cast<uint32_t>(ix);
+		}
+	}
+	Layout result;
+	result.Declaration = &layout;
+	result.Stride = stride;
+	result.IndexType = indexType;
+	result.IndexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	_layouts.push_back(result);
+	return static_cast<uint32_t>(_layouts.size() - 1);
+}
+
+VertexArrayObject::sptr GeometryArena::Upload(const void* vertices, size_t vertexSize, size_t vertexCount, const std::vector<BufferAttribute>& layout,
+	const uint32_t* indices, size_t indexCount, MeshHandle* outHandle)
+{
+	// Non-indexed meshes get a sequential index buffer, so that every mesh in the arena can be drawn the same way
+	std::vector<uint32_t> generated;
+	if (indices == nullptr || indexCount == 0) {
+		generated.resize(vertexCount);
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			generated[ix] = static_cast<uint32_t>(ix);
+		}
+		indices = generated.data();
+		indexCount = generated.size();
+	}
+
+	// Most meshes are small enough to use 16 bit indices, which halves the size of the index data
+	if (IndexBuffer::FitsShortIndices(indices, indexCount)) {
+		std::vector<uint16_t> compact(indices, indices + indexCount);
+		return Upload(vertices, vertexSize, vertexCount, layout, compact.data(), GL_UNSIGNED_SHORT, indexCount, outHandle);
+	}
+	return Upload(vertices, vertexSize, vertexCount, layout, indices, GL_UNSIGNED_INT, indexCount, outHandle);
+}
+
+VertexArrayObject::sptr GeometryArena::Upload(const void* vertices, size_t vertexSize, size_t vertexCount, const std::vector<BufferAttribute>& layout,
+	const void* indices, GLenum indexType, size_t indexCount, MeshHandle* outHandle)
+{
+	LOG_ASSERT(indexType == GL_UNSIGNED_SHORT || indexType == GL_UNSIGNED_INT, "Geometry arenas only store 16 or 32 bit indices!");
+	MeshHandle handle;
+	handle.LayoutId = GetLayoutId(layout, vertexSize, indexType);
+	handle.VertexCount = static_cast<uint32_t>(vertexCount);
+	handle.IndexCount = static_cast<uint32_t>(indexCount);
+	Layout& target = _layouts[handle.LayoutId];
+
+	// Find the first page that has room for the mesh
+	size_t baseVertex = 0, firstIndex = 0;
+	Page* page = nullptr;
+	for (size_t ix = 0; ix < target.Pages.size(); ix++) {
+		Page& candidate = target.Pages[ix];
+		if (candidate.VertexRanges.Allocate(vertexCount, baseVertex)) {
+			if (candidate.IndexRanges.Allocate(indexCount, firstIndex)) {
+				page = &candidate;
+				handle.PageIndex = static_cast<uint32_t>(ix);
+				break;
+			}
+			candidate.VertexRanges.Free(baseVertex, vertexCount);
+		}
+	}
+
+	// If no page had room, we make a new one (making sure it's large enough to hold the mesh)
+	if (page == nullptr) {
+		Page newPage;
+		size_t pageVertices = std::max(_verticesPerPage, vertexCount);
+		size_t pageIndices = std::max(_indicesPerPage, indexCount);
+
+		newPage.Vertices = VertexBuffer::Create();
+		newPage.Vertices->AllocateStorage(vertexSize, pageVertices);
+		newPage.Indices = IndexBuffer::Create();
+		newPage.Indices->AllocateStorage(target.IndexSize, pageIndices, indexType);
+		newPage.Vao = VertexArrayObject::Create();
+		newPage.Vao->AddVertexBuffer(newPage.Vertices, layout);
+		newPage.Vao->SetIndexBuffer(newPage.Indices);
+		newPage.VertexRanges = RangeAllocator(pageVertices);
+		newPage.IndexRanges = RangeAllocator(pageIndices);
+		newPage.VertexRanges.Allocate(vertexCount, baseVertex);
+		newPage.IndexRanges.Allocate(indexCount, firstIndex);
+
+		LOG_INFO("Allocated geometry arena page for layout {} ({} vertices, {} indices)", handle.LayoutId, pageVertices, pageIndices);
+
+		target.Pages.push_back(newPage);
+		handle.PageIndex = static_cast<uint32_t>(target.Pages.size() - 1);
+		page = &target.Pages.back();
+	}
+
+	handle.BaseVertex = static_cast<uint32_t>(baseVertex);
+	handle.FirstIndex = static_cast<uint32_t>(firstIndex);
+
+	page->Vertices->UpdateData(vertices, baseVertex * vertexSize, vertexCount * vertexSize);
+	page->Indices->UpdateData(indices, firstIndex * target.IndexSize, indexCount * target.IndexSize);
+
+	if (outHandle != nullptr) {
+		*outHandle = handle;
+	}
+
+	// The view will hand it's range back to us when it's destroyed (if we're still alive)
+	std::weak_ptr<GeometryArena> arena = weak_from_this();
+	return VertexArrayObject::Create(page->Vao, handle.FirstIndex, (GLsizei)handle.IndexCount, (GLint)handle.BaseVertex, (GLsizei)handle.VertexCount,
+		[arena, handle]() {
+			if (sptr locked = arena.lock()) {
+				locked->_Free(handle);
+			}
+		});
+}
+
+void GeometryArena::_Free(const MeshHandle& handle) {
+	Page& page = _layouts[handle.LayoutId].Pages[handle.PageIndex];
+	page.VertexRanges.Free(handle.BaseVertex, handle.VertexCount);
+	page.IndexRanges.Free(handle.FirstIndex, handle.IndexCount);
+}
+
+size_t GeometryArena::GetPageCount() const {
+	size_t result = 0;
+	for (const Layout& layout : _layouts) {
+		result += layout.Pages.size();
+	}
+	return result;
+}
+
+size_t GeometryArena::GetReservedBytes() const {
+	size_t result = 0;
+	for (const Layout& layout : _layouts) {
+		for (const Page& page : layout.Pages) {
+			result += page.Vertices->GetTotalSize() + page.Indices->GetTotalSize();
+		}
+	}
+	return result;
+}
+
+size_t GeometryArena::GetUsedBytes() const {
+	size_t result = 0;
+	for (const Layout& layout : _layouts) {
+		for (const Page& page : layout.Pages) {
+			result += page.VertexRanges.GetUsed() * layout.Stride + page.IndexRanges.GetUsed() * layout.IndexSize;
+		}
+	}
+	return result;
+}
@@ -1,4 +1,6 @@
 #include "IBuffer.h"
+#include "GLStateCache.h"
+#include "Logging.h"
 
 IBuffer::IBuffer(GLenum type, GLenum usage) :
 	_elementCount(0),
@@ -12,7 +14,7 @@ IBuffer::IBuffer(GLenum type, GLenum usage) :
 
 IBuffer::~IBuffer() {
 	if (_handle != 0) {
-		glDeleteBuffers(1, &_handle);
+		GLStateCache::DeleteBuffers(1, &_handle);
 		_handle = 0;
 	}
 }
@@ -24,10 +26,25 @@ void IBuffer::LoadData(const void* data, size_t elementSize, size_t elementCount
 	_elementSize = elementSize;
 }
 
+void IBuffer::AllocateStorage(size_t elementSize, size_t elementCount, GLbitfield flags, const void* data) {
+	// Immutable storage can only be specified once. Swapping in a new handle would leave VAOs and mapped pointers
+	// using the old one, so this is a bug in the caller
+	GLint isImmutable = GL_FALSE;
+	glGetNamedBufferParameteriv(_handle, GL_BUFFER_IMMUTABLE_STORAGE, &isImmutable);
+	LOG_ASSERT(!isImmutable, "Buffer {} already has immutable storage!", _handle);
+	glNamedBufferStorage(_handle, elementSize * elementCount, data, flags);
+	_elementCount = elementCount;
+	_elementSize = elementSize;
+}
+
+void IBuffer::UpdateData(const void* data, size_t offset, size_t size) {
+	glNamedBufferSubData(_handle, offset, size, data);
+}
+
 void IBuffer::Bind() {
-	glBindBuffer(_type, _handle);
+	GLStateCache::BindBuffer(_type, _handle);
 }
 
 void IBuffer::UnBind(GLenum type) {
-	glBindBuffer(type, 0);
+	GLStateCache::BindBuffer(type, 0);
 }
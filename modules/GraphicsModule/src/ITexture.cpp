@@ -1,5 +1,6 @@
 #include "ITexture.h"
 
+#include "GLStateCache.h"
 #include "Logging.h"
 
 ITexture::Limits ITexture::_limits = ITexture::Limits();
@@ -31,21 +32,19 @@ ITexture::ITexture()
 
 ITexture::~ITexture() {
 	if (glIsTexture(_handle)) {
-		glDeleteTextures(1, &_handle);
+		GLStateCache::DeleteTextures(1, &_handle);
 	}
 }
 
 void ITexture::Bind(int slot) const {
 	if (_handle != 0) {
-		//glActiveTexture(GL_TEXTURE0 + slot);
-		glBindTextureUnit(slot, _handle);
+		GLStateCache::BindTextureUnit(slot, _handle);
 	}
 }
 
 void ITexture::Unbind(int slot)
 {
-	//glActiveTexture(GL_TEXTURE0 + slot);
-	glBindTextureUnit(slot, 0);
+	GLStateCache::BindTextureUnit(slot, 0);
 }
 
 
@@ -0,0 +1,99 @@
+#include "MappedFile.h"
+
+#ifdef WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::sptr MappedFile::Create(const std::string& path) {
+	sptr result = std::make_shared<MappedFile>();
+	return result->_Open(path) ? result : nullptr;
+}
+
+MappedFile::MappedFile() :
+	_data(nullptr),
+	_size(0),
+	_file(nullptr),
+	_mapping(nullptr)
+{ }
+
+#ifdef WINDOWS
+
+MappedFile::~MappedFile() {
+	if (_data != nullptr) {
+		UnmapViewOfFile(_data);
+	}
+	if (_mapping != nullptr) {
+		CloseHandle(_mapping);
+	}
+	if (_file != nullptr) {
+		CloseHandle(_file);
+	}
+}
+
+bool MappedFile::_Open(const std::string& path) {
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	_file = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		return false;
+	}
+	_size = static_cast<size_t>(size.QuadPart);
+	// Windows can't map an empty file, but there's nothing to read anyways
+	if (_size == 0) {
+		return true;
+	}
+
+	_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_mapping == nullptr) {
+		return false;
+	}
+	_data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	return _data != nullptr;
+}
+
+#else
+
+MappedFile::~MappedFile() {
+	if (_data != nullptr) {
+		munmap(const_cast<uint8_t*>(_data), _size);
+	}
+}
+
+bool MappedFile::_Open(const std::string& path) {
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(file, &info) != 0) {
+		close(file);
+		return false;
+	}
+	_size = static_cast<size_t>(info.st_size);
+	if (_size == 0) {
+		close(file);
+		return true;
+	}
+
+	void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file, 0);
+	// The mapping keeps it's own reference to the file, so we can close our handle right away
+	close(file);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+	_data = static_cast<const uint8_t*>(data);
+	return true;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include "MaterialBuffer.h"
+#include <stdexcept>
+#include "GLStateCache.h"
+#include "Logging.h"
+
+MaterialBuffer::sptr MaterialBuffer::_default = nullptr;
+
+MaterialBuffer::MaterialBuffer(size_t capacity) :
+	IBuffer(GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW),
+	_alignment(256),
+	_ranges(0),
+	_bytesUploaded(0)
+{
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	_alignment = static_cast<size_t>(alignment > 0 ? alignment : 256);
+
+	size_t units = capacity / _alignment;
+	_ranges = RangeAllocator(units);
+	AllocateStorage(_alignment, units, GL_DYNAMIC_STORAGE_BIT);
+}
+
+void MaterialBuffer::LoadData(const void* /*data*/, size_t /*elementSize*/, size_t /*elementCount*/) {
+	throw std::runtime_error("Material buffers have fixed storage, use Allocate and Update instead");
+}
+
+MaterialBuffer::Allocation MaterialBuffer::Allocate(size_t size) {
+	size_t units = (size + _alignment - 1) / _alignment;
+	size_t offset = 0;
+	if (units == 0 || !_ranges.Allocate(units, offset)) {
+		LOG_WARN("Material buffer is full, failed to allocate a {} byte block! ({} of {} bytes used)", size, GetUsed(), GetTotalSize());
+		return { 0, 0 };
+	}
+	return { offset * _alignment, size };
+}
+
+void MaterialBuffer::Free(const Allocation& allocation) {
+	if (allocation.IsValid()) {
+		_ranges.Free(allocation.Offset / _alignment, (allocation.Size + _alignment - 1) / _alignment);
+	}
+}
+
+void MaterialBuffer::Update(const Allocation& allocation, const void* data, size_t offset, size_t size) {
+	LOG_ASSERT(offset + size <= allocation.Size, "Material block update is out of range!");
+	UpdateData(data, allocation.Offset + offset, size);
+	_bytesUploaded += size;
+}
+
+void MaterialBuffer::Bind(const Allocation& allocation) {
+	GLStateCache::BindBufferRange(GL_UNIFORM_BUFFER, BINDING, _handle, allocation.Offset, allocation.Size);
+}
+
+void MaterialBuffer::Bind() {
+	GLStateCache::BindBufferBase(GL_UNIFORM_BUFFER, BINDING, _handle);
+}
@@ -0,0 +1,269 @@
+#include "MeshCooker.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "HashUtils.h"
+#include "IndexBuffer.h"
+#include "Logging.h"
+#include "MappedFile.h"
+#include "VertexBuffer.h"
+#include "VertexTypes.h"
+
+MeshCooker::sptr MeshCooker::_default = nullptr;
+
+// Ranges are written and read with a single memcpy, so they need to match the cooked layout exactly
+static_assert(sizeof(DrawRange) == sizeof(CookedDrawRange), "DrawRange should match CookedDrawRange");
+
+// The minimum value of GL_MAX_VERTEX_ATTRIBS, any slot past this didn't come from one of our layouts
+static const uint32_t MAX_ATTRIBUTE_SLOTS = 16;
+
+static size_t AlignUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// Gets the size of a single component of an attribute, or 0 for types that our layouts never use
+static size_t GetComponentSize(uint32_t type) {
+	switch (type) {
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:  return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT:     return 2;
+		case GL_INT:
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:          return 4;
+		default:                return 0;
+	}
+}
+
+// The arena tells layouts apart by the address of their declaration, so cooked layouts need to be matched back to
+// the static declarations to share pages with meshes that were baked from source
+static const std::vector<BufferAttribute>* FindKnownLayout(const std::vector<BufferAttribute>& layout, size_t stride) {
+	static const std::pair<const std::vector<BufferAttribute>*, size_t> known[] = {
+		{ &VertexPosCol::V_DECL,              sizeof(VertexPosCol) },
+		{ &VertexPosNormCol::V_DECL,          sizeof(VertexPosNormCol) },
+		{ &VertexPosNormTex::V_DECL,          sizeof(VertexPosNormTex) },
+		{ &VertexPosNormTexCol::V_DECL,       sizeof(VertexPosNormTexCol) },
+		{ &VertexPackedPosNormTexCol::V_DECL, sizeof(VertexPackedPosNormTexCol) },
+		{ &VertexHalfPosNormTexCol::V_DECL,   sizeof(VertexHalfPosNormTexCol) }
+	};
+	for (const auto& [declaration, size] : known) {
+		if (size != stride || declaration->size() != layout.size()) {
+			continue;
+		}
+		bool matches = true;
+		for (size_t ix = 0; ix < layout.size() && matches; ix++) {
+			const BufferAttribute& a = (*declaration)[ix];
+			const BufferAttribute& b = layout[ix];
+			matches = a.Slot == b.Slot && a.Size == b.Size && a.Type == b.Type && a.Normalized == b.Normalized &&
+				a.Offset == b.Offset && a.Usage == b.Usage;
+		}
+		if (matches) {
+			return declaration;
+		}
+	}
+	return nullptr;
+}
+
+MeshCooker::MeshCooker(const std::string& directory) :
+	_directory(directory)
+{
+	std::error_code error;
+	std::filesystem::create_directories(_directory, error);
+	if (error) {
+		LOG_WARN("Failed to create mesh cache directory \"{}\": {}", _directory, error.message());
+	}
+}
+
+uint64_t MeshCooker::ComputeKey(const std::string& path, const std::string& options) const {
+	MappedFile::sptr source = MappedFile::Create(path);
+	if (source == nullptr) {
+		return 0;
+	}
+	uint64_t hash = HashFnv1a64(&COOKED_MESH_VERSION, sizeof(uint32_t));
+	hash = HashFnv1a64(source->GetData(), source->GetSize(), hash);
+	hash = HashFnv1a64(options.data(), options.size(), hash);
+	// 0 is reserved for sources we couldn't read
+	return hash != 0 ? hash : 1;
+}
+
+bool MeshCooker::Write(uint64_t key, const MeshData& mesh) const {
+	LOG_ASSERT(mesh.Layout != nullptr, "Cooked meshes need a vertex layout!");
+
+	// Most meshes (and every range of a split mesh) fit in 16 bit indices, which halves the size of the index section
+	bool compact = IndexBuffer::FitsShortIndices(mesh.Indices, mesh.IndexCount);
+	std::vector<uint16_t> shortIndices;
+	const void* indices = mesh.Indices;
+	size_t indexSize = sizeof(uint32_t);
+	if (compact) {
+		shortIndices.assign(mesh.Indices, mesh.Indices + mesh.IndexCount);
+		indices = shortIndices.data();
+		indexSize = sizeof(uint16_t);
+	}
+
+	CookedMeshHeader header;
+	header.Magic = COOKED_MESH_MAGIC;
+	header.Version = COOKED_MESH_VERSION;
+	header.Key = key;
+	for (int ix = 0; ix < 16; ix++) {
+		header.Dequantization[ix] = mesh.Dequantization[ix / 4][ix % 4];
+	}
+	for (int ix = 0; ix < 3; ix++) {
+		header.BoundsCenter[ix] = mesh.BoundsCenter[ix];
+	}
+	header.BoundsRadius = mesh.BoundsRadius;
+	header.Stride = static_cast<uint32_t>(mesh.Stride);
+	header.AttributeCount = static_cast<uint32_t>(mesh.Layout->size());
+	header.RangeCount = static_cast<uint32_t>(mesh.Ranges.size());
+	header.IndexType = compact ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	header.VertexCount = mesh.VertexCount;
+	header.IndexCount = mesh.IndexCount;
+	size_t tableEnd = sizeof(CookedMeshHeader) + header.AttributeCount * sizeof(CookedAttribute) + header.RangeCount * sizeof(CookedDrawRange);
+	header.VertexOffset = AlignUp(tableEnd, COOKED_MESH_SECTION_ALIGNMENT);
+	header.IndexOffset = AlignUp(header.VertexOffset + mesh.VertexCount * mesh.Stride, COOKED_MESH_SECTION_ALIGNMENT);
+	header.FileSize = header.IndexOffset + mesh.IndexCount * indexSize;
+
+	// Write to a temporary file first, so that a load that gets interrupted never leaves a partial file behind
+	std::string path = _GetPath(key);
+	std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			LOG_WARN("Failed to write cooked mesh \"{}\"", path);
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(CookedMeshHeader));
+		for (const BufferAttribute& attrib : *mesh.Layout) {
+			CookedAttribute cooked;
+			cooked.Slot = attrib.Slot;
+			cooked.Size = static_cast<uint32_t>(attrib.Size);
+			cooked.Type = attrib.Type;
+			cooked.Normalized = attrib.Normalized;
+			cooked.Offset = static_cast<uint32_t>(attrib.Offset);
+			cooked.Usage = static_cast<uint32_t>(attrib.Usage);
+			file.write(reinterpret_cast<const char*>(&cooked), sizeof(CookedAttribute));
+		}
+		file.write(reinterpret_cast<const char*>(mesh.Ranges.data()), mesh.Ranges.size() * sizeof(CookedDrawRange));
+
+		const char padding[COOKED_MESH_SECTION_ALIGNMENT] = { 0 };
+		file.write(padding, header.VertexOffset - tableEnd);
+		file.write(static_cast<const char*>(mesh.Vertices), mesh.VertexCount * mesh.Stride);
+		file.write(padding, header.IndexOffset - (header.VertexOffset + mesh.VertexCount * mesh.Stride));
+		file.write(static_cast<const char*>(indices), mesh.IndexCount * indexSize);
+		if (!file) {
+			LOG_WARN("Failed to write cooked mesh \"{}\"", path);
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+	if (error) {
+		LOG_WARN("Failed to write cooked mesh \"{}\": {}", path, error.message());
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
+
+VertexArrayObject::sptr MeshCooker::TryLoad(uint64_t key, const GeometryArena::sptr& arena) const {
+	if (key == 0) {
+		return nullptr;
+	}
+	std::string path = _GetPath(key);
+	MappedFile::sptr file = MappedFile::Create(path);
+	if (file == nullptr || file->GetSize() < sizeof(CookedMeshHeader)) {
+		return nullptr;
+	}
+
+	const uint8_t* data = file->GetData();
+	CookedMeshHeader header;
+	memcpy(&header, data, sizeof(CookedMeshHeader));
+	if (header.Magic != COOKED_MESH_MAGIC || header.Version != COOKED_MESH_VERSION || header.Key != key) {
+		return nullptr;
+	}
+	// Everything past the header comes from the file, so the counts and offsets are checked against the size of the
+	// file before they're used for anything, without multiplying counts that could overflow
+	size_t indexSize = header.IndexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	uint64_t tableEnd = sizeof(CookedMeshHeader) + static_cast<uint64_t>(header.AttributeCount) * sizeof(CookedAttribute) + static_cast<uint64_t>(header.RangeCount) * sizeof(CookedDrawRange);
+	bool valid = (header.IndexType == GL_UNSIGNED_SHORT || header.IndexType == GL_UNSIGNED_INT) &&
+		header.FileSize == file->GetSize() && header.Stride > 0 && header.VertexCount > 0 &&
+		header.AttributeCount > 0 && header.AttributeCount <= MAX_ATTRIBUTE_SLOTS &&
+		(header.RangeCount == 0 || header.IndexCount > 0) &&
+		header.VertexOffset >= tableEnd && header.VertexOffset % COOKED_MESH_SECTION_ALIGNMENT == 0 && header.VertexOffset <= header.FileSize &&
+		header.VertexCount <= (header.FileSize - header.VertexOffset) / header.Stride &&
+		header.IndexOffset >= header.VertexOffset + header.VertexCount * header.Stride && header.IndexOffset % COOKED_MESH_SECTION_ALIGNMENT == 0 &&
+		header.IndexOffset <= header.FileSize && header.IndexCount <= (header.FileSize - header.IndexOffset) / indexSize &&
+		std::isfinite(header.BoundsCenter[0]) && std::isfinite(header.BoundsCenter[1]) && std::isfinite(header.BoundsCenter[2]) &&
+		std::isfinite(header.BoundsRadius) && header.BoundsRadius >= 0.0f;
+
+	// Every attribute has to fit within a vertex, and each slot can only be used once
+	std::vector<BufferAttribute> layout;
+	layout.reserve(valid ? header.AttributeCount : 0);
+	uint32_t usedSlots = 0;
+	for (uint32_t ix = 0; ix < header.AttributeCount && valid; ix++) {
+		CookedAttribute cooked;
+		memcpy(&cooked, data + sizeof(CookedMeshHeader) + ix * sizeof(CookedAttribute), sizeof(CookedAttribute));
+		size_t componentSize = GetComponentSize(cooked.Type);
+		valid = cooked.Slot < MAX_ATTRIBUTE_SLOTS && (usedSlots & (1u << cooked.Slot)) == 0 &&
+			cooked.Size >= 1 && cooked.Size <= 4 && componentSize > 0 &&
+			cooked.Offset <= header.Stride && cooked.Size * componentSize <= header.Stride - cooked.Offset;
+		if (valid) {
+			usedSlots |= 1u << cooked.Slot;
+			layout.emplace_back(cooked.Slot, cooked.Size, cooked.Type, cooked.Normalized != 0, header.Stride, cooked.Offset, static_cast<AttribUsage>(cooked.Usage));
+		}
+	}
+
+	// Every range has to stay within the index section, and start on a vertex that exists
+	std::vector<DrawRange> ranges(valid ? header.RangeCount : 0);
+	if (valid) {
+		memcpy(ranges.data(), data + sizeof(CookedMeshHeader) + header.AttributeCount * sizeof(CookedAttribute), header.RangeCount * sizeof(CookedDrawRange));
+	}
+	for (size_t ix = 0; ix < ranges.size() && valid; ix++) {
+		const DrawRange& range = ranges[ix];
+		valid = range.IndexCount >= 0 && range.FirstIndex <= header.IndexCount &&
+			static_cast<uint64_t>(range.IndexCount) <= header.IndexCount - range.FirstIndex &&
+			range.BaseVertex >= 0 && static_cast<uint64_t>(range.BaseVertex) < header.VertexCount;
+	}
+	if (!valid) {
+		LOG_WARN("Cooked mesh \"{}\" is corrupt, it will be re-cooked", path);
+		return nullptr;
+	}
+
+	// The sections go straight from the mapped file to OpenGL, the only copy made is the one into the buffer itself
+	const void* vertices = data + header.VertexOffset;
+	const void* indices = data + header.IndexOffset;
+	VertexArrayObject::sptr result;
+	const std::vector<BufferAttribute>* known = FindKnownLayout(layout, header.Stride);
+	if (arena != nullptr && known != nullptr && header.IndexCount > 0) {
+		result = arena->Upload(vertices, header.Stride, header.VertexCount, *known, indices, header.IndexType, header.IndexCount);
+	} else {
+		VertexBuffer::sptr vbo = VertexBuffer::Create();
+		vbo->AllocateStorage(header.Stride, header.VertexCount, 0, vertices);
+
+		result = VertexArrayObject::Create();
+		result->AddVertexBuffer(vbo, known != nullptr ? *known : layout);
+		if (header.IndexCount > 0) {
+			IndexBuffer::sptr ebo = IndexBuffer::Create();
+			ebo->AllocateStorage(indexSize, header.IndexCount, header.IndexType, 0, indices);
+			result->SetIndexBuffer(ebo);
+		}
+	}
+
+	glm::mat4 dequantization;
+	for (int ix = 0; ix < 16; ix++) {
+		dequantization[ix / 4][ix % 4] = header.Dequantization[ix];
+	}
+	result->SetDequantization(dequantization);
+	result->SetBounds(glm::vec3(header.BoundsCenter[0], header.BoundsCenter[1], header.BoundsCenter[2]), header.BoundsRadius);
+	result->SetDrawRanges(ranges);
+	return result;
+}
+
+std::string MeshCooker::_GetPath(uint64_t key) const {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx%s", static_cast<unsigned long long>(key), FILE_EXTENSION);
+	return _directory + "/" + name;
+}
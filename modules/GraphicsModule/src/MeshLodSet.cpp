@@ -0,0 +1,76 @@
+#include "MeshLodSet.h"
+#include <algorithm>
+#include "Logging.h"
+#include "ResourcePools.h"
+
+MeshLodSet::MeshLodSet() :
+	_boundsCenter(glm::vec3(0.0f)),
+	_boundsRadius(0.0f)
+{ }
+
+MeshLodSet::~MeshLodSet() {
+	for (const Level& level : _levels) {
+		ResourcePools::Meshes().Remove(level.Handle);
+	}
+}
+
+size_t MeshLodSet::GetDataSize() const {
+	// Levels that are views into the same vertices (see MeshBuilder::BakeLods) only differ by their indices, so each
+	// distinct range of vertices is only counted once
+	std::vector<std::pair<const VertexArrayObject*, GLint>> counted;
+	size_t result = 0;
+	for (const Level& level : _levels) {
+		const VertexArrayObject* owner = level.Mesh->IsView() ? level.Mesh->GetSource().get() : level.Mesh.get();
+		std::pair<const VertexArrayObject*, GLint> vertices(owner, level.Mesh->GetBaseVertex());
+		if (std::find(counted.begin(), counted.end(), vertices) == counted.end()) {
+			counted.push_back(vertices);
+			result += level.Mesh->GetVertexDataSize();
+		}
+		result += level.Mesh->GetIndexDataSize();
+	}
+	return result;
+}
+
+void MeshLodSet::AddLevel(const VertexArrayObject::sptr& mesh, float error, size_t triangleCount) {
+	LOG_ASSERT(mesh != nullptr, "LOD levels must have a mesh!");
+	// Keep the errors sorted, selection relies on coarser levels never being more accurate
+	if (!_levels.empty()) {
+		error = std::max(error, _levels.back().Error);
+	}
+	_levels.push_back({ mesh, ResourcePools::Meshes().Add(mesh), error, triangleCount });
+}
+
+float MeshLodSet::GetPixelsPerUnit(const glm::mat4& world, const glm::vec3& cameraPos, const glm::mat4& projection, float viewportHeight) const {
+	// We use the largest axis scale so that we never under-estimate the error
+	float scale = std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+	// projection[1][1] is cot(fov / 2) for perspective, or 2 / height for orthographic projections
+	float pixelsPerUnit = scale * projection[1][1] * viewportHeight * 0.5f;
+
+	// Perspective projections have a -1 in [2][3] to divide by depth, orthographic ones don't
+	if (projection[2][3] != 0.0f) {
+		glm::vec3 center = glm::vec3(world * glm::vec4(_boundsCenter, 1.0f));
+		// Measure to the closest point on the bounding sphere, so large objects don't lose detail when we're close to them
+		float distance = glm::length(center - cameraPos) - _boundsRadius * scale;
+		pixelsPerUnit /= std::max(distance, 0.0001f);
+	}
+	return pixelsPerUnit;
+}
+
+size_t MeshLodSet::SelectLevel(size_t current, float pixelsPerUnit, float threshold, float hysteresis) const {
+	if (_levels.empty()) {
+		return 0;
+	}
+	current = std::min(current, _levels.size() - 1);
+
+	// Find the coarsest level that is still within the threshold, errors only ever increase along the chain
+	size_t desired = 0;
+	while (desired + 1 < _levels.size() && _levels[desired + 1].Error * pixelsPerUnit <= threshold) {
+		desired++;
+	}
+
+	// Going coarser needs some margin, otherwise an object sitting right at the threshold would switch every frame
+	while (desired > current && _levels[desired].Error * pixelsPerUnit > threshold * (1.0f - hysteresis)) {
+		desired--;
+	}
+	return desired;
+}
@@ -0,0 +1,709 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_set>
+#include "Logging.h"
+
+// Tuning values for the Forsyth algorithm, see https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+static const size_t FORSYTH_CACHE_SIZE  = 32;
+static const float  CACHE_DECAY_POWER   = 1.5f;
+static const float  LAST_TRI_SCORE      = 0.75f;
+static const float  VALENCE_BOOST_SCALE = 2.0f;
+static const float  VALENCE_BOOST_POWER = 0.5f;
+
+// Scores a vertex based on it's position in the simulated cache and how many triangles still need it
+static float ForsythVertexScore(int cachePosition, uint32_t remainingValence) {
+	// Vertices with no triangles left don't matter any more
+	if (remainingValence == 0) {
+		return -1.0f;
+	}
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		// The vertices of the last triangle get a fixed score, so we don't favour one edge over another
+		if (cachePosition < 3) {
+			score = LAST_TRI_SCORE;
+		} else {
+			const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+			score = powf(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+		}
+	}
+	// Boost vertices with few triangles left, so we finish them off instead of leaving lone triangles behind
+	score += VALENCE_BOOST_SCALE * powf((float)remainingValence, -VALENCE_BOOST_POWER);
+	return score;
+}
+
+// A symmetric 4x4 matrix storing the sum of squared distances to a set of planes, see Garland & Heckbert 1997
+struct Quadric {
+	double A00, A01, A02, A11, A12, A22, B0, B1, B2, C;
+	double Weight;
+
+	Quadric() : A00(0), A01(0), A02(0), A11(0), A12(0), A22(0), B0(0), B1(0), B2(0), C(0), Weight(0) {}
+
+	// Creates a quadric for the plane with the given normal passing through the point, scaled by weight
+	static Quadric FromPlane(const glm::vec3& normal, const glm::vec3& point, double weight) {
+		Quadric result;
+		double a = normal.x, b = normal.y, c = normal.z;
+		double d = -(a * point.x + b * point.y + c * point.z);
+		result.A00 = a * a * weight; result.A01 = a * b * weight; result.A02 = a * c * weight;
+		result.A11 = b * b * weight; result.A12 = b * c * weight; result.A22 = c * c * weight;
+		result.B0 = a * d * weight; result.B1 = b * d * weight; result.B2 = c * d * weight;
+		result.C = d * d * weight;
+		result.Weight = weight;
+		return result;
+	}
+
+	Quadric& operator +=(const Quadric& other) {
+		A00 += other.A00; A01 += other.A01; A02 += other.A02;
+		A11 += other.A11; A12 += other.A12; A22 += other.A22;
+		B0 += other.B0; B1 += other.B1; B2 += other.B2;
+		C += other.C;
+		Weight += other.Weight;
+		return *this;
+	}
+
+	// Returns the weighted sum of squared distances from the point to all the planes
+	double Evaluate(const glm::vec3& p) const {
+		double x = p.x, y = p.y, z = p.z;
+		double result =
+			A00 * x * x + 2.0 * A01 * x * y + 2.0 * A02 * x * z +
+			A11 * y * y + 2.0 * A12 * y * z +
+			A22 * z * z +
+			2.0 * (B0 * x + B1 * y + B2 * z) + C;
+		return result > 0.0 ? result : 0.0;
+	}
+};
+
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, size_t cacheSize) {
+	CacheStats result = { 0.0f, 0.0f };
+	if (indexCount < 3 || vertexCount == 0) {
+		return result;
+	}
+
+	// We simulate a FIFO using timestamps, a vertex is in the cache if it was added less than cacheSize misses ago
+	std::vector<size_t> timestamps(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	size_t time = cacheSize + 1;
+	size_t misses = 0;
+	size_t unique = 0;
+	for (size_t ix = 0; ix < indexCount; ix++) {
+		uint32_t vertex = indices[ix];
+		if (time - timestamps[vertex] > cacheSize) {
+			timestamps[vertex] = time++;
+			misses++;
+		}
+		if (!referenced[vertex]) {
+			referenced[vertex] = true;
+			unique++;
+		}
+	}
+
+	result.ACMR = (float)misses / (float)(indexCount / 3);
+	result.ATVR = (float)misses / (float)unique;
+	return result;
+}
+
+size_t MeshOptimizer::WeldVertices(const void* vertices, size_t vertexSize, size_t vertexCount, std::vector<uint32_t>& outRemap) {
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(vertices);
+	outRemap.assign(vertexCount, INVALID_INDEX);
+
+	// Open addressing hash table, storing the original index of each unique vertex (or INVALID_INDEX for empty)
+	size_t tableSize = 1;
+	while (tableSize < vertexCount * 2) {
+		tableSize <<= 1;
+	}
+	std::vector<uint32_t> table(tableSize, INVALID_INDEX);
+
+	size_t unique = 0;
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		const uint8_t* vertex = data + ix * vertexSize;
+
+		// FNV-1a over the bytes of the vertex
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t b = 0; b < vertexSize; b++) {
+			hash = (hash ^ vertex[b]) * 1099511628211ull;
+		}
+
+		size_t slot = hash & (tableSize - 1);
+		while (true) {
+			uint32_t existing = table[slot];
+			if (existing == INVALID_INDEX) {
+				table[slot] = static_cast<uint32_t>(ix);
+				outRemap[ix] = static_cast<uint32_t>(unique++);
+				break;
+			}
+			if (memcmp(data + existing * vertexSize, vertex, vertexSize) == 0) {
+				outRemap[ix] = outRemap[existing];
+				break;
+			}
+			slot = (slot + 1) & (tableSize - 1);
+		}
+	}
+	return unique;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount) {
+	const size_t triCount = indexCount / 3;
+	if (triCount == 0) {
+		return;
+	}
+
+	// Build the list of triangles that use each vertex
+	std::vector<uint32_t> remainingValence(vertexCount, 0);
+	for (size_t ix = 0; ix < triCount * 3; ix++) {
+		remainingValence[indices[ix]]++;
+	}
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		adjacencyOffsets[ix + 1] = adjacencyOffsets[ix] + remainingValence[ix];
+	}
+	std::vector<uint32_t> adjacency(triCount * 3);
+	{
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t ix = 0; ix < triCount * 3; ix++) {
+			adjacency[fill[indices[ix]]++] = static_cast<uint32_t>(ix / 3);
+		}
+	}
+
+	// Calculate our initial scores
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		vertexScores[ix] = ForsythVertexScore(-1, remainingValence[ix]);
+	}
+	std::vector<float> triScores(triCount);
+	std::vector<bool> emitted(triCount, false);
+	uint32_t bestTri = 0;
+	for (size_t ix = 0; ix < triCount; ix++) {
+		triScores[ix] = vertexScores[indices[ix * 3]] + vertexScores[indices[ix * 3 + 1]] + vertexScores[indices[ix * 3 + 2]];
+		if (triScores[ix] > triScores[bestTri]) {
+			bestTri = static_cast<uint32_t>(ix);
+		}
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(triCount * 3);
+	std::vector<uint32_t> cache, newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+	size_t nextSearch = 0;
+
+	for (size_t emittedCount = 0; emittedCount < triCount; emittedCount++) {
+		// If none of the triangles around the cache are left, fall back to the next one we haven't drawn yet
+		if (bestTri == INVALID_INDEX) {
+			while (emitted[nextSearch]) {
+				nextSearch++;
+			}
+			bestTri = static_cast<uint32_t>(nextSearch);
+		}
+
+		const uint32_t* tri = indices + bestTri * 3;
+		emitted[bestTri] = true;
+		newCache.clear();
+		for (int v = 0; v < 3; v++) {
+			result.push_back(tri[v]);
+			remainingValence[tri[v]]--;
+			newCache.push_back(tri[v]);
+		}
+		// The triangle's vertices move to the front of the cache, everything else gets pushed back
+		for (uint32_t vertex : cache) {
+			if (vertex != tri[0] && vertex != tri[1] && vertex != tri[2]) {
+				newCache.push_back(vertex);
+			}
+		}
+
+		// Update the scores of everything that moved in the cache
+		for (size_t ix = 0; ix < newCache.size(); ix++) {
+			uint32_t vertex = newCache[ix];
+			cachePosition[vertex] = ix < FORSYTH_CACHE_SIZE ? static_cast<int>(ix) : -1;
+			vertexScores[vertex] = ForsythVertexScore(cachePosition[vertex], remainingValence[vertex]);
+		}
+
+		// Update the triangles around the cache, and pick the best one to go next
+		bestTri = INVALID_INDEX;
+		float bestScore = -1.0f;
+		for (uint32_t vertex : newCache) {
+			for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; a++) {
+				uint32_t triIx = adjacency[a];
+				if (emitted[triIx]) {
+					continue;
+				}
+				const uint32_t* other = indices + triIx * 3;
+				triScores[triIx] = vertexScores[other[0]] + vertexScores[other[1]] + vertexScores[other[2]];
+				if (triScores[triIx] > bestScore) {
+					bestScore = triScores[triIx];
+					bestTri = triIx;
+				}
+			}
+		}
+
+		// Drop anything that fell out of the cache
+		if (newCache.size() > FORSYTH_CACHE_SIZE) {
+			newCache.resize(FORSYTH_CACHE_SIZE);
+		}
+		cache.swap(newCache);
+	}
+
+	memcpy(indices, result.data(), result.size() * sizeof(uint32_t));
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* indices, size_t indexCount, const glm::vec3* positions, size_t vertexCount, float threshold) {
+	const size_t triCount = indexCount / 3;
+	if (triCount == 0) {
+		return;
+	}
+
+	// Work out how many misses each triangle causes with the current order
+	std::vector<size_t> timestamps(vertexCount, 0);
+	std::vector<uint8_t> triMisses(triCount, 0);
+	size_t time = DEFAULT_CACHE_SIZE + 1;
+	size_t totalMisses = 0;
+	for (size_t ix = 0; ix < triCount * 3; ix++) {
+		uint32_t vertex = indices[ix];
+		if (time - timestamps[vertex] > DEFAULT_CACHE_SIZE) {
+			timestamps[vertex] = time++;
+			triMisses[ix / 3]++;
+			totalMisses++;
+		}
+	}
+	const float meshAcmr = (float)totalMisses / (float)triCount;
+
+	// Split the list into clusters. We only split where the cache is cold (all 3 vertices missed), so re-ordering
+	// the clusters won't hurt the cache much, and only if the cluster so far is about as good as the whole mesh
+	std::vector<size_t> clusterStarts;
+	clusterStarts.push_back(0);
+	size_t clusterMisses = 0;
+	size_t clusterTris = 0;
+	for (size_t ix = 0; ix < triCount; ix++) {
+		if (clusterTris > 0 && triMisses[ix] == 3 && (float)clusterMisses / (float)clusterTris <= meshAcmr * threshold) {
+			clusterStarts.push_back(ix);
+			clusterMisses = 0;
+			clusterTris = 0;
+		}
+		clusterMisses += triMisses[ix];
+		clusterTris++;
+	}
+	if (clusterStarts.size() < 2) {
+		return;
+	}
+
+	// Calculate the area weighted center and normal of each cluster, as well as the center of the whole mesh
+	struct Cluster {
+		size_t    Start, End;
+		glm::vec3 Center;
+		glm::vec3 Normal;
+		float     Area;
+		float     SortKey;
+	};
+	std::vector<Cluster> clusters(clusterStarts.size());
+	glm::vec3 meshCenter = glm::vec3(0.0f);
+	float meshArea = 0.0f;
+	for (size_t ix = 0; ix < clusters.size(); ix++) {
+		Cluster& cluster = clusters[ix];
+		cluster.Start = clusterStarts[ix];
+		cluster.End = ix + 1 < clusterStarts.size() ? clusterStarts[ix + 1] : triCount;
+		cluster.Center = glm::vec3(0.0f);
+		cluster.Normal = glm::vec3(0.0f);
+		cluster.Area = 0.0f;
+		for (size_t t = cluster.Start; t < cluster.End; t++) {
+			const glm::vec3& a = positions[indices[t * 3]];
+			const glm::vec3& b = positions[indices[t * 3 + 1]];
+			const glm::vec3& c = positions[indices[t * 3 + 2]];
+			glm::vec3 cross = glm::cross(b - a, c - a);
+			float area = glm::length(cross) * 0.5f;
+			cluster.Center += (a + b + c) * (area / 3.0f);
+			cluster.Normal += cross;
+			cluster.Area += area;
+		}
+		meshCenter += cluster.Center;
+		meshArea += cluster.Area;
+		cluster.Center = cluster.Area > 0.0f ? cluster.Center / cluster.Area : glm::vec3(0.0f);
+	}
+	meshCenter = meshArea > 0.0f ? meshCenter / meshArea : glm::vec3(0.0f);
+
+	// Clusters facing away from the center are on the outside of the mesh, so they should be drawn first
+	for (Cluster& cluster : clusters) {
+		float normalLength = glm::length(cluster.Normal);
+		cluster.SortKey = normalLength > 0.0f ? glm::dot(cluster.Center - meshCenter, cluster.Normal / normalLength) : 0.0f;
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& l, const Cluster& r) {
+		return l.SortKey > r.SortKey;
+	});
+
+	std::vector<uint32_t> result;
+	result.reserve(triCount * 3);
+	for (const Cluster& cluster : clusters) {
+		result.insert(result.end(), indices + cluster.Start * 3, indices + cluster.End * 3);
+	}
+	memcpy(indices, result.data(), result.size() * sizeof(uint32_t));
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(const uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& outRemap) {
+	outRemap.assign(vertexCount, INVALID_INDEX);
+	size_t next = 0;
+	for (size_t ix = 0; ix < indexCount; ix++) {
+		uint32_t vertex = indices[ix];
+		LOG_ASSERT(vertex < vertexCount, "Index {} is out of range ({} vertices)", vertex, vertexCount);
+		if (outRemap[vertex] == INVALID_INDEX) {
+			outRemap[vertex] = static_cast<uint32_t>(next++);
+		}
+	}
+	return next;
+}
+
+void MeshOptimizer::SplitIndices(const uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& outVertexSources,
+	std::vector<uint32_t>& outIndices, std::vector<DrawRange>& outRanges, size_t maxVertices)
+{
+	LOG_ASSERT(maxVertices >= 3, "Ranges must be able to hold at least a single triangle!");
+	outVertexSources.clear();
+	outIndices.clear();
+	outRanges.clear();
+	outIndices.reserve(indexCount);
+
+	// Stores which range each source vertex was last added to, and where it was added
+	std::vector<uint32_t> rangeOf(vertexCount, INVALID_INDEX);
+	std::vector<uint32_t> localOf(vertexCount, 0);
+
+	DrawRange range = { 0, 0, 0 };
+	uint32_t rangeIx = 0;
+	size_t rangeVertices = 0;
+	for (size_t ix = 0; ix + 2 < indexCount; ix += 3) {
+		// Count how many new vertices this triangle would add to the current range
+		size_t added = 0;
+		for (int v = 0; v < 3; v++) {
+			added += rangeOf[indices[ix + v]] != rangeIx ? 1 : 0;
+		}
+		// If the triangle doesn't fit, close off this range and start a new one
+		if (rangeVertices + added > maxVertices) {
+			outRanges.push_back(range);
+			rangeIx++;
+			range.FirstIndex = static_cast<GLuint>(outIndices.size());
+			range.IndexCount = 0;
+			range.BaseVertex = static_cast<GLint>(outVertexSources.size());
+			rangeVertices = 0;
+		}
+		for (int v = 0; v < 3; v++) {
+			uint32_t vertex = indices[ix + v];
+			if (rangeOf[vertex] != rangeIx) {
+				rangeOf[vertex] = rangeIx;
+				localOf[vertex] = static_cast<uint32_t>(rangeVertices++);
+				outVertexSources.push_back(vertex);
+			}
+			outIndices.push_back(localOf[vertex]);
+		}
+		range.IndexCount += 3;
+	}
+	if (range.IndexCount > 0) {
+		outRanges.push_back(range);
+	}
+}
+
+void MeshOptimizer::SplitSharedIndices(const std::vector<std::vector<uint32_t>>& lists, size_t vertexCount, std::vector<uint32_t>& outVertexSources,
+	std::vector<uint32_t>& outIndices, std::vector<std::vector<DrawRange>>& outRanges, size_t maxVertices)
+{
+	outVertexSources.clear();
+	outIndices.clear();
+	outRanges.assign(lists.size(), std::vector<DrawRange>());
+	if (lists.empty()) {
+		return;
+	}
+
+	// The most detailed list decides the ranges that every other list draws from
+	std::vector<DrawRange> baseRanges;
+	SplitIndices(lists[0].data(), lists[0].size(), vertexCount, outVertexSources, outIndices, baseRanges, maxVertices);
+	outRanges[0] = baseRanges;
+
+	// Find every range each source vertex was copied into, vertices on the edge of a range are in more than one
+	std::vector<uint32_t> copyStart(vertexCount + 1, 0);
+	for (uint32_t source : outVertexSources) {
+		copyStart[source + 1]++;
+	}
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		copyStart[ix + 1] += copyStart[ix];
+	}
+	std::vector<uint32_t> copyRange(outVertexSources.size());
+	std::vector<uint32_t> copyLocal(outVertexSources.size());
+	{
+		std::vector<uint32_t> filled(copyStart.begin(), copyStart.end() - 1);
+		uint32_t range = 0;
+		for (size_t ix = 0; ix < outVertexSources.size(); ix++) {
+			while (range + 1 < baseRanges.size() && ix >= static_cast<size_t>(baseRanges[range + 1].BaseVertex)) {
+				range++;
+			}
+			uint32_t slot = filled[outVertexSources[ix]]++;
+			copyRange[slot] = range;
+			copyLocal[slot] = static_cast<uint32_t>(ix - baseRanges[range].BaseVertex);
+		}
+	}
+	// Gets where a vertex was copied to in the given range, or INVALID_INDEX if it isn't in that range
+	auto findLocal = [&](uint32_t vertex, uint32_t range) {
+		for (uint32_t copy = copyStart[vertex]; copy < copyStart[vertex + 1]; copy++) {
+			if (copyRange[copy] == range) {
+				return copyLocal[copy];
+			}
+		}
+		return INVALID_INDEX;
+	};
+
+	// Triangles that don't fit in any of the base ranges go into extra ranges at the end of the vertices, which work
+	// like the ranges in SplitIndices, but carry on from one list to the next so the lists can share them
+	std::vector<uint32_t> extraRangeOf(vertexCount, INVALID_INDEX);
+	std::vector<uint32_t> extraLocalOf(vertexCount, 0);
+	uint32_t extraRange = 0;
+	size_t extraBase = outVertexSources.size();
+	size_t extraVertices = 0;
+
+	std::vector<std::vector<uint32_t>> buckets(baseRanges.size());
+	for (size_t list = 1; list < lists.size(); list++) {
+		const std::vector<uint32_t>& indices = lists[list];
+		size_t listStart = outIndices.size();
+		std::vector<uint32_t> extras;
+		for (size_t ix = 0; ix + 2 < indices.size(); ix += 3) {
+			uint32_t a = indices[ix], b = indices[ix + 1], c = indices[ix + 2];
+			bool placed = false;
+			for (uint32_t copy = copyStart[a]; copy < copyStart[a + 1] && !placed; copy++) {
+				uint32_t range = copyRange[copy];
+				uint32_t localB = findLocal(b, range);
+				uint32_t localC = localB != INVALID_INDEX ? findLocal(c, range) : INVALID_INDEX;
+				if (localC != INVALID_INDEX) {
+					buckets[range].insert(buckets[range].end(), { copyLocal[copy], localB, localC });
+					placed = true;
+				}
+			}
+			if (!placed) {
+				extras.insert(extras.end(), { a, b, c });
+			}
+		}
+
+		// Each base range that this list uses gets one draw range, in the same order as the first list
+		for (size_t range = 0; range < buckets.size(); range++) {
+			if (!buckets[range].empty()) {
+				DrawRange draw = { static_cast<GLuint>(outIndices.size() - listStart), static_cast<GLsizei>(buckets[range].size()), baseRanges[range].BaseVertex };
+				outRanges[list].push_back(draw);
+				outIndices.insert(outIndices.end(), buckets[range].begin(), buckets[range].end());
+				buckets[range].clear();
+			}
+		}
+
+		DrawRange draw = { static_cast<GLuint>(outIndices.size() - listStart), 0, static_cast<GLint>(extraBase) };
+		for (size_t ix = 0; ix < extras.size(); ix += 3) {
+			size_t added = 0;
+			for (int v = 0; v < 3; v++) {
+				added += extraRangeOf[extras[ix + v]] != extraRange ? 1 : 0;
+			}
+			if (extraVertices + added > maxVertices) {
+				if (draw.IndexCount > 0) {
+					outRanges[list].push_back(draw);
+				}
+				extraRange++;
+				extraBase = outVertexSources.size();
+				extraVertices = 0;
+				draw = { static_cast<GLuint>(outIndices.size() - listStart), 0, static_cast<GLint>(extraBase) };
+			}
+			for (int v = 0; v < 3; v++) {
+				uint32_t vertex = extras[ix + v];
+				if (extraRangeOf[vertex] != extraRange) {
+					extraRangeOf[vertex] = extraRange;
+					extraLocalOf[vertex] = static_cast<uint32_t>(extraVertices++);
+					outVertexSources.push_back(vertex);
+				}
+				outIndices.push_back(extraLocalOf[vertex]);
+			}
+			draw.IndexCount += 3;
+		}
+		if (draw.IndexCount > 0) {
+			outRanges[list].push_back(draw);
+		}
+	}
+}
+
+float MeshOptimizer::Simplify(const uint32_t* indices, size_t indexCount, const glm::vec3* positions, size_t vertexCount, size_t targetIndexCount, std::vector<uint32_t>& outIndices) {
+	outIndices.assign(indices, indices + (indexCount / 3) * 3);
+	if (outIndices.size() <= targetIndexCount) {
+		return 0.0f;
+	}
+
+	// Vertices that share a position (ex: UV seams or hard edges) are treated as the same point when collapsing,
+	// otherwise we would tear the mesh apart along seams
+	std::vector<uint32_t> positionIds;
+	size_t positionCount = WeldVertices(positions, sizeof(glm::vec3), vertexCount, positionIds);
+	std::vector<glm::vec3> uniquePositions(positionCount);
+	for (size_t ix = 0; ix < vertexCount; ix++) {
+		uniquePositions[positionIds[ix]] = positions[ix];
+	}
+
+	// Any edge that is only used in one direction is on an open border, so we lock the vertices on it
+	std::vector<bool> locked(positionCount, false);
+	{
+		std::unordered_set<uint64_t> edges;
+		edges.reserve(outIndices.size());
+		for (size_t ix = 0; ix < outIndices.size(); ix += 3) {
+			for (int e = 0; e < 3; e++) {
+				uint64_t a = positionIds[outIndices[ix + e]], b = positionIds[outIndices[ix + (e + 1) % 3]];
+				edges.insert((a << 32) | b);
+			}
+		}
+		for (uint64_t edge : edges) {
+			uint64_t reverse = (edge << 32) | (edge >> 32);
+			if (edges.find(reverse) == edges.end()) {
+				locked[edge >> 32] = true;
+				locked[edge & 0xFFFFFFFF] = true;
+			}
+		}
+	}
+
+	// Build the error quadrics from the planes of the triangles around each position
+	std::vector<Quadric> quadrics(positionCount);
+	for (size_t ix = 0; ix < outIndices.size(); ix += 3) {
+		const glm::vec3& a = positions[outIndices[ix]];
+		const glm::vec3& b = positions[outIndices[ix + 1]];
+		const glm::vec3& c = positions[outIndices[ix + 2]];
+		glm::vec3 cross = glm::cross(b - a, c - a);
+		float length = glm::length(cross);
+		if (length <= 0.0f) {
+			continue;
+		}
+		Quadric quadric = Quadric::FromPlane(cross / length, a, length * 0.5);
+		for (int v = 0; v < 3; v++) {
+			quadrics[positionIds[outIndices[ix + v]]] += quadric;
+		}
+	}
+
+	struct Collapse {
+		uint32_t From, To;  // Position IDs
+		uint32_t ToVertex;  // The vertex index of the target, from the triangle the edge came from
+		double   Cost;
+	};
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> triOffsets, triList;
+	std::vector<uint32_t> collapseTo(vertexCount);
+	std::vector<bool> touched(positionCount);
+	double maxError = 0.0;
+
+	while (outIndices.size() > targetIndexCount) {
+		const size_t triCount = outIndices.size() / 3;
+
+		// Build the list of triangles around each position
+		triOffsets.assign(positionCount + 1, 0);
+		for (uint32_t index : outIndices) {
+			triOffsets[positionIds[index] + 1]++;
+		}
+		for (size_t ix = 0; ix < positionCount; ix++) {
+			triOffsets[ix + 1] += triOffsets[ix];
+		}
+		triList.resize(outIndices.size());
+		{
+			std::vector<uint32_t> fill(triOffsets.begin(), triOffsets.end() - 1);
+			for (size_t ix = 0; ix < outIndices.size(); ix++) {
+				triList[fill[positionIds[outIndices[ix]]]++] = static_cast<uint32_t>(ix / 3);
+			}
+		}
+
+		// Find the cost of every edge collapse, we only ever move a vertex onto one of it's neighbours
+		collapses.clear();
+		for (size_t ix = 0; ix < outIndices.size(); ix += 3) {
+			for (int e = 0; e < 3; e++) {
+				uint32_t from = positionIds[outIndices[ix + e]];
+				uint32_t toVertex = outIndices[ix + (e + 1) % 3];
+				uint32_t to = positionIds[toVertex];
+				if (!locked[from] && from != to) {
+					collapses.push_back({ from, to, toVertex, quadrics[from].Evaluate(uniquePositions[to]) });
+				}
+			}
+		}
+		if (collapses.empty()) {
+			break;
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.Cost < r.Cost; });
+
+		// Perform as many of the cheapest collapses as we can in this pass. Each collapse removes about 2 triangles,
+		// and we don't allow collapses to overlap so that the flip checks stay valid
+		for (size_t ix = 0; ix < vertexCount; ix++) {
+			collapseTo[ix] = static_cast<uint32_t>(ix);
+		}
+		std::fill(touched.begin(), touched.end(), false);
+		size_t trianglesToRemove = (outIndices.size() - targetIndexCount) / 3;
+		size_t removed = 0;
+		size_t performed = 0;
+		for (const Collapse& collapse : collapses) {
+			if (removed >= trianglesToRemove) {
+				break;
+			}
+			if (touched[collapse.From] || touched[collapse.To]) {
+				continue;
+			}
+
+			// Make sure that moving the vertex won't flip any of the triangles around it
+			bool flips = false;
+			for (uint32_t t = triOffsets[collapse.From]; t < triOffsets[collapse.From + 1] && !flips; t++) {
+				const uint32_t* tri = &outIndices[triList[t] * 3];
+				glm::vec3 before[3], after[3];
+				bool degenerate = false;
+				for (int v = 0; v < 3; v++) {
+					uint32_t id = positionIds[tri[v]];
+					degenerate |= id == collapse.To;
+					before[v] = uniquePositions[id];
+					after[v] = id == collapse.From ? uniquePositions[collapse.To] : before[v];
+				}
+				if (!degenerate) {
+					glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+					glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+					flips = glm::dot(normalBefore, normalAfter) <= 0.0f;
+				}
+			}
+			if (flips) {
+				continue;
+			}
+
+			// Each vertex at the source position needs to go to a vertex at the target position. We prefer one that
+			// shares a triangle with it, so that attributes stay continuous on the same side of a seam
+			for (uint32_t t = triOffsets[collapse.From]; t < triOffsets[collapse.From + 1]; t++) {
+				const uint32_t* tri = &outIndices[triList[t] * 3];
+				uint32_t target = INVALID_INDEX;
+				for (int v = 0; v < 3; v++) {
+					if (positionIds[tri[v]] == collapse.To) {
+						target = tri[v];
+					}
+				}
+				for (int v = 0; v < 3; v++) {
+					if (positionIds[tri[v]] == collapse.From) {
+						if (target != INVALID_INDEX) {
+							collapseTo[tri[v]] = target;
+						} else if (collapseTo[tri[v]] == tri[v]) {
+							collapseTo[tri[v]] = collapse.ToVertex;
+						}
+					}
+				}
+				// Nothing else around this collapse can move during this pass
+				for (int v = 0; v < 3; v++) {
+					touched[positionIds[tri[v]]] = true;
+				}
+			}
+
+			quadrics[collapse.To] += quadrics[collapse.From];
+			// Convert the area weighted squared distance into an approximate distance
+			double weight = quadrics[collapse.From].Weight;
+			maxError = std::max(maxError, weight > 0.0 ? collapse.Cost / weight : 0.0);
+			removed += 2;
+			performed++;
+		}
+		if (performed == 0) {
+			break;
+		}
+
+		// Apply the collapses, and remove any triangles that have become degenerate
+		size_t write = 0;
+		for (size_t ix = 0; ix < triCount * 3; ix += 3) {
+			uint32_t a = collapseTo[outIndices[ix]], b = collapseTo[outIndices[ix + 1]], c = collapseTo[outIndices[ix + 2]];
+			uint32_t pa = positionIds[a], pb = positionIds[b], pc = positionIds[c];
+			if (pa != pb && pb != pc && pa != pc) {
+				outIndices[write++] = a;
+				outIndices[write++] = b;
+				outIndices[write++] = c;
+			}
+		}
+		outIndices.resize(write);
+	}
+
+	return static_cast<float>(sqrt(maxError));
+}
@@ -6,9 +6,26 @@
 #include <iostream>
 
 #include "StringUtils.h"
+#include "MeshCooker.h"
+#include "ResourceCache.h"
 
 VertexArrayObject::sptr NotObjLoader::LoadFromFile(const std::string& filename)
 {
+	return ResourceCache::Load<VertexArrayObject>(ResourceCache::MakeKey(filename, "NotObjLoader"), [&]() { return _Load(filename); });
+}
+
+VertexArrayObject::sptr NotObjLoader::_Load(const std::string& filename)
+{
+	// Scenes that have been loaded before can be uploaded from the mesh cache without re-generating all the shapes
+	const MeshCooker::sptr& cooker = MeshCooker::GetDefault();
+	uint64_t cookedKey = cooker != nullptr ? cooker->ComputeKey(filename, "NotObjLoader") : 0;
+	if (cookedKey != 0) {
+		VertexArrayObject::sptr cooked = cooker->TryLoad(cookedKey);
+		if (cooked != nullptr) {
+			return cooked;
+		}
+	}
+
 	// Open our file in binary mode
 	std::ifstream file;
 	file.open(filename, std::ios::binary);
@@ -108,5 +125,8 @@ VertexArrayObject::sptr NotObjLoader::LoadFromFile(const std::string& filename)
 	// You'll need to keep track of these and create vertex entries for each vertex in the face
 	// If you want to get fancy, you can track which vertices you've already added
 
+	if (cookedKey != 0) {
+		mesh.Cook(*cooker, cookedKey);
+	}
 	return mesh.Bake();
 }
@@ -1,14 +1,408 @@
 #include "ObjLoader.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <string>
 #include <sstream>
 #include <fstream>
 #include <iostream>
-#include <unordered_map>
 
 #include "StringUtils.h"
+#include "Logging.h"
+#include "AttributeIndexMap.h"
+#include "MappedFile.h"
+#include "MeshCooker.h"
+#include "ParallelFor.h"
+#include "ResourceCache.h"
 
-VertexArrayObject::sptr ObjLoader::LoadFromFile(const std::string& filename, const glm::vec4& inColor)
+VertexArrayObject::sptr ObjLoader::LoadFromFile(const std::string& filename, const glm::vec4& inColor, bool packed, bool optimize)
+{
+	std::string options = fmt::format("ObjLoader|{},{},{},{}|{}|{}", inColor.r, inColor.g, inColor.b, inColor.a, packed, optimize);
+	return ResourceCache::Load<VertexArrayObject>(ResourceCache::MakeKey(filename, options), [&]() {
+		// If this model has been loaded with these options before, we can skip parsing and upload the cooked copy
+		const MeshCooker::sptr& cooker = MeshCooker::GetDefault();
+		uint64_t cookedKey = cooker != nullptr ? cooker->ComputeKey(filename, options) : 0;
+		if (cookedKey != 0) {
+			VertexArrayObject::sptr cooked = cooker->TryLoad(cookedKey);
+			if (cooked != nullptr) {
+				return cooked;
+			}
+		}
+
+		MeshBuilder<VertexPosNormTexCol> mesh;
+		Parse(filename, inColor, mesh);
+
+		if (optimize) {
+			MeshOptimizer::Report report = mesh.Optimize();
+			LOG_INFO("Optimized \"{}\": ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}, {} -> {} vertices", filename,
+				report.Before.ACMR, report.After.ACMR, report.Before.ATVR, report.After.ATVR, report.VerticesBefore, report.VerticesAfter);
+		}
+
+		if (cookedKey != 0) {
+			if (packed) {
+				mesh.CookPacked<VertexPackedPosNormTexCol>(*cooker, cookedKey);
+			} else {
+				mesh.Cook(*cooker, cookedKey);
+			}
+		}
+		return packed ? mesh.BakePacked<VertexPackedPosNormTexCol>() : mesh.Bake();
+	});
+}
+
+MeshLodSet::sptr ObjLoader::LoadLodsFromFile(const std::string& filename, const glm::vec4& inColor, bool packed, const std::vector<float>& ratios)
+{
+	std::string options = fmt::format("ObjLoader|Lods|{},{},{},{}|{}|{}", inColor.r, inColor.g, inColor.b, inColor.a, packed, fmt::join(ratios, ","));
+	return ResourceCache::Load<MeshLodSet>(ResourceCache::MakeKey(filename, options), [&]() {
+		return _LoadLods(filename, inColor, packed, ratios);
+	});
+}
+
+MeshLodSet::sptr ObjLoader::_LoadLods(const std::string& filename, const glm::vec4& inColor, bool packed, const std::vector<float>& ratios)
+{
+	MeshBuilder<VertexPosNormTexCol> mesh;
+	Parse(filename, inColor, mesh);
+
+	// Welding is what lets the simplifier see which triangles are connected, so we always optimize first
+	mesh.Optimize();
+	MeshLodSet::sptr result = packed ? mesh.BakeLodsPacked<VertexPackedPosNormTexCol>(ratios) : mesh.BakeLods(ratios);
+
+	for (size_t ix = 0; ix < result->GetLevelCount(); ix++) {
+		LOG_INFO("LOD {} of \"{}\": {} triangles, error {:.5f}", ix, filename, result->GetLevel(ix).TriangleCount, result->GetLevel(ix).Error);
+	}
+	return result;
+}
+
+// Lines are split into chunks of about this many bytes, which are parsed in parallel
+static const size_t OBJ_CHUNK_SIZE = 1024 * 1024;
+// A rough guess at how many bytes of an OBJ file there are per face, counting the attribute lines
+static const size_t OBJ_BYTES_PER_FACE = 96;
+// The most faces we'll reserve space for up front, bigger meshes grow the rest of the way while parsing
+static const size_t OBJ_MAX_ESTIMATED_FACES = 4 * 1024 * 1024;
+
+// One corner of a face, holding the 1-based position, UV and normal indices. UV and normal are 0 when missing
+struct ObjCorner
+{
+	int32_t Position;
+	int32_t UV;
+	int32_t Normal;
+	// A bit for each index that was negative in the file, and is still relative to the start of it's chunk
+	uint32_t RelativeMask;
+};
+
+// The attributes and faces parsed from one chunk of an OBJ file
+struct ObjChunk
+{
+	const char*            Begin;
+	const char*            End;
+	std::vector<glm::vec3> Positions;
+	std::vector<glm::vec3> Normals;
+	std::vector<glm::vec2> UVs;
+	std::vector<ObjCorner> Corners;
+	// The number of corners in each face
+	std::vector<uint32_t>  FaceSizes;
+};
+
+static inline bool IsObjSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline void SkipObjSpaces(const char*& cursor, const char* end) {
+	while (cursor < end && IsObjSpace(*cursor)) {
+		cursor++;
+	}
+}
+
+// Reads a signed integer, returning false if there are no digits at the cursor
+static inline bool ScanObjInt(const char*& cursor, const char* end, int32_t& result) {
+	const char* c = cursor;
+	bool negative = c < end && *c == '-';
+	if (negative || (c < end && *c == '+')) {
+		c++;
+	}
+	if (c == end || *c < '0' || *c > '9') {
+		return false;
+	}
+	int64_t value = 0;
+	for (; c < end && *c >= '0' && *c <= '9'; c++) {
+		value = std::min<int64_t>(value * 10 + (*c - '0'), INT32_MAX);
+	}
+	result = static_cast<int32_t>(negative ? -value : value);
+	cursor = c;
+	return true;
+}
+
+// Reads a float without going through the locale or allocating. Values that fit in a float's mantissa with a small
+// exponent (which is everything an exporter normally writes) are converted with a single correctly rounded multiply or
+// divide, anything else falls back to strtof so that we always get the same result as the stream parser
+static inline bool ScanObjFloat(const char*& cursor, const char* end, float& result) {
+	static const float powers[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+	const char* start = cursor;
+	const char* c = cursor;
+	bool negative = c < end && *c == '-';
+	if (negative || (c < end && *c == '+')) {
+		c++;
+	}
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	for (; c < end && *c >= '0' && *c <= '9'; c++, digits++) {
+		mantissa = mantissa * 10 + (*c - '0');
+	}
+	if (c < end && *c == '.') {
+		for (c++; c < end && *c >= '0' && *c <= '9'; c++, digits++, exponent--) {
+			mantissa = mantissa * 10 + (*c - '0');
+		}
+	}
+	if (digits == 0) {
+		return false;
+	}
+	if (c < end && (*c == 'e' || *c == 'E')) {
+		const char* exponentStart = c + 1;
+		int32_t value;
+		if (ScanObjInt(exponentStart, end, value)) {
+			exponent += value;
+			c = exponentStart;
+		}
+	}
+	cursor = c;
+
+	// Mantissas up to 2^24 and powers of ten up to 10^10 are exact in a float, so one operation rounds correctly
+	if (digits <= 19 && mantissa <= (1ull << 24) && exponent >= -10 && exponent <= 10) {
+		float value = static_cast<float>(mantissa);
+		value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+		result = negative ? -value : value;
+		return true;
+	}
+
+	char buffer[64];
+	size_t length = std::min<size_t>(c - start, sizeof(buffer) - 1);
+	memcpy(buffer, start, length);
+	buffer[length] = '\0';
+	result = strtof(buffer, nullptr);
+	return true;
+}
+
+// Reads up to count floats into result, leaving the rest untouched
+template <int Count, typename Vec>
+static inline void ScanObjVector(const char* cursor, const char* end, Vec& result) {
+	for (int ix = 0; ix < Count; ix++) {
+		SkipObjSpaces(cursor, end);
+		if (!ScanObjFloat(cursor, end, result[ix])) {
+			return;
+		}
+	}
+}
+
+// Checks if the line starts with the given command, followed by whitespace
+static inline bool IsObjCommand(const char* line, const char* end, const char* command, size_t length) {
+	return (size_t)(end - line) > length && memcmp(line, command, length) == 0 && IsObjSpace(line[length]);
+}
+
+// Stores an index from the file into a corner. Negative indices count back from the last attribute, since we don't
+// know how many attributes came before this chunk yet they're stored relative to the chunk's start until it's merged
+static inline void StoreObjIndex(int32_t value, size_t localCount, int bit, int32_t& index, uint32_t& relativeMask) {
+	if (value < 0) {
+		index = static_cast<int32_t>(localCount) + value + 1;
+		relativeMask |= 1u << bit;
+	} else {
+		index = value;
+	}
+}
+
+static void ParseObjChunk(ObjChunk& chunk) {
+	const char* cursor = chunk.Begin;
+	while (cursor < chunk.End) {
+		const char* lineEnd = static_cast<const char*>(memchr(cursor, '\n', chunk.End - cursor));
+		if (lineEnd == nullptr) {
+			lineEnd = chunk.End;
+		}
+		SkipObjSpaces(cursor, lineEnd);
+
+		if (IsObjCommand(cursor, lineEnd, "v", 1)) {
+			glm::vec3 position(0.0f);
+			ScanObjVector<3>(cursor + 2, lineEnd, position);
+			chunk.Positions.push_back(position);
+		}
+		else if (IsObjCommand(cursor, lineEnd, "vn", 2)) {
+			glm::vec3 normal(0.0f);
+			ScanObjVector<3>(cursor + 3, lineEnd, normal);
+			chunk.Normals.push_back(normal);
+		}
+		else if (IsObjCommand(cursor, lineEnd, "vt", 2)) {
+			glm::vec2 uv(0.0f);
+			ScanObjVector<2>(cursor + 3, lineEnd, uv);
+			chunk.UVs.push_back(uv);
+		}
+		else if (IsObjCommand(cursor, lineEnd, "f", 1)) {
+			// Corners can be any of "p", "p/t", "p//n" or "p/t/n"
+			const char* c = cursor + 2;
+			uint32_t size = 0;
+			while (true) {
+				SkipObjSpaces(c, lineEnd);
+				int32_t value;
+				if (!ScanObjInt(c, lineEnd, value)) {
+					break;
+				}
+				ObjCorner corner = { 0, 0, 0, 0 };
+				StoreObjIndex(value, chunk.Positions.size(), 0, corner.Position, corner.RelativeMask);
+				if (c < lineEnd && *c == '/') {
+					c++;
+					if (ScanObjInt(c, lineEnd, value)) {
+						StoreObjIndex(value, chunk.UVs.size(), 1, corner.UV, corner.RelativeMask);
+					}
+					if (c < lineEnd && *c == '/') {
+						c++;
+						if (ScanObjInt(c, lineEnd, value)) {
+							StoreObjIndex(value, chunk.Normals.size(), 2, corner.Normal, corner.RelativeMask);
+						}
+					}
+				}
+				chunk.Corners.push_back(corner);
+				size++;
+			}
+			chunk.FaceSizes.push_back(size);
+		}
+
+		cursor = lineEnd + 1;
+	}
+}
+
+static inline bool ObjCornersEqual(const ObjCorner& a, const ObjCorner& b) {
+	return a.Position == b.Position && a.UV == b.UV && a.Normal == b.Normal;
+}
+
+void ObjLoader::Parse(const std::string& filename, const glm::vec4& inColor, MeshBuilder<VertexPosNormTexCol>& mesh)
+{
+	MappedFile::sptr file = MappedFile::Create(filename);
+	// If our file fails to open, we will throw an error
+	if (file == nullptr) {
+		throw std::runtime_error("Failed to open file");
+	}
+	const char* begin = reinterpret_cast<const char*>(file->GetData());
+	const char* end = begin + file->GetSize();
+
+	// Split the file into chunks that end on line breaks
+	std::vector<ObjChunk> chunks;
+	for (const char* cursor = begin; cursor < end; ) {
+		const char* chunkEnd = end;
+		if ((size_t)(end - cursor) > OBJ_CHUNK_SIZE) {
+			const char* lineEnd = static_cast<const char*>(memchr(cursor + OBJ_CHUNK_SIZE, '\n', end - cursor - OBJ_CHUNK_SIZE));
+			chunkEnd = lineEnd != nullptr ? lineEnd + 1 : end;
+		}
+		chunks.emplace_back();
+		chunks.back().Begin = cursor;
+		chunks.back().End = chunkEnd;
+		cursor = chunkEnd;
+	}
+	ParallelFor(chunks.size(), [&](size_t ix) { ParseObjChunk(chunks[ix]); });
+
+	// Work out where each chunk's attributes and faces start in the whole file
+	std::vector<size_t> positionBase(chunks.size()), normalBase(chunks.size()), uvBase(chunks.size());
+	std::vector<size_t> cornerBase(chunks.size()), faceBase(chunks.size());
+	size_t positionCount = 0, normalCount = 0, uvCount = 0, cornerCount = 0, faceCount = 0;
+	for (size_t ix = 0; ix < chunks.size(); ix++) {
+		positionBase[ix] = positionCount; positionCount += chunks[ix].Positions.size();
+		normalBase[ix] = normalCount;     normalCount += chunks[ix].Normals.size();
+		uvBase[ix] = uvCount;             uvCount += chunks[ix].UVs.size();
+		cornerBase[ix] = cornerCount;     cornerCount += chunks[ix].Corners.size();
+		faceBase[ix] = faceCount;         faceCount += chunks[ix].FaceSizes.size();
+	}
+
+	// Merge the chunks, resolving relative indices now that we know where each chunk starts
+	std::vector<glm::vec3> positions(positionCount);
+	std::vector<glm::vec3> normals(normalCount);
+	std::vector<glm::vec2> textureCoords(uvCount);
+	std::vector<ObjCorner> corners(cornerCount);
+	std::vector<uint32_t>  faceSizes(faceCount);
+	std::atomic<bool> invalid(false);
+	ParallelFor(chunks.size(), [&](size_t ix) {
+		ObjChunk& chunk = chunks[ix];
+		std::copy(chunk.Positions.begin(), chunk.Positions.end(), positions.begin() + positionBase[ix]);
+		std::copy(chunk.Normals.begin(), chunk.Normals.end(), normals.begin() + normalBase[ix]);
+		std::copy(chunk.UVs.begin(), chunk.UVs.end(), textureCoords.begin() + uvBase[ix]);
+		std::copy(chunk.FaceSizes.begin(), chunk.FaceSizes.end(), faceSizes.begin() + faceBase[ix]);
+		for (size_t cx = 0; cx < chunk.Corners.size(); cx++) {
+			ObjCorner corner = chunk.Corners[cx];
+			if (corner.RelativeMask & 1) { corner.Position += static_cast<int32_t>(positionBase[ix]); }
+			if (corner.RelativeMask & 2) { corner.UV += static_cast<int32_t>(uvBase[ix]); }
+			if (corner.RelativeMask & 4) { corner.Normal += static_cast<int32_t>(normalBase[ix]); }
+			corner.RelativeMask = 0;
+			if (corner.Position < 1 || (size_t)corner.Position > positionCount ||
+				corner.UV < 0 || (size_t)corner.UV > uvCount || corner.Normal < 0 || (size_t)corner.Normal > normalCount) {
+				invalid = true;
+			}
+			corners[cornerBase[ix] + cx] = corner;
+		}
+		// Free the chunk's copies as we go, since big files can have a lot of them
+		chunk = ObjChunk();
+	});
+	if (invalid) {
+		throw std::runtime_error("OBJ file has a face that references a missing attribute");
+	}
+
+	// Find the unique combinations of attributes in parallel. Each slot in the table holds 1 + the index of the
+	// earliest corner we've seen with it's attributes, which is lowered with compare and swap as other threads find
+	// earlier ones, so that no locks are needed and we end up with the first corner that used each combination
+	size_t capacity = 16;
+	while (capacity < cornerCount * 2) {
+		capacity *= 2;
+	}
+	const size_t mask = capacity - 1;
+	std::vector<std::atomic<uint32_t>> slots(capacity);
+	std::vector<uint32_t> cornerSlots(cornerCount);
+	ParallelFor(cornerCount, [&](size_t ix) {
+		const ObjCorner& corner = corners[ix];
+		uint32_t id = static_cast<uint32_t>(ix) + 1;
+		for (size_t slot = AttributeIndexMap::Hash(corner.Position, corner.UV, corner.Normal) & mask; ; slot = (slot + 1) & mask) {
+			uint32_t current = slots[slot].load(std::memory_order_relaxed);
+			// If the claim fails, current is updated to the corner of whoever got there first
+			if (current == 0 && slots[slot].compare_exchange_strong(current, id, std::memory_order_relaxed)) {
+				cornerSlots[ix] = static_cast<uint32_t>(slot);
+				break;
+			}
+			if (ObjCornersEqual(corners[current - 1], corner)) {
+				while (id < current && !slots[slot].compare_exchange_weak(current, id, std::memory_order_relaxed)) { }
+				cornerSlots[ix] = static_cast<uint32_t>(slot);
+				break;
+			}
+		}
+	}, 4096);
+
+	// Now we can add the vertices in the order they first appear, which matches what ParseStream produces
+	std::vector<uint32_t> slotVertices(capacity);
+	std::vector<uint32_t> cornerVertices(cornerCount);
+	for (size_t ix = 0; ix < cornerCount; ix++) {
+		uint32_t slot = cornerSlots[ix];
+		if (slots[slot].load(std::memory_order_relaxed) == ix + 1) {
+			const ObjCorner& corner = corners[ix];
+			VertexPosNormTexCol vertex;
+			vertex.Position = positions[corner.Position - 1];
+			vertex.UV = corner.UV != 0 ? textureCoords[corner.UV - 1] : glm::vec2(0.0f);
+			vertex.Normal = corner.Normal != 0 ? normals[corner.Normal - 1] : glm::vec3(0.0f, 0.0f, 1.0f);
+			vertex.Color = inColor;
+			slotVertices[slot] = mesh.AddVertex(vertex);
+		}
+		cornerVertices[ix] = slotVertices[slot];
+	}
+
+	// Faces are split into a fan of triangles, which gives the same triangles as ParseStream for tris and quads
+	size_t triangleCount = 0;
+	for (uint32_t size : faceSizes) {
+		triangleCount += size >= 3 ? size - 2 : 0;
+	}
+	mesh.ReserveIndexSpace(triangleCount * 3);
+	const uint32_t* face = cornerVertices.data();
+	for (uint32_t size : faceSizes) {
+		for (uint32_t ix = 2; ix < size; ix++) {
+			mesh.AddIndexTri(face[0], face[ix - 1], face[ix]);
+		}
+		face += size;
+	}
+}
+
+void ObjLoader::ParseStream(const std::string& filename, const glm::vec4& inColor, MeshBuilder<VertexPosNormTexCol>& mesh)
 {	
 	// Open our file in binary mode
 	std::ifstream file;
@@ -24,11 +418,18 @@ VertexArrayObject::sptr ObjLoader::LoadFromFile(const std::string& filename, con
 	std::vector<glm::vec3> normals;
 	std::vector<glm::vec2> textureCoords;
 
-	// We'll use bitmask keys and a map to avoid duplicate vertices
-	std::unordered_map<uint64_t, uint32_t> indexMap;
-
-	// We'll leverage the mesh builder class
-	MeshBuilder<VertexPosNormTexCol> mesh;
+	// We'll use a map from attribute indices to vertices to avoid duplicate vertices. Face lines are usually the
+	// biggest part of the file, so we can guess how many vertices we'll need from it's size and skip most of the
+	// rehashing as the map fills. Streams we can't seek in (ex: pipes) get no estimate
+	file.seekg(0, std::ios::end);
+	std::streamoff fileSize = file.tellg();
+	file.clear();
+	file.seekg(0, std::ios::beg);
+	file.clear();
+	size_t estimatedFaces = fileSize > 0 ? std::min(static_cast<size_t>(fileSize) / OBJ_BYTES_PER_FACE, OBJ_MAX_ESTIMATED_FACES) : 0;
+	AttributeIndexMap indexMap(estimatedFaces);
+	mesh.ReserveVertexSpace(estimatedFaces);
+	mesh.ReserveIndexSpace(estimatedFaces * 3);
 
 	// Temporaries for loading data
 	glm::vec3 temp;
@@ -74,37 +475,29 @@ VertexArrayObject::sptr ObjLoader::LoadFromFile(const std::string& filename, con
 					vertexIndices = glm::ivec3(0);
 					stream >> vertexIndices.x >> tempChar >> vertexIndices.y >> tempChar >> vertexIndices.z;
 					// The OBJ format can have negative values, which are a reference from the last added attributes
-					if (vertexIndices.x < 0) { vertexIndices.x = positions.size() - 1 + vertexIndices.x; }
-					if (vertexIndices.y < 0) { vertexIndices.y = textureCoords.size() - 1 + vertexIndices.y; }
-					if (vertexIndices.z < 0) { vertexIndices.z = normals.size() - 1 + vertexIndices.z; }
-					// We can construct a key using a bitmask of the attribute indices
-					// This let's us quickly look up a combination of attributes to see if it's already been added
-					// Note that this limits us to 2,097,150 unique attributes for positions, normals and textures
-					const uint64_t mask = 0b0'000000000000000000000'000000000000000000000'111111111111111111111;
-					uint64_t key = ((vertexIndices.x & mask) << 42) | ((vertexIndices.y & mask) << 21) | (vertexIndices.z & mask);
-
-					// Find the index associated with the combination of attributes
-					auto it = indexMap.find(key);
-
-					// If it exists, we push the index to our indices
-					if (it != indexMap.end()) {
-						edges[ix] = it->second;
+					if (vertexIndices.x < 0) { vertexIndices.x = positions.size() + 1 + vertexIndices.x; }
+					if (vertexIndices.y < 0) { vertexIndices.y = textureCoords.size() + 1 + vertexIndices.y; }
+					if (vertexIndices.z < 0) { vertexIndices.z = normals.size() + 1 + vertexIndices.z; }
+					if (vertexIndices.x < 1 || (size_t)vertexIndices.x > positions.size() ||
+						vertexIndices.y < 0 || (size_t)vertexIndices.y > textureCoords.size() ||
+						vertexIndices.z < 0 || (size_t)vertexIndices.z > normals.size()) {
+						throw std::runtime_error("OBJ file has a face that references a missing attribute");
 					}
-					else {
+
+					// Find the index associated with the combination of attributes, if it's new the next vertex we add
+					// will be the one for it
+					uint32_t index;
+					if (indexMap.FindOrAdd(vertexIndices, static_cast<uint32_t>(mesh.GetVertexCount()), index)) {
 						// Construct a new vertex using the indices for the vertex
 						VertexPosNormTexCol vertex;
 						vertex.Position = positions[vertexIndices.x - 1];
 						vertex.UV = vertexIndices.y != 0 ? textureCoords[vertexIndices.y - 1] : glm::vec2(0.0f);
 						vertex.Normal = vertexIndices.z != 0 ? normals[vertexIndices.z - 1] : glm::vec3(0.0f, 0.0f, 1.0f);
 						vertex.Color = inColor;
-
-						// Add to the mesh, get index of the added vertex
-						uint32_t index = mesh.AddVertex(vertex);
-						// Cache the index based on our key
-						indexMap[key] = index;
-						// Add index to mesh, and add to edges list for if we are using quads
-						edges[ix] = index;
+						mesh.AddVertex(vertex);
 					}
+					// Add to edges list for if we are using quads
+					edges[ix] = index;
 				} else {
 					break;
 				}
@@ -124,6 +517,4 @@ VertexArrayObject::sptr ObjLoader::LoadFromFile(const std::string& filename, con
 	// Note: with actual OBJ files you're going to run into the issue where faces are composited of different indices
 	// You'll need to keep track of these and create vertex entries for each vertex in the face
 	// If you want to get fancy, you can track which vertices you've already added
-
-	return mesh.Bake();
-}
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include "ProgramCache.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "Logging.h"
+
+ProgramCache::sptr ProgramCache::_default = nullptr;
+
+// Written at the start of every cached binary, so that we can reject files that are truncated or from an older format
+struct ProgramBinaryHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t Key;
+	uint32_t Format;
+	uint32_t Length;
+};
+static const uint32_t PROGRAM_BINARY_MAGIC   = 0x4350474F; // "OGPC"
+static const uint32_t PROGRAM_BINARY_VERSION = 1;
+
+// 64 bit FNV-1a, continuing from the given hash so that multiple strings can be combined into one key
+static uint64_t HashFnv1a64(const void* data, size_t length, uint64_t hash = 14695981039346656037ull) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t ix = 0; ix < length; ix++) {
+		hash = (hash ^ bytes[ix]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+static uint64_t HashGLString(GLenum name, uint64_t hash) {
+	const char* value = reinterpret_cast<const char*>(glGetString(name));
+	return value != nullptr ? HashFnv1a64(value, strlen(value), hash) : hash;
+}
+
+ProgramCache::ProgramCache(const std::string& directory) :
+	_directory(directory),
+	_driverHash(0),
+	_supported(false),
+	_stats({ 0, 0, 0, 0.0 })
+{
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	_supported = formatCount > 0;
+	if (!_supported) {
+		LOG_WARN("Driver does not support program binaries, shaders will always be compiled from source");
+		return;
+	}
+
+	_driverHash = HashGLString(GL_VENDOR, HashFnv1a64(nullptr, 0));
+	_driverHash = HashGLString(GL_RENDERER, _driverHash);
+	_driverHash = HashGLString(GL_VERSION, _driverHash);
+
+	std::error_code error;
+	std::filesystem::create_directories(_directory, error);
+	if (error) {
+		LOG_WARN("Failed to create program cache directory \"{}\": {}", _directory, error.message());
+		_supported = false;
+	}
+}
+
+uint64_t ProgramCache::ComputeKey(const std::vector<std::pair<GLenum, std::string>>& stages) const {
+	uint64_t hash = _driverHash;
+	for (const auto& stage : stages) {
+		hash = HashFnv1a64(&stage.first, sizeof(GLenum), hash);
+		hash = HashFnv1a64(stage.second.data(), stage.second.size(), hash);
+	}
+	return hash;
+}
+
+bool ProgramCache::TryLoad(GLuint program, uint64_t key) {
+	if (!_supported) {
+		return false;
+	}
+	std::string path = _GetPath(key);
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	ProgramBinaryHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(ProgramBinaryHeader));
+	std::vector<char> binary;
+	if (file && header.Magic == PROGRAM_BINARY_MAGIC && header.Version == PROGRAM_BINARY_VERSION && header.Key == key) {
+		binary.resize(header.Length);
+		file.read(binary.data(), header.Length);
+	}
+	bool valid = !binary.empty() && file.gcount() == static_cast<std::streamsize>(header.Length);
+	file.close();
+
+	// The driver may reject binaries even if it gave them to us (ex: after a driver update with the same version string)
+	GLint status = GL_FALSE;
+	if (valid) {
+		glProgramBinary(program, header.Format, binary.data(), static_cast<GLsizei>(binary.size()));
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+	}
+	if (status == GL_FALSE) {
+		LOG_WARN("Discarding rejected program binary \"{}\"", path);
+		std::error_code error;
+		std::filesystem::remove(path, error);
+		_stats.Rejected++;
+		return false;
+	}
+	return true;
+}
+
+void ProgramCache::Store(GLuint program, uint64_t key) {
+	if (!_supported) {
+		return;
+	}
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	ProgramBinaryHeader header;
+	header.Magic = PROGRAM_BINARY_MAGIC;
+	header.Version = PROGRAM_BINARY_VERSION;
+	header.Key = key;
+	header.Format = format;
+	header.Length = static_cast<uint32_t>(length);
+
+	std::string path = _GetPath(key);
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		LOG_WARN("Failed to write program binary \"{}\"", path);
+		return;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(ProgramBinaryHeader));
+	file.write(binary.data(), length);
+}
+
+void ProgramCache::RecordLink(bool fromCache, double milliseconds) {
+	if (fromCache) {
+		_stats.Hits++;
+	} else {
+		_stats.Misses++;
+	}
+	_stats.LinkTimeMs += milliseconds;
+}
+
+std::string ProgramCache::_GetPath(uint64_t key) const {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+	return _directory + "/" + name;
+}
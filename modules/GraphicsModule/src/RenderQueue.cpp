@@ -0,0 +1,137 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <utility>
+
+// The width of each field in the sort key, these need to add up to 64 bits
+static const int LAYER_BITS    = 8;
+static const int SHADER_BITS   = 10;
+static const int MATERIAL_BITS = 12;
+static const int VAO_BITS      = 9;
+static const int MESH_BITS     = 10;
+static const int DEPTH_BITS    = 14;
+static_assert(LAYER_BITS + 1 + SHADER_BITS + MATERIAL_BITS + VAO_BITS + MESH_BITS + DEPTH_BITS == 64, "Sort key fields must fill 64 bits");
+
+// Masks a value to the given number of bits, and moves it into place
+static inline uint64_t PackField(uint64_t value, int bits, int shift) {
+	return (value & ((1ull << bits) - 1)) << shift;
+}
+
+RenderQueue::RenderQueue(size_t capacity) :
+	_view(glm::mat4(1.0f)),
+	_farPlane(1.0f),
+	_sortSkipped(false)
+{
+	_items.reserve(capacity);
+	_keys.reserve(capacity);
+	_lastKeys.reserve(capacity);
+	_order.reserve(capacity);
+	_entries.reserve(capacity);
+	_scratch.reserve(capacity);
+}
+
+void RenderQueue::Begin(const glm::mat4& view, float farPlane) {
+	_view = view;
+	_farPlane = farPlane > 0.0f ? farPlane : 1.0f;
+	_items.clear();
+	_keys.clear();
+}
+
+void RenderQueue::Push(const RendererComponent& renderer, const ::Transform& transform) {
+	const VertexArrayObject* mesh = ResourcePools::Meshes().Get(renderer.Mesh);
+	ShaderMaterial* material = ResourcePools::Materials().Get(renderer.Material);
+	if (mesh == nullptr || material == nullptr) {
+		return;
+	}
+	const Shader::sptr& shader = material->GetActiveShader();
+	if (shader == nullptr) {
+		return;
+	}
+
+	// We only need the z of the object's origin in view space, the camera looks down -z
+	const glm::mat4& world = transform.WorldTransform();
+	float viewZ = _view[0][2] * world[3][0] + _view[1][2] * world[3][1] + _view[2][2] * world[3][2] + _view[3][2];
+	float depth = glm::clamp(-viewZ / _farPlane, 0.0f, 1.0f);
+
+	_items.push_back({ mesh, material, &transform });
+	_keys.push_back(MakeKey(material->RenderLayer, material->Transparent, shader->GetId(), material->GetId(), mesh->GetHandle(), mesh->GetId(), depth));
+}
+
+void RenderQueue::Sort() {
+	// If every object has the same key as last frame, the last order is still correct. This is the common case when
+	// nothing is added or removed and the camera isn't moving
+	_sortSkipped = _keys == _lastKeys && _order.size() == _keys.size();
+	if (_sortSkipped) {
+		return;
+	}
+	_RadixSort();
+	_lastKeys = _keys;
+}
+
+uint64_t RenderQueue::MakeKey(int layer, bool transparent, uint32_t shaderId, uint32_t materialId, uint32_t vaoHandle, uint32_t meshId, float depth) {
+	uint64_t quantizedLayer = static_cast<uint64_t>(glm::clamp(layer, -128, 127) + 128);
+	uint64_t quantizedDepth = static_cast<uint64_t>(glm::clamp(depth, 0.0f, 1.0f) * ((1 << DEPTH_BITS) - 1));
+
+	uint64_t key = PackField(quantizedLayer, LAYER_BITS, 64 - LAYER_BITS);
+	if (!transparent) {
+		// Group by state first, then front to back so that early depth testing can reject hidden fragments. Arena views
+		// share their page's VAO, so sorting on the VAO before the mesh keeps each page's draws together for batching
+		key |= PackField(shaderId,       SHADER_BITS,   MATERIAL_BITS + VAO_BITS + MESH_BITS + DEPTH_BITS);
+		key |= PackField(materialId,     MATERIAL_BITS, VAO_BITS + MESH_BITS + DEPTH_BITS);
+		key |= PackField(vaoHandle,      VAO_BITS,      MESH_BITS + DEPTH_BITS);
+		key |= PackField(meshId,         MESH_BITS,     DEPTH_BITS);
+		key |= PackField(quantizedDepth, DEPTH_BITS,    0);
+	} else {
+		// Transparent objects need to blend over everything behind them, so depth wins over state and is drawn back to front
+		key |= 1ull << (64 - LAYER_BITS - 1);
+		key |= PackField((1 << DEPTH_BITS) - 1 - quantizedDepth, DEPTH_BITS, SHADER_BITS + MATERIAL_BITS + VAO_BITS + MESH_BITS);
+		key |= PackField(shaderId,   SHADER_BITS,   MATERIAL_BITS + VAO_BITS + MESH_BITS);
+		key |= PackField(materialId, MATERIAL_BITS, VAO_BITS + MESH_BITS);
+		key |= PackField(vaoHandle,  VAO_BITS,      MESH_BITS);
+		key |= PackField(meshId,     MESH_BITS,     0);
+	}
+	return key;
+}
+
+void RenderQueue::_RadixSort() {
+	const size_t count = _keys.size();
+	_entries.resize(count);
+	_scratch.resize(count);
+	_order.resize(count);
+
+	// Build the histograms for all 8 passes in one go
+	uint32_t histograms[8][256] = { };
+	for (size_t ix = 0; ix < count; ix++) {
+		uint64_t key = _keys[ix];
+		_entries[ix] = { key, static_cast<uint32_t>(ix) };
+		for (int pass = 0; pass < 8; pass++) {
+			histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+		}
+	}
+
+	SortEntry* source = _entries.data();
+	SortEntry* destination = _scratch.data();
+	for (int pass = 0; pass < 8 && count > 0; pass++) {
+		int shift = pass * 8;
+		uint32_t* histogram = histograms[pass];
+		// If every key has the same digit, this pass wouldn't move anything (ex: the layer byte in most scenes)
+		if (histogram[(source[0].Key >> shift) & 0xFF] == count) {
+			continue;
+		}
+		// Turn the counts into the offset of each bucket
+		uint32_t offset = 0;
+		for (int digit = 0; digit < 256; digit++) {
+			uint32_t digitCount = histogram[digit];
+			histogram[digit] = offset;
+			offset += digitCount;
+		}
+		// Scattering in order keeps the sort stable, so the previous passes are preserved
+		for (size_t ix = 0; ix < count; ix++) {
+			destination[histogram[(source[ix].Key >> shift) & 0xFF]++] = source[ix];
+		}
+		std::swap(source, destination);
+	}
+
+	for (size_t ix = 0; ix < count; ix++) {
+		_order[ix] = source[ix].Index;
+	}
+}
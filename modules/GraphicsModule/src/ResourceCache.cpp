@@ -0,0 +1,52 @@
+#include "ResourceCache.h"
+#include <algorithm>
+#include <filesystem>
+
+ResourceCache::sptr ResourceCache::_default = nullptr;
+
+ResourceCache::ResourceCache() :
+	_stats({ 0, 0, 0, 0, 0 })
+{ }
+
+std::string ResourceCache::MakeKey(const std::string& path, const std::string& options) {
+	// Resolves symlinks for the part of the path that exists, and "." and ".." for the rest
+	std::error_code error;
+	std::filesystem::path absolute = std::filesystem::absolute(path, error);
+	if (error) {
+		absolute = path;
+	}
+	std::filesystem::path canonical = std::filesystem::weakly_canonical(absolute, error);
+	std::string result = (error ? absolute : canonical).lexically_normal().generic_string();
+#ifdef WINDOWS
+	// Paths on Windows are case insensitive
+	std::transform(result.begin(), result.end(), result.begin(), [](char c) { return static_cast<char>(::tolower(c)); });
+#endif
+	return result + "|" + options;
+}
+
+void ResourceCache::Prune() {
+	for (auto it = _entries.begin(); it != _entries.end(); ) {
+		if (it->second.Resource.expired()) {
+			it = _entries.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void ResourceCache::Clear() {
+	_entries.clear();
+}
+
+const ResourceCache::Stats& ResourceCache::GetStats() {
+	Prune();
+	_stats.Entries = _entries.size();
+	_stats.BytesResident = 0;
+	for (const auto& kvp : _entries) {
+		std::shared_ptr<void> resource = kvp.second.Resource.lock();
+		if (resource != nullptr) {
+			_stats.BytesResident += kvp.second.Measure(resource.get());
+		}
+	}
+	return _stats;
+}
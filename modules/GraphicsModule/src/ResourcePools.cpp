@@ -0,0 +1,15 @@
+#include "ResourcePools.h"
+
+ResourcePool<VertexArrayObject> ResourcePools::_meshes;
+ResourcePool<ShaderMaterial>    ResourcePools::_materials;
+ResourcePool<Shader>            ResourcePools::_shaders;
+ResourcePool<ITexture>          ResourcePools::_textures;
+ResourcePool<MeshLodSet>        ResourcePools::_lodSets;
+
+void ResourcePools::Clear() {
+	_lodSets.Clear();
+	_materials.Clear();
+	_meshes.Clear();
+	_shaders.Clear();
+	_textures.Clear();
+}
@@ -1,33 +1,244 @@
 #include "Shader.h"
+#include "GLStateCache.h"
 #include "Logging.h"
+#include "ProgramCache.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <fstream>
 #include <sstream>
+#include <unordered_set>
+
+bool Shader::_parallelCompile = false;
+IdPool Shader::_ids;
+
+// glMaxShaderCompilerThreadsKHR, loaded by InitParallelCompile since it's not in our glad loader
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+static PFNGLMAXSHADERCOMPILERTHREADSKHRPROC MaxShaderCompilerThreads = nullptr;
 
 Shader::Shader() :
-	_vs(0),
-	_fs(0),
-	_handle(0)
+	_handle(0),
+	_state(ShaderState::Unlinked),
+	_cache(nullptr),
+	_cacheKey(0),
+	_buildTimeMs(0.0),
+	_variantMask(0),
+	_id(_ids.Allocate())
 {
 	_handle = glCreateProgram();
 }
 
 Shader::~Shader() {
+	// If we're destroyed while still compiling, the parts are still attached
+	for (GLuint part : _parts) {
+		glDeleteShader(part);
+	}
 	if (_handle != 0) {
-		glDeleteProgram(_handle);
+		GLStateCache::DeleteProgram(_handle);
 		_handle = 0;
 		LOG_INFO("Deleting shader program");
 	}
+	_ids.Release(_id);
+}
+
+Shader::sptr Shader::LoadAsync(const char* vsPath, const char* fsPath) {
+	sptr result = Create();
+	result->LoadShaderPartFromFile(vsPath, GL_VERTEX_SHADER);
+	result->LoadShaderPartFromFile(fsPath, GL_FRAGMENT_SHADER);
+	result->LinkAsync();
+	return result;
+}
+
+bool Shader::InitParallelCompile(GLADloadproc loader, GLuint maxThreads) {
+	bool hasKhr = false, hasArb = false;
+	GLint extensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	for (GLint ix = 0; ix < extensionCount; ix++) {
+		const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, ix));
+		hasKhr |= strcmp(name, "GL_KHR_parallel_shader_compile") == 0;
+		hasArb |= strcmp(name, "GL_ARB_parallel_shader_compile") == 0;
+	}
+
+	// Both extensions use the same enums, only the name of the thread count function differs
+	MaxShaderCompilerThreads = nullptr;
+	if (hasKhr) {
+		MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsKHR");
+	} else if (hasArb) {
+		MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsARB");
+	}
+
+	_parallelCompile = MaxShaderCompilerThreads != nullptr;
+	if (_parallelCompile) {
+		MaxShaderCompilerThreads(maxThreads);
+		LOG_INFO("Parallel shader compilation enabled");
+	} else {
+		LOG_INFO("Parallel shader compilation is not supported, shaders will be compiled when they are first used");
+	}
+	return _parallelCompile;
 }
 
 bool Shader::LoadShaderPart(const char* source, GLenum type)
 {
-	// Creates a new shader part (VS, FS, GS, etc...)
-	GLuint handle = glCreateShader(type);
+	if (type != GL_VERTEX_SHADER && type != GL_FRAGMENT_SHADER) {
+		LOG_WARN("Not implemented");
+		return false;
+	}
+	// We hold on to the source until Link, since we may be able to skip compiling it if the program is in the cache
+	std::string processed = source;
+	_Preprocess(processed);
+	_stages.emplace_back(type, std::move(processed));
+	return true;
+}
+
+// Splits a line of GLSL into whitespace separated tokens
+static std::vector<std::string> Tokenize(const std::string& line) {
+	std::vector<std::string> tokens;
+	std::istringstream stream(line);
+	std::string token;
+	while (stream >> token) {
+		tokens.push_back(token);
+	}
+	return tokens;
+}
+
+void Shader::_Preprocess(std::string& source) {
+	std::vector<std::string> lines;
+	std::istringstream stream(source);
+	std::string line;
+	while (std::getline(stream, line)) {
+		lines.push_back(line);
+	}
+
+	// Collect the keywords first, so they can be declared anywhere in the file
+	bool hasPragmas = false;
+	for (std::string& line : lines) {
+		std::vector<std::string> tokens = Tokenize(line);
+		if (tokens.size() >= 2 && tokens[0] == "#pragma" && tokens[1] == "multi_compile") {
+			for (size_t ix = 2; ix < tokens.size(); ix++) {
+				if (std::find(_keywords.begin(), _keywords.end(), tokens[ix]) == _keywords.end()) {
+					LOG_ASSERT(_keywords.size() < 32, "Shaders can have at most 32 keywords!");
+					_keywords.push_back(tokens[ix]);
+				}
+			}
+			// Comment the line out instead of removing it, so that line numbers in compile errors still line up
+			line = "// " + line;
+			hasPragmas = true;
+		}
+	}
+	if (_keywords.empty()) {
+		return;
+	}
+
+	// Find the uniforms that are only declared when a keyword is enabled. We only track #ifdef KEYWORD blocks, anything
+	// in an #else branch or other conditional is treated as being in every variant. Members of uniform blocks count
+	// too, as long as the block's opening brace is on the same line as it's name
+	std::vector<uint32_t> conditions;
+	bool inBlock = false;
+	auto addParam = [&](const std::string& token) {
+		uint32_t mask = 0;
+		for (uint32_t condition : conditions) {
+			mask |= condition;
+		}
+		if (mask != 0) {
+			// Strip off any array size or the trailing semicolon
+			std::string name = token.substr(0, token.find_first_of("[;"));
+			_paramKeywords[name] |= mask;
+		}
+	};
+	for (const std::string& line : lines) {
+		std::vector<std::string> tokens = Tokenize(line);
+		if (tokens.empty()) {
+			continue;
+		}
+		if (tokens[0] == "#ifdef" && tokens.size() > 1) {
+			conditions.push_back(GetKeywordMask({ tokens[1] }));
+		} else if (tokens[0] == "#if" || tokens[0] == "#ifndef") {
+			conditions.push_back(0);
+		} else if ((tokens[0] == "#else" || tokens[0] == "#elif") && !conditions.empty()) {
+			conditions.back() = 0;
+		} else if (tokens[0] == "#endif" && !conditions.empty()) {
+			conditions.pop_back();
+		} else if (inBlock) {
+			if (tokens[0][0] == '}') {
+				inBlock = false;
+			} else if (tokens.size() >= 2 && tokens[0][0] != '/') {
+				addParam(tokens[1]);
+			}
+		} else {
+			// Uniforms may have a layout qualifier in front of them
+			auto uniform = std::find(tokens.begin(), tokens.end(), "uniform");
+			if (uniform == tokens.end()) {
+				continue;
+			}
+			if (line.find('{') != std::string::npos) {
+				inBlock = true;
+			} else if (tokens.end() - uniform >= 3) {
+				addParam(*(uniform + 2));
+			}
+		}
+	}
+
+	if (hasPragmas) {
+		source.clear();
+		for (const std::string& line : lines) {
+			source += line;
+			source += '\n';
+		}
+	}
+}
 
-	// Load the GLSL source and compile it
-	glShaderSource(handle, 1, &source, nullptr);
-	glCompileShader(handle);
+uint32_t Shader::GetKeywordMask(const std::vector<std::string>& keywords) const {
+	uint32_t mask = 0;
+	for (const std::string& keyword : keywords) {
+		auto it = std::find(_keywords.begin(), _keywords.end(), keyword);
+		if (it != _keywords.end()) {
+			mask |= 1u << (it - _keywords.begin());
+		}
+	}
+	return mask;
+}
+
+uint32_t Shader::GetParamKeywords(const std::string& name) const {
+	auto it = _paramKeywords.find(name);
+	return it != _paramKeywords.end() ? it->second : 0;
+}
 
+Shader::sptr Shader::GetVariant(uint32_t mask) {
+	// Ignore any bits that don't belong to one of our keywords
+	mask &= _keywords.size() < 32 ? (1u << _keywords.size()) - 1 : 0xFFFFFFFFu;
+	if (mask == 0) {
+		if (_state == ShaderState::Unlinked) {
+			LinkAsync();
+		}
+		return shared_from_this();
+	}
+
+	auto it = _variants.find(mask);
+	if (it != _variants.end()) {
+		return it->second;
+	}
+
+	std::vector<std::string> defines;
+	for (size_t ix = 0; ix < _keywords.size(); ix++) {
+		if ((mask & (1u << ix)) != 0) {
+			defines.push_back(_keywords[ix]);
+		}
+	}
+	LOG_INFO("Building shader variant 0x{:X} ({} keywords)", mask, defines.size());
+
+	sptr variant = Create();
+	for (const auto& stage : _stages) {
+		variant->LoadShaderPart(stage.second.c_str(), stage.first, defines);
+	}
+	variant->_variantMask = mask;
+	variant->LinkAsync();
+	_variants[mask] = variant;
+	return variant;
+}
+
+// Logs the compile errors for a shader part, returning false if it failed to compile. This will block until the part
+// is done compiling, so it should only be called once the program has finished linking
+static bool CheckCompileStatus(GLuint handle) {
 	// Get the compilation status for the shader part
 	GLint status = 0;
 	glGetShaderiv(handle, GL_COMPILE_STATUS, &status);
@@ -48,56 +259,162 @@ bool Shader::LoadShaderPart(const char* source, GLenum type)
 
 		// Clean up our log memory
 		delete[] log;
-
-		// Delete the broken shader result
-		glDeleteShader(handle);
-		handle = 0;
 	}
 
-	switch (type) {
-		case GL_VERTEX_SHADER: _vs = handle; break;
-		case GL_FRAGMENT_SHADER: _fs = handle; break;
-		default: LOG_WARN("Not implemented"); break;
+	return status != GL_FALSE;
+}
+
+bool Shader::LoadShaderPart(const char* source, GLenum type, const std::vector<std::string>& defines) {
+	if (defines.empty()) {
+		return LoadShaderPart(source, type);
 	}
 
-	return status != GL_FALSE;
+	// The #version directive has to come first, so our defines go on the line after it
+	std::string result = source;
+	size_t insertAt = 0;
+	size_t version = result.find("#version");
+	if (version != std::string::npos) {
+		size_t lineEnd = result.find('\n', version);
+		insertAt = lineEnd == std::string::npos ? result.length() : lineEnd + 1;
+	}
+	std::string block;
+	for (const std::string& define : defines) {
+		block += "#define " + define + "\n";
+	}
+	result.insert(insertAt, block);
+	return LoadShaderPart(result.c_str(), type);
 }
 
 bool Shader::LoadShaderPartFromFile(const char* path, GLenum type) {
+	return LoadShaderPartFromFile(path, type, {});
+}
+
+// Reads a shader file, replacing any #include "file" lines with the contents of that file. Paths are relative to the
+// file doing the including, and each file will only be included once, so headers don't need include guards
+static void ReadShaderFile(const std::string& path, std::string& result, std::unordered_set<std::string>& included) {
+	if (!included.insert(path).second) {
+		return;
+	}
 	std::ifstream file(path);
 	if (!file.is_open()) {
 		LOG_ERROR("File not found: {}", path);
 		throw std::runtime_error("File not found, see logs for more information");
 	}
-	std::stringstream stream;
-	stream << file.rdbuf();
-	bool result = LoadShaderPart(stream.str().c_str(), type);
-	file.close();
-	return result;
+	size_t slash = path.find_last_of("/\\");
+	std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+	std::string line;
+	while (std::getline(file, line)) {
+		size_t start = line.find_first_not_of(" \t");
+		if (start != std::string::npos && line.compare(start, 8, "#include") == 0) {
+			size_t open = line.find('"', start);
+			size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+			if (close == std::string::npos) {
+				LOG_ERROR("Malformed #include in {}: {}", path, line);
+				throw std::runtime_error("Malformed #include, see logs for more information");
+			}
+			ReadShaderFile(directory + line.substr(open + 1, close - open - 1), result, included);
+		} else {
+			result += line;
+			result += '\n';
+		}
+	}
+}
+
+bool Shader::LoadShaderPartFromFile(const char* path, GLenum type, const std::vector<std::string>& defines) {
+	std::string source;
+	std::unordered_set<std::string> included;
+	ReadShaderFile(path, source, included);
+	return LoadShaderPart(source.c_str(), type, defines);
 }
 
 bool Shader::Link()
 {
-	LOG_ASSERT(_vs != 0 && _fs != 0, "Must attach both a vertex and fragment shader!");
+	return LinkAsync() && Wait();
+}
 
-	// Attach our two shaders
-	glAttachShader(_handle, _vs);
-	glAttachShader(_handle, _fs);
+bool Shader::LinkAsync()
+{
+	LOG_ASSERT(_state == ShaderState::Unlinked, "Shader has already been linked!");
+	auto start = std::chrono::high_resolution_clock::now();
+	LOG_ASSERT(
+		std::any_of(_stages.begin(), _stages.end(), [](const auto& stage) { return stage.first == GL_VERTEX_SHADER; }) &&
+		std::any_of(_stages.begin(), _stages.end(), [](const auto& stage) { return stage.first == GL_FRAGMENT_SHADER; }),
+		"Must attach both a vertex and fragment shader!");
 
-	// Perform linking
+	// If we've linked this exact program before on this driver, we can skip compiling it
+	_cache = ProgramCache::GetDefault();
+	if (_cache != nullptr) {
+		_cacheKey = _cache->ComputeKey(_stages);
+		if (_cache->TryLoad(_handle, _cacheKey)) {
+			// Variants are built from our stages, so we need to keep them if we have any keywords
+			if (_keywords.empty()) {
+				_stages.clear();
+			}
+			_Reflect();
+			_state = ShaderState::Ready;
+			_cache->RecordLink(true, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+			_cache = nullptr;
+			return true;
+		}
+		glProgramParameteri(_handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	// Submit all our stages and the link without checking any results, checking the status of a shader or program
+	// forces the driver to finish building it, which would stop the other programs from compiling in parallel
+	for (const auto& stage : _stages) {
+		GLuint part = glCreateShader(stage.first);
+		const char* sourcePtr = stage.second.c_str();
+		glShaderSource(part, 1, &sourcePtr, nullptr);
+		glCompileShader(part);
+		glAttachShader(_handle, part);
+		_parts.push_back(part);
+	}
+	if (_keywords.empty()) {
+		_stages.clear();
+	}
 	glLinkProgram(_handle);
 
-	// Remove shader parts to save space (we can do this since we only needed the shader parts to compile an actual shader program)
-	glDetachShader(_handle, _vs);
-	glDeleteShader(_vs);
-	glDetachShader(_handle, _fs);
-	glDeleteShader(_fs);
+	_state = ShaderState::Compiling;
+	_buildTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return true;
+}
+
+bool Shader::IsReady() {
+	if (_state == ShaderState::Compiling) {
+		if (_parallelCompile) {
+			GLint complete = GL_FALSE;
+			glGetProgramiv(_handle, GL_COMPLETION_STATUS_KHR, &complete);
+			if (complete == GL_FALSE) {
+				return false;
+			}
+		}
+		_FinishLink();
+	}
+	return _state == ShaderState::Ready;
+}
+
+bool Shader::Wait() {
+	if (_state == ShaderState::Compiling) {
+		_FinishLink();
+	}
+	return _state == ShaderState::Ready;
+}
+
+void Shader::_FinishLink() {
+	auto start = std::chrono::high_resolution_clock::now();
 
 	GLint status = 0;
 	glGetProgramiv(_handle, GL_LINK_STATUS, &status);
 
 	if (status == GL_FALSE)
 	{
+		// Link failures are usually caused by a stage that didn't compile, so report those first
+		bool compiled = true;
+		for (GLuint part : _parts) {
+			compiled &= CheckCompileStatus(part);
+		}
+
 		// Get the length of the log
 		GLint length = 0;
 		glGetProgramiv(_handle, GL_INFO_LOG_LENGTH, &length);
@@ -109,19 +426,187 @@ bool Shader::Link()
 			LOG_ERROR("Shader failed to link:\n{}", log);
 			delete[] log;
 		}
-		else {
+		else if (compiled) {
 			LOG_ERROR("Shader failed to link for an unknown reason!");
 		}
 	}
-	return status != GL_FALSE;
+
+	// Remove shader parts to save space (we can do this since we only needed the shader parts to compile an actual shader program)
+	for (GLuint part : _parts) {
+		glDetachShader(_handle, part);
+		glDeleteShader(part);
+	}
+	_parts.clear();
+
+	if (status != GL_FALSE) {
+		_Reflect();
+		if (_cache != nullptr) {
+			_cache->Store(_handle, _cacheKey);
+		}
+		_state = ShaderState::Ready;
+	} else {
+		_state = ShaderState::Failed;
+	}
+
+	if (_cache != nullptr) {
+		_buildTimeMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		_cache->RecordLink(false, _buildTimeMs);
+		_cache = nullptr;
+	}
+}
+
+void Shader::_Reflect() {
+	_uniforms.clear();
+	_uniformBlocks.clear();
+	_samplers.clear();
+	_missingUniforms.clear();
+
+	std::vector<char> nameBuffer;
+	// Arrays are reported as "name[0]", we strip the suffix so they can be looked up with just their name
+	auto readName = [&](GLenum programInterface, GLuint index, GLint length) {
+		nameBuffer.resize(std::max(length, 1));
+		glGetProgramResourceName(_handle, programInterface, index, length, nullptr, nameBuffer.data());
+		std::string name = nameBuffer.data();
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+			name.resize(name.size() - 3);
+		}
+		return name;
+	};
+
+	GLint uniformCount = 0;
+	glGetProgramInterfaceiv(_handle, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+	_uniforms.reserve(uniformCount);
+	const GLenum uniformProps[] = { GL_NAME_LENGTH, GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE, GL_BLOCK_INDEX, GL_OFFSET };
+	for (GLint ix = 0; ix < uniformCount; ix++) {
+		GLint values[6];
+		glGetProgramResourceiv(_handle, GL_UNIFORM, ix, 6, uniformProps, 6, nullptr, values);
+
+		UniformInfo info;
+		info.Name = readName(GL_UNIFORM, ix, values[0]);
+		info.Hash = UniformId(info.Name).Hash;
+		info.Type = static_cast<GLenum>(values[1]);
+		info.Location = values[2];
+		info.ArraySize = values[3];
+		info.BlockIndex = values[4];
+		info.Offset = values[5];
+		_uniforms.push_back(info);
+	}
+	std::sort(_uniforms.begin(), _uniforms.end(), [](const UniformInfo& l, const UniformInfo& r) { return l.Hash < r.Hash; });
+	for (size_t ix = 0; ix < _uniforms.size(); ix++) {
+		if (ix > 0 && _uniforms[ix].Hash == _uniforms[ix - 1].Hash) {
+			LOG_WARN("Uniforms \"{}\" and \"{}\" have the same hash, only one of them can be used!", _uniforms[ix - 1].Name, _uniforms[ix].Name);
+		}
+		if (IsSamplerType(_uniforms[ix].Type)) {
+			_samplers.push_back(ix);
+		}
+	}
+
+	GLint blockCount = 0;
+	glGetProgramInterfaceiv(_handle, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &blockCount);
+	_uniformBlocks.reserve(blockCount);
+	const GLenum blockProps[] = { GL_NAME_LENGTH, GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+	for (GLint ix = 0; ix < blockCount; ix++) {
+		GLint values[3];
+		glGetProgramResourceiv(_handle, GL_UNIFORM_BLOCK, ix, 3, blockProps, 3, nullptr, values);
+
+		UniformBlockInfo info;
+		info.Name = readName(GL_UNIFORM_BLOCK, ix, values[0]);
+		info.Hash = UniformId(info.Name).Hash;
+		info.Binding = values[1];
+		info.DataSize = values[2];
+		_uniformBlocks.push_back(info);
+	}
+}
+
+int Shader::FindUniform(UniformId id) const {
+	auto it = std::lower_bound(_uniforms.begin(), _uniforms.end(), id.Hash, [](const UniformInfo& info, uint32_t hash) { return info.Hash < hash; });
+	if (it != _uniforms.end() && it->Hash == id.Hash) {
+		return static_cast<int>(it - _uniforms.begin());
+	}
+	return -1;
+}
+
+const UniformInfo* Shader::GetUniformInfo(UniformId id) const {
+	int index = FindUniform(id);
+	return index != -1 ? &_uniforms[index] : nullptr;
+}
+
+const UniformBlockInfo* Shader::GetUniformBlockInfo(UniformId id) const {
+	for (const UniformBlockInfo& block : _uniformBlocks) {
+		if (block.Hash == id.Hash) {
+			return &block;
+		}
+	}
+	return nullptr;
+}
+
+bool Shader::ValidateUniform(UniformId id, GLenum type) const {
+	const UniformInfo* info = GetUniformInfo(id);
+	if (info == nullptr) {
+		return false;
+	}
+	// Any sampler can be fed by a texture unit, the texture itself determines if the sampler type is correct
+	bool matches = info->Type == type || (IsSamplerType(info->Type) && IsSamplerType(type));
+	if (!matches) {
+		LOG_WARN("Uniform \"{}\" has type 0x{:04X}, but was given a value of type 0x{:04X}", info->Name, info->Type, type);
+	}
+	return matches;
+}
+
+bool Shader::IsSamplerType(GLenum type) {
+	switch (type) {
+		case GL_SAMPLER_1D:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+		case GL_SAMPLER_1D_SHADOW:
+		case GL_SAMPLER_2D_SHADOW:
+		case GL_SAMPLER_1D_ARRAY:
+		case GL_SAMPLER_2D_ARRAY:
+		case GL_SAMPLER_CUBE_MAP_ARRAY:
+		case GL_SAMPLER_1D_ARRAY_SHADOW:
+		case GL_SAMPLER_2D_ARRAY_SHADOW:
+		case GL_SAMPLER_2D_MULTISAMPLE:
+		case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+		case GL_SAMPLER_CUBE_SHADOW:
+		case GL_SAMPLER_CUBE_MAP_ARRAY_SHADOW:
+		case GL_SAMPLER_BUFFER:
+		case GL_SAMPLER_2D_RECT:
+		case GL_SAMPLER_2D_RECT_SHADOW:
+		case GL_INT_SAMPLER_1D:
+		case GL_INT_SAMPLER_2D:
+		case GL_INT_SAMPLER_3D:
+		case GL_INT_SAMPLER_CUBE:
+		case GL_INT_SAMPLER_1D_ARRAY:
+		case GL_INT_SAMPLER_2D_ARRAY:
+		case GL_INT_SAMPLER_CUBE_MAP_ARRAY:
+		case GL_INT_SAMPLER_2D_MULTISAMPLE:
+		case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+		case GL_INT_SAMPLER_BUFFER:
+		case GL_INT_SAMPLER_2D_RECT:
+		case GL_UNSIGNED_INT_SAMPLER_1D:
+		case GL_UNSIGNED_INT_SAMPLER_2D:
+		case GL_UNSIGNED_INT_SAMPLER_3D:
+		case GL_UNSIGNED_INT_SAMPLER_CUBE:
+		case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_CUBE_MAP_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE:
+		case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+		case GL_UNSIGNED_INT_SAMPLER_2D_RECT:
+			return true;
+		default:
+			return false;
+	}
 }
 
 void Shader::Bind() {
-	glUseProgram(_handle);
+	GLStateCache::UseProgram(_handle);
 }
 
 void Shader::UnBind() {
-	glUseProgram(0);
+	GLStateCache::UseProgram(0);
 }
 
 void Shader::SetUniformMatrix(int location, const glm::mat3* value, int count, bool transposed) {
@@ -173,24 +658,26 @@ void Shader::SetUniform(int location, const glm::bvec4* value, int count) {
 	glProgramUniform4i(location, value->x, value->y, value->z, value->w, 1);
 }
 
-int Shader::GetUniformLocation(const std::string& name) {
-	// Search the map for the given name
-	std::unordered_map<std::string, int>::const_iterator it = _uniformLocs.find(name);
-	int result = -1;
-
-	// If our entry was not found, we call glGetUniform and store it for next time
-	if (it == _uniformLocs.end()) {
-		result = glGetUniformLocation(_handle, name.c_str());
-		_uniformLocs[name] = result;
-
-		if (result == -1) {
-			LOG_WARN("Ignoring uniform \"{}\"", name);
-		}
+int Shader::GetUniformLocation(UniformId id) {
+	int index = FindUniform(id);
+	if (index != -1) {
+		return _uniforms[index].Location;
 	}
-	// Otherwise, we had a value in the map, return it
-	else {
-		result = it->second;
+	// Only warn the first time, since this is likely to be called every frame
+	if (_missingUniforms.insert(id.Hash).second) {
+		LOG_WARN("Ignoring uniform with hash 0x{:08X}", id.Hash);
 	}
+	return -1;
+}
 
-	return result;
-}
\ No newline at end of file
+int Shader::GetUniformLocation(const std::string& name) {
+	UniformId id(name);
+	int index = FindUniform(id);
+	if (index != -1) {
+		return _uniforms[index].Location;
+	}
+	if (_missingUniforms.insert(id.Hash).second) {
+		LOG_WARN("Ignoring uniform \"{}\"", name);
+	}
+	return -1;
+}
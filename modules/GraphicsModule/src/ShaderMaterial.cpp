@@ -1,4 +1,6 @@
 #include "ShaderMaterial.h"
+#include <algorithm>
+#include <cstring>
 
 template<typename T>
 void SubmitUniforms(const Shader::sptr& shader, const std::unordered_map<ShaderParamName, T>& values) {
@@ -14,79 +16,263 @@ void SubmitUniformsMat(const Shader::sptr& shader, const std::unordered_map<Shad
 	}
 }
 
+// Copies a value into a std140 block, returning the number of bytes that it covers
+template<typename T>
+size_t WriteStd140(uint8_t* dest, const T& value) {
+	memcpy(dest, &value, sizeof(T));
+	return sizeof(T);
+}
+
+// std140 pads every column of a mat3 out to a vec4
+template<>
+size_t WriteStd140(uint8_t* dest, const glm::mat3& value) {
+	for (int col = 0; col < 3; col++) {
+		memcpy(dest + col * sizeof(glm::vec4), &value[col], sizeof(glm::vec3));
+	}
+	return 2 * sizeof(glm::vec4) + sizeof(glm::vec3);
+}
+
+IdPool ShaderMaterial::_ids;
+
 ShaderMaterial::ShaderMaterial()
-	: Shader(nullptr),  RenderLayer(0)
+	: Shader(nullptr),  RenderLayer(0), Transparent(false), _activeShader(nullptr), _activeSource(nullptr), _variantDirty(true), _unresolved(false),
+	_id(_ids.Allocate()), _blockBuffer(nullptr), _block({ 0, 0 }), _dirtyBegin(0), _dirtyEnd(0), _hasLooseParams(false)
 {
 }
 
 ShaderMaterial::~ShaderMaterial() {
 	LOG_INFO("Deleting material");
+	if (_blockBuffer != nullptr) {
+		_blockBuffer->Free(_block);
+	}
+	_ids.Release(_id);
 }
 
-void ShaderMaterial::Apply()
-{	
-	int slot = 1;
+// Finds a material parameter in the active shader, making sure that it's actually declared with the type we will be
+// uploading. Parameters that are missing or have the wrong type are skipped by Apply
+const UniformInfo* ShaderMaterial::_ResolveParam(const std::string& name, GLenum type) {
+	UniformId id(name);
+	const UniformInfo* info = _activeShader->GetUniformInfo(id);
+	if (info == nullptr) {
+		LOG_WARN("Ignoring material parameter \"{}\", the shader does not use it", name);
+		return nullptr;
+	}
+	return _activeShader->ValidateUniform(id, type) ? info : nullptr;
+}
+
+template<typename T>
+uint32_t CollectKeywords(const Shader::sptr& shader, const std::unordered_map<ShaderParamName, T>& values) {
+	uint32_t mask = 0;
+	for (auto& kvp : values) {
+		mask |= shader->GetParamKeywords(kvp.first.Name);
+	}
+	return mask;
+}
+
+const Shader::sptr& ShaderMaterial::GetActiveShader() {
+	if (_variantDirty || _activeSource != Shader.get()) {
+		_variantDirty = false;
+		_activeSource = Shader.get();
+
+		Shader::sptr variant = nullptr;
+		if (Shader != nullptr) {
+			// Enable every keyword that one of our parameters is declared under
+			uint32_t mask = 0;
+			mask |= CollectKeywords(Shader, Textures);
+			mask |= CollectKeywords(Shader, FloatParams);
+			mask |= CollectKeywords(Shader, Vec2Params);
+			mask |= CollectKeywords(Shader, Vec3Params);
+			mask |= CollectKeywords(Shader, Vec4Params);
+			mask |= CollectKeywords(Shader, Mat4Params);
+			mask |= CollectKeywords(Shader, Mat3Params);
+			variant = Shader->GetVariant(mask);
+		}
+
+		// Our parameter locations are only valid for the program they were looked up in
+		if (variant != _activeShader) {
+			_activeShader = variant;
+			_unresolved = true;
+		}
+	}
+	return _activeShader;
+}
+
+template<typename T>
+void ShaderMaterial::_WriteParam(const ShaderParamName& name, const T& value) {
+	// Until we're compiled we don't know where anything goes, _Compile will write everything anyways
+	if (_unresolved || name.Offset < 0) {
+		return;
+	}
+	size_t begin = static_cast<size_t>(name.Offset);
+	size_t end = begin + WriteStd140(_blockData.data() + begin, value);
+	if (_dirtyEnd <= _dirtyBegin) {
+		_dirtyBegin = begin;
+		_dirtyEnd = end;
+	} else {
+		_dirtyBegin = std::min(_dirtyBegin, begin);
+		_dirtyEnd = std::max(_dirtyEnd, end);
+	}
+}
+
+template<typename T>
+void ShaderMaterial::_CompileParams(const std::unordered_map<ShaderParamName, T>& values, GLenum type, int blockIndex) {
+	for (auto& kvp : values) {
+		const UniformInfo* info = _ResolveParam(kvp.first.Name, type);
+		bool inBlock = info != nullptr && blockIndex != -1 && info->BlockIndex == blockIndex;
+		kvp.first.Location = (info != nullptr && info->BlockIndex == -1) ? info->Location : -1;
+		kvp.first.Offset = (inBlock && _block.IsValid()) ? info->Offset : -1;
+		_hasLooseParams |= kvp.first.Location != -1;
+		if (kvp.first.Offset != -1) {
+			WriteStd140(_blockData.data() + kvp.first.Offset, kvp.second);
+		}
+	}
+}
+
+void ShaderMaterial::_Compile() {
+	_unresolved = false;
+	_hasLooseParams = false;
+
+	// Find the material block in the active shader, block members are looked up by the same names as regular uniforms
+	int blockIndex = -1;
+	const std::vector<UniformBlockInfo>& blocks = _activeShader->GetUniformBlocks();
+	for (size_t ix = 0; ix < blocks.size(); ix++) {
+		if (blocks[ix].Hash == UniformId(MaterialBuffer::BLOCK_NAME).Hash) {
+			blockIndex = static_cast<int>(ix);
+			if (blocks[ix].Binding != static_cast<GLint>(MaterialBuffer::BINDING)) {
+				LOG_WARN("Material block is bound to {}, but the material buffer is bound to {}!", blocks[ix].Binding, MaterialBuffer::BINDING);
+			}
+			break;
+		}
+	}
+
+	// Make sure our range of the material buffer fits the block, variants may declare different parameters
+	size_t blockSize = blockIndex != -1 ? static_cast<size_t>(blocks[blockIndex].DataSize) : 0;
+	if (blockSize != _block.Size) {
+		if (_blockBuffer != nullptr) {
+			_blockBuffer->Free(_block);
+		}
+		_block = { 0, 0 };
+		_blockBuffer = blockSize > 0 ? MaterialBuffer::GetDefault() : nullptr;
+		if (_blockBuffer != nullptr) {
+			_block = _blockBuffer->Allocate(blockSize);
+		} else if (blockSize > 0) {
+			LOG_WARN("No default material buffer has been set, the material block for \"{}\" will not be bound", DebugName);
+		}
+	}
+	_blockData.assign(_block.Size, 0);
+
+	_CompileParams(FloatParams, GL_FLOAT, blockIndex);
+	_CompileParams(Vec2Params, GL_FLOAT_VEC2, blockIndex);
+	_CompileParams(Vec3Params, GL_FLOAT_VEC3, blockIndex);
+	_CompileParams(Vec4Params, GL_FLOAT_VEC4, blockIndex);
+	_CompileParams(Mat4Params, GL_FLOAT_MAT4, blockIndex);
+	_CompileParams(Mat3Params, GL_FLOAT_MAT3, blockIndex);
+	// The whole block was just rewritten, so all of it needs to be uploaded
+	_dirtyBegin = 0;
+	_dirtyEnd = _blockData.size();
+
+	// Each sampler gets a fixed unit based on it's position in the program's sampler list. Since that only depends on the
+	// program, every material using it agrees on the units, and the sampler uniforms only need to be set once
+	_textureTable.clear();
+	const std::vector<size_t>& samplers = _activeShader->GetSamplers();
 	for (auto& kvp : Textures) {
-		if (kvp.first.Location != -1 && kvp.second != nullptr) {
-			Shader->SetUniform(kvp.first.Location, slot);
-			kvp.second->Bind(slot);
-			slot++;
+		const UniformInfo* info = _ResolveParam(kvp.first.Name, GL_SAMPLER_2D);
+		kvp.first.Location = -1;
+		kvp.first.Offset = -1;
+		if (info == nullptr) {
+			continue;
+		}
+		int uniformIx = _activeShader->FindUniform(UniformId(kvp.first.Name));
+		auto it = std::find(samplers.begin(), samplers.end(), static_cast<size_t>(uniformIx));
+		GLuint unit = 1 + static_cast<GLuint>(it - samplers.begin());
+		_activeShader->SetUniform(info->Location, static_cast<int>(unit));
+		_textureTable.push_back({ unit, &kvp.second });
+	}
+}
+
+void ShaderMaterial::Apply()
+{
+	const Shader::sptr& shader = GetActiveShader();
+	if (shader == nullptr || !shader->IsReady()) {
+		return;
+	}
+	// Parameters are laid out once we know which variant we're using, and it has finished linking
+	if (_unresolved) {
+		_Compile();
+	}
+
+	if (_block.IsValid()) {
+		// Only the bytes that changed since the last Apply go up, most frames this is nothing
+		if (_dirtyEnd > _dirtyBegin) {
+			_blockBuffer->Update(_block, _blockData.data() + _dirtyBegin, _dirtyBegin, _dirtyEnd - _dirtyBegin);
+			_dirtyBegin = _dirtyEnd = 0;
 		}
+		_blockBuffer->Bind(_block);
 	}
 
-	SubmitUniforms(Shader, FloatParams);
-	SubmitUniforms(Shader, Vec2Params);
-	SubmitUniforms(Shader, Vec3Params);
-	SubmitUniforms(Shader, Vec4Params);
-	SubmitUniformsMat(Shader, Mat4Params);
-	SubmitUniformsMat(Shader, Mat3Params);
+	for (const auto& entry : _textureTable) {
+		if (*entry.second != nullptr) {
+			(*entry.second)->Bind(entry.first);
+		}
+	}
+
+	// Regular uniforms are part of the program's state, so another material may have changed them since we were applied
+	if (_hasLooseParams) {
+		SubmitUniforms(shader, FloatParams);
+		SubmitUniforms(shader, Vec2Params);
+		SubmitUniforms(shader, Vec3Params);
+		SubmitUniforms(shader, Vec4Params);
+		SubmitUniformsMat(shader, Mat4Params);
+		SubmitUniformsMat(shader, Mat3Params);
+	}
+}
+
+void ShaderMaterial::_OnParamAdded() {
+	// A new parameter may need a different variant, and even if it doesn't it still needs to be laid out. Changing the
+	// value of an existing parameter doesn't need either
+	_variantDirty = true;
+	_unresolved = true;
+}
+
+template<typename T>
+void ShaderMaterial::_SetParam(std::unordered_map<ShaderParamName, T>& values, const std::string& name, const T& value) {
+	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
+	auto result = values.insert_or_assign(name, value);
+	if (result.second) {
+		_OnParamAdded();
+	} else {
+		_WriteParam(result.first->first, value);
+	}
 }
 
 void ShaderMaterial::Set(const std::string& name, const ITexture::sptr& texture) {
 	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Textures[pName] = texture;
+	// The texture table points at the values in the map, so replacing an existing texture doesn't need anything else
+	if (Textures.insert_or_assign(name, texture).second) {
+		_OnParamAdded();
+	}
 }
 
 void ShaderMaterial::Set(const std::string& name, float value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	FloatParams[pName] = value;
+	_SetParam(FloatParams, name, value);
 }
 
 void ShaderMaterial::Set(const std::string& name, const glm::vec2& value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Vec2Params[pName] = value;
+	_SetParam(Vec2Params, name, value);
 }
 
 void ShaderMaterial::Set(const std::string& name, const glm::vec3& value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Vec3Params[pName] = value;
+	_SetParam(Vec3Params, name, value);
 }
 
 void ShaderMaterial::Set(const std::string& name, const glm::vec4& value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Vec4Params[pName] = value;
+	_SetParam(Vec4Params, name, value);
 }
 
 void ShaderMaterial::Set(const std::string& name, const glm::mat4& value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Mat4Params[pName] = value;
+	_SetParam(Mat4Params, name, value);
 }
 
 void ShaderMaterial::Set(const std::string& name, const glm::mat3& value) {
-	LOG_ASSERT(Shader != nullptr, "Must set Material shader before setting params");
-	ShaderParamName pName = name;
-	pName.Location = Shader->GetUniformLocation(name);
-	Mat3Params[pName] = value;
+	_SetParam(Mat3Params, name, value);
 }
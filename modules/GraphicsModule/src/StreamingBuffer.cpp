@@ -0,0 +1,91 @@
+#include "StreamingBuffer.h"
+#include "GLStateCache.h"
+#include "Logging.h"
+
+// We round our frame regions up to this size, so that the start of every region satisfies any
+// alignment requirement the driver may have for uniform or storage buffer offsets
+#define STREAMING_REGION_ALIGNMENT 256
+
+StreamingBuffer::StreamingBuffer(GLenum type, size_t frameSize, uint32_t frameCount) :
+	IBuffer(type, GL_STREAM_DRAW),
+	_mapped(nullptr),
+	_frameHead(0),
+	_frameCount(frameCount),
+	_frameIndex(0),
+	_stallCount(0)
+{
+	LOG_ASSERT(frameSize > 0 && frameCount > 0, "Streaming buffers must have a non-zero frame size and count!");
+	_frameSize = (frameSize + STREAMING_REGION_ALIGNMENT - 1) & ~((size_t)STREAMING_REGION_ALIGNMENT - 1);
+	_fences.resize(_frameCount, nullptr);
+
+	// We use immutable storage here, since we will never re-size the buffer, and it allows us to keep the buffer mapped
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	_elementSize = 1;
+	_elementCount = _frameSize * _frameCount;
+	glNamedBufferStorage(_handle, _elementCount, nullptr, flags);
+	_mapped = static_cast<uint8_t*>(glMapNamedBufferRange(_handle, 0, _elementCount, flags));
+	LOG_ASSERT(_mapped != nullptr, "Failed to persistently map streaming buffer!");
+}
+
+StreamingBuffer::~StreamingBuffer() {
+	for (GLsync& fence : _fences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	if (_handle != 0 && _mapped != nullptr) {
+		glUnmapNamedBuffer(_handle);
+		_mapped = nullptr;
+	}
+}
+
+StreamingBuffer::Allocation StreamingBuffer::Allocate(size_t bytes, size_t align) {
+	if (align == 0) align = 1;
+	// Round our head up to the next multiple of the alignment
+	size_t offset = ((_frameHead + align - 1) / align) * align;
+	if (offset + bytes > _frameSize) {
+		LOG_WARN("Streaming buffer out of space for frame! Requested {} bytes with {} of {} used", bytes, _frameHead, _frameSize);
+		return Allocation();
+	}
+	_frameHead = offset + bytes;
+
+	size_t globalOffset = (size_t)_frameIndex * _frameSize + offset;
+	return Allocation(_mapped + globalOffset, static_cast<GLintptr>(globalOffset), bytes);
+}
+
+void StreamingBuffer::BeginFrame() {
+	GLsync& fence = _fences[_frameIndex];
+	if (fence != nullptr) {
+		// Check to see if the GPU is done with the region before we block on it, so we can track stalls
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			_stallCount++;
+			do {
+				// We flush on the wait so we can't deadlock on a fence that was never submitted
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			} while (result == GL_TIMEOUT_EXPIRED);
+		}
+		if (result == GL_WAIT_FAILED) {
+			LOG_WARN("Failed to wait on streaming buffer fence");
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+	_frameHead = 0;
+}
+
+void StreamingBuffer::EndFrame() {
+	GLsync& fence = _fences[_frameIndex];
+	if (fence != nullptr) {
+		glDeleteSync(fence);
+	}
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	_frameIndex = (_frameIndex + 1) % _frameCount;
+	_frameHead = 0;
+}
+
+void StreamingBuffer::BindRange(GLuint index, const Allocation& allocation) const {
+	LOG_ASSERT(_type == GL_UNIFORM_BUFFER || _type == GL_SHADER_STORAGE_BUFFER, "BindRange is only valid for uniform and storage buffers!");
+	GLStateCache::BindBufferRange(_type, index, _handle, allocation.Offset, allocation.Size);
+}
@@ -1,4 +1,9 @@
 #include "Texture2D.h"
+#include <algorithm>
+#include "GLStateCache.h"
+#include "ResourceCache.h"
+#include "TextureCooker.h"
+#include "TextureLoader.h"
 
 Texture2D::Texture2D(const Texture2DDescription& description) :
 	ITexture(), _description(description)
@@ -9,38 +14,96 @@ Texture2D::Texture2D(const Texture2DDescription& description) :
 
 void Texture2D::_RecreateTexture() {
 	if (_handle != 0) {
-		glDeleteTextures(1, &_handle);
+		GLStateCache::DeleteTextures(1, &_handle);
 		_handle = 0;
 	}
 
-	glCreateTextures(GL_TEXTURE_2D, 1, &_handle);
+	_handle = _CreateStorage(_description);
+}
+
+uint32_t Texture2D::GetStorageLevels(const Texture2DDescription& description) {
+	// Without the rest of the chain, glGenerateTextureMipmap has nowhere to put the smaller levels and every lookup
+	// samples the full sized image
+	uint32_t fullCount = GetFullMipCount(description.Width, description.Height);
+	if (description.MipLevels == 0) {
+		return description.GenerateMipMaps ? fullCount : 1;
+	}
+	return std::min(description.MipLevels, fullCount);
+}
+
+uint32_t Texture2D::_GetUploadLevels(const Texture2DDescription& description, const Texture2DData::sptr& data) {
+	// Only uncompressed single level images get their chain generated on the GPU. Everything else only has the levels
+	// it came with, so allocating more would leave levels undefined and the texture incomplete under mip filtering
+	if (data->GetLevelCount() > 1 || data->IsCompressed() || !description.GenerateMipMaps) {
+		return data->GetLevelCount();
+	}
+	return description.MipLevels;
+}
+
+size_t Texture2D::GetDataSize() const {
+	size_t result = 0;
+	for (uint32_t ix = 0; ix < GetLevelCount(); ix++) {
+		result += GetImageSize(_description.Format, std::max(_description.Width >> ix, 1u), std::max(_description.Height >> ix, 1u));
+	}
+	return result;
+}
+
+GLuint Texture2D::_CreateStorage(Texture2DDescription& description) {
+	GLuint handle = 0;
+	glCreateTextures(GL_TEXTURE_2D, 1, &handle);
 
-	if (_description.MaxAnisotropic < 0.0f) {
-		_description.MaxAnisotropic = ITexture::GetLimits().MAX_ANISOTROPY;
+	if (description.MaxAnisotropic < 0.0f) {
+		description.MaxAnisotropic = ITexture::GetLimits().MAX_ANISOTROPY;
 	}
 
-	if (_description.Width * _description.Height > 0 && _description.Format != InternalFormat::Unknown)
+	if (description.Width * description.Height > 0 && description.Format != InternalFormat::Unknown)
 	{
-		glTextureStorage2D(_handle, 1, *_description.Format, _description.Width, _description.Height);
+		glTextureStorage2D(handle, GetStorageLevels(description), *description.Format, description.Width, description.Height);
 
-		glTextureParameteri(_handle, GL_TEXTURE_WRAP_S, (GLenum)_description.HorizontalWrap);
-		glTextureParameteri(_handle, GL_TEXTURE_WRAP_T, (GLenum)_description.VerticalWrap);
-		glTextureParameteri(_handle, GL_TEXTURE_MIN_FILTER, (GLenum)_description.MinificationFilter);
-		glTextureParameteri(_handle, GL_TEXTURE_MAG_FILTER, (GLenum)_description.MagnificationFilter);
-		glTextureParameterf(_handle, GL_TEXTURE_MAX_ANISOTROPY, _description.MaxAnisotropic);
+		glTextureParameteri(handle, GL_TEXTURE_WRAP_S, (GLenum)description.HorizontalWrap);
+		glTextureParameteri(handle, GL_TEXTURE_WRAP_T, (GLenum)description.VerticalWrap);
+		glTextureParameteri(handle, GL_TEXTURE_MIN_FILTER, (GLenum)description.MinificationFilter);
+		glTextureParameteri(handle, GL_TEXTURE_MAG_FILTER, (GLenum)description.MagnificationFilter);
+		glTextureParameterf(handle, GL_TEXTURE_MAX_ANISOTROPY, description.MaxAnisotropic);
+	}
+	return handle;
+}
+
+void Texture2D::_AdoptStorage(GLuint handle, const Texture2DDescription& description) {
+	if (_handle != 0) {
+		GLStateCache::DeleteTextures(1, &_handle);
 	}
+	_handle = handle;
+	_description.Width = description.Width;
+	_description.Height = description.Height;
+	_description.Format = description.Format;
+	_description.MipLevels = description.MipLevels;
+
+	// The sampling settings may have been changed while the new texture was being built
+	glTextureParameteri(_handle, GL_TEXTURE_WRAP_S, (GLenum)_description.HorizontalWrap);
+	glTextureParameteri(_handle, GL_TEXTURE_WRAP_T, (GLenum)_description.VerticalWrap);
+	glTextureParameteri(_handle, GL_TEXTURE_MIN_FILTER, (GLenum)_description.MinificationFilter);
+	glTextureParameteri(_handle, GL_TEXTURE_MAG_FILTER, (GLenum)_description.MagnificationFilter);
+	glTextureParameterf(_handle, GL_TEXTURE_MAX_ANISOTROPY, _description.MaxAnisotropic);
 }
 
 void Texture2D::LoadData(const Texture2DData::sptr& data) {
+	// Compressed data can't be converted on upload, so the texture needs to be in the same format
+	bool formatChanged = data->IsCompressed() && _description.Format != data->GetRecommendedFormat();
+	Texture2DDescription target = _description;
+	target.MipLevels = _GetUploadLevels(_description, data);
+	bool levelsChanged = GetStorageLevels(target) != GetStorageLevels(_description);
 	if (_description.Width != data->GetWidth() ||
-		_description.Height != data->GetHeight()) 
+		_description.Height != data->GetHeight() ||
+		formatChanged || levelsChanged) 
 	{
 		_description.Width = data->GetWidth();
 		_description.Height = data->GetHeight();
 		
-		if (_description.Format == InternalFormat::Unknown) {
+		if (_description.Format == InternalFormat::Unknown || formatChanged) {
 			_description.Format = data->GetRecommendedFormat();
 		}
+		_description.MipLevels = target.MipLevels;
 		
 		_RecreateTexture();
 	}
@@ -50,25 +113,59 @@ void Texture2D::LoadData(const Texture2DData::sptr& data) {
 		glObjectLabel(GL_TEXTURE, _handle, data->DebugName.length(), data->DebugName.c_str());
 	}
 	
-	// Align the data store to the size of a single component in
+	if (data->IsCompressed()) {
+		// Compressed data is uploaded as-is, one level at a time
+		for (uint32_t ix = 0; ix < data->GetLevelCount(); ix++) {
+			const MipLevel& level = data->GetLevel(ix);
+			glCompressedTextureSubImage2D(_handle, ix, 0, 0, level.Width, level.Height, *_description.Format, (GLsizei)level.Size, data->GetLevelDataPtr(ix));
+		}
+		return;
+	}
+
+	// Align the data store to the size of a single component in, smaller mip levels are rarely a multiple of 4 bytes wide
 	// See https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glPixelStore.xhtml
 	int componentSize = (GLint)GetTexelComponentSize(data->GetPixelType());
-	glPixelStorei(GL_PACK_ALIGNMENT, componentSize);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, componentSize);
 
 	// Upload our data to our image
-	glTextureSubImage2D(_handle, 0, 0, 0, _description.Width, _description.Height, *data->GetFormat(), *data->GetPixelType(), data->GetDataPtr());
+	for (uint32_t ix = 0; ix < data->GetLevelCount(); ix++) {
+		const MipLevel& level = data->GetLevel(ix);
+		glTextureSubImage2D(_handle, ix, 0, 0, level.Width, level.Height, *data->GetFormat(), *data->GetPixelType(), data->GetLevelDataPtr(ix));
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-	if (_description.GenerateMipMaps) {
+	// If the data came with it's own mip chain we've already uploaded it
+	if (_description.GenerateMipMaps && data->GetLevelCount() == 1) {
 		glGenerateTextureMipmap(_handle);
 	}
 }
 
 Texture2D::sptr Texture2D::LoadFromFile(const std::string& path) {
-	Texture2DData::sptr data = Texture2DData::LoadFromFile(path);
-	LOG_ASSERT(data != nullptr, "Failed to load image from file!");
-	Texture2D::sptr result = Texture2D::Create();
-	result->LoadData(data);
-	return result;
+	return ResourceCache::Load<Texture2D>(ResourceCache::MakeKey(path, "Texture2D"), [&]() {
+		// Picks up the cooked copy of the image if there's an up to date one
+		Texture2DData::sptr data = TextureCooker::LoadData(path);
+		LOG_ASSERT(data != nullptr, "Failed to load image from file!");
+		Texture2D::sptr result = Texture2D::Create();
+		result->LoadData(data);
+		return result;
+	});
+}
+
+Texture2D::sptr Texture2D::LoadFromFileAsync(const std::string& path) {
+	const TextureLoader::sptr& loader = TextureLoader::GetDefault();
+	if (loader == nullptr) {
+		return LoadFromFile(path);
+	}
+	// A texture from LoadFromFile is already complete, so we can hand it out here too. The reverse doesn't hold, since
+	// LoadFromFile has to return a texture that's ready, so textures that may still be loading get a key of their own
+	const ResourceCache::sptr& cache = ResourceCache::GetDefault();
+	if (cache != nullptr) {
+		Texture2D::sptr loaded = cache->Find<Texture2D>(ResourceCache::MakeKey(path, "Texture2D"));
+		if (loaded != nullptr) {
+			return loaded;
+		}
+	}
+	return ResourceCache::Load<Texture2D>(ResourceCache::MakeKey(path, "Texture2D|Async"), [&]() { return loader->Load(path); });
 }
 
 void Texture2D::SetMinFilter(MinFilter filter) {
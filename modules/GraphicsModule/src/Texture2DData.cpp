@@ -1,8 +1,13 @@
 #include "Texture2DData.h"
 
+#include <algorithm>
+#include <cmath>
 #include <filesystem>
 #include <stb_image.h>
 
+#include "ParallelFor.h"
+#include "TextureContainer.h"
+
 Texture2DData::Texture2DData(uint32_t width, uint32_t height, PixelFormat format, PixelType type, void* sourceData, InternalFormat recommendedFormat) :
 	_width(width), _height(height), _format(format), _type(type), _data(nullptr), _recommendedFormat(recommendedFormat)
 {
@@ -13,6 +18,33 @@ Texture2DData::Texture2DData(uint32_t width, uint32_t height, PixelFormat format
 	if (sourceData != nullptr) {
 		memcpy(_data, sourceData, _dataSize);
 	}
+	_levels.push_back({ width, height, 0, _dataSize });
+}
+
+Texture2DData::Texture2DData(uint32_t width, uint32_t height, InternalFormat compressedFormat, const std::vector<MipLevel>& levels, const void* sourceData) :
+	Texture2DData(width, height, compressedFormat == InternalFormat::BC5 ? PixelFormat::RG : PixelFormat::RGBA, PixelType::UByte, compressedFormat, levels, sourceData)
+{
+	LOG_ASSERT(IsCompressedFormat(compressedFormat), "Format {} is not a compressed format!", compressedFormat);
+}
+
+Texture2DData::Texture2DData(uint32_t width, uint32_t height, PixelFormat format, PixelType type, InternalFormat recommendedFormat, const std::vector<MipLevel>& levels, const void* sourceData) :
+	_width(width), _height(height), _format(format), _type(type), _data(nullptr), _recommendedFormat(recommendedFormat), _levels(levels)
+{
+	LOG_ASSERT(!levels.empty(), "Texture data needs at least one level!");
+	_dataSize = levels.back().Offset + levels.back().Size;
+	_data = malloc(_dataSize);
+	LOG_ASSERT(_data != nullptr, "Failed to allocate texture data!");
+	if (sourceData != nullptr) {
+		memcpy(_data, sourceData, _dataSize);
+	}
+}
+
+Texture2DData::Texture2DData(AdoptTag, uint32_t width, uint32_t height, PixelFormat format, PixelType type, void* ownedData, InternalFormat recommendedFormat) :
+	_width(width), _height(height), _format(format), _type(type), _data(ownedData), _recommendedFormat(recommendedFormat)
+{
+	LOG_ASSERT(ownedData != nullptr, "Cannot adopt a null buffer!");
+	_dataSize = width * (size_t)height * GetTexelSize(_format, _type);
+	_levels.push_back({ width, height, 0, _dataSize });
 }
 
 Texture2DData::~Texture2DData() {
@@ -21,11 +53,28 @@ Texture2DData::~Texture2DData() {
 
 Texture2DData::sptr Texture2DData::LoadFromFile(const std::string& file, bool forceRgba)
 {
+	// Compressed images come from containers that already hold the whole mip chain
+	if (TextureContainer::IsContainerFile(file)) {
+		TextureContainer::sptr container = TextureContainer::LoadFromFile(file);
+		if (container == nullptr) {
+			return nullptr;
+		}
+		if (container->FaceCount != 1) {
+			LOG_WARN("\"{}\" is a cubemap, load it with TextureCubeMapData instead", file);
+			return nullptr;
+		}
+		const MipLevel& base = container->Levels[0];
+		Texture2DData::sptr result = std::make_shared<Texture2DData>(base.Width, base.Height, container->Format, container->Levels, container->Data.data());
+		result->DebugName = std::filesystem::path(file).filename().string();
+		return result;
+	}
+
 	// Variables that will store properties about our image
 	int width, height, numChannels;
 	const int targetChannels = forceRgba ? 4 : 0;
 
-	// Use STBI to load the image
+	// Use STBI to load the image. Note that the flip flag is global in this version of STBI, this may be called from
+	// TextureLoader's worker threads, so everything that loads images must agree on it
 	stbi_set_flip_vertically_on_load(true);
 	uint8_t* data = stbi_load(file.c_str(), &width, &height, &numChannels, targetChannels);
 
@@ -71,13 +120,249 @@ Texture2DData::sptr Texture2DData::LoadFromFile(const std::string& file, bool fo
 		LOG_WARN("The alignment of a horizontal line is not a multiple of 4, this will require a call to glPixelStorei(GL_PACK_ALIGNMENT)");
 	}
 
-	// Create the result and store our image data in it
+	// Create the result and hand it STBI's data, STBI allocates with malloc so we can free it the same way we would our own
 	// Note that stbi will always give us an array of unsigned bytes (uint8_t)
-	Texture2DData::sptr result = std::make_shared<Texture2DData>(width, height, image_format, PixelType::UByte, data, internal_format);
+	Texture2DData::sptr result = Texture2DData::sptr(new Texture2DData(AdoptTag(), width, height, image_format, PixelType::UByte, data, internal_format));
 	result->DebugName = std::filesystem::path(file).filename().string();
-	
-	// We now have a copy in our ptr, we can free STBI's copy of it
-	stbi_image_free(data);
 
 	return result;
 }
+
+// Lookup tables for converting between 8 bit sRGB and linear values, so we don't need a pow for every texel
+struct SrgbTables
+{
+	float   Decode[256];
+	// Indexed by the linear value scaled to 16 bits, which is fine enough that the result matches the exact conversion
+	uint8_t Encode[65536];
+
+	SrgbTables() {
+		for (int ix = 0; ix < 256; ix++) {
+			float c = ix / 255.0f;
+			Decode[ix] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (int ix = 0; ix < 65536; ix++) {
+			float c = ix / 65535.0f;
+			c = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+			Encode[ix] = static_cast<uint8_t>(c * 255.0f + 0.5f);
+		}
+	}
+
+	static const SrgbTables& Get() {
+		static SrgbTables tables;
+		return tables;
+	}
+};
+
+// Zeroth order modified Bessel function of the first kind, used by the Kaiser window
+static float BesselI0(float x) {
+	float sum = 1.0f, term = 1.0f;
+	for (int k = 1; k < 16; k++) {
+		term *= (x / (2.0f * k)) * (x / (2.0f * k));
+		sum += term;
+	}
+	return sum;
+}
+
+static float Sinc(float x) {
+	static const float PI = 3.14159265358979f;
+	return x == 0.0f ? 1.0f : sinf(PI * x) / (PI * x);
+}
+
+// The texels of the larger level that contribute to a single texel of the smaller one, along one axis. First is always
+// in the image and there are never more weights than texels left after it, so the filter loops don't need to clamp
+struct MipFilterTaps
+{
+	uint32_t           First;
+	std::vector<float> Weights;
+};
+
+// Works out the filter weights for downsampling one axis from srcSize to dstSize texels. Texels past the edge of the
+// image are clamped to the edge, so their weights are folded into the edge texels
+static std::vector<MipFilterTaps> BuildMipFilterTaps(uint32_t srcSize, uint32_t dstSize, MipFilterType filter) {
+	// Radius of the windowed sinc filters, in texels of the smaller level
+	static const float KAISER_RADIUS  = 2.0f;
+	static const float KAISER_ALPHA   = 4.0f;
+	static const float LANCZOS_RADIUS = 3.0f;
+
+	std::vector<MipFilterTaps> result(dstSize);
+	std::vector<float> weights;
+	const float scale = srcSize / static_cast<float>(dstSize);
+	for (uint32_t ix = 0; ix < dstSize; ix++) {
+		int first;
+		weights.clear();
+		if (filter == MipFilterType::Box || srcSize == dstSize) {
+			// Weight each texel by how much of it falls in the footprint, which handles odd sizes as well
+			float begin = ix * scale, end = (ix + 1) * scale;
+			first = static_cast<int>(begin);
+			for (int src = first; src < static_cast<int>(ceilf(end)); src++) {
+				float overlap = std::min(end, src + 1.0f) - std::max(begin, static_cast<float>(src));
+				weights.push_back(std::max(overlap, 0.0f));
+			}
+		} else {
+			// Distances are measured in texels of the smaller level, so the filter scales with the downsampling ratio
+			const float radius = filter == MipFilterType::Kaiser ? KAISER_RADIUS : LANCZOS_RADIUS;
+			float center = (ix + 0.5f) * scale;
+			first = static_cast<int>(floorf(center - radius * scale));
+			int last = static_cast<int>(ceilf(center + radius * scale));
+			for (int src = first; src <= last; src++) {
+				float x = (src + 0.5f - center) / scale;
+				float t = x / radius;
+				if (t * t >= 1.0f) {
+					weights.push_back(0.0f);
+				} else if (filter == MipFilterType::Kaiser) {
+					weights.push_back(Sinc(x) * BesselI0(KAISER_ALPHA * sqrtf(1.0f - t * t)) / BesselI0(KAISER_ALPHA));
+				} else {
+					weights.push_back(Sinc(x) * Sinc(t));
+				}
+			}
+		}
+
+		// Fold texels that fall off the edges onto the edge texels
+		MipFilterTaps& taps = result[ix];
+		int begin = std::max(first, 0);
+		int end = std::min(first + static_cast<int>(weights.size()), static_cast<int>(srcSize));
+		taps.First = static_cast<uint32_t>(begin);
+		taps.Weights.assign(end - begin, 0.0f);
+		float total = 0.0f;
+		for (size_t tap = 0; tap < weights.size(); tap++) {
+			int src = std::clamp(first + static_cast<int>(tap), begin, end - 1);
+			taps.Weights[src - begin] += weights[tap];
+			total += weights[tap];
+		}
+		for (float& weight : taps.Weights) {
+			weight /= total;
+		}
+	}
+	return result;
+}
+
+// Filters a single row horizontally. This is templated on the channel count so that the inner loops have a fixed
+// length, which lets the compiler unroll them and keep the sums in vector registers
+template <uint32_t Channels>
+static void FilterMipRow(const float* source, float* dest, const std::vector<MipFilterTaps>& taps) {
+	for (size_t x = 0; x < taps.size(); x++) {
+		float sum[Channels] = {};
+		const float* texel = source + taps[x].First * Channels;
+		const float* weights = taps[x].Weights.data();
+		const size_t tapCount = taps[x].Weights.size();
+		for (size_t tap = 0; tap < tapCount; tap++, texel += Channels) {
+			for (uint32_t c = 0; c < Channels; c++) {
+				sum[c] += texel[c] * weights[tap];
+			}
+		}
+		for (uint32_t c = 0; c < Channels; c++) {
+			dest[x * Channels + c] = sum[c];
+		}
+	}
+}
+
+bool Texture2DData::GenerateMipChain(MipFilterType filter, bool srgb) {
+	if (IsCompressed() || _type != PixelType::UByte) {
+		LOG_WARN("Cannot generate mips for \"{}\", only uncompressed 8 bit images are supported", DebugName);
+		return false;
+	}
+
+	const uint32_t channels = static_cast<uint32_t>(GetTexelComponentCount(_format));
+	const uint32_t levelCount = GetFullMipCount(_width, _height);
+	// Only the color channels of color images are sRGB, alpha is always linear
+	const uint32_t srgbChannels = (srgb && channels >= 3) ? 3 : 0;
+	const SrgbTables& tables = SrgbTables::Get();
+
+	// Lay out the whole chain, then copy the first level into it
+	std::vector<MipLevel> levels(levelCount);
+	size_t offset = 0;
+	for (uint32_t ix = 0; ix < levelCount; ix++) {
+		levels[ix].Width = std::max(_width >> ix, 1u);
+		levels[ix].Height = std::max(_height >> ix, 1u);
+		levels[ix].Offset = offset;
+		levels[ix].Size = levels[ix].Width * (size_t)levels[ix].Height * channels;
+		offset += levels[ix].Size;
+	}
+	uint8_t* data = static_cast<uint8_t*>(malloc(offset));
+	LOG_ASSERT(data != nullptr, "Failed to allocate texture data!");
+	memcpy(data, GetLevelDataPtr(0), levels[0].Size);
+
+	// Each level is filtered from the one above it, we keep the previous level around in linear floating point so that
+	// rounding errors don't build up as we go down the chain
+	std::vector<float> current(levels[0].Size);
+	ParallelFor(levels[0].Height, [&](size_t y) {
+		const size_t begin = y * levels[0].Width * channels;
+		const size_t end = begin + levels[0].Width * channels;
+		for (size_t ix = begin; ix < end; ix += channels) {
+			for (uint32_t c = 0; c < channels; c++) {
+				current[ix + c] = c < srgbChannels ? tables.Decode[data[ix + c]] : data[ix + c] * (1.0f / 255.0f);
+			}
+		}
+	});
+
+	std::vector<float> next;
+	for (uint32_t level = 1; level < levelCount; level++) {
+		const MipLevel& src = levels[level - 1];
+		const MipLevel& dst = levels[level];
+		std::vector<MipFilterTaps> horizontal = BuildMipFilterTaps(src.Width, dst.Width, filter);
+		std::vector<MipFilterTaps> vertical = BuildMipFilterTaps(src.Height, dst.Height, filter);
+
+		// Each row of the level is filtered vertically into a row of the larger level's width, which is a weighted sum of
+		// whole rows and vectorizes well, and then filtered horizontally down to the final width
+		next.resize(dst.Size);
+		uint8_t* dstData = data + dst.Offset;
+		ParallelFor(dst.Height, [&](size_t y) {
+			const size_t srcRowSize = src.Width * (size_t)channels;
+			const size_t dstRowSize = dst.Width * (size_t)channels;
+			const MipFilterTaps& taps = vertical[y];
+
+			std::vector<float> column(srcRowSize, 0.0f);
+			for (size_t tap = 0; tap < taps.Weights.size(); tap++) {
+				const float* srcRow = current.data() + (taps.First + tap) * srcRowSize;
+				const float weight = taps.Weights[tap];
+				for (size_t ix = 0; ix < srcRowSize; ix++) {
+					column[ix] += srcRow[ix] * weight;
+				}
+			}
+
+			float* dstRow = next.data() + y * dstRowSize;
+			switch (channels) {
+			case 1: FilterMipRow<1>(column.data(), dstRow, horizontal); break;
+			case 2: FilterMipRow<2>(column.data(), dstRow, horizontal); break;
+			case 3: FilterMipRow<3>(column.data(), dstRow, horizontal); break;
+			case 4: FilterMipRow<4>(column.data(), dstRow, horizontal); break;
+			}
+
+			// Sharper filters ring a little, so clamp before the values get stored
+			uint8_t* dstBytes = dstData + y * dstRowSize;
+			for (size_t ix = 0; ix < dstRowSize; ix += channels) {
+				for (uint32_t c = 0; c < channels; c++) {
+					float value = std::clamp(dstRow[ix + c], 0.0f, 1.0f);
+					dstRow[ix + c] = value;
+					dstBytes[ix + c] = c < srgbChannels ?
+						tables.Encode[static_cast<uint32_t>(value * 65535.0f + 0.5f)] :
+						static_cast<uint8_t>(value * 255.0f + 0.5f);
+				}
+			}
+		});
+		current.swap(next);
+	}
+
+	free(_data);
+	_data = data;
+	_dataSize = offset;
+	_levels = std::move(levels);
+	return true;
+}
+
+void Texture2DData::FlipVertically() {
+	LOG_ASSERT(!IsCompressed(), "Cannot flip block compressed data!");
+	std::vector<uint8_t> temp;
+	for (const MipLevel& level : _levels) {
+		const size_t rowSize = level.Size / level.Height;
+		uint8_t* data = static_cast<uint8_t*>(_data) + level.Offset;
+		temp.resize(rowSize);
+		for (uint32_t y = 0; y < level.Height / 2; y++) {
+			uint8_t* top = data + y * rowSize;
+			uint8_t* bottom = data + (level.Height - 1 - y) * rowSize;
+			memcpy(temp.data(), top, rowSize);
+			memcpy(top, bottom, rowSize);
+			memcpy(bottom, temp.data(), rowSize);
+		}
+	}
+}
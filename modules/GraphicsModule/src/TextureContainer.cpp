@@ -0,0 +1,277 @@
+#include "TextureContainer.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#define MAKE_FOURCC(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+// See https://docs.microsoft.com/en-us/windows/win32/direct3ddds/dds-header
+struct DdsPixelFormat
+{
+	uint32_t Size;
+	uint32_t Flags;
+	uint32_t FourCC;
+	uint32_t RGBBitCount;
+	uint32_t RBitMask, GBitMask, BBitMask, ABitMask;
+};
+
+struct DdsHeader
+{
+	uint32_t       Size;
+	uint32_t       Flags;
+	uint32_t       Height;
+	uint32_t       Width;
+	uint32_t       PitchOrLinearSize;
+	uint32_t       Depth;
+	uint32_t       MipMapCount;
+	uint32_t       Reserved1[11];
+	DdsPixelFormat PixelFormat;
+	uint32_t       Caps, Caps2, Caps3, Caps4;
+	uint32_t       Reserved2;
+};
+static_assert(sizeof(DdsHeader) == 124, "DDS header must be 124 bytes");
+
+// Follows the regular header when the four CC is DX10, and lets the file use any DXGI format
+struct DdsHeaderDx10
+{
+	uint32_t DxgiFormat;
+	uint32_t ResourceDimension;
+	uint32_t MiscFlag;
+	uint32_t ArraySize;
+	uint32_t MiscFlags2;
+};
+
+static const uint32_t DDS_MAGIC              = MAKE_FOURCC('D', 'D', 'S', ' ');
+static const uint32_t DDPF_FOURCC            = 0x4;
+static const uint32_t DDSD_MIPMAPCOUNT       = 0x20000;
+static const uint32_t DDSCAPS2_CUBEMAP       = 0x200;
+static const uint32_t DDSCAPS2_ALL_FACES     = 0xFC00;
+static const uint32_t DDS_MISC_TEXTURECUBE   = 0x4;
+
+// The KTX2 file identifier, see https://github.khronos.org/KTX-Specification/
+static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+static const size_t  KTX2_HEADER_SIZE = 80;
+static const size_t  KTX2_LEVEL_INDEX_ENTRY_SIZE = 24;
+
+// Reads a value out of a byte array, the caller is responsible for checking that it's in bounds
+template <typename T>
+static T ReadValue(const std::vector<uint8_t>& data, size_t offset) {
+	T result;
+	memcpy(&result, data.data() + offset, sizeof(T));
+	return result;
+}
+
+static InternalFormat FormatFromFourCC(uint32_t fourCC) {
+	switch (fourCC) {
+		case MAKE_FOURCC('D', 'X', 'T', '1'): return InternalFormat::BC1;
+		case MAKE_FOURCC('D', 'X', 'T', '5'): return InternalFormat::BC3;
+		case MAKE_FOURCC('A', 'T', 'I', '2'):
+		case MAKE_FOURCC('B', 'C', '5', 'U'): return InternalFormat::BC5;
+		default:                              return InternalFormat::Unknown;
+	}
+}
+
+static InternalFormat FormatFromDxgi(uint32_t format) {
+	switch (format) {
+		case 71: return InternalFormat::BC1;      // DXGI_FORMAT_BC1_UNORM
+		case 72: return InternalFormat::BC1_SRGB; // DXGI_FORMAT_BC1_UNORM_SRGB
+		case 77: return InternalFormat::BC3;      // DXGI_FORMAT_BC3_UNORM
+		case 78: return InternalFormat::BC3_SRGB; // DXGI_FORMAT_BC3_UNORM_SRGB
+		case 83: return InternalFormat::BC5;      // DXGI_FORMAT_BC5_UNORM
+		case 98: return InternalFormat::BC7;      // DXGI_FORMAT_BC7_UNORM
+		case 99: return InternalFormat::BC7_SRGB; // DXGI_FORMAT_BC7_UNORM_SRGB
+		default: return InternalFormat::Unknown;
+	}
+}
+
+static InternalFormat FormatFromVulkan(uint32_t format) {
+	switch (format) {
+		case 131: // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+		case 133: return InternalFormat::BC1;      // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+		case 132: // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+		case 134: return InternalFormat::BC1_SRGB; // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+		case 137: return InternalFormat::BC3;      // VK_FORMAT_BC3_UNORM_BLOCK
+		case 138: return InternalFormat::BC3_SRGB; // VK_FORMAT_BC3_SRGB_BLOCK
+		case 141: return InternalFormat::BC5;      // VK_FORMAT_BC5_UNORM_BLOCK
+		case 145: return InternalFormat::BC7;      // VK_FORMAT_BC7_UNORM_BLOCK
+		case 146: return InternalFormat::BC7_SRGB; // VK_FORMAT_BC7_SRGB_BLOCK
+		default:  return InternalFormat::Unknown;
+	}
+}
+
+// Checks the size and level count from a file header before we lay out the levels, since both come straight from the
+// file and a level count past the full chain would shift the size down to nothing
+static bool IsValidLevelLayout(uint32_t width, uint32_t height, uint32_t levelCount) {
+	return width > 0 && height > 0 && levelCount <= GetFullMipCount(width, height);
+}
+
+static std::string GetLowerExtension(const std::string& path) {
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	return extension;
+}
+
+bool TextureContainer::IsContainerFile(const std::string& path) {
+	std::string extension = GetLowerExtension(path);
+	return extension == ".dds" || extension == ".ktx2";
+}
+
+TextureContainer::sptr TextureContainer::LoadFromFile(const std::string& path) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		LOG_WARN("Failed to open texture container \"{}\"", path);
+		return nullptr;
+	}
+	std::vector<uint8_t> contents(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(contents.data()), contents.size());
+	file.close();
+
+	TextureContainer::sptr result = std::make_shared<TextureContainer>();
+	bool success = GetLowerExtension(path) == ".ktx2" ? _ParseKtx2(contents, *result) : _ParseDds(contents, *result);
+	if (!success) {
+		LOG_WARN("Failed to load texture container \"{}\"", path);
+		return nullptr;
+	}
+	return result;
+}
+
+size_t TextureContainer::_LayoutLevels(uint32_t width, uint32_t height, uint32_t levelCount) {
+	Levels.clear();
+	size_t offset = 0;
+	for (uint32_t level = 0; level < levelCount; level++) {
+		uint32_t levelWidth = std::max(1u, width >> level);
+		uint32_t levelHeight = std::max(1u, height >> level);
+		size_t size = GetCompressedImageSize(Format, levelWidth, levelHeight);
+		Levels.push_back({ levelWidth, levelHeight, offset, size });
+		offset += size * FaceCount;
+	}
+	return offset;
+}
+
+bool TextureContainer::_ParseDds(const std::vector<uint8_t>& file, TextureContainer& result) {
+	if (file.size() < 4 + sizeof(DdsHeader) || ReadValue<uint32_t>(file, 0) != DDS_MAGIC) {
+		LOG_WARN("Not a DDS file");
+		return false;
+	}
+	DdsHeader header = ReadValue<DdsHeader>(file, 4);
+	size_t dataStart = 4 + sizeof(DdsHeader);
+
+	if ((header.PixelFormat.Flags & DDPF_FOURCC) == 0) {
+		LOG_WARN("Uncompressed DDS files are not supported");
+		return false;
+	}
+
+	bool isCube = (header.Caps2 & DDSCAPS2_CUBEMAP) != 0;
+	if (isCube && (header.Caps2 & DDSCAPS2_ALL_FACES) != DDSCAPS2_ALL_FACES) {
+		LOG_WARN("DDS cubemaps must contain all 6 faces");
+		return false;
+	}
+
+	if (header.PixelFormat.FourCC == MAKE_FOURCC('D', 'X', '1', '0')) {
+		if (file.size() < dataStart + sizeof(DdsHeaderDx10)) {
+			LOG_WARN("DDS file is missing it's DX10 header");
+			return false;
+		}
+		DdsHeaderDx10 dx10 = ReadValue<DdsHeaderDx10>(file, dataStart);
+		dataStart += sizeof(DdsHeaderDx10);
+		result.Format = FormatFromDxgi(dx10.DxgiFormat);
+		isCube |= (dx10.MiscFlag & DDS_MISC_TEXTURECUBE) != 0;
+		if (dx10.ArraySize > 1) {
+			LOG_WARN("DDS texture arrays are not supported, only the first element will be loaded");
+		}
+		if (result.Format == InternalFormat::Unknown) {
+			LOG_WARN("Unsupported DXGI format {} in DDS file", dx10.DxgiFormat);
+			return false;
+		}
+	} else {
+		result.Format = FormatFromFourCC(header.PixelFormat.FourCC);
+		if (result.Format == InternalFormat::Unknown) {
+			LOG_WARN("Unsupported four CC 0x{:08X} in DDS file", header.PixelFormat.FourCC);
+			return false;
+		}
+	}
+
+	uint32_t levelCount = (header.Flags & DDSD_MIPMAPCOUNT) != 0 ? std::max(1u, header.MipMapCount) : 1u;
+	if (!IsValidLevelLayout(header.Width, header.Height, levelCount)) {
+		LOG_WARN("DDS file has an invalid size ({}x{}) or level count ({})", header.Width, header.Height, levelCount);
+		return false;
+	}
+	result.FaceCount = isCube ? 6 : 1;
+	size_t totalSize = result._LayoutLevels(header.Width, header.Height, levelCount);
+	if (file.size() - dataStart < totalSize) {
+		LOG_WARN("DDS file is truncated, expected {} bytes of data but found {}", totalSize, file.size() - dataStart);
+		return false;
+	}
+
+	// DDS stores every level of a face before moving on to the next face, we want all the faces of a level together
+	result.Data.resize(totalSize);
+	size_t source = dataStart;
+	for (uint32_t face = 0; face < result.FaceCount; face++) {
+		for (const MipLevel& level : result.Levels) {
+			memcpy(result.Data.data() + level.Offset + face * level.Size, file.data() + source, level.Size);
+			source += level.Size;
+		}
+	}
+	return true;
+}
+
+bool TextureContainer::_ParseKtx2(const std::vector<uint8_t>& file, TextureContainer& result) {
+	if (file.size() < KTX2_HEADER_SIZE || memcmp(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+		LOG_WARN("Not a KTX2 file");
+		return false;
+	}
+	uint32_t vkFormat         = ReadValue<uint32_t>(file, 12);
+	uint32_t width            = ReadValue<uint32_t>(file, 20);
+	uint32_t height           = ReadValue<uint32_t>(file, 24);
+	uint32_t depth            = ReadValue<uint32_t>(file, 28);
+	uint32_t layerCount       = ReadValue<uint32_t>(file, 32);
+	uint32_t faceCount        = ReadValue<uint32_t>(file, 36);
+	uint32_t levelCount       = ReadValue<uint32_t>(file, 40);
+	uint32_t supercompression = ReadValue<uint32_t>(file, 44);
+
+	result.Format = FormatFromVulkan(vkFormat);
+	if (result.Format == InternalFormat::Unknown) {
+		LOG_WARN("Unsupported Vulkan format {} in KTX2 file", vkFormat);
+		return false;
+	}
+	if (supercompression != 0) {
+		LOG_WARN("Supercompressed KTX2 files are not supported");
+		return false;
+	}
+	if (depth > 1 || layerCount > 1 || (faceCount != 1 && faceCount != 6)) {
+		LOG_WARN("Only 2D textures and cubemaps are supported in KTX2 files");
+		return false;
+	}
+
+	// A level count of 0 means that the file only has the base level, and asks the loader to generate the rest
+	levelCount = std::max(1u, levelCount);
+	if (!IsValidLevelLayout(width, height, levelCount)) {
+		LOG_WARN("KTX2 file has an invalid size ({}x{}) or level count ({})", width, height, levelCount);
+		return false;
+	}
+	if (file.size() < KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_INDEX_ENTRY_SIZE) {
+		LOG_WARN("KTX2 file is truncated");
+		return false;
+	}
+
+	result.FaceCount = faceCount;
+	size_t totalSize = result._LayoutLevels(width, height, levelCount);
+	result.Data.resize(totalSize);
+
+	// The level index gives us where each level is, all the faces of a level are already stored together
+	for (uint32_t ix = 0; ix < levelCount; ix++) {
+		size_t entry = KTX2_HEADER_SIZE + ix * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+		uint64_t byteOffset = ReadValue<uint64_t>(file, entry);
+		uint64_t byteLength = ReadValue<uint64_t>(file, entry + 8);
+		const MipLevel& level = result.Levels[ix];
+		if (byteLength != level.Size * faceCount || byteOffset > file.size() || file.size() - byteOffset < byteLength) {
+			LOG_WARN("Level {} of KTX2 file has an invalid size or offset", ix);
+			return false;
+		}
+		memcpy(result.Data.data() + level.Offset, file.data() + byteOffset, static_cast<size_t>(byteLength));
+	}
+	return true;
+}
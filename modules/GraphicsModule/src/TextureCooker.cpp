@@ -0,0 +1,256 @@
+#include "TextureCooker.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <gzip/compress.hpp>
+#include <gzip/decompress.hpp>
+
+#include "BlockCompressor.h"
+#include "HashUtils.h"
+#include "Logging.h"
+
+TextureCooker::sptr TextureCooker::_default = nullptr;
+
+// Written at the start of every cooked texture, followed by a MipLevel for every level and then the gzipped image data
+struct CookedTextureHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t Key;
+	uint32_t Width;
+	uint32_t Height;
+	uint32_t Format;
+	uint32_t Type;
+	uint32_t RecommendedFormat;
+	uint32_t LevelCount;
+	// The size of the image data before and after it was compressed
+	uint64_t DataSize;
+	uint64_t PackedSize;
+};
+static const uint32_t COOKED_TEXTURE_MAGIC   = 0x5845544F; // "OTEX"
+// Bump this whenever the processing changes, so that old cooked files are re-cooked
+static const uint32_t COOKED_TEXTURE_VERSION = 2;
+
+static bool ReadWholeFile(const std::string& path, std::vector<char>& result) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file) {
+		return false;
+	}
+	result.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(result.data(), result.size());
+	return static_cast<bool>(file);
+}
+
+TextureCooker::TextureCooker(const std::string& directory, const Settings& settings) :
+	_directory(directory),
+	_settings(settings)
+{
+	std::error_code error;
+	std::filesystem::create_directories(_directory, error);
+	if (error) {
+		LOG_WARN("Failed to create texture cache directory \"{}\": {}", _directory, error.message());
+	}
+}
+
+uint64_t TextureCooker::ComputeKey(const void* source, size_t size) const {
+	uint64_t hash = HashFnv1a64(&COOKED_TEXTURE_VERSION, sizeof(uint32_t));
+	hash = HashFnv1a64(source, size, hash);
+	// Hash the settings one at a time, so that padding in the struct doesn't end up in the key
+	uint8_t settings[] = {
+		_settings.FlipVertically,
+		_settings.GenerateMips,
+		static_cast<uint8_t>(_settings.MipFilter),
+		_settings.SRGB,
+		_settings.Compress
+	};
+	return HashFnv1a64(settings, sizeof(settings), hash);
+}
+
+bool TextureCooker::Cook(const std::string& path, bool force) {
+	std::vector<char> source;
+	if (!ReadWholeFile(path, source)) {
+		LOG_WARN("Failed to read image \"{}\"", path);
+		return false;
+	}
+	uint64_t key = ComputeKey(source.data(), source.size());
+	if (!force && std::filesystem::exists(_GetPath(key))) {
+		return true;
+	}
+
+	Texture2DData::sptr data = Texture2DData::LoadFromFile(path);
+	if (data == nullptr) {
+		return false;
+	}
+
+	// Containers are already compressed with their own mip chains, all we can do for them is store them
+	if (!data->IsCompressed()) {
+		// Texture2DData always loads images bottom row first
+		if (!_settings.FlipVertically) {
+			data->FlipVertically();
+		}
+		if (_settings.GenerateMips) {
+			data->GenerateMipChain(_settings.MipFilter, _settings.SRGB);
+		}
+		if (_settings.Compress) {
+			Texture2DData::sptr compressed = BlockCompressor::Compress(data);
+			if (compressed != nullptr) {
+				data = compressed;
+			} else {
+				LOG_INFO("\"{}\" is in a format we can't block compress, it will be stored uncompressed", path);
+			}
+		}
+	}
+
+	return _Write(data, key);
+}
+
+bool TextureCooker::_Write(const Texture2DData::sptr& data, uint64_t key) const {
+	std::string packed;
+	try {
+		packed = gzip::compress(static_cast<const char*>(data->GetDataPtr()), data->GetDataSize());
+	}
+	catch (const std::exception& e) {
+		LOG_WARN("Failed to compress \"{}\": {}", data->DebugName, e.what());
+		return false;
+	}
+
+	CookedTextureHeader header;
+	header.Magic = COOKED_TEXTURE_MAGIC;
+	header.Version = COOKED_TEXTURE_VERSION;
+	header.Key = key;
+	header.Width = data->GetWidth();
+	header.Height = data->GetHeight();
+	header.Format = *data->GetFormat();
+	header.Type = *data->GetPixelType();
+	header.RecommendedFormat = *data->GetRecommendedFormat();
+	header.LevelCount = data->GetLevelCount();
+	header.DataSize = data->GetDataSize();
+	header.PackedSize = packed.size();
+
+	// Write to a temporary file first, so that a cooker that gets interrupted never leaves a partial file behind
+	std::string path = _GetPath(key);
+	std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			LOG_WARN("Failed to write cooked texture \"{}\"", path);
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(CookedTextureHeader));
+		for (uint32_t ix = 0; ix < data->GetLevelCount(); ix++) {
+			file.write(reinterpret_cast<const char*>(&data->GetLevel(ix)), sizeof(MipLevel));
+		}
+		file.write(packed.data(), packed.size());
+	}
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+	if (error) {
+		LOG_WARN("Failed to write cooked texture \"{}\": {}", path, error.message());
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
+
+Texture2DData::sptr TextureCooker::TryLoad(const std::string& path) const {
+	std::vector<char> source;
+	if (!ReadWholeFile(path, source)) {
+		return nullptr;
+	}
+	uint64_t key = ComputeKey(source.data(), source.size());
+	std::string cookedPath = _GetPath(key);
+	std::ifstream file(cookedPath, std::ios::binary);
+	if (!file) {
+		return nullptr;
+	}
+
+	CookedTextureHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(CookedTextureHeader));
+	if (!file || header.Magic != COOKED_TEXTURE_MAGIC || header.Version != COOKED_TEXTURE_VERSION || header.Key != key ||
+		header.Width == 0 || header.Height == 0 || header.LevelCount == 0 || header.LevelCount > GetFullMipCount(header.Width, header.Height) ||
+		!IsValidPixelFormat(static_cast<GLint>(header.Format)) || !IsValidPixelType(static_cast<GLint>(header.Type)) ||
+		!IsValidInternalFormat(static_cast<GLint>(header.RecommendedFormat)))
+	{
+		LOG_WARN("Ignoring invalid cooked texture \"{}\"", cookedPath);
+		return nullptr;
+	}
+	std::vector<MipLevel> levels(header.LevelCount);
+	file.read(reinterpret_cast<char*>(levels.data()), header.LevelCount * sizeof(MipLevel));
+	if (!file) {
+		LOG_WARN("Cooked texture \"{}\" is truncated", cookedPath);
+		return nullptr;
+	}
+
+	// Every level needs to be the right size for it's place in the chain, hold exactly the bytes those dimensions
+	// need, and lie inside the data after the level before it, otherwise a corrupt file would have us reading past
+	// the end of the image
+	PixelFormat format = static_cast<PixelFormat>(header.Format);
+	PixelType type = static_cast<PixelType>(header.Type);
+	InternalFormat recommendedFormat = static_cast<InternalFormat>(header.RecommendedFormat);
+	size_t levelEnd = 0;
+	for (uint32_t ix = 0; ix < header.LevelCount; ix++) {
+		const MipLevel& level = levels[ix];
+		size_t expectedSize = IsCompressedFormat(recommendedFormat) ?
+			GetCompressedImageSize(recommendedFormat, level.Width, level.Height) :
+			level.Width * (size_t)level.Height * GetTexelSize(format, type);
+		if (level.Width != std::max(header.Width >> ix, 1u) || level.Height != std::max(header.Height >> ix, 1u) ||
+			level.Size != expectedSize || level.Offset < levelEnd || level.Size > header.DataSize || level.Offset > header.DataSize - level.Size)
+		{
+			LOG_WARN("Cooked texture \"{}\" has an invalid mip level", cookedPath);
+			return nullptr;
+		}
+		levelEnd = level.Offset + level.Size;
+	}
+
+	// Make sure the packed data is actually there before we allocate room for it
+	std::error_code error;
+	uintmax_t fileSize = std::filesystem::file_size(cookedPath, error);
+	size_t dataStart = sizeof(CookedTextureHeader) + header.LevelCount * sizeof(MipLevel);
+	if (error || fileSize < dataStart || header.PackedSize > fileSize - dataStart) {
+		LOG_WARN("Cooked texture \"{}\" is truncated", cookedPath);
+		return nullptr;
+	}
+	std::vector<char> packed(header.PackedSize);
+	file.read(packed.data(), packed.size());
+	if (!file) {
+		LOG_WARN("Cooked texture \"{}\" is truncated", cookedPath);
+		return nullptr;
+	}
+
+	std::vector<char> data;
+	try {
+		// The decompressor grows it's output by twice the input size at a time, so it's limit needs some headroom
+		gzip::Decompressor(header.DataSize + 2 * header.PackedSize).decompress(data, packed.data(), packed.size());
+	}
+	catch (const std::exception& e) {
+		LOG_WARN("Failed to decompress cooked texture \"{}\": {}", cookedPath, e.what());
+		return nullptr;
+	}
+	if (data.size() != header.DataSize || levelEnd != header.DataSize) {
+		LOG_WARN("Cooked texture \"{}\" does not match it's header", cookedPath);
+		return nullptr;
+	}
+
+	Texture2DData::sptr result = std::make_shared<Texture2DData>(header.Width, header.Height, format, type, recommendedFormat, levels, data.data());
+	result->DebugName = std::filesystem::path(path).filename().string();
+	return result;
+}
+
+Texture2DData::sptr TextureCooker::LoadData(const std::string& path) {
+	if (_default != nullptr) {
+		Texture2DData::sptr result = _default->TryLoad(path);
+		if (result != nullptr) {
+			return result;
+		}
+	}
+	return Texture2DData::LoadFromFile(path);
+}
+
+std::string TextureCooker::_GetPath(uint64_t key) const {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx%s", static_cast<unsigned long long>(key), FILE_EXTENSION);
+	return _directory + "/" + name;
+}
@@ -1,4 +1,7 @@
 #include "TextureCubeMap.h"
+#include <algorithm>
+#include "GLStateCache.h"
+#include "ResourceCache.h"
 
 TextureCubeMap::TextureCubeMap(const TextureCubeDesc& description) :
 	ITexture(), _description(description)
@@ -7,9 +10,34 @@ TextureCubeMap::TextureCubeMap(const TextureCubeDesc& description) :
 	_RecreateTexture();
 }
 
+uint32_t TextureCubeMap::GetStorageLevels(const TextureCubeDesc& description) {
+	uint32_t fullCount = GetFullMipCount(description.Size, description.Size);
+	if (description.MipLevels == 0) {
+		return description.GenerateMipMaps ? fullCount : 1;
+	}
+	return std::min(description.MipLevels, fullCount);
+}
+
+uint32_t TextureCubeMap::_GetUploadLevels(const TextureCubeDesc& description, const TextureCubeMapData::sptr& data) {
+	// Same as Texture2D, only uncompressed single level faces get their chain generated on the GPU
+	if (data->GetLevelCount() > 1 || data->IsCompressed() || !description.GenerateMipMaps) {
+		return data->GetLevelCount();
+	}
+	return description.MipLevels;
+}
+
+size_t TextureCubeMap::GetDataSize() const {
+	size_t result = 0;
+	for (uint32_t ix = 0; ix < GetLevelCount(); ix++) {
+		uint32_t size = std::max(_description.Size >> ix, 1u);
+		result += GetImageSize(_description.Format, size, size) * 6;
+	}
+	return result;
+}
+
 void TextureCubeMap::_RecreateTexture() {
 	if (_handle != 0) {
-		glDeleteTextures(1, &_handle);
+		GLStateCache::DeleteTextures(1, &_handle);
 		_handle = 0;
 	}
 
@@ -17,7 +45,7 @@ void TextureCubeMap::_RecreateTexture() {
 
 	if (_description.Size > 0 && _description.Format != InternalFormat::Unknown)
 	{
-		glTextureStorage2D(_handle, 1, *_description.Format, _description.Size, _description.Size);
+		glTextureStorage2D(_handle, GetStorageLevels(_description), *_description.Format, _description.Size, _description.Size);
 
 		glTextureParameteri(_handle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 		glTextureParameteri(_handle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -27,13 +55,19 @@ void TextureCubeMap::_RecreateTexture() {
 }
 
 void TextureCubeMap::LoadData(const TextureCubeMapData::sptr& data) {
-	if (_description.Size != data->GetSize())
+	// Compressed data can't be converted on upload, so the texture needs to be in the same format
+	bool formatChanged = data->IsCompressed() && _description.Format != data->GetRecommendedFormat();
+	TextureCubeDesc target = _description;
+	target.MipLevels = _GetUploadLevels(_description, data);
+	bool levelsChanged = GetStorageLevels(target) != GetStorageLevels(_description);
+	if (_description.Size != data->GetSize() || formatChanged || levelsChanged)
 	{
 		_description.Size = data->GetSize();
 
-		if (_description.Format == InternalFormat::Unknown) {
+		if (_description.Format == InternalFormat::Unknown || formatChanged) {
 			_description.Format = data->GetRecommendedFormat();
 		}
+		_description.MipLevels = target.MipLevels;
 
 		_RecreateTexture();
 	}
@@ -43,13 +77,23 @@ void TextureCubeMap::LoadData(const TextureCubeMapData::sptr& data) {
 		glObjectLabel(GL_TEXTURE, _handle, data->DebugName.length(), data->DebugName.c_str());
 	}
 
+	if (data->IsCompressed()) {
+		// The faces of each level are stored back to back, so each level is a single upload
+		for (uint32_t ix = 0; ix < data->GetLevelCount(); ix++) {
+			const MipLevel& level = data->GetLevel(ix);
+			glCompressedTextureSubImage3D(_handle, ix, 0, 0, 0, level.Width, level.Height, 6, *_description.Format, (GLsizei)(level.Size * 6), data->GetLevelDataPtr(ix));
+		}
+		return;
+	}
+
 	// Align the data store to the size of a single component in
 	// See https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glPixelStore.xhtml
 	int componentSize = (GLint)GetTexelComponentSize(data->GetPixelType());
-	glPixelStorei(GL_PACK_ALIGNMENT, componentSize);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, componentSize);
 
 	// Upload our data to our image
 	glTextureSubImage3D(_handle, 0, 0, 0, 0, _description.Size, _description.Size, 6, *data->GetFormat(), *data->GetPixelType(), data->GetDataPtr());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
 	if (_description.GenerateMipMaps) {
 		glGenerateTextureMipmap(_handle);
@@ -58,10 +102,23 @@ void TextureCubeMap::LoadData(const TextureCubeMapData::sptr& data) {
 
 TextureCubeMap::sptr TextureCubeMap::LoadFromImages(const std::string& path)
 {
-	TextureCubeMapData::sptr data = TextureCubeMapData::LoadFromImages(path);
-	TextureCubeMap::sptr result = TextureCubeMap::Create();
-	result->LoadData(data);
-	return result;
+	return ResourceCache::Load<TextureCubeMap>(ResourceCache::MakeKey(path, "TextureCubeMap|Images"), [&]() {
+		TextureCubeMapData::sptr data = TextureCubeMapData::LoadFromImages(path);
+		TextureCubeMap::sptr result = TextureCubeMap::Create();
+		result->LoadData(data);
+		return result;
+	});
+}
+
+TextureCubeMap::sptr TextureCubeMap::LoadFromFile(const std::string& path)
+{
+	return ResourceCache::Load<TextureCubeMap>(ResourceCache::MakeKey(path, "TextureCubeMap"), [&]() {
+		TextureCubeMapData::sptr data = TextureCubeMapData::LoadFromFile(path);
+		LOG_ASSERT(data != nullptr, "Failed to load cubemap from file!");
+		TextureCubeMap::sptr result = TextureCubeMap::Create();
+		result->LoadData(data);
+		return result;
+	});
 }
 
 void TextureCubeMap::SetMinFilter(MinFilter filter) {
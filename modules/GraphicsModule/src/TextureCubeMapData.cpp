@@ -1,6 +1,8 @@
 #include "TextureCubeMapData.h"
 #include <filesystem>
 
+#include "TextureContainer.h"
+
 TextureCubeMapData::TextureCubeMapData(uint32_t size, PixelFormat format, PixelType type, void* sourceData, InternalFormat recommendedFormat) :
 	_size(size), _format(format), _type(type), _data(nullptr), _recommendedFormat(recommendedFormat) {
 	LOG_ASSERT(size > 0, "Size must be greater than zero! Got {}", size)
@@ -11,6 +13,23 @@ TextureCubeMapData::TextureCubeMapData(uint32_t size, PixelFormat format, PixelT
 	if (sourceData != nullptr) {
 		memcpy(_data, sourceData, _dataSize);
 	}
+	_levels.push_back({ size, size, 0, _faceDataSize });
+}
+
+TextureCubeMapData::TextureCubeMapData(uint32_t size, InternalFormat compressedFormat, const std::vector<MipLevel>& levels, const void* sourceData) :
+	_size(size), _format(PixelFormat::RGBA), _type(PixelType::UByte), _data(nullptr), _recommendedFormat(compressedFormat), _levels(levels) {
+	LOG_ASSERT(IsCompressedFormat(compressedFormat), "Format {} is not a compressed format!", compressedFormat);
+	LOG_ASSERT(!levels.empty(), "Compressed data needs at least one level!");
+	if (compressedFormat == InternalFormat::BC5) {
+		_format = PixelFormat::RG;
+	}
+	_faceDataSize = levels[0].Size;
+	_dataSize = levels.back().Offset + levels.back().Size * 6;
+	_data = malloc(_dataSize);
+	LOG_ASSERT(_data != nullptr, "Failed to allocate texture data!")
+	if (sourceData != nullptr) {
+		memcpy(_data, sourceData, _dataSize);
+	}
 }
 
 TextureCubeMapData::~TextureCubeMapData() {
@@ -70,7 +89,27 @@ TextureCubeMapData::sptr TextureCubeMapData::LoadFromImages(const std::string& r
 	return CreateFromImages(data);
 }
 
+TextureCubeMapData::sptr TextureCubeMapData::LoadFromFile(const std::string& file) {
+	TextureContainer::sptr container = TextureContainer::LoadFromFile(file);
+	if (container == nullptr) {
+		return nullptr;
+	}
+	if (container->FaceCount != 6) {
+		LOG_WARN("\"{}\" is not a cubemap", file);
+		return nullptr;
+	}
+	const MipLevel& base = container->Levels[0];
+	if (base.Width != base.Height) {
+		LOG_WARN("Cubemap \"{}\" does not have square faces! {}x{}", file, base.Width, base.Height);
+		return nullptr;
+	}
+	TextureCubeMapData::sptr result = std::make_shared<TextureCubeMapData>(base.Width, container->Format, container->Levels, container->Data.data());
+	result->DebugName = std::filesystem::path(file).filename().string();
+	return result;
+}
+
 void TextureCubeMapData::LoadFaceData(const Texture2DData::sptr& data, CubeMapFace face) {
+	LOG_ASSERT(!IsCompressed(), "Faces can't be loaded into compressed cubemap data!");
 	if (data != nullptr) {
 		LOG_ASSERT(data->GetWidth() == data->GetHeight() && data->GetWidth() == _size, "Data is not square or does not match size of cubemap! {}x{} vs {}", data->GetWidth(), data->GetHeight(), _size);
 		LOG_ASSERT(data->GetFormat() == _format, "Data format does not match! {} vs {}", data->GetFormat(), _format);
@@ -0,0 +1,254 @@
+#include "TextureLoader.h"
+#include <algorithm>
+#include <cstring>
+#include "GLStateCache.h"
+#include "Logging.h"
+#include "TextureCooker.h"
+
+TextureLoader::sptr TextureLoader::_default = nullptr;
+
+TextureLoader::TextureLoader(size_t frameBudget, uint32_t workerCount) :
+	_ring(nullptr),
+	_frameBytes(0),
+	_pendingCount(0),
+	_stopping(false)
+{
+	LOG_ASSERT(frameBudget > 0, "Texture loader needs a non-zero upload budget!");
+	// Each frame gets it's own region of the ring, so we never write over rows the GPU is still copying from
+	_ring = StreamingBuffer::Create(GL_PIXEL_UNPACK_BUFFER, frameBudget);
+
+	if (workerCount == 0) {
+		// Leave a core for the main thread
+		uint32_t cores = std::thread::hardware_concurrency();
+		workerCount = cores > 1 ? cores - 1 : 1;
+	}
+	for (uint32_t ix = 0; ix < workerCount; ix++) {
+		_workers.emplace_back(&TextureLoader::_WorkerMain, this);
+	}
+}
+
+TextureLoader::~TextureLoader() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_wake.notify_all();
+	for (std::thread& worker : _workers) {
+		worker.join();
+	}
+
+	// Anything that didn't finish is dropped, the textures keep their placeholders
+	for (Upload& upload : _uploads) {
+		if (upload.Handle != 0) {
+			GLStateCache::DeleteTextures(1, &upload.Handle);
+		}
+	}
+	for (Upload& upload : _inFlight) {
+		glDeleteSync(upload.Fence);
+		GLStateCache::DeleteTextures(1, &upload.Handle);
+	}
+}
+
+Texture2D::sptr TextureLoader::Load(const std::string& path, const glm::vec4& placeholder) {
+	Texture2DDescription desc = Texture2DDescription();
+	desc.Width = 1;
+	desc.Height = 1;
+	desc.Format = InternalFormat::RGBA8;
+	Texture2D::sptr result = Texture2D::Create(desc);
+	result->Clear(placeholder);
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_requests.push_back({ path, result });
+	}
+	_wake.notify_one();
+	_pendingCount++;
+	return result;
+}
+
+void TextureLoader::_WorkerMain() {
+	while (true) {
+		DecodeRequest request;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wake.wait(lock, [this]() { return _stopping || !_requests.empty(); });
+			if (_stopping) {
+				return;
+			}
+			request = std::move(_requests.front());
+			_requests.pop_front();
+		}
+
+		// No point decoding an image for a texture that's already gone
+		Texture2DData::sptr data = nullptr;
+		if (!request.Target.expired()) {
+			data = TextureCooker::LoadData(request.Path);
+		}
+
+		// We still pass failures along, so that the GL thread can keep track of what's pending
+		std::lock_guard<std::mutex> lock(_mutex);
+		_decoded.push_back({ request.Target, data, Texture2DDescription(), 0, 0, 0, nullptr });
+	}
+}
+
+void TextureLoader::Update() {
+	_frameBytes = 0;
+
+	// Swap in the textures that the GPU has finished copying into
+	for (size_t ix = 0; ix < _inFlight.size(); ) {
+		GLenum result = glClientWaitSync(_inFlight[ix].Fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			ix++;
+			continue;
+		}
+		if (result == GL_WAIT_FAILED) {
+			LOG_WARN("Failed to wait on texture upload fence, swapping texture in anyways");
+		}
+		glDeleteSync(_inFlight[ix].Fence);
+		_Finish(_inFlight[ix]);
+		_inFlight[ix] = std::move(_inFlight.back());
+		_inFlight.pop_back();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (Upload& upload : _decoded) {
+			_uploads.push_back(std::move(upload));
+		}
+		_decoded.clear();
+	}
+	if (_uploads.empty()) {
+		return;
+	}
+
+	_ring->BeginFrame();
+	_ring->Bind();
+	// Rows are padded out to 4 bytes in the ring, which is the default unpack alignment
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	while (!_uploads.empty()) {
+		Upload& upload = _uploads.front();
+		// Images that failed to load or were released while decoding just keep their placeholders
+		if (upload.Data == nullptr || upload.Target.expired()) {
+			if (upload.Handle != 0) {
+				GLStateCache::DeleteTextures(1, &upload.Handle);
+			}
+			_pendingCount--;
+			_uploads.pop_front();
+			continue;
+		}
+		if (!_UploadRows(upload)) {
+			break;
+		}
+		_inFlight.push_back(std::move(upload));
+		_uploads.pop_front();
+	}
+	IBuffer::UnBind(GL_PIXEL_UNPACK_BUFFER);
+	_ring->EndFrame();
+}
+
+bool TextureLoader::_UploadRows(Upload& upload) {
+	const Texture2DData::sptr& data = upload.Data;
+
+	// The storage gets created when we start uploading, so that we pick up any sampling settings made in the meantime
+	if (upload.Handle == 0) {
+		upload.Description = upload.Target.lock()->GetDescription();
+		upload.Description.Width = data->GetWidth();
+		upload.Description.Height = data->GetHeight();
+		upload.Description.Format = data->GetRecommendedFormat();
+		upload.Description.MipLevels = Texture2D::_GetUploadLevels(upload.Description, data);
+		upload.Handle = Texture2D::_CreateStorage(upload.Description);
+		upload.Level = 0;
+		upload.RowsUploaded = 0;
+		if (!data->DebugName.empty()) {
+			glObjectLabel(GL_TEXTURE, upload.Handle, static_cast<GLsizei>(data->DebugName.length()), data->DebugName.c_str());
+		}
+	}
+
+	// Compressed images are copied a row of blocks at a time, where each row of blocks covers 4 rows of texels
+	const bool compressed = data->IsCompressed();
+	const uint32_t rowHeight = compressed ? 4 : 1;
+	const GLenum format = *upload.Description.Format;
+
+	while (upload.Level < data->GetLevelCount()) {
+		const MipLevel& level = data->GetLevel(upload.Level);
+		const uint32_t rowCount = (level.Height + rowHeight - 1) / rowHeight;
+		const size_t rowSize = compressed ? level.Size / rowCount : level.Width * GetTexelSize(data->GetFormat(), data->GetPixelType());
+		// Compressed blocks are 8 or 16 bytes, so only uncompressed rows need to be padded out
+		const size_t pitch = (rowSize + 3) & ~(size_t)3;
+		const uint8_t* source = static_cast<const uint8_t*>(data->GetLevelDataPtr(upload.Level));
+
+		if (pitch > _ring->GetFrameSize()) {
+			// A single row would never fit in the budget, so the only way forward is to upload the level in one go
+			LOG_WARN("Rows of \"{}\" are bigger than the texture upload budget, uploading it directly", data->DebugName);
+			IBuffer::UnBind(GL_PIXEL_UNPACK_BUFFER);
+			if (compressed) {
+				glCompressedTextureSubImage2D(upload.Handle, upload.Level, 0, 0, level.Width, level.Height, format, (GLsizei)level.Size, source);
+			} else {
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+				glTextureSubImage2D(upload.Handle, upload.Level, 0, 0, level.Width, level.Height, *data->GetFormat(), *data->GetPixelType(), source);
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			}
+			_ring->Bind();
+			_frameBytes += level.Size;
+			upload.RowsUploaded = rowCount;
+		} else {
+			size_t available = _ring->GetFrameSize() - _ring->GetFrameUsage();
+			uint32_t rows = static_cast<uint32_t>(std::min<size_t>(rowCount - upload.RowsUploaded, available / pitch));
+			if (rows == 0) {
+				return false;
+			}
+			StreamingBuffer::Allocation block = _ring->Allocate(rows * pitch, 4);
+			if (!block.IsValid()) {
+				return false;
+			}
+
+			// Copy the rows into the ring, padding them out if they aren't already aligned
+			const uint8_t* first = source + upload.RowsUploaded * rowSize;
+			uint8_t* dest = static_cast<uint8_t*>(block.Data);
+			if (pitch == rowSize) {
+				memcpy(dest, first, rows * rowSize);
+			} else {
+				for (uint32_t row = 0; row < rows; row++) {
+					memcpy(dest + row * pitch, first + row * rowSize, rowSize);
+				}
+			}
+
+			// With an unpack buffer bound, the pointer is an offset into the buffer and the copy can happen whenever the GPU gets to it
+			uint32_t y = upload.RowsUploaded * rowHeight;
+			uint32_t height = std::min(rows * rowHeight, level.Height - y);
+			const void* offset = reinterpret_cast<const void*>(block.Offset);
+			if (compressed) {
+				glCompressedTextureSubImage2D(upload.Handle, upload.Level, 0, y, level.Width, height, format, (GLsizei)(rows * rowSize), offset);
+			} else {
+				glTextureSubImage2D(upload.Handle, upload.Level, 0, y, level.Width, height, *data->GetFormat(), *data->GetPixelType(), offset);
+			}
+			_frameBytes += block.Size;
+			upload.RowsUploaded += rows;
+		}
+
+		if (upload.RowsUploaded < rowCount) {
+			return false;
+		}
+		upload.Level++;
+		upload.RowsUploaded = 0;
+	}
+
+	// Compressed textures can't have their mips generated, and pre-built mip chains have already been uploaded
+	if (upload.Description.GenerateMipMaps && !compressed && data->GetLevelCount() == 1) {
+		glGenerateTextureMipmap(upload.Handle);
+	}
+	// Everything has been copied out of the CPU side data, so we can release it now rather than when the fence signals
+	upload.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	upload.Data = nullptr;
+	return true;
+}
+
+void TextureLoader::_Finish(Upload& upload) {
+	_pendingCount--;
+	Texture2D::sptr texture = upload.Target.lock();
+	if (texture == nullptr) {
+		GLStateCache::DeleteTextures(1, &upload.Handle);
+		return;
+	}
+	texture->_AdoptStorage(upload.Handle, upload.Description);
+}
@@ -1,22 +1,81 @@
 #include "VertexArrayObject.h"
+#include "GLStateCache.h"
 #include "IndexBuffer.h"
 #include "Logging.h"
 #include "VertexBuffer.h"
 
+IdPool VertexArrayObject::_ids;
+
 VertexArrayObject::VertexArrayObject() :
 	_indexBuffer(nullptr),
 	_handle(0),
-	_vertexCount(0)
+	_id(_ids.Allocate()),
+	_vertexCount(0),
+	_dequantization(glm::mat4(1.0f)),
+	_boundsCenter(glm::vec3(0.0f)),
+	_boundsRadius(0.0f),
+	_source(nullptr),
+	_firstIndex(0),
+	_indexCount(0),
+	_baseVertex(0),
+	_onRelease(nullptr)
 {
 	glCreateVertexArrays(1, &_handle);
 }
 
+VertexArrayObject::VertexArrayObject(const sptr& source, GLuint firstIndex, GLsizei indexCount, GLint baseVertex, GLsizei vertexCount, const std::function<void()>& onRelease) :
+	_indexBuffer(nullptr),
+	_handle(0),
+	_id(_ids.Allocate()),
+	_vertexCount(vertexCount),
+	_dequantization(glm::mat4(1.0f)),
+	_boundsCenter(glm::vec3(0.0f)),
+	_boundsRadius(0.0f),
+	_source(source),
+	_firstIndex(firstIndex),
+	_indexCount(indexCount),
+	_baseVertex(baseVertex),
+	_onRelease(onRelease)
+{
+	LOG_ASSERT(source != nullptr && !source->IsView(), "Views must be created from a VAO that owns it's buffers!");
+	_handle = source->GetHandle();
+}
+
 VertexArrayObject::~VertexArrayObject()
 {
-	if (_handle != 0) {
-		glDeleteVertexArrays(1, &_handle);
+	if (_source != nullptr) {
+		// Views don't own the handle, but may need to hand their range back to whoever allocated it
+		if (_onRelease) {
+			_onRelease();
+		}
+		_handle = 0;
+	}
+	else if (_handle != 0) {
+		GLStateCache::DeleteVertexArrays(1, &_handle);
 		_handle = 0;
 	}
+	_ids.Release(_id);
+}
+
+GLsizei VertexArrayObject::GetIndexCount() const {
+	if (_source != nullptr) {
+		return _indexCount;
+	}
+	return _indexBuffer != nullptr ? _indexBuffer->GetElementCount() : 0;
+}
+
+size_t VertexArrayObject::GetVertexDataSize() const {
+	const VertexArrayObject* owner = _source != nullptr ? _source.get() : this;
+	size_t vertexSize = 0;
+	for (const VertexBufferBinding& binding : owner->_vertexBuffers) {
+		vertexSize += binding.Buffer->GetElementSize();
+	}
+	return vertexSize * _vertexCount;
+}
+
+size_t VertexArrayObject::GetIndexDataSize() const {
+	const IndexBuffer::sptr& indexBuffer = GetIndexBuffer();
+	return indexBuffer != nullptr ? indexBuffer->GetElementSize() * GetIndexCount() : 0;
 }
 
 void VertexArrayObject::SetDebugName(const std::string& name) {
@@ -24,15 +83,14 @@ void VertexArrayObject::SetDebugName(const std::string& name) {
 }
 
 void VertexArrayObject::SetIndexBuffer(const IndexBuffer::sptr& ibo) {
+	LOG_ASSERT(_source == nullptr, "Cannot modify the buffers of a VAO view!");
 	_indexBuffer = ibo;
-	Bind();
-	if (_indexBuffer != nullptr) _indexBuffer->Bind();
-	else IndexBuffer::UnBind();
-	UnBind();
+	glVertexArrayElementBuffer(_handle, _indexBuffer != nullptr ? _indexBuffer->GetHandle() : 0);
 }
 
 void VertexArrayObject::AddVertexBuffer(const VertexBuffer::sptr& buffer, const std::vector<BufferAttribute>& attributes)
 {
+	LOG_ASSERT(_source == nullptr, "Cannot modify the buffers of a VAO view!");
 	if (_vertexCount == 0) {
 		_vertexCount = buffer->GetElementCount();
 	} else {
@@ -47,26 +105,65 @@ void VertexArrayObject::AddVertexBuffer(const VertexBuffer::sptr& buffer, const
 	buffer->Bind();
 	for (const BufferAttribute& attrib : attributes) {
 		glEnableVertexArrayAttrib(_handle, attrib.Slot);
-		glVertexAttribPointer(attrib.Slot, attrib.Size, attrib.Type, attrib.Normalized, attrib.Stride, (void*)attrib.Offset);
+		// Integer data that isn't normalized goes to int/ivec inputs, glVertexAttribPointer would convert it to floats
+		if (attrib.IsInteger()) {
+			glVertexAttribIPointer(attrib.Slot, attrib.Size, attrib.Type, attrib.Stride, (void*)attrib.Offset);
+		} else {
+			glVertexAttribPointer(attrib.Slot, attrib.Size, attrib.Type, attrib.Normalized, attrib.Stride, (void*)attrib.Offset);
+		}
 	}
 	UnBind();
 
 }
 
 void VertexArrayObject::Bind() const {
-	glBindVertexArray(_handle);
+	GLStateCache::BindVertexArray(_handle);
 }
 
 void VertexArrayObject::UnBind() {
-	glBindVertexArray(0);
+	GLStateCache::BindVertexArray(0);
 }
 
 void VertexArrayObject::Render() const {
 	Bind();
-	if (_indexBuffer != nullptr) {
-		glDrawElements(GL_TRIANGLES, _indexBuffer->GetElementCount(), _indexBuffer->GetElementType(), nullptr);
+	const IndexBuffer::sptr& indexBuffer = GetIndexBuffer();
+	if (!_drawRanges.empty() && indexBuffer != nullptr) {
+		// Meshes that were split get a draw per range
+		for (const DrawRange& range : _drawRanges) {
+			const void* offset = (const void*)((_firstIndex + range.FirstIndex) * indexBuffer->GetElementSize());
+			glDrawElementsBaseVertex(GL_TRIANGLES, range.IndexCount, indexBuffer->GetElementType(), offset, _baseVertex + range.BaseVertex);
+		}
+	}
+	else if (_source != nullptr) {
+		// Views draw a sub-range of the shared buffers
+		if (indexBuffer != nullptr) {
+			const void* offset = (const void*)(_firstIndex * indexBuffer->GetElementSize());
+			glDrawElementsBaseVertex(GL_TRIANGLES, _indexCount, indexBuffer->GetElementType(), offset, _baseVertex);
+		} else {
+			glDrawArrays(GL_TRIANGLES, _baseVertex, _vertexCount);
+		}
+	}
+	else if (indexBuffer != nullptr) {
+		glDrawElements(GL_TRIANGLES, indexBuffer->GetElementCount(), indexBuffer->GetElementType(), nullptr);
 	} else {
 		glDrawArrays(GL_TRIANGLES, 0, _vertexCount / 3);
 	}
-	UnBind();
+}
+
+void VertexArrayObject::RenderInstanced(GLsizei instanceCount, GLuint baseInstance) const {
+	Bind();
+	const IndexBuffer::sptr& indexBuffer = GetIndexBuffer();
+	if (!_drawRanges.empty() && indexBuffer != nullptr) {
+		for (const DrawRange& range : _drawRanges) {
+			const void* offset = (const void*)((_firstIndex + range.FirstIndex) * indexBuffer->GetElementSize());
+			glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, range.IndexCount, indexBuffer->GetElementType(), offset, instanceCount, _baseVertex + range.BaseVertex, baseInstance);
+		}
+	}
+	// For VAOs that own their buffers, the first index and base vertex will be 0, so we can use the same path for both
+	else if (indexBuffer != nullptr) {
+		const void* offset = (const void*)(_firstIndex * indexBuffer->GetElementSize());
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, GetIndexCount(), indexBuffer->GetElementType(), offset, instanceCount, _baseVertex, baseInstance);
+	} else {
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLES, _baseVertex, _vertexCount, instanceCount, baseInstance);
+	}
 }
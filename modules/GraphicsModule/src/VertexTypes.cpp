@@ -1,29 +1,84 @@
 #include "VertexTypes.h"
-#pragma warning( push )
-
-VertexPosCol* VPC = nullptr;
-VertexPosNormCol* VPNC = nullptr;
-VertexPosNormTex* VPNT = nullptr;
-VertexPosNormTexCol* VPNTC = nullptr;
+#include <cstring>
+#include <GLM/gtc/packing.hpp>
+#include <GLM/gtc/matrix_transform.hpp>
 
 const std::vector<BufferAttribute> VertexPosCol::V_DECL = {
-	BufferAttribute(0, 3, GL_FLOAT, false, sizeof(VertexPosCol), (size_t)&VPC->Position, AttribUsage::Position),
-	BufferAttribute(1, 4, GL_FLOAT, false, sizeof(VertexPosCol), (size_t)&VPC->Color, AttribUsage::Color),
+	MakeAttribute(0, &VertexPosCol::Position, AttribUsage::Position),
+	MakeAttribute(1, &VertexPosCol::Color, AttribUsage::Color),
 };
 const std::vector<BufferAttribute> VertexPosNormCol::V_DECL = {
-	BufferAttribute(0, 3, GL_FLOAT, false, sizeof(VertexPosNormCol), (size_t)&VPNC->Position, AttribUsage::Position),
-	BufferAttribute(1, 4, GL_FLOAT, false, sizeof(VertexPosNormCol), (size_t)&VPNC->Color, AttribUsage::Color),
-	BufferAttribute(2, 3, GL_FLOAT, false, sizeof(VertexPosNormCol), (size_t)&VPNC->Normal, AttribUsage::Normal),
+	MakeAttribute(0, &VertexPosNormCol::Position, AttribUsage::Position),
+	MakeAttribute(1, &VertexPosNormCol::Color, AttribUsage::Color),
+	MakeAttribute(2, &VertexPosNormCol::Normal, AttribUsage::Normal),
 };
 const std::vector<BufferAttribute> VertexPosNormTex::V_DECL = {
-	BufferAttribute(0, 3, GL_FLOAT, false, sizeof(VertexPosNormTex), (size_t)&VPNT->Position, AttribUsage::Position),
-	BufferAttribute(2, 3, GL_FLOAT, false, sizeof(VertexPosNormTex), (size_t)&VPNT->Normal, AttribUsage::Normal),
-	BufferAttribute(3, 2, GL_FLOAT, false, sizeof(VertexPosNormTex), (size_t)&VPNT->UV, AttribUsage::Texture),
+	MakeAttribute(0, &VertexPosNormTex::Position, AttribUsage::Position),
+	MakeAttribute(2, &VertexPosNormTex::Normal, AttribUsage::Normal),
+	MakeAttribute(3, &VertexPosNormTex::UV, AttribUsage::Texture),
 };
 const std::vector<BufferAttribute> VertexPosNormTexCol::V_DECL = {
-	BufferAttribute(0, 3, GL_FLOAT, false, sizeof(VertexPosNormTexCol), (size_t)&VPNTC->Position, AttribUsage::Position),
-	BufferAttribute(1, 4, GL_FLOAT, false, sizeof(VertexPosNormTexCol), (size_t)&VPNTC->Color, AttribUsage::Color), 
-	BufferAttribute(2, 3, GL_FLOAT, false, sizeof(VertexPosNormTexCol), (size_t)&VPNTC->Normal, AttribUsage::Normal),
-	BufferAttribute(3, 2, GL_FLOAT, false, sizeof(VertexPosNormTexCol), (size_t)&VPNTC->UV, AttribUsage::Texture),
+	MakeAttribute(0, &VertexPosNormTexCol::Position, AttribUsage::Position),
+	MakeAttribute(1, &VertexPosNormTexCol::Color, AttribUsage::Color),
+	MakeAttribute(2, &VertexPosNormTexCol::Normal, AttribUsage::Normal),
+	MakeAttribute(3, &VertexPosNormTexCol::UV, AttribUsage::Texture),
+};
+const std::vector<BufferAttribute> VertexPackedPosNormTexCol::V_DECL = {
+	MakeAttribute(0, &VertexPackedPosNormTexCol::Position, AttribUsage::Position),
+	MakeAttribute(1, &VertexPackedPosNormTexCol::Color, AttribUsage::Color),
+	MakeAttribute(2, &VertexPackedPosNormTexCol::Normal, AttribUsage::Normal),
+	MakeAttribute(3, &VertexPackedPosNormTexCol::UV, AttribUsage::Texture),
+};
+const std::vector<BufferAttribute> VertexHalfPosNormTexCol::V_DECL = {
+	MakeAttribute(0, &VertexHalfPosNormTexCol::Position, AttribUsage::Position),
+	MakeAttribute(1, &VertexHalfPosNormTexCol::Color, AttribUsage::Color),
+	MakeAttribute(2, &VertexHalfPosNormTexCol::Normal, AttribUsage::Normal),
+	MakeAttribute(3, &VertexHalfPosNormTexCol::UV, AttribUsage::Texture),
 };
-#pragma warning(pop)
\ No newline at end of file
+
+static_assert(sizeof(VertexPackedPosNormTexCol) == 20, "Packed vertices should not have any padding!");
+static_assert(sizeof(VertexHalfPosNormTexCol) == 20, "Packed vertices should not have any padding!");
+
+glm::mat4 VertexQuantization::ToMatrix() const {
+	return glm::scale(glm::translate(glm::mat4(1.0f), Center), Extents);
+}
+
+Snorm16x4 PackSnorm16(const glm::vec3& value) {
+	Snorm16x4 result;
+	result.X = (int16_t)glm::packSnorm1x16(value.x);
+	result.Y = (int16_t)glm::packSnorm1x16(value.y);
+	result.Z = (int16_t)glm::packSnorm1x16(value.z);
+	result.W = 0;
+	return result;
+}
+
+Half4 PackHalf(const glm::vec3& value) {
+	Half4 result;
+	result.X = glm::packHalf1x16(value.x);
+	result.Y = glm::packHalf1x16(value.y);
+	result.Z = glm::packHalf1x16(value.z);
+	result.W = 0;
+	return result;
+}
+
+OctNormal16 PackOctahedral(const glm::vec3& normal) {
+	// Project the normal onto the octahedron |x| + |y| + |z| = 1, then fold the lower hemisphere over the upper one
+	glm::vec3 n = normal / glm::max(glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z), 1e-6f);
+	glm::vec2 result = glm::vec2(n.x, n.y);
+	if (n.z < 0.0f) {
+		result = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * glm::vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+	}
+	return { (int16_t)glm::packSnorm1x16(result.x), (int16_t)glm::packSnorm1x16(result.y) };
+}
+
+Unorm16x2 PackUnorm16(const glm::vec2& value) {
+	// Note that unorm can only store [0, 1], so wrapped texture coordinates will be clamped
+	return { glm::packUnorm1x16(value.x), glm::packUnorm1x16(value.y) };
+}
+
+Rgba8 PackRgba8(const glm::vec4& color) {
+	glm::uint32 packed = glm::packUnorm4x8(color);
+	Rgba8 result;
+	memcpy(&result, &packed, sizeof(Rgba8));
+	return result;
+}
@@ -11,6 +11,7 @@ Helpful reference: https://www.khronos.org/files/gltf20-reference-guide.pdf
 
 #include "Mesh.h"
 
+#include <cstdint>
 #include <string>
 
 //Forward declaration of objects defined by the tinyGLTF library.
@@ -31,7 +32,18 @@ namespace nou::GLTF
 	};
 
 	//Loads a 3D model into the mesh object given.
+	//Meshes are cooked into cache/meshes the first time they're loaded, 
+	//so later loads can skip parsing the glTF entirely.
 	void LoadMesh(const std::string& filename, Mesh& mesh, bool flipUVY = true);
+
+	//Computes the key a mesh is cooked under from the contents of the file
+	//(and any external buffers it references) and the load options.
+	bool ComputeCacheKey(const std::string& filename, bool flipUVY, uint64_t& key);
+
+	//Reads and writes cooked meshes. These use the same .otmesh container as
+	//the graphics module's MeshCooker, holding a single interleaved stream.
+	bool LoadCachedMesh(uint64_t key, Mesh& mesh);
+	bool WriteCachedMesh(uint64_t key, const Mesh& mesh);
 	
 	void DumpErrorsAndWarnings(const std::string& filename,
 							   const std::string& err,
@@ -41,6 +41,10 @@ namespace nou
 		void SetNormals(const std::vector<glm::vec3>& normals);
 		void SetUVs(const std::vector<glm::vec2>& uvs);
 
+		const std::vector<glm::vec3>& GetVerts() const { return m_verts; }
+		const std::vector<glm::vec3>& GetNormals() const { return m_normals; }
+		const std::vector<glm::vec2>& GetUVs() const { return m_uvs; }
+
 		//Fetches a vertex buffer associated with the desired attribute.
 		//Used by mesh rendering components to grab the requisite data
 		//associated with this model in OpenGL.
@@ -9,14 +9,62 @@ Helpful reference: https://www.khronos.org/files/gltf20-reference-guide.pdf
 
 #include "NOU/GLTFLoader.h"
 
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <sstream>
 
 #include "tiny_gltf.h"
+#include "json.hpp"
+#include "CookedMesh.h"
+#include "HashUtils.h"
 
 namespace nou::GLTF
 {
+	//AttribUsage values from the graphics module, for tools reading the files.
+	static const uint32_t USAGE_POSITION = 1;
+	static const uint32_t USAGE_TEXTURE = 6;
+	static const uint32_t USAGE_NORMAL = 10;
+
+	static size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	static bool ReadWholeFile(const std::string& filename, std::string& result)
+	{
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
+
+		if (!file)
+			return false;
+
+		result.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(&result[0], result.size());
+
+		return static_cast<bool>(file);
+	}
+
+	static std::string GetCachedMeshPath(uint64_t key)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx%s", static_cast<unsigned long long>(key), COOKED_MESH_EXTENSION);
+		return std::string(COOKED_MESH_DIRECTORY) + "/" + name;
+	}
+
 	void LoadMesh(const std::string& filename, Mesh& mesh, bool flipUVY)
 	{
+		//If we've loaded this file before, we can skip parsing it.
+		uint64_t key = 0;
+		bool hasKey = ComputeCacheKey(filename, flipUVY, key);
+
+		if (hasKey && LoadCachedMesh(key, mesh))
+		{
+			printf("Loaded mesh from %s (cooked).\n", filename.c_str());
+			return;
+		}
+
 		auto gltf = std::make_unique<tinygltf::Model>();
 
 		std::string err, warn;
@@ -37,10 +85,254 @@ namespace nou::GLTF
 			return;
 		}
 
+		if (hasKey)
+			WriteCachedMesh(key, mesh);
+
 		DumpErrorsAndWarnings(filename, err, warn);
 		printf("Loaded mesh from %s.\n", filename.c_str());
 	}
 
+	bool ComputeCacheKey(const std::string& filename, bool flipUVY, uint64_t& key)
+	{
+		std::string source;
+
+		if (!ReadWholeFile(filename, source))
+			return false;
+
+		uint64_t hash = HashFnv1a64(&COOKED_MESH_VERSION, sizeof(uint32_t));
+		hash = HashFnv1a64("nou::GLTF", 9, hash);
+		hash = HashFnv1a64(source.data(), source.size(), hash);
+
+		//.gltf files can keep their buffers in separate files, which need to
+		//be part of the key too. Embedded (data:) buffers are already hashed.
+		if (filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".gltf") == 0)
+		{
+			nlohmann::json doc = nlohmann::json::parse(source, nullptr, false);
+
+			if (!doc.is_discarded() && doc.contains("buffers") && doc["buffers"].is_array())
+			{
+				std::filesystem::path dir = std::filesystem::path(filename).parent_path();
+
+				for (const auto& buffer : doc["buffers"])
+				{
+					if (!buffer.contains("uri") || !buffer["uri"].is_string())
+						continue;
+
+					std::string uri = buffer["uri"].get<std::string>();
+
+					if (uri.rfind("data:", 0) == 0)
+						continue;
+
+					std::string data;
+
+					//If we can't read a buffer, we can't tell if it changed.
+					if (!ReadWholeFile((dir / uri).string(), data))
+						return false;
+
+					hash = HashFnv1a64(data.data(), data.size(), hash);
+				}
+			}
+		}
+
+		unsigned char flip = flipUVY ? 1 : 0;
+		hash = HashFnv1a64(&flip, 1, hash);
+
+		key = hash;
+		return true;
+	}
+
+	bool LoadCachedMesh(uint64_t key, Mesh& mesh)
+	{
+		std::string file;
+
+		if (!ReadWholeFile(GetCachedMeshPath(key), file) || file.size() < sizeof(CookedMeshHeader))
+			return false;
+
+		CookedMeshHeader header;
+		memcpy(&header, file.data(), sizeof(CookedMeshHeader));
+
+		if (header.Magic != COOKED_MESH_MAGIC || header.Version != COOKED_MESH_VERSION ||
+			header.Key != key || header.FileSize != file.size() || header.IndexCount != 0 ||
+			header.VertexCount == 0 || header.AttributeCount == 0 || header.AttributeCount > 3 || header.Stride == 0 ||
+			header.VertexOffset < sizeof(CookedMeshHeader) + header.AttributeCount * sizeof(CookedAttribute) ||
+			header.VertexOffset > file.size() || header.VertexCount > (file.size() - header.VertexOffset) / header.Stride ||
+			!std::isfinite(header.BoundsCenter[0]) || !std::isfinite(header.BoundsCenter[1]) ||
+			!std::isfinite(header.BoundsCenter[2]) || !std::isfinite(header.BoundsRadius) || header.BoundsRadius < 0.0f)
+			return false;
+
+		//We only write position, normal and UV as floats, so anything else
+		//wasn't written by us.
+		std::vector<CookedAttribute> attribs(header.AttributeCount);
+		memcpy(attribs.data(), file.data() + sizeof(CookedMeshHeader), attribs.size() * sizeof(CookedAttribute));
+
+		const CookedAttribute* pos = nullptr;
+		const CookedAttribute* normal = nullptr;
+		const CookedAttribute* uv = nullptr;
+
+		for (const CookedAttribute& attrib : attribs)
+		{
+			if (attrib.Type != GL_FLOAT || attrib.Offset + attrib.Size * sizeof(float) > header.Stride)
+				return false;
+
+			if (attrib.Slot == static_cast<uint32_t>(Mesh::Attrib::POSITION) && attrib.Size == 3)
+				pos = &attrib;
+			else if (attrib.Slot == static_cast<uint32_t>(Mesh::Attrib::NORMAL) && attrib.Size == 3)
+				normal = &attrib;
+			else if (attrib.Slot == static_cast<uint32_t>(Mesh::Attrib::UV) && attrib.Size == 2)
+				uv = &attrib;
+			else
+				return false;
+		}
+
+		if (pos == nullptr)
+			return false;
+
+		//nou::Mesh keeps a copy of each attribute, so the stream gets split back up here.
+		const char* vertex = file.data() + header.VertexOffset;
+		std::vector<glm::vec3> verts(header.VertexCount);
+		std::vector<glm::vec3> normals(normal != nullptr ? header.VertexCount : 0);
+		std::vector<glm::vec2> uvs(uv != nullptr ? header.VertexCount : 0);
+
+		for (size_t i = 0; i < header.VertexCount; ++i, vertex += header.Stride)
+		{
+			memcpy(&verts[i], vertex + pos->Offset, sizeof(glm::vec3));
+
+			if (normal != nullptr)
+				memcpy(&normals[i], vertex + normal->Offset, sizeof(glm::vec3));
+
+			if (uv != nullptr)
+				memcpy(&uvs[i], vertex + uv->Offset, sizeof(glm::vec2));
+		}
+
+		mesh.SetVerts(verts);
+
+		if (normal != nullptr)
+			mesh.SetNormals(normals);
+
+		if (uv != nullptr)
+			mesh.SetUVs(uvs);
+
+		return true;
+	}
+
+	bool WriteCachedMesh(uint64_t key, const Mesh& mesh)
+	{
+		const std::vector<glm::vec3>& verts = mesh.GetVerts();
+		const std::vector<glm::vec3>& normals = mesh.GetNormals();
+		const std::vector<glm::vec2>& uvs = mesh.GetUVs();
+
+		if (verts.empty())
+			return false;
+
+		bool hasNormals = normals.size() == verts.size();
+		bool hasUVs = uvs.size() == verts.size();
+
+		std::vector<CookedAttribute> attribs;
+		uint32_t stride = 0;
+
+		attribs.push_back({ static_cast<uint32_t>(Mesh::Attrib::POSITION), 3, GL_FLOAT, 0, stride, USAGE_POSITION });
+		stride += sizeof(glm::vec3);
+
+		if (hasNormals)
+		{
+			attribs.push_back({ static_cast<uint32_t>(Mesh::Attrib::NORMAL), 3, GL_FLOAT, 0, stride, USAGE_NORMAL });
+			stride += sizeof(glm::vec3);
+		}
+
+		if (hasUVs)
+		{
+			attribs.push_back({ static_cast<uint32_t>(Mesh::Attrib::UV), 2, GL_FLOAT, 0, stride, USAGE_TEXTURE });
+			stride += sizeof(glm::vec2);
+		}
+
+		CookedMeshHeader header = {};
+		header.Magic = COOKED_MESH_MAGIC;
+		header.Version = COOKED_MESH_VERSION;
+		header.Key = key;
+		header.Stride = stride;
+		header.AttributeCount = static_cast<uint32_t>(attribs.size());
+		header.RangeCount = 0;
+		header.IndexType = GL_UNSIGNED_INT;
+		header.VertexCount = verts.size();
+		header.IndexCount = 0;
+
+		//Identity, since we don't quantize anything.
+		for (int i = 0; i < 16; ++i)
+			header.Dequantization[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+
+		//Bounding sphere around the middle of the bounding box.
+		glm::vec3 min = verts[0], max = verts[0];
+
+		for (const glm::vec3& vert : verts)
+		{
+			min = glm::min(min, vert);
+			max = glm::max(max, vert);
+		}
+
+		glm::vec3 center = (min + max) * 0.5f;
+		float radius = 0.0f;
+
+		for (const glm::vec3& vert : verts)
+			radius = glm::max(radius, glm::length(vert - center));
+
+		for (int i = 0; i < 3; ++i)
+			header.BoundsCenter[i] = center[i];
+
+		header.BoundsRadius = radius;
+
+		size_t tableEnd = sizeof(CookedMeshHeader) + attribs.size() * sizeof(CookedAttribute);
+		header.VertexOffset = AlignUp(tableEnd, COOKED_MESH_SECTION_ALIGNMENT);
+		header.IndexOffset = AlignUp(header.VertexOffset + verts.size() * stride, COOKED_MESH_SECTION_ALIGNMENT);
+		header.FileSize = header.IndexOffset;
+
+		std::string file(header.FileSize, '\0');
+		memcpy(&file[0], &header, sizeof(CookedMeshHeader));
+		memcpy(&file[sizeof(CookedMeshHeader)], attribs.data(), attribs.size() * sizeof(CookedAttribute));
+
+		char* vertex = &file[header.VertexOffset];
+
+		for (size_t i = 0; i < verts.size(); ++i, vertex += stride)
+		{
+			size_t offset = 0;
+
+			memcpy(vertex, &verts[i], sizeof(glm::vec3));
+			offset += sizeof(glm::vec3);
+
+			if (hasNormals)
+			{
+				memcpy(vertex + offset, &normals[i], sizeof(glm::vec3));
+				offset += sizeof(glm::vec3);
+			}
+
+			if (hasUVs)
+				memcpy(vertex + offset, &uvs[i], sizeof(glm::vec2));
+		}
+
+		std::error_code error;
+		std::filesystem::create_directories(COOKED_MESH_DIRECTORY, error);
+
+		//Write to a temporary file first so we never leave a partial file behind.
+		std::string path = GetCachedMeshPath(key);
+		std::string tempPath = path + ".tmp";
+
+		{
+			std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+
+			if (!out || !out.write(file.data(), file.size()))
+				return false;
+		}
+
+		std::filesystem::rename(tempPath, path, error);
+
+		if (error)
+		{
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+
+		return true;
+	}
+
 	void DumpErrorsAndWarnings(const std::string& filename,
 							   const std::string& err,
 							   const std::string& warn)
@@ -1,26 +1,54 @@
-#version 410
+#version 420
+
+// TEXTURED samples the diffuse and specular maps, REFLECTION mixes in the environment map based on the reflectivity
+// map. Materials enable these automatically based on the parameters they set
+#pragma multi_compile TEXTURED REFLECTION
+
+#include "uniforms.glsl"
 
 layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec3 inNormal;
+layout(location = 3) in vec2 inUV;
 
-uniform vec3  u_AmbientCol;
-uniform float u_AmbientStrength;
+// Per-material parameters, stored in the shared material buffer (see MaterialBuffer)
+layout(std140, binding = 2) uniform b_Material {
+	float u_Shininess;
+	#ifdef TEXTURED
+	float u_TextureMix;
+	#endif
+	#ifdef REFLECTION
+	mat3  u_EnvironmentRotation;
+	#endif
+};
 
-uniform vec3  u_LightPos;
-uniform vec3  u_LightCol;
-uniform float u_AmbientLightStrength;
-uniform float u_SpecularLightStrength;
-uniform float u_Shininess;
+#ifdef TEXTURED
+uniform sampler2D s_Diffuse;
+uniform sampler2D s_Diffuse2;
+uniform sampler2D s_Specular;
+#endif
 
-uniform vec3  u_CamPos;
+#ifdef REFLECTION
+uniform sampler2D s_Reflectivity;
+uniform samplerCube s_Environment;
+#endif
 
 out vec4 frag_color;
 
+// The textured and reflective variants use the attenuated lighting from the shaders they replaced, while the base
+// variant keeps the original lighting exactly as it was
+#if defined(TEXTURED) || defined(REFLECTION)
+#define ATTENUATED
+#endif
+
 // https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
 void main() {
 	// Lecture 5
+	#ifdef ATTENUATED
+	vec3 ambient = u_AmbientLightStrength * u_LightCol;
+	#else
 	vec3 ambient = ((u_AmbientLightStrength * u_LightCol) + (u_AmbientCol * u_AmbientStrength));
+	#endif
 
 	// Diffuse
 	vec3 N = normalize(inNormal);
@@ -31,21 +59,55 @@ void main() {
 
 	//Attenuation
 	float dist = length(u_LightPos - inPos);
+	#ifdef ATTENUATED
+	float attenuation = 1.0f / (
+		u_LightAttenuationConstant +
+		u_LightAttenuationLinear * dist +
+		u_LightAttenuationQuadratic * dist * dist);
+	#else
 	diffuse = diffuse / dist; // (dist*dist)
+	#endif
 
 	// Specular
 	vec3 viewDir  = normalize(u_CamPos - inPos);
 	vec3 h        = normalize(lightDir + viewDir);
 
-	//vec3 camPos = u_CamPos;//Pass this as a uniform from your C++ code
-	//float specularStrength = 1.0; // this can be a uniform
-	//vec3 camDir = normalize(camPos - inPos);
-	//vec3 reflectDir = reflect(-lightDir, N);
-	// New
+	#ifdef TEXTURED
+	// Get the specular power from the specular map
+	float texSpec = texture(s_Specular, inUV).x;
+	float spec = pow(max(dot(N, h), 0.0), u_Shininess); // Shininess coefficient (can be a uniform)
+	vec3 specular = u_SpecularLightStrength * texSpec * spec * u_LightCol; // Can also use a specular color
+
+	// Get the albedo from the diffuse / albedo map
+	vec4 textureColor1 = texture(s_Diffuse, inUV);
+	vec4 textureColor2 = texture(s_Diffuse2, inUV);
+	vec4 textureColor = mix(textureColor1, textureColor2, u_TextureMix);
+	#else
 	float spec = pow(max(dot(N, h), 0.0), u_Shininess); // Shininess coefficient (can be a uniform)
 	vec3 specular = u_SpecularLightStrength * spec * u_LightCol; // Can also use a specular color
+	#endif
+
+	#ifdef ATTENUATED
+	#ifndef TEXTURED
+	vec4 textureColor = vec4(1.0);
+	#endif
+
+	vec3 result = (
+		(u_AmbientCol * u_AmbientStrength) + // global ambient light
+		(ambient + diffuse + specular) * attenuation // light factors from our single light
+		) * inColor * textureColor.rgb; // Object color
+
+	#ifdef REFLECTION
+	vec3 toEye = normalize(inPos - u_CamPos);
+	vec3 reflected = reflect(toEye, N);
+	vec3 environment = texture(s_Environment, u_EnvironmentRotation * reflected).rgb;
+	result = mix(result, environment, texture(s_Reflectivity, inUV).r);
+	#endif
 
+	frag_color = vec4(result, textureColor.a);
+	#else
 	vec3 result = (ambient + diffuse + specular) * inColor;
 
 	frag_color = vec4(result, 1.0);
-}
\ No newline at end of file
+	#endif
+}
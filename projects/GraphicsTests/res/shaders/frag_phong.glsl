@@ -1,19 +1,13 @@
-#version 410
+#version 420
+
+#include "uniforms.glsl"
 
 layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec3 inNormal;
 
-uniform vec3  u_AmbientCol;
-uniform float u_AmbientStrength;
-
-uniform vec3  u_LightPos;
-uniform vec3  u_LightCol;
-uniform float u_AmbientLightStrength;
 uniform float u_Shininess;
 
-uniform vec3  u_CamPos;
-
 out vec4 frag_color;
 
 void main() {
@@ -1,14 +1,18 @@
-#version 410
+#version 420
+
+#include "uniforms.glsl"
 
 layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec3 inNormal;
 layout(location = 3) in vec2 inUV;
 
-uniform samplerCube s_Environment;
-uniform mat3 u_EnvironmentRotation;
+// Per-material parameters, stored in the shared material buffer (see MaterialBuffer)
+layout(std140, binding = 2) uniform b_Material {
+	mat3 u_EnvironmentRotation;
+};
 
-uniform vec3  u_CamPos;
+uniform samplerCube s_Environment;
 
 out vec4 frag_color;
 
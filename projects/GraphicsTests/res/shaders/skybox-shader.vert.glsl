@@ -1,11 +1,15 @@
-#version 410
+#version 420
+
+#include "uniforms.glsl"
 
 layout(location = 0) in vec3 inPosition;
 
 layout(location = 0) out vec3 outNormal;
 
-uniform mat4 u_SkyboxMatrix;
-uniform mat3 u_EnvironmentRotation;
+// Per-material parameters, stored in the shared material buffer (see MaterialBuffer)
+layout(std140, binding = 2) uniform b_Material {
+	mat3 u_EnvironmentRotation;
+};
 
 void main() {
     vec4 pos = u_SkyboxMatrix * vec4(inPosition, 1.0);
@@ -0,0 +1,27 @@
+// Uniform blocks shared by all of our shaders, these are updated once per frame by BackendHandler and stay bound
+// for the whole frame, so switching shaders doesn't need any uniform uploads. Must match FrameUniforms.h!
+
+// Camera and timing data, see FrameUniforms
+layout(std140, binding = 0) uniform b_FrameUniforms {
+	mat4  u_View;
+	mat4  u_Projection;
+	mat4  u_ViewProjection;
+	mat4  u_SkyboxMatrix;
+	vec3  u_CamPos;
+	float u_Time;
+};
+
+// Scene lighting, see LightUniforms
+// See https://learnopengl.com/Lighting/Light-casters for a good reference on how the attenuation works, or
+// https://developer.valvesoftware.com/wiki/Constant-Linear-Quadratic_Falloff
+layout(std140, binding = 1) uniform b_LightUniforms {
+	vec3  u_LightPos;
+	float u_AmbientLightStrength;
+	vec3  u_LightCol;
+	float u_SpecularLightStrength;
+	vec3  u_AmbientCol;
+	float u_AmbientStrength;
+	float u_LightAttenuationConstant;
+	float u_LightAttenuationLinear;
+	float u_LightAttenuationQuadratic;
+};
@@ -1,8 +1,23 @@
-#version 410
+#version 420
+
+#include "uniforms.glsl"
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
+// Compile with PACKED_NORMALS defined for meshes using octahedral normals (ex: VertexPackedPosNormTexCol)
+#ifdef PACKED_NORMALS
+layout(location = 2) in vec2 inNormalOct;
+
+vec3 DecodeOctahedral(vec2 e) {
+	vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+#define inNormal DecodeOctahedral(inNormalOct)
+#else
 layout(location = 2) in vec3 inNormal;
+#endif
 layout(location = 3) in vec2 inUV;
 
 layout(location = 0) out vec3 outPos;
@@ -11,11 +26,8 @@ layout(location = 2) out vec3 outNormal;
 layout(location = 3) out vec2 outUV;
 
 uniform mat4 u_ModelViewProjection;
-uniform mat4 u_View;
 uniform mat4 u_Model;
 uniform mat3 u_NormalMatrix;
-uniform vec3 u_LightPos;
-
 
 void main() {
 
@@ -0,0 +1,56 @@
+#version 460
+
+#include "uniforms.glsl"
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+// Compile with PACKED_NORMALS defined for meshes using octahedral normals (ex: VertexPackedPosNormTexCol)
+#ifdef PACKED_NORMALS
+layout(location = 2) in vec2 inNormalOct;
+
+vec3 DecodeOctahedral(vec2 e) {
+	vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+#define inNormal DecodeOctahedral(inNormalOct)
+#else
+layout(location = 2) in vec3 inNormal;
+#endif
+layout(location = 3) in vec2 inUV;
+
+layout(location = 0) out vec3 outPos;
+layout(location = 1) out vec3 outColor;
+layout(location = 2) out vec3 outNormal;
+layout(location = 3) out vec2 outUV;
+
+// Per-object data written by the BatchRenderer, see BatchRenderer::ObjectData
+struct ObjectData {
+	mat4 Model;
+	mat4 NormalMatrix; // Only the upper 3x3 is used, stored as a mat4 to keep the std430 layout simple
+};
+
+layout(std430, binding = 0) readonly buffer b_ObjectData {
+	ObjectData Objects[];
+};
+
+void main() {
+	// The batch renderer stores the index of the object in the base instance of each draw command
+	ObjectData object = Objects[gl_BaseInstance + gl_InstanceID];
+
+	// Pass vertex pos in world space to frag shader
+	vec4 worldPos = object.Model * vec4(inPosition, 1.0);
+	outPos = worldPos.xyz;
+
+	gl_Position = u_ViewProjection * worldPos;
+
+	// Normals
+	outNormal = mat3(object.NormalMatrix) * inNormal;
+
+	// Pass our UV coords to the fragment shader
+	outUV = inUV;
+
+	///////////
+	outColor = inColor;
+}
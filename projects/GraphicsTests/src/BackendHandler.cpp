@@ -89,6 +89,8 @@ bool BackendHandler::InitGLAD()
 		LOG_ERROR("Failed to initialize Glad");
 		return false;
 	}
+	// Let the driver compile shaders on it's own threads if it can, so shaders built with LinkAsync load in parallel
+	Shader::InitParallelCompile((GLADloadproc)glfwGetProcAddress);
 	return true;
 }
 
@@ -168,21 +170,32 @@ void BackendHandler::RenderImGui()
 	}
 }
 
+// The per-draw uniforms are hashed at compile time, so looking them up doesn't need to build or hash any strings
+static constexpr UniformId U_MODEL_VIEW_PROJECTION("u_ModelViewProjection");
+static constexpr UniformId U_MODEL("u_Model");
+static constexpr UniformId U_NORMAL_MATRIX("u_NormalMatrix");
+
 void BackendHandler::RenderVAO(const Shader::sptr& shader, const VertexArrayObject::sptr& vao, const glm::mat4& viewProjection, const Transform& transform)
 {
-	shader->SetUniformMatrix("u_ModelViewProjection", viewProjection * transform.WorldTransform());
-	shader->SetUniformMatrix("u_Model", transform.WorldTransform());
-	shader->SetUniformMatrix("u_NormalMatrix", transform.WorldNormalMatrix());
+	// Quantized meshes need to be mapped back into model space before the world transform is applied
+	glm::mat4 model = transform.WorldTransform() * vao->GetDequantization();
+	shader->SetUniformMatrix(U_MODEL_VIEW_PROJECTION, viewProjection * model);
+	shader->SetUniformMatrix(U_MODEL, model);
+	shader->SetUniformMatrix(U_NORMAL_MATRIX, transform.WorldNormalMatrix());
 	vao->Render();
 }
 
-void BackendHandler::SetupShaderForFrame(const Shader::sptr& shader, const glm::mat4& view, const glm::mat4& projection)
+void BackendHandler::UpdateFrameUniforms(const UniformBuffer::sptr& buffer, const glm::mat4& view, const glm::mat4& projection, float time)
 {
-	shader->Bind();
-	// These are the uniforms that update only once per frame
-	shader->SetUniformMatrix("u_View", view);
-	shader->SetUniformMatrix("u_ViewProjection", projection * view);
-	shader->SetUniformMatrix("u_SkyboxMatrix", projection * glm::mat4(glm::mat3(view)));
-	glm::vec3 camPos = glm::inverse(view) * glm::vec4(0, 0, 0, 1);
-	shader->SetUniform("u_CamPos", camPos);
+	// These are the uniforms that update only once per frame, every shader that includes uniforms.glsl reads them
+	// from the same buffer, so we don't need to do anything when the bound shader changes
+	FrameUniforms data;
+	data.View = view;
+	data.Projection = projection;
+	data.ViewProjection = projection * view;
+	data.SkyboxMatrix = projection * glm::mat4(glm::mat3(view));
+	data.CamPos = glm::inverse(view) * glm::vec4(0, 0, 0, 1);
+	data.Time = time;
+	buffer->Update(data);
+	buffer->Bind();
 }
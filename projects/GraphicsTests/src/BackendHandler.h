@@ -14,6 +14,8 @@
 #include <Transform.h>
 #include <VertexArrayObject.h>
 #include <Shader.h>
+#include <UniformBuffer.h>
+#include "FrameUniforms.h"
 
 #include <Application.h>
 #include <Camera.h>
@@ -58,7 +60,8 @@ public:
 
 	//Render our VAO
 	static void RenderVAO(const Shader::sptr& shader, const VertexArrayObject::sptr& vao, const glm::mat4& viewProjection, const Transform& transform);
-	static void SetupShaderForFrame(const Shader::sptr& shader, const glm::mat4& view, const glm::mat4& projection);
+	//Upload the per-frame camera data to the frame uniform buffer, and bind it for all shaders to use
+	static void UpdateFrameUniforms(const UniformBuffer::sptr& buffer, const glm::mat4& view, const glm::mat4& projection, float time);
 
 	static GLFWwindow* window;
 	static std::vector<std::function<void()>> imGuiCallbacks;
@@ -0,0 +1,46 @@
+#pragma once
+#include <GLM/glm.hpp>
+
+// These mirror the uniform blocks in res/shaders/uniforms.glsl, and need to follow the std140 layout rules. Every
+// vec3 is followed by a float so that it fills a full 16 byte slot, and the struct sizes are padded to 16 bytes
+
+/// <summary>
+/// The uniform block binding point for FrameUniforms (b_FrameUniforms in GLSL)
+/// </summary>
+constexpr unsigned int FRAME_UNIFORM_BINDING = 0;
+/// <summary>
+/// The uniform block binding point for LightUniforms (b_LightUniforms in GLSL)
+/// </summary>
+constexpr unsigned int LIGHT_UNIFORM_BINDING = 1;
+
+/// <summary>
+/// Camera and timing data that is updated once per frame
+/// </summary>
+struct FrameUniforms
+{
+	glm::mat4 View;
+	glm::mat4 Projection;
+	glm::mat4 ViewProjection;
+	glm::mat4 SkyboxMatrix;
+	glm::vec3 CamPos;
+	float     Time;
+};
+static_assert(sizeof(FrameUniforms) == 272, "FrameUniforms must match the std140 layout of b_FrameUniforms!");
+
+/// <summary>
+/// The scene's lighting settings, shared by all of the lit shaders
+/// </summary>
+struct LightUniforms
+{
+	glm::vec3 LightPos;
+	float     AmbientLightStrength;
+	glm::vec3 LightCol;
+	float     SpecularLightStrength;
+	glm::vec3 AmbientCol;
+	float     AmbientStrength;
+	float     AttenuationConstant;
+	float     AttenuationLinear;
+	float     AttenuationQuadratic;
+	float     Padding;
+};
+static_assert(sizeof(LightUniforms) == 64, "LightUniforms must match the std140 layout of b_LightUniforms!");
@@ -1,4 +1,5 @@
 #include "Framebuffer.h"
+#include <GLStateCache.h>
 
 GLuint Framebuffer::_fullscreenQuadVBO = 0;
 GLuint Framebuffer::_fullscreenQuadVAO = 0;
@@ -15,7 +16,7 @@ DepthTarget::~DepthTarget()
 void DepthTarget::Unload()
 {
 	//Deletes the texture at the specific handle
-	glDeleteTextures(1, &_texture.GetHandle());
+	GLStateCache::DeleteTextures(1, &_texture.GetHandle());
 }
 
 ColorTarget::~ColorTarget()
@@ -26,7 +27,7 @@ ColorTarget::~ColorTarget()
 
 void ColorTarget::Unload()
 {
-	glDeleteTextures(_numAttachments, &_textures[0].GetHandle());
+	GLStateCache::DeleteTextures(_numAttachments, &_textures[0].GetHandle());
 }
 
 Framebuffer::Framebuffer()
@@ -41,7 +42,7 @@ Framebuffer::~Framebuffer()
 void Framebuffer::Unload()
 {
 	//Deletes the framebuffer
-	glDeleteFramebuffers(1, &_FBO);
+	GLStateCache::DeleteFramebuffers(1, &_FBO);
 	//Sets init to false
 	_isInit = false;
 }
@@ -57,10 +58,8 @@ void Framebuffer::Init(unsigned width, unsigned height)
 
 void Framebuffer::Init()
 {
-	//Generates the FBO
-	glGenFramebuffers(1, &_FBO);
-	//Bind it
-	glBindFramebuffer(GL_FRAMEBUFFER, _FBO);
+	//Generates the FBO, we set it up with DSA so we don't need to disturb the bound framebuffer or textures
+	glCreateFramebuffers(1, &_FBO);
 
 	if (_depthActive)
 	{
@@ -68,11 +67,9 @@ void Framebuffer::Init()
 		_clearFlag |= GL_DEPTH_BUFFER_BIT;
 
 		//Generate the texture
-		glGenTextures(1, &_depth._texture.GetHandle());
-		//Binds the texture
-		glBindTexture(GL_TEXTURE_2D, _depth._texture.GetHandle());
+		glCreateTextures(GL_TEXTURE_2D, 1, &_depth._texture.GetHandle());
 		//Sets the texture data
-		glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, _width, _height);
+		glTextureStorage2D(_depth._texture.GetHandle(), 1, GL_DEPTH_COMPONENT24, _width, _height);
 
 		//Set texture parameters
 		glTextureParameteri(_depth._texture.GetHandle(), GL_TEXTURE_MIN_FILTER, _filter);
@@ -81,9 +78,7 @@ void Framebuffer::Init()
 		glTextureParameteri(_depth._texture.GetHandle(), GL_TEXTURE_WRAP_T, _wrap);
 
 		//Sets up as a framebuffer texture
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _depth._texture.GetHandle(), 0);
-
-		glBindTexture(GL_TEXTURE_2D, GL_NONE);
+		glNamedFramebufferTexture(_FBO, GL_DEPTH_ATTACHMENT, _depth._texture.GetHandle(), 0);
 	}
 
 	//If there is more than zero color attachments
@@ -95,17 +90,15 @@ void Framebuffer::Init()
 		//Creates the GLuints to hold the new texture handles;
 		GLuint* textureHandles = new GLuint[_color._numAttachments];
 
-		glGenTextures(_color._numAttachments, textureHandles);
+		glCreateTextures(GL_TEXTURE_2D, _color._numAttachments, textureHandles);
 
 		//Loops through them
 		for (unsigned i = 0; i < _color._numAttachments; i++)
 		{
 			_color._textures[i].GetHandle() = textureHandles[i];
 
-			//Binds the texture
-			glBindTexture(GL_TEXTURE_2D, _color._textures[i].GetHandle());
 			//Sets the texture storage
-			glTexStorage2D(GL_TEXTURE_2D, 1, _color._formats[i], _width, _height);
+			glTextureStorage2D(_color._textures[i].GetHandle(), 1, _color._formats[i], _width, _height);
 
 			//Set texture parameters
 			glTextureParameteri(_color._textures[i].GetHandle(), GL_TEXTURE_MIN_FILTER, _filter);
@@ -114,16 +107,17 @@ void Framebuffer::Init()
 			glTextureParameteri(_color._textures[i].GetHandle(), GL_TEXTURE_WRAP_T, _wrap);
 
 			//Sets up as a framebuffer texture
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, _color._textures[i].GetHandle(), 0);
+			glNamedFramebufferTexture(_FBO, GL_COLOR_ATTACHMENT0 + i, _color._textures[i].GetHandle(), 0);
 		}
 
 		delete[] textureHandles;
+
+		//The draw buffers are part of the framebuffer's state, so we only need to set them once
+		glNamedFramebufferDrawBuffers(_FBO, _color._numAttachments, &_color._buffers[0]);
 	}
 
 	//Make sure it's set up right
 	CheckFBO();
-	//Unbind buffer
-	glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
 	//Set init to true
 	_isInit = true;
 }
@@ -164,8 +158,7 @@ void Framebuffer::BindColorAsTexture(unsigned colorBuffer, int textureSlot) cons
 void Framebuffer::UnbindTexture(int textureSlot) const
 {
 	//Binds textures to GL_NONE
-	glActiveTexture(GL_TEXTURE0 + textureSlot);
-	glBindTexture(GL_TEXTURE_2D, GL_NONE);
+	GLStateCache::BindTextureUnit(textureSlot, GL_NONE);
 }
 
 void Framebuffer::Reshape(unsigned width, unsigned height)
@@ -196,17 +189,12 @@ void Framebuffer::SetViewport() const
 
 void Framebuffer::Bind() const
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, _FBO);
-
-	if (_color._numAttachments)
-	{
-		glDrawBuffers(_color._numAttachments, &_color._buffers[0]);
-	}
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, _FBO);
 }
 
 void Framebuffer::Unbind() const
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
 }
 
 void Framebuffer::RenderToFSQ() const
@@ -223,27 +211,21 @@ void Framebuffer::RenderToFSQ() const
 
 void Framebuffer::DrawToBackbuffer()
 {
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, _FBO);
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GL_NONE);
-
 	//Blits the framebuffer to the back buffer
-	glBlitFramebuffer(0, 0, _width, _height, 0, 0, _width, _height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, GL_NONE);
+	glBlitNamedFramebuffer(_FBO, GL_NONE, 0, 0, _width, _height, 0, 0, _width, _height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
 }
 
 void Framebuffer::Clear()
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, _FBO);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, _FBO);
 	glClear(_clearFlag);
-	glBindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, GL_NONE);
 }
 
 bool Framebuffer::CheckFBO()
 {
-	//Binds the framebuffer
-	Bind();
 	//Check the framebuffer status
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	if (glCheckNamedFramebufferStatus(_FBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 	{
 		printf("Framebuffer is not vibing\n");
 		return false;
@@ -282,7 +264,7 @@ void Framebuffer::InitFullscreenQuad()
 	//Generates vertex array
 	glGenVertexArrays(1, &_fullscreenQuadVAO);
 	//Binds VAO
-	glBindVertexArray(_fullscreenQuadVAO);
+	GLStateCache::BindVertexArray(_fullscreenQuadVAO);
 
 	//Enables 2 vertex attrib array slots
 	glEnableVertexAttribArray(0); //Vertices
@@ -292,7 +274,7 @@ void Framebuffer::InitFullscreenQuad()
 	glGenBuffers(1, &_fullscreenQuadVBO);
 
 	//Binds the VBO
-	glBindBuffer(GL_ARRAY_BUFFER, _fullscreenQuadVBO);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, _fullscreenQuadVBO);
 	//Buffers the vbo data
 	glBufferData(GL_ARRAY_BUFFER, vertexSize + texCoordSize, VBO_DATA, GL_STATIC_DRAW);
 
@@ -304,15 +286,14 @@ void Framebuffer::InitFullscreenQuad()
 	glVertexAttribPointer((GLuint)1, 2, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<void*>(vertexSize));
 #pragma warning(pop)
 
-	glBindBuffer(GL_ARRAY_BUFFER, GL_NONE);
-	glBindVertexArray(GL_NONE);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, GL_NONE);
+	GLStateCache::BindVertexArray(GL_NONE);
 }
 
 void Framebuffer::DrawFullscreenQuad()
 {
-	glBindVertexArray(_fullscreenQuadVAO);
+	GLStateCache::BindVertexArray(_fullscreenQuadVAO);
 	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glBindVertexArray(GL_NONE);
 }
 
 
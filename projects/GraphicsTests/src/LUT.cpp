@@ -1,4 +1,5 @@
 #include "LUT.h"
+#include <GLStateCache.h>
 #pragma warning(disable : 4996)
 LUT3D::LUT3D()
 {
@@ -28,40 +29,34 @@ void LUT3D::loadFromFile(std::string path)
 			data.push_back(lineData);
 	}
 
-	glEnable(GL_TEXTURE_3D);
+	// We use DSA here so that loading doesn't change which textures are bound
+	glCreateTextures(GL_TEXTURE_3D, 1, &_handle);
+	glTextureParameteri(_handle, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(_handle, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(_handle, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(_handle, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTextureParameteri(_handle, GL_TEXTURE_WRAP_R, GL_REPEAT);
 
-	glGenTextures(1, &_handle);
-	bind();
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
-
-	glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB, 64, 64, 64, 0, GL_RGB, GL_FLOAT, &data[0]);
-	unbind();
-
-	glDisable(GL_TEXTURE_3D);
+	glTextureStorage3D(_handle, 1, GL_RGB8, 64, 64, 64);
+	glTextureSubImage3D(_handle, 0, 0, 0, 0, 64, 64, 64, GL_RGB, GL_FLOAT, &data[0]);
 }
 
 void LUT3D::bind()
 {
-	glBindTexture(GL_TEXTURE_3D, _handle);
+	bind(0);
 }
 
 void LUT3D::unbind()
 {
-	glBindTexture(GL_TEXTURE_3D, GL_NONE);
+	unbind(0);
 }
 
 void LUT3D::bind(int textureSlot)
 {
-	glActiveTexture(GL_TEXTURE0 + textureSlot);
-	bind();
+	GLStateCache::BindTextureUnit(textureSlot, _handle);
 }
 
 void LUT3D::unbind(int textureSlot)
 {
-	glActiveTexture(GL_TEXTURE0 + textureSlot);
-	unbind();
+	GLStateCache::BindTextureUnit(textureSlot, GL_NONE);
 }
\ No newline at end of file
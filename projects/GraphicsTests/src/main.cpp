@@ -7,6 +7,10 @@
 
 #include <Texture2D.h>
 #include <Texture2DData.h>
+#include <TextureLoader.h>
+#include <TextureCooker.h>
+#include <ResourceCache.h>
+#include <MeshCooker.h>
 #include <MeshBuilder.h>
 #include <MeshFactory.h>
 #include <NotObjLoader.h>
@@ -16,6 +20,12 @@
 #include <RendererComponent.h>
 #include <TextureCubeMap.h>
 #include <TextureCubeMapData.h>
+#include <BatchRenderer.h>
+#include <RenderQueue.h>
+#include <GeometryArena.h>
+#include <MaterialBuffer.h>
+#include <ProgramCache.h>
+#include <GLStateCache.h>
 
 #include <Timing.h>
 #include <GameObjectTag.h>
@@ -47,11 +57,19 @@ int main() {
 	{
 		#pragma region Shader and ImGui
 
-		// Load our shaders
+		// Linked programs are stored on disk, so that later runs can skip compiling shaders that haven't changed
+		ProgramCache::sptr programCache = ProgramCache::Create();
+		ProgramCache::SetDefault(programCache);
+
+		// Load our shaders. The scene shaders are built in the background, objects using them will pop in once they're
+		// ready instead of making us wait for every program to compile in turn
+		std::vector<Shader::sptr> pendingShaders;
+
+		// Our lit shader has TEXTURED and REFLECTION keywords, we don't link it here since each material will pick the
+		// variant it needs, and only those variants get compiled
 		Shader::sptr shader = Shader::Create();
-		shader->LoadShaderPartFromFile("shaders/vertex_shader.glsl", GL_VERTEX_SHADER);
-		shader->LoadShaderPartFromFile("shaders/frag_blinn_phong_textured.glsl", GL_FRAGMENT_SHADER);
-		shader->Link();
+		shader->LoadShaderPartFromFile("shaders/vertex_shader_indirect.glsl", GL_VERTEX_SHADER);
+		shader->LoadShaderPartFromFile("shaders/frag_blinn_phong.glsl", GL_FRAGMENT_SHADER);
 
 		Shader::sptr colorCorrectionShader = Shader::Create();
 		colorCorrectionShader->LoadShaderPartFromFile("shaders/passthrough_vert.glsl", GL_VERTEX_SHADER);
@@ -70,49 +88,29 @@ int main() {
 		float colorSlider = 0.0f;
 		float colorOption = 0.0f;
 
-		// These are our application / scene level uniforms that don't necessarily update
-		// every frame
-		shader->SetUniform("u_LightPos", lightPos);
-		shader->SetUniform("u_LightCol", lightCol);
-		shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
-		shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
-		shader->SetUniform("u_AmbientCol", ambientCol);
-		shader->SetUniform("u_AmbientStrength", ambientPow);
-		shader->SetUniform("u_LightAttenuationConstant", 1.0f);
-		shader->SetUniform("u_LightAttenuationLinear", lightLinearFalloff);
-		shader->SetUniform("u_LightAttenuationQuadratic", lightQuadraticFalloff);
+		// The camera and lighting uniforms live in uniform buffers that every shader shares (see uniforms.glsl), so
+		// they only need to be uploaded once per frame no matter how many shaders we use
+		UniformBuffer::sptr frameUniforms = UniformBuffer::Create(sizeof(FrameUniforms), FRAME_UNIFORM_BINDING);
+		UniformBuffer::sptr lightUniforms = UniformBuffer::Create(sizeof(LightUniforms), LIGHT_UNIFORM_BINDING);
+
+		// The batch renderer will handle drawing our render group each frame
+		BatchRenderer::sptr batchRenderer = BatchRenderer::Create();
 
 		// We'll add some ImGui controls to control our shader
 		BackendHandler::imGuiCallbacks.push_back([&]() {
 			if (ImGui::CollapsingHeader("Scene Level Lighting Settings"))
 			{
-				if (ImGui::ColorPicker3("Ambient Color", glm::value_ptr(ambientCol))) {
-					shader->SetUniform("u_AmbientCol", ambientCol);
-				}
-				if (ImGui::SliderFloat("Fixed Ambient Power", &ambientPow, 0.01f, 1.0f)) {
-					shader->SetUniform("u_AmbientStrength", ambientPow);
-				}
+				ImGui::ColorPicker3("Ambient Color", glm::value_ptr(ambientCol));
+				ImGui::SliderFloat("Fixed Ambient Power", &ambientPow, 0.01f, 1.0f);
 			}
 			if (ImGui::CollapsingHeader("Light Level Lighting Settings"))
 			{
-				if (ImGui::DragFloat3("Light Pos", glm::value_ptr(lightPos), 0.01f, -10.0f, 10.0f)) {
-					shader->SetUniform("u_LightPos", lightPos);
-				}
-				if (ImGui::ColorPicker3("Light Col", glm::value_ptr(lightCol))) {
-					shader->SetUniform("u_LightCol", lightCol);
-				}
-				if (ImGui::SliderFloat("Light Ambient Power", &lightAmbientPow, 0.0f, 1.0f)) {
-					shader->SetUniform("u_AmbientLightStrength", lightAmbientPow);
-				}
-				if (ImGui::SliderFloat("Light Specular Power", &lightSpecularPow, 0.0f, 1.0f)) {
-					shader->SetUniform("u_SpecularLightStrength", lightSpecularPow);
-				}
-				if (ImGui::DragFloat("Light Linear Falloff", &lightLinearFalloff, 0.01f, 0.0f, 1.0f)) {
-					shader->SetUniform("u_LightAttenuationLinear", lightLinearFalloff);
-				}
-				if (ImGui::DragFloat("Light Quadratic Falloff", &lightQuadraticFalloff, 0.01f, 0.0f, 1.0f)) {
-					shader->SetUniform("u_LightAttenuationQuadratic", lightQuadraticFalloff);
-				}
+				ImGui::DragFloat3("Light Pos", glm::value_ptr(lightPos), 0.01f, -10.0f, 10.0f);
+				ImGui::ColorPicker3("Light Col", glm::value_ptr(lightCol));
+				ImGui::SliderFloat("Light Ambient Power", &lightAmbientPow, 0.0f, 1.0f);
+				ImGui::SliderFloat("Light Specular Power", &lightSpecularPow, 0.0f, 1.0f);
+				ImGui::DragFloat("Light Linear Falloff", &lightLinearFalloff, 0.01f, 0.0f, 1.0f);
+				ImGui::DragFloat("Light Quadratic Falloff", &lightQuadraticFalloff, 0.01f, 0.0f, 1.0f);
 			}
 
 			if (ImGui::CollapsingHeader("Color Correction Settings"))
@@ -142,22 +140,51 @@ int main() {
 			}
 			ImGui::PlotLines("FPS", fpsBuffer, 128);
 			ImGui::Text("MIN: %f MAX: %f AVG: %f", minFps, maxFps, avgFps / 128.0f);
+
+			// The state cache counts the binds and state changes it saw last frame, and how many it didn't need to send
+			const GLStateCache::FrameStats& stateStats = GLStateCache::GetLastFrameStats();
+			ImGui::Text("GL state changes: %u issued, %u filtered", stateStats.Issued, stateStats.Filtered);
+			// Runs of the same mesh and material are drawn as instances of a single command
+			ImGui::Text("Batches: %zu objects in %zu draw calls, %zu drawn as instances",
+				batchRenderer->GetObjectCount(), batchRenderer->GetDrawCallCount(), batchRenderer->GetInstancedObjectCount());
+
+			const TextureLoader::sptr& textureLoader = TextureLoader::GetDefault();
+			if (textureLoader != nullptr) {
+				ImGui::Text("Textures loading: %zu (%zu of %zu bytes uploaded last frame)",
+					textureLoader->GetPendingCount(), textureLoader->GetFrameBytes(), textureLoader->GetFrameBudget());
+			}
+
+			const ResourceCache::sptr& resourceCache = ResourceCache::GetDefault();
+			if (resourceCache != nullptr) {
+				const ResourceCache::Stats& cacheStats = resourceCache->GetStats();
+				ImGui::Text("Resource cache: %zu hits, %zu misses, %zu live (%.2f MB resident, %.2f MB saved)",
+					cacheStats.Hits, cacheStats.Misses, cacheStats.Entries, cacheStats.BytesResident / (1024.0 * 1024.0), cacheStats.BytesSaved / (1024.0 * 1024.0));
+			}
 			});
 
 		#pragma endregion 
 
 		// GL states
-		glEnable(GL_DEPTH_TEST);
-		glEnable(GL_CULL_FACE);
-		glDepthFunc(GL_LEQUAL); // New 
+		GLStateCache::Enable(GL_DEPTH_TEST);
+		GLStateCache::Enable(GL_CULL_FACE);
+		GLStateCache::DepthFunc(GL_LEQUAL); // New 
 
 		#pragma region TEXTURE LOADING
 
+		// Textures are decoded in the background and streamed in over the first few frames, until then they're white
+		TextureLoader::SetDefault(TextureLoader::Create());
+		// Images that have been run through the TextureCooker tool are loaded from the cache, with their mips already built
+		TextureCooker::SetDefault(TextureCooker::Create());
+		// Models are cooked into a binary format the first time they're loaded, later runs upload the cooked files directly
+		MeshCooker::SetDefault(MeshCooker::Create());
+		// Textures and meshes that are loaded from the same file more than once share the same GPU objects
+		ResourceCache::SetDefault(ResourceCache::Create());
+
 		// Load some textures from files
-		Texture2D::sptr diffuse = Texture2D::LoadFromFile("images/Stone_001_Diffuse.png");
-		Texture2D::sptr diffuse2 = Texture2D::LoadFromFile("images/box.bmp");
-		Texture2D::sptr specular = Texture2D::LoadFromFile("images/Stone_001_Specular.png");
-		Texture2D::sptr reflectivity = Texture2D::LoadFromFile("images/box-reflections.bmp");
+		Texture2D::sptr diffuse = Texture2D::LoadFromFileAsync("images/Stone_001_Diffuse.png");
+		Texture2D::sptr diffuse2 = Texture2D::LoadFromFileAsync("images/box.bmp");
+		Texture2D::sptr specular = Texture2D::LoadFromFileAsync("images/Stone_001_Specular.png");
+		Texture2D::sptr reflectivity = Texture2D::LoadFromFileAsync("images/box-reflections.bmp");
 		//LUT3D colorCube("cubes/CustomCorrection.cube");
 		LUT3D defaultCube("cubes/Neutral-512.cube"); //default colours
 		//color cubes
@@ -192,6 +219,18 @@ int main() {
 		GameScene::sptr scene = GameScene::Create("test");
 		Application::Instance().ActiveScene = scene;
 
+		// The render queue sorts everything into draw order before it goes to the batch renderer
+		RenderQueue::sptr renderQueue = RenderQueue::Create();
+
+		// All meshes baked from here on will be packed into a few shared buffers, so the batch renderer can draw
+		// different meshes with the same layout without switching VAOs
+		GeometryArena::sptr geometryArena = GeometryArena::Create();
+		GeometryArena::SetDefault(geometryArena);
+
+		// Material parameters are packed into blocks in a single shared uniform buffer, so switching materials is just
+		// a range bind, and only parameters that change get uploaded
+		MaterialBuffer::SetDefault(MaterialBuffer::Create());
+
 		// We can create a group ahead of time to make iterating on the group faster
 		entt::basic_group<entt::entity, entt::exclude_t<>, entt::get_t<Transform>, RendererComponent> renderGroup =
 			scene->Registry().group<RendererComponent>(entt::get_t<Transform>());
@@ -206,33 +245,17 @@ int main() {
 		material0->Set("u_TextureMix", 0.5f); 
 
 		// Load a second material for our reflective material!
-		Shader::sptr reflectiveShader = Shader::Create();
-		reflectiveShader->LoadShaderPartFromFile("shaders/vertex_shader.glsl", GL_VERTEX_SHADER);
-		reflectiveShader->LoadShaderPartFromFile("shaders/frag_reflection.frag.glsl", GL_FRAGMENT_SHADER);
-		reflectiveShader->Link();
-
-		Shader::sptr reflective = Shader::Create();
-		reflective->LoadShaderPartFromFile("shaders/vertex_shader.glsl", GL_VERTEX_SHADER);
-		reflective->LoadShaderPartFromFile("shaders/frag_blinn_phong_reflection.glsl", GL_FRAGMENT_SHADER);
-		reflective->Link();
-		
-		// 
+		Shader::sptr reflectiveShader = Shader::LoadAsync("shaders/vertex_shader_indirect.glsl", "shaders/frag_reflection.frag.glsl");
+		pendingShaders.push_back(reflectiveShader);
+
+		// Setting the reflection parameters will enable the REFLECTION variant for this material
 		ShaderMaterial::sptr material1 = ShaderMaterial::Create(); 
-		material1->Shader = reflective;
+		material1->Shader = shader;
 		material1->Set("s_Diffuse", diffuse);
 		material1->Set("s_Diffuse2", diffuse2);
 		material1->Set("s_Specular", specular);
 		material1->Set("s_Reflectivity", reflectivity); 
 		material1->Set("s_Environment", environmentMap); 
-		material1->Set("u_LightPos", lightPos);
-		material1->Set("u_LightCol", lightCol);
-		material1->Set("u_AmbientLightStrength", lightAmbientPow); 
-		material1->Set("u_SpecularLightStrength", lightSpecularPow); 
-		material1->Set("u_AmbientCol", ambientCol);
-		material1->Set("u_AmbientStrength", ambientPow);
-		material1->Set("u_LightAttenuationConstant", 1.0f);
-		material1->Set("u_LightAttenuationLinear", lightLinearFalloff);
-		material1->Set("u_LightAttenuationQuadratic", lightQuadraticFalloff);
 		material1->Set("u_Shininess", 8.0f);
 		material1->Set("u_TextureMix", 0.5f);
 		material1->Set("u_EnvironmentRotation", glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1, 0, 0))));
@@ -242,6 +265,14 @@ int main() {
 		reflectiveMat->Set("s_Environment", environmentMap);
 		reflectiveMat->Set("u_EnvironmentRotation", glm::mat3(glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(1, 0, 0))));
 
+		// Pick the variants our materials need now, so they start compiling while we load the rest of the scene
+		pendingShaders.push_back(material0->GetActiveShader());
+		pendingShaders.push_back(material1->GetActiveShader());
+
+		// Renderers refer to materials and meshes by handle, the pools will keep them alive until we clear them at shutdown
+		MaterialHandle material0Handle = ResourcePools::Materials().Add(material0);
+		MaterialHandle reflectiveMatHandle = ResourcePools::Materials().Add(reflectiveMat);
+
 		//GameObject sceneObj = scene->CreateEntity("scene_geo"); 
 		//{
 		//	VertexArrayObject::sptr sceneVao = NotObjLoader::LoadFromFile("Sample.notobj");
@@ -261,8 +292,8 @@ int main() {
 		
 		GameObject obj2 = scene->CreateEntity("monkey_quads");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/monkey_quads.obj");
-			obj2.emplace<RendererComponent>().SetMesh(vao).SetMaterial(material0);
+			MeshLodSet::sptr lods = ObjLoader::LoadLodsFromFile("models/monkey_quads.obj");
+			obj2.emplace<RendererComponent>().SetLods(ResourcePools::LodSets().Add(lods)).SetMaterial(material0Handle);
 			obj2.get<Transform>().SetLocalPosition(0.0f, 0.0f, 1000.0f);
 			BehaviourBinding::BindDisabled<SimpleMoveBehaviour>(obj2);
 		}
@@ -270,7 +301,7 @@ int main() {
 		GameObject obj3 = scene->CreateEntity("paddle1");
 		{
 			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/red_paddle.obj");
-			obj3.emplace<RendererComponent>().SetMesh(vao).SetMaterial(reflectiveMat);
+			obj3.emplace<RendererComponent>().SetMesh(ResourcePools::Meshes().Add(vao)).SetMaterial(reflectiveMatHandle);
 			obj3.get<Transform>().SetLocalPosition(0.0f, 0.0f, 0.0f);
 			obj3.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
 			BehaviourBinding::BindDisabled<SimpleMoveBehaviour>(obj3);
@@ -283,7 +314,7 @@ int main() {
 			MeshFactory::AddCube(builder, glm::vec3(0.0f), glm::vec3(1.0f), glm::vec3(0.0f));
 			VertexArrayObject::sptr vao = builder.Bake();
 			
-			obj5.emplace<RendererComponent>().SetMesh(vao).SetMaterial(reflectiveMat);
+			obj5.emplace<RendererComponent>().SetMesh(ResourcePools::Meshes().Add(vao)).SetMaterial(reflectiveMatHandle);
 			obj5.get<Transform>().SetLocalPosition(-4.0f, 0.0f, 2000.0f);
 			BehaviourBinding::BindDisabled<SimpleMoveBehaviour>(obj5);
 		}
@@ -329,7 +360,7 @@ int main() {
 		GameObject obj7 = scene->CreateEntity("paddle2");
 		{
 			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/blue_paddle.obj");
-			obj7.emplace<RendererComponent>().SetMesh(vao).SetMaterial(reflectiveMat);
+			obj7.emplace<RendererComponent>().SetMesh(ResourcePools::Meshes().Add(vao)).SetMaterial(reflectiveMatHandle);
 			obj7.get<Transform>().SetLocalPosition(2.0f, 0.0f, 0.0f);
 			obj7.get<Transform>().SetLocalRotation(90.0f, 0.0f, 0.0f);
 			BehaviourBinding::BindDisabled<SimpleMoveBehaviour>(obj7);
@@ -337,8 +368,8 @@ int main() {
 	
 		GameObject obj8 = scene->CreateEntity("paddle2");
 		{
-			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/dagger.obj");
-			obj8.emplace<RendererComponent>().SetMesh(vao).SetMaterial(reflectiveMat);
+			MeshLodSet::sptr lods = ObjLoader::LoadLodsFromFile("models/dagger.obj");
+			obj8.emplace<RendererComponent>().SetLods(ResourcePools::LodSets().Add(lods)).SetMaterial(reflectiveMatHandle);
 			obj8.get<Transform>().SetLocalPosition(4.0f, 0.0f, 2.0f);
 			obj8.get<Transform>().SetLocalRotation(0.0f, -90.0f, 0.0f);
 			BehaviourBinding::BindDisabled<SimpleMoveBehaviour>(obj8);
@@ -347,7 +378,7 @@ int main() {
 		GameObject obj9 = scene->CreateEntity("wall1");
 		{
 			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/plane.obj");
-			obj9.emplace<RendererComponent>().SetMesh(vao).SetMaterial(material0 );
+			obj9.emplace<RendererComponent>().SetMesh(ResourcePools::Meshes().Add(vao)).SetMaterial(material0Handle);
 			obj9.get<Transform>().SetLocalPosition(-5.0f, 0.0f, 2.0f);
 			obj9.get<Transform>().SetLocalRotation(0.0f, 90.0f, 0.0f);
 			obj9.get<Transform>().SetLocalScale(5.0f, 5.0f, 5.0f);
@@ -357,7 +388,7 @@ int main() {
 		GameObject obj10 = scene->CreateEntity("wall2");
 		{
 			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/plane.obj");
-			obj10.emplace<RendererComponent>().SetMesh(vao).SetMaterial(material0);
+			obj10.emplace<RendererComponent>().SetMesh(ResourcePools::Meshes().Add(vao)).SetMaterial(material0Handle);
 			obj10.get<Transform>().SetLocalPosition(0.0f, -5.0f, 2.0f);
 			obj10.get<Transform>().SetLocalRotation(0.0f, 90.0f, 90.0f);
 			obj10.get<Transform>().SetLocalScale(5.0f, 5.0f, 5.0f);
@@ -367,7 +398,7 @@ int main() {
 		GameObject obj11 = scene->CreateEntity("floor");
 		{
 			VertexArrayObject::sptr vao = ObjLoader::LoadFromFile("models/plane.obj");
-			obj11.emplace<RendererComponent>().SetMesh(vao).SetMaterial(material0);
+			obj11.emplace<RendererComponent>().SetMesh(ResourcePools::Meshes().Add(vao)).SetMaterial(material0Handle);
 			obj11.get<Transform>().SetLocalPosition(0.0f, 0.0f, 0.0f);
 			obj11.get<Transform>().SetLocalRotation(0.0f, 0.0f, 0.0f);
 			obj11.get<Transform>().SetLocalScale(5.0f, 5.0f, 5.0f);
@@ -408,10 +439,8 @@ int main() {
 		/////////////////////////////////// SKYBOX ///////////////////////////////////////////////
 		{
 			// Load our shaders
-			Shader::sptr skybox = std::make_shared<Shader>();
-			skybox->LoadShaderPartFromFile("shaders/skybox-shader.vert.glsl", GL_VERTEX_SHADER);
-			skybox->LoadShaderPartFromFile("shaders/skybox-shader.frag.glsl", GL_FRAGMENT_SHADER);
-			skybox->Link();
+			Shader::sptr skybox = Shader::LoadAsync("shaders/skybox-shader.vert.glsl", "shaders/skybox-shader.frag.glsl");
+			pendingShaders.push_back(skybox);
 
 			ShaderMaterial::sptr skyboxMat = ShaderMaterial::Create();
 			skyboxMat->Shader = skybox;  
@@ -426,7 +455,7 @@ int main() {
 			
 			GameObject skyboxObj = scene->CreateEntity("skybox");  
 			skyboxObj.get<Transform>().SetLocalPosition(0.0f, 0.0f, 0.0f);
-			skyboxObj.get_or_emplace<RendererComponent>().SetMesh(meshVao).SetMaterial(skyboxMat);
+			skyboxObj.get_or_emplace<RendererComponent>().SetMesh(ResourcePools::Meshes().Add(meshVao)).SetMaterial(ResourcePools::Materials().Add(skyboxMat));
 		}
 		////////////////////////////////////////////////////////////////////////////////////////
 
@@ -512,6 +541,10 @@ int main() {
 		///// Game loop /////
 		while (!glfwWindowShouldClose(BackendHandler::window)) {
 			glfwPollEvents();
+			// Start counting the state changes for this frame
+			GLStateCache::BeginFrame();
+			// Stream in a bit more of any textures that are still loading
+			TextureLoader::GetDefault()->Update();
 
 			// Update the timing
 			time.CurrentFrame = glfwGetTime();
@@ -549,7 +582,7 @@ int main() {
 			colorCorrect->Clear();
 
 			glClearColor(0.08f, 0.17f, 0.31f, 1.0f);
-			glEnable(GL_DEPTH_TEST);
+			GLStateCache::Enable(GL_DEPTH_TEST);
 			glClearDepth(1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -562,48 +595,63 @@ int main() {
 			Transform& camTransform = cameraObject.get<Transform>();
 			glm::mat4 view = glm::inverse(camTransform.LocalTransform());
 			glm::mat4 projection = cameraObject.get<Camera>().GetProjection();
-			glm::mat4 viewProjection = projection * view;
+
+			// Upload our frame level uniforms once, they stay bound for every shader we use this frame
+			BackendHandler::UpdateFrameUniforms(frameUniforms, view, projection, static_cast<float>(time.CurrentFrame));
+			LightUniforms lights;
+			lights.LightPos = lightPos;
+			lights.LightCol = lightCol;
+			lights.AmbientLightStrength = lightAmbientPow;
+			lights.SpecularLightStrength = lightSpecularPow;
+			lights.AmbientCol = ambientCol;
+			lights.AmbientStrength = ambientPow;
+			lights.AttenuationConstant = 1.0f;
+			lights.AttenuationLinear = lightLinearFalloff;
+			lights.AttenuationQuadratic = lightQuadraticFalloff;
+			lights.Padding = 0.0f;
+			lightUniforms->Update(lights);
+			lightUniforms->Bind();
+
+			// Pick the level of detail for everything that has a LOD set, this needs to happen before sorting since it
+			// can change the mesh that the object will draw with
+			int viewportWidth, viewportHeight;
+			glfwGetFramebufferSize(BackendHandler::window, &viewportWidth, &viewportHeight);
+			glm::vec3 cameraPos = glm::vec3(camTransform.LocalTransform()[3]);
+			renderGroup.each([&](entt::entity e, RendererComponent& renderer, Transform& transform) {
+				renderer.UpdateLod(transform.WorldTransform(), cameraPos, projection, static_cast<float>(viewportHeight));
+			});
 						
-			// Sort the renderers by shader and material, we will go for a minimizing context switches approach here,
-			// but you could for instance sort front to back to optimize for fill rate if you have intensive fragment shaders
-			renderGroup.sort<RendererComponent>([](const RendererComponent& l, const RendererComponent& r) {
-				// Sort by render layer first, higher numbers get drawn last
-				if (l.Material->RenderLayer < r.Material->RenderLayer) return true;
-				if (l.Material->RenderLayer > r.Material->RenderLayer) return false;
-
-				// Sort by shader pointer next (so materials using the same shader run sequentially where possible)
-				if (l.Material->Shader < r.Material->Shader) return true;
-				if (l.Material->Shader > r.Material->Shader) return false;
-
-				// Sort by material pointer last (so we can minimize switching between materials)
-				if (l.Material < r.Material) return true;
-				if (l.Material > r.Material) return false;
-				
-				return false;
+			// Sort the renderers by layer, then shader, material and mesh to minimize context switches, with opaque objects
+			// front to back within each group and transparent objects back to front (see RenderQueue for the key layout)
+			renderQueue->Begin(view, cameraObject.get<Camera>().GetFarPlane());
+			renderGroup.each([&](entt::entity e, RendererComponent& renderer, Transform& transform) {
+				renderQueue->Push(renderer, transform);
 			});
+			renderQueue->Sort();
 
-			// Start by assuming no shader or material is applied
-			Shader::sptr current = nullptr;
-			ShaderMaterial::sptr currentMat = nullptr;
-			
 			colorCorrect->Bind();
 
-			// Iterate over the render group components and draw them
-			renderGroup.each( [&](entt::entity e, RendererComponent& renderer, Transform& transform) {
-				// If the shader has changed, set up it's uniforms
-				if (current != renderer.Material->Shader) {
-					current = renderer.Material->Shader;
-					current->Bind();
-					BackendHandler::SetupShaderForFrame(current, view, projection);
-				}
-				// If the material has changed, apply it
-				if (currentMat != renderer.Material) {
-					currentMat = renderer.Material;
-					currentMat->Apply();
+			// Gather the sorted renderers into the batch renderer, consecutive objects with the same shader, material and
+			// mesh will be drawn with a single indirect draw call
+			batchRenderer->Begin();
+			for (size_t ix = 0; ix < renderQueue->GetCount(); ix++) {
+				const RenderQueue::Item& item = renderQueue->GetItem(ix);
+				batchRenderer->Submit(item.Mesh, item.Material, item.Transform->WorldTransform(), item.Transform->WorldNormalMatrix());
+			}
+			// Draw all our buckets, the frame level uniforms are already bound so we don't need to do anything per shader
+			batchRenderer->Flush();
+
+			// Submitting polls the shaders that are still compiling, once they're all done we can report how long it took
+			if (!pendingShaders.empty()) {
+				pendingShaders.erase(std::remove_if(pendingShaders.begin(), pendingShaders.end(), [](const Shader::sptr& s) {
+					return s->GetState() != ShaderState::Compiling;
+				}), pendingShaders.end());
+				if (pendingShaders.empty()) {
+					const ProgramCache::Stats& cacheStats = programCache->GetStats();
+					LOG_INFO("Shader programs: {} from cache, {} compiled, {} rejected, {:.2f} ms on the main thread",
+						cacheStats.Hits, cacheStats.Misses, cacheStats.Rejected, cacheStats.LinkTimeMs);
 				}
-				// Render the mesh
-				BackendHandler::RenderVAO(renderer.Material->Shader, renderer.Mesh, viewProjection, transform);
-			});
+			}
 
 			colorCorrect->Unbind();
 			colorCorrectionShader->Bind();
@@ -658,6 +706,16 @@ int main() {
 
 		// Nullify scene so that we can release references
 		Application::Instance().ActiveScene = nullptr;
+		// Release everything the renderers were using, then the default arena so it's buffers are freed before the context
+		// is destroyed
+		ResourcePools::Clear();
+		TextureLoader::SetDefault(nullptr);
+		TextureCooker::SetDefault(nullptr);
+		MeshCooker::SetDefault(nullptr);
+		ResourceCache::SetDefault(nullptr);
+		GeometryArena::SetDefault(nullptr);
+		MaterialBuffer::SetDefault(nullptr);
+		ProgramCache::SetDefault(nullptr);
 		BackendHandler::ShutdownImGui();
 	}	
 
@@ -0,0 +1,161 @@
+// Command line tool comparing the OBJ parsers in ObjLoader. The model is tiled into a much bigger OBJ file (each copy
+// has it's face indices offset so it references it's own attributes), then both parsers load that file a few times
+// and we report the best time for each, along with whether they produced the same mesh.
+//
+// Usage: ObjBenchmark [options] <obj file>
+//   -n, --copies <count>  The number of copies of the model to put in the scaled up file (default: 256)
+//   -r, --runs <count>    The number of times to run each parser (default: 5)
+//
+// Ex: ObjBenchmark projects/GraphicsTests/res/models/monkey_quads.obj
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+
+#include <Logging.h>
+#include <ObjLoader.h>
+
+typedef MeshBuilder<VertexPosNormTexCol> ObjMesh;
+
+static void PrintUsage() {
+	printf("Usage: ObjBenchmark [options] <obj file>\n");
+	printf("  -n, --copies <count>  The number of copies of the model to put in the scaled up file (default: 256)\n");
+	printf("  -r, --runs <count>    The number of times to run each parser (default: 5)\n");
+}
+
+// Offsets the positive indices in a face corner, relative indices are left alone since they still work in each copy
+static std::string OffsetCorner(const std::string& corner, const int offsets[3]) {
+	std::string result;
+	size_t start = 0;
+	for (int ix = 0; ix < 3 && start <= corner.size(); ix++) {
+		size_t split = std::min(corner.find('/', start), corner.size());
+		std::string part = corner.substr(start, split - start);
+		if (ix > 0) {
+			result += '/';
+		}
+		if (!part.empty() && part[0] != '-') {
+			part = std::to_string(std::stoi(part) + offsets[ix]);
+		}
+		result += part;
+		start = split + 1;
+	}
+	return result;
+}
+
+// Writes the model out the given number of times into one file
+static bool WriteScaledFile(const std::string& source, const std::string& dest, int copies) {
+	std::ifstream input(source, std::ios::binary);
+	if (!input) {
+		return false;
+	}
+	std::vector<std::string> lines;
+	int counts[3] = { 0, 0, 0 };
+	for (std::string line; std::getline(input, line); ) {
+		if (line.rfind("v ", 0) == 0) { counts[0]++; }
+		else if (line.rfind("vt ", 0) == 0) { counts[1]++; }
+		else if (line.rfind("vn ", 0) == 0) { counts[2]++; }
+		lines.push_back(line);
+	}
+
+	std::ofstream output(dest, std::ios::binary | std::ios::trunc);
+	for (int copy = 0; copy < copies; copy++) {
+		const int offsets[3] = { counts[0] * copy, counts[1] * copy, counts[2] * copy };
+		for (const std::string& line : lines) {
+			if (line.rfind("f ", 0) == 0) {
+				std::istringstream stream(line.substr(2));
+				output << "f";
+				for (std::string corner; stream >> corner; ) {
+					output << ' ' << OffsetCorner(corner, offsets);
+				}
+				output << '\n';
+			} else {
+				output << line << '\n';
+			}
+		}
+	}
+	return static_cast<bool>(output);
+}
+
+// Runs the parser the given number of times, returning the best time in milliseconds
+static double TimeParser(const std::function<void(ObjMesh&)>& parse, int runs, ObjMesh& result) {
+	double best = 0.0;
+	for (int ix = 0; ix < runs; ix++) {
+		ObjMesh mesh;
+		auto start = std::chrono::high_resolution_clock::now();
+		parse(mesh);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		best = ix == 0 ? ms : std::min(best, ms);
+		if (ix == runs - 1) {
+			result = std::move(mesh);
+		}
+	}
+	return best;
+}
+
+int main(int argc, char** argv) {
+	Logger::Init();
+
+	int copies = 256;
+	int runs = 5;
+	std::string source;
+	for (int ix = 1; ix < argc; ix++) {
+		const char* arg = argv[ix];
+		if ((strcmp(arg, "-n") == 0 || strcmp(arg, "--copies") == 0) && ix + 1 < argc) {
+			copies = std::max(atoi(argv[++ix]), 1);
+		} else if ((strcmp(arg, "-r") == 0 || strcmp(arg, "--runs") == 0) && ix + 1 < argc) {
+			runs = std::max(atoi(argv[++ix]), 1);
+		} else if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+			PrintUsage();
+			return 0;
+		} else if (arg[0] == '-') {
+			printf("Unknown option \"%s\"\n", arg);
+			PrintUsage();
+			return 1;
+		} else {
+			source = arg;
+		}
+	}
+	if (source.empty()) {
+		PrintUsage();
+		return 1;
+	}
+
+	std::filesystem::path scaled = std::filesystem::temp_directory_path() /
+		(std::filesystem::path(source).stem().string() + "_x" + std::to_string(copies) + ".obj");
+	if (!WriteScaledFile(source, scaled.string(), copies)) {
+		LOG_WARN("Failed to write scaled up copy of \"{}\"", source);
+		return 1;
+	}
+	double megabytes = std::filesystem::file_size(scaled) / (1024.0 * 1024.0);
+	LOG_INFO("Wrote {} copies of \"{}\" to \"{}\" ({:.1f} MB)", copies, source, scaled.string(), megabytes);
+
+	ObjMesh streamMesh, mappedMesh;
+	double streamMs = TimeParser([&](ObjMesh& mesh) { ObjLoader::ParseStream(scaled.string(), glm::vec4(1.0f), mesh); }, runs, streamMesh);
+	double mappedMs = TimeParser([&](ObjMesh& mesh) { ObjLoader::Parse(scaled.string(), glm::vec4(1.0f), mesh); }, runs, mappedMesh);
+
+	LOG_INFO("ParseStream: {:8.2f} ms ({:.1f} MB/s), {} vertices, {} indices", streamMs, megabytes * 1000.0 / streamMs,
+		streamMesh.GetVertexCount(), streamMesh.GetIndexCount());
+	LOG_INFO("Parse:       {:8.2f} ms ({:.1f} MB/s), {} vertices, {} indices", mappedMs, megabytes * 1000.0 / mappedMs,
+		mappedMesh.GetVertexCount(), mappedMesh.GetIndexCount());
+	LOG_INFO("Speedup: {:.2f}x", streamMs / mappedMs);
+
+	bool identical = streamMesh.GetVertexCount() == mappedMesh.GetVertexCount() &&
+		streamMesh.GetIndexCount() == mappedMesh.GetIndexCount() &&
+		memcmp(streamMesh.GetVertexDataPtr(), mappedMesh.GetVertexDataPtr(), streamMesh.GetVertexCount() * sizeof(VertexPosNormTexCol)) == 0 &&
+		memcmp(streamMesh.GetIndexDataPtr(), mappedMesh.GetIndexDataPtr(), streamMesh.GetIndexCount() * sizeof(uint32_t)) == 0;
+	if (identical) {
+		LOG_INFO("Both parsers produced identical meshes");
+	} else {
+		LOG_WARN("The parsers produced different meshes!");
+	}
+
+	std::error_code error;
+	std::filesystem::remove(scaled, error);
+
+	Logger::Uninitialize();
+	return identical ? 0 : 1;
+}
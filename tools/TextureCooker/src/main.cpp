@@ -0,0 +1,126 @@
+// Command line tool for cooking images ahead of time, so that the game can load them from the texture cache instead of
+// decoding them and building their mips every time it starts. This doesn't need a window or an OpenGL context, so it
+// can be run as part of a build script.
+//
+// Usage: TextureCooker [options] <images or folders...>
+//   -o, --out <folder>  The folder to write cooked textures to (default: cache/textures)
+//   --compress          Block compress images (BC1 for RGB, BC3 for RGBA and BC5 for RG)
+//   --no-mips           Don't build mip chains
+//   --kaiser            Build mip chains with a Kaiser filter instead of a box filter
+//   --lanczos           Build mip chains with a Lanczos filter instead of a box filter
+//   --linear            Treat color channels as linear rather than sRGB when building mips
+//   --no-flip           Store images top row first
+//   --force             Cook images even if the cache already has an up to date copy
+//
+// The game only picks up cooked textures made with the same settings as it's TextureCooker, which uses the defaults
+// above unless it's told otherwise
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <Logging.h>
+#include <TextureCooker.h>
+
+// The extensions of files that Texture2DData::LoadFromFile can load
+static bool IsImageFile(const std::filesystem::path& path) {
+	static const char* extensions[] = { ".png", ".jpg", ".jpeg", ".bmp", ".tga", ".dds", ".ktx2" };
+	std::string extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	for (const char* candidate : extensions) {
+		if (extension == candidate) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void PrintUsage() {
+	printf("Usage: TextureCooker [options] <images or folders...>\n");
+	printf("  -o, --out <folder>  The folder to write cooked textures to (default: %s)\n", TextureCooker::DEFAULT_DIRECTORY);
+	printf("  --compress          Block compress images (BC1 for RGB, BC3 for RGBA and BC5 for RG)\n");
+	printf("  --no-mips           Don't build mip chains\n");
+	printf("  --kaiser            Build mip chains with a Kaiser filter instead of a box filter\n");
+	printf("  --lanczos           Build mip chains with a Lanczos filter instead of a box filter\n");
+	printf("  --linear            Treat color channels as linear rather than sRGB when building mips\n");
+	printf("  --no-flip           Store images top row first\n");
+	printf("  --force             Cook images even if the cache already has an up to date copy\n");
+}
+
+int main(int argc, char** argv) {
+	Logger::Init();
+
+	TextureCooker::Settings settings;
+	std::string directory = TextureCooker::DEFAULT_DIRECTORY;
+	bool force = false;
+	std::vector<std::filesystem::path> inputs;
+
+	for (int ix = 1; ix < argc; ix++) {
+		const char* arg = argv[ix];
+		if ((strcmp(arg, "-o") == 0 || strcmp(arg, "--out") == 0) && ix + 1 < argc) {
+			directory = argv[++ix];
+		} else if (strcmp(arg, "--compress") == 0) {
+			settings.Compress = true;
+		} else if (strcmp(arg, "--no-mips") == 0) {
+			settings.GenerateMips = false;
+		} else if (strcmp(arg, "--kaiser") == 0) {
+			settings.MipFilter = MipFilterType::Kaiser;
+		} else if (strcmp(arg, "--lanczos") == 0) {
+			settings.MipFilter = MipFilterType::Lanczos;
+		} else if (strcmp(arg, "--linear") == 0) {
+			settings.SRGB = false;
+		} else if (strcmp(arg, "--no-flip") == 0) {
+			settings.FlipVertically = false;
+		} else if (strcmp(arg, "--force") == 0) {
+			force = true;
+		} else if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+			PrintUsage();
+			return 0;
+		} else if (arg[0] == '-') {
+			printf("Unknown option \"%s\"\n", arg);
+			PrintUsage();
+			return 1;
+		} else {
+			inputs.push_back(arg);
+		}
+	}
+	if (inputs.empty()) {
+		PrintUsage();
+		return 1;
+	}
+
+	// Expand folders into every image inside of them
+	std::vector<std::string> files;
+	for (const std::filesystem::path& input : inputs) {
+		std::error_code error;
+		if (std::filesystem::is_directory(input, error)) {
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(input, error)) {
+				if (entry.is_regular_file() && IsImageFile(entry.path())) {
+					files.push_back(entry.path().string());
+				}
+			}
+		} else {
+			files.push_back(input.string());
+		}
+	}
+
+	TextureCooker::sptr cooker = TextureCooker::Create(directory, settings);
+	size_t failed = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	// Each image is split across all the cores while it's cooked, so we only cook one at a time
+	for (const std::string& file : files) {
+		if (cooker->Cook(file, force)) {
+			LOG_INFO("Cooked \"{}\"", file);
+		} else {
+			LOG_WARN("Failed to cook \"{}\"", file);
+			failed++;
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	LOG_INFO("Cooked {} of {} images into \"{}\" in {:.2f}s", files.size() - failed, files.size(), directory, seconds);
+
+	Logger::Uninitialize();
+	return failed == 0 ? 0 : 1;
+}